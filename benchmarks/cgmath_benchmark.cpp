@@ -0,0 +1,687 @@
+// Prints the SIMD path cgmath selected and the time per operation for every path the CPU supports, to track regressions.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tt_animation.h"
+#include "tt_bvh.h"
+#include "tt_cgmath.h"
+#include "tt_cgmath_wide.h"
+#include "tt_frustum.h"
+#include "tt_math.h"
+#include "tt_mesh_processing.h"
+#include "tt_packing.h"
+#include "tt_skinning.h"
+#include "tt_transform_hierarchy.h"
+
+using namespace TT;
+
+namespace {
+	const size_t COUNT = 1024;
+	volatile float sink;
+
+	// The fastest of several short runs, which filters out interruptions.
+	template<typename F> double nsPerOp(F&& f, size_t opsPerCall) {
+		using Clock = std::chrono::steady_clock;
+		f();
+		double best = 1e30;
+		for (int run = 0; run < 30; ++run) {
+			size_t calls = 0;
+			auto start = Clock::now();
+			std::chrono::duration<double, std::nano> elapsed;
+			do {
+				f();
+				++calls;
+				elapsed = Clock::now() - start;
+			} while (elapsed.count() < 5e6);
+			best = std::min(best, elapsed.count() / (double)(calls * opsPerCall));
+		}
+		return best;
+	}
+
+	// Mat44::TRS as it was built before the closed form, from three axis rotations and a scale matrix.
+	Mat44 composedTRS(Vec translate, Vec radians, Vec scale, ERotateOrder order) {
+		Mat44 rotations[3] = { Mat44::rotateX(radians.x), Mat44::rotateY(radians.y), Mat44::rotateZ(radians.z) };
+		Mat44 r = Mat44::scale(scale.x, scale.y, scale.z) * (rotations[((int)order >> 4) & 0b11] * rotations[((int)order >> 2) & 0b11] * rotations[(int)order & 0b11]);
+		r.m[12] = translate.x;
+		r.m[13] = translate.y;
+		r.m[14] = translate.z;
+		return r;
+	}
+
+	// Gauss-Jordan with partial pivoting in double, as the reference for the float inverses.
+	void inverseDouble(const Mat44& in, double out[16]) {
+		double a[4][8];
+		for (int r = 0; r < 4; ++r) {
+			for (int c = 0; c < 4; ++c) {
+				a[r][c] = in.m[c * 4 + r];
+				a[r][c + 4] = r == c ? 1.0 : 0.0;
+			}
+		}
+		for (int c = 0; c < 4; ++c) {
+			int pivot = c;
+			for (int r = c + 1; r < 4; ++r)
+				if (fabs(a[r][c]) > fabs(a[pivot][c]))
+					pivot = r;
+			std::swap(a[c], a[pivot]);
+			for (int r = 0; r < 4; ++r) {
+				if (r == c)
+					continue;
+				double f = a[r][c] / a[c][c];
+				for (int k = 0; k < 8; ++k)
+					a[r][k] -= f * a[c][k];
+			}
+		}
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				out[c * 4 + r] = a[r][c + 4] / a[r][r];
+	}
+
+	// The largest difference to the double inverse, relative to the inverse's largest element.
+	float inverseError(const std::vector<Mat44>& a, const std::vector<Mat44>& inverses) {
+		double e = 0.0;
+		for (size_t n = 0; n < a.size(); ++n) {
+			double reference[16];
+			inverseDouble(a[n], reference);
+			double difference = 0.0, largest = 0.0;
+			for (int i = 0; i < 16; ++i) {
+				difference = std::max(difference, fabs(reference[i] - inverses[n].m[i]));
+				largest = std::max(largest, fabs(reference[i]));
+			}
+			e = std::max(e, difference / largest);
+		}
+		return (float)e;
+	}
+
+	// Möller-Trumbore against every triangle, the reference for the BVH.
+	RayHit bruteIntersect(const std::vector<Vec>& vertices, const Ray& ray) {
+		RayHit hit;
+		for (size_t t = 0; t < vertices.size() / 3; ++t) {
+			Vec3 v0 = vertices[t * 3], e1 = vertices[t * 3 + 1] - v0, e2 = vertices[t * 3 + 2] - v0;
+			Vec3 p = Vec3(ray.direction).cross(e2);
+			float det = e1.dot(p).x;
+			if (fabsf(det) < 1e-12f)
+				continue;
+			Vec3 s = ray.origin - v0;
+			float u = s.dot(p).x / det;
+			Vec3 q = s.cross(e1);
+			float v = ray.direction.dot(q).x / det;
+			float distance = e2.dot(q).x / det;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < hit.distance)
+				hit = { distance, (unsigned int)t, u, v };
+		}
+		return hit;
+	}
+
+	// The largest error against the double precision function in units in the last place of the float result, over samples spread evenly in [low, high].
+	template<typename F, typename R> double maxUlp(F f, R reference, float low, float high) {
+		const size_t SAMPLES = 1 << 18;
+		std::vector<float> in(SAMPLES), out(SAMPLES);
+		for (size_t i = 0; i < SAMPLES; ++i)
+			in[i] = low + (high - low) * ((float)i + 0.5f) / SAMPLES;
+		f(in.data(), out.data(), SAMPLES);
+		double e = 0.0;
+		for (size_t i = 0; i < SAMPLES; ++i) {
+			double r = reference((double)in[i]);
+			float rf = fabsf((float)r);
+			e = std::max(e, fabs(out[i] - r) / (double)(std::nextafter(rf, INFINITY) - rf));
+		}
+		return e;
+	}
+
+	float maxDifference(const Mat44& a, const Mat44& b) {
+		float d = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			d = std::max(d, fabsf(a.m[i] - b.m[i]));
+		return d;
+	}
+}
+
+int main() {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+	std::vector<Mat44> a(COUNT), b(COUNT), out(COUNT);
+	std::vector<Vec> v(COUNT), vOut(COUNT);
+	std::vector<Vec3> points(COUNT), pointsOut(COUNT);
+	std::vector<float> x(COUNT), y(COUNT), z(COUNT), outX(COUNT), outY(COUNT), outZ(COUNT);
+	std::vector<float> angles(COUNT), positive(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		a[i] = Mat44::TRS(random(rng), random(rng), random(rng), random(rng), random(rng), random(rng), 1.0f + random(rng) * 0.5f, 1.0f, 1.0f);
+		b[i] = Mat44::TRS(random(rng), random(rng), random(rng), random(rng), random(rng), random(rng));
+		v[i] = Vec(random(rng), random(rng), random(rng), random(rng));
+		angles[i] = random(rng) * 10.0f;
+		positive[i] = std::exp2(random(rng) * 20.0f);
+		points[i] = Vec3(random(rng), random(rng), random(rng));
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+	}
+
+	std::vector<Quat> q(COUNT), qOut(COUNT);
+	std::vector<Vec> scales(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		q[i] = Quat::euler(v[i]);
+		scales[i] = Vec(1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 0.0f);
+	}
+
+	// The closed form TRS and decompose() against the composed matrices, for every rotate order. Every tenth angle sits in gimbal lock.
+	float trsError = 0.0f, decomposeError = 0.0f;
+	for (ERotateOrder order : { ERotateOrder::XYZ, ERotateOrder::XZY, ERotateOrder::YXZ, ERotateOrder::YZX, ERotateOrder::ZXY, ERotateOrder::ZYX }) {
+		for (size_t i = 0; i < COUNT; ++i) {
+			Vec radians = v[i] * 3.0f;
+			if (i % 10 == 0)
+				radians[((int)order >> 2) & 0b11] = i % 20 == 0 ? PI * 0.5f : -PI * 0.5f;
+			Mat44 m = Mat44::TRS(v[COUNT - 1 - i], radians, scales[i], order);
+			trsError = std::max(trsError, maxDifference(m, composedTRS(v[COUNT - 1 - i], radians, scales[i], order)));
+			Vec translate, angles, scale;
+			m.decompose(translate, angles, scale, order);
+			decomposeError = std::max(decomposeError, maxDifference(m, Mat44::TRS(translate, angles, scale, order)));
+		}
+	}
+	printf("closed form TRS max error %g, TRS(decompose(m)) max error %g\n", trsError, decomposeError);
+
+	// Rigid matrices for inverseRigid and projective ones (view projections) for the general inverse, a is affine.
+	std::vector<Mat44> rigid(COUNT), projective(COUNT), inverses(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		rigid[i] = Mat44::TRS(v[i] * 10.0f, v[COUNT - 1 - i] * 3.0f, Vec(1.0f));
+		projective[i] = rigid[i] * Mat44::perspectiveY(1.0f + random(rng) * 0.5f, 1.5f, 0.1f, 1000.0f);
+	}
+
+	// A scene of 200k spheres and boxes, about a quarter of which are in view.
+	const size_t VOLUMES = 200000;
+	std::uniform_real_distribution<float> scene(-500.0f, 500.0f), size(0.5f, 5.0f);
+	std::vector<float> cx(VOLUMES), cy(VOLUMES), cz(VOLUMES), ex(VOLUMES), ey(VOLUMES), ez(VOLUMES);
+	for (size_t i = 0; i < VOLUMES; ++i) {
+		cx[i] = scene(rng);
+		cy[i] = scene(rng) * 0.1f;
+		cz[i] = scene(rng);
+		ex[i] = size(rng);
+		ey[i] = size(rng);
+		ez[i] = size(rng);
+	}
+	Frustum frustum(Mat44::translate(-10.0f, -5.0f, 20.0f) * Mat44::rotateY(0.3f) * Mat44::perspectiveY(1.2f, 16.0f / 9.0f, 0.1f, 1000.0f));
+	std::vector<unsigned int> visibleBits((VOLUMES + 31) / 32), visibleIndices(VOLUMES), expectedIndices;
+	std::vector<unsigned char> sphereVisible(VOLUMES), boxVisible(VOLUMES);
+	for (size_t i = 0; i < VOLUMES; ++i) {
+		sphereVisible[i] = frustum.isSphereVisible(Vec(cx[i], cy[i], cz[i], 0.0f), ex[i]);
+		boxVisible[i] = frustum.isBoxVisible(Vec(cx[i], cy[i], cz[i], 0.0f), Vec(ex[i], ey[i], ez[i], 0.0f));
+	}
+	// Differences to the scalar test, only possible for volumes touching a plane within rounding.
+	auto cullMismatches = [&](const std::vector<unsigned char>& expected, size_t visible) {
+		size_t mismatches = 0, n = 0;
+		for (size_t i = 0; i < VOLUMES; ++i) {
+			bool bit = (visibleBits[i / 32] >> (i % 32)) & 1;
+			mismatches += bit != (bool)expected[i];
+			if (bit)
+				mismatches += n >= visible || visibleIndices[n++] != i;
+		}
+		return mismatches + (n != visible);
+	};
+
+	// Values for the packing round trips: unit floats for unorm8 and unit vectors for octahedral16, x is in [-1, 1].
+	std::vector<float> unit(COUNT);
+	std::vector<Vec3> normals(COUNT), normalsOut(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		unit[i] = x[i] * 0.5f + 0.5f;
+		normals[i] = points[i].normalized();
+	}
+	std::vector<f16> halves(COUNT);
+	std::vector<snorm16> snorms(COUNT);
+	std::vector<unorm8> unorms(COUNT);
+	std::vector<octahedral16> octahedrals(COUNT);
+	auto maxAbsError = [&](const std::vector<float>& expected) {
+		float e = 0.0f;
+		for (size_t i = 0; i < COUNT; ++i)
+			e = std::max(e, fabsf(outX[i] - expected[i]));
+		return e;
+	};
+
+	ESimdPath selected = simdPath();
+	printf("selected path: %s\n", simdPathName(selected));
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("\n%s: not supported\n", simdPathName(path));
+			continue;
+		}
+		printf("\n%s\n", simdPathName(path));
+		auto error = [&](const std::vector<Mat44>& m, auto inverse) {
+			for (size_t i = 0; i < COUNT; ++i)
+				inverses[i] = inverse(m[i]);
+			return inverseError(m, inverses);
+		};
+		auto fast = [](const Mat44& m) { return m.inversed(); };
+		auto precise = [](const Mat44& m) { return m.inversed(EInversePrecision::Precise); };
+		auto affine = [](const Mat44& m) { return m.inversedAffine(); };
+		auto rigidInverse = [](const Mat44& m) { return m.inversedRigid(); };
+		printf("  inverse error        fast      precise   affine    rigid\n");
+		printf("  projective           %-9.3g %-9.3g\n", error(projective, fast), error(projective, precise));
+		printf("  affine               %-9.3g %-9.3g %-9.3g\n", error(a, fast), error(a, precise), error(a, affine));
+		printf("  rigid                %-9.3g %-9.3g %-9.3g %-9.3g\n", error(rigid, fast), error(rigid, precise), error(rigid, affine), error(rigid, rigidInverse));
+		auto sinArray = [](const float* in, float* out, size_t n) { TT::sin(in, out, n); };
+		auto expArray = [](const float* in, float* out, size_t n) { TT::exp(in, out, n); };
+		auto logArray = [](const float* in, float* out, size_t n) { TT::log(in, out, n); };
+		auto atanArray = [](const float* in, float* out, size_t n) { std::vector<float> ones(n, 1.0f); TT::atan2(in, ones.data(), out, n); };
+		printf("  max ulp: sin %.2f (|a| < pi) %.2f (|a| < 8192), exp %.2f, log %.2f, atan2 %.2f\n",
+			maxUlp(sinArray, [](double a) { return std::sin(a); }, -3.14159f, 3.14159f),
+			maxUlp(sinArray, [](double a) { return std::sin(a); }, -8192.0f, 8192.0f),
+			maxUlp(expArray, [](double a) { return std::exp(a); }, -100.0f, 88.0f),
+			maxUlp(logArray, [](double a) { return std::log(a); }, 1e-30f, 1e30f),
+			maxUlp(atanArray, [](double a) { return std::atan2(a, 1.0); }, -100.0f, 100.0f));
+		pack(x.data(), halves.data(), COUNT);
+		unpack(halves.data(), outX.data(), COUNT);
+		float halfError = 0.0f;
+		for (size_t i = 0; i < COUNT; ++i)
+			if (fabsf(x[i]) >= 6.1035156e-5f)
+				halfError = std::max(halfError, fabsf(outX[i] - x[i]) / fabsf(x[i]));
+		pack(x.data(), snorms.data(), COUNT);
+		unpack(snorms.data(), outX.data(), COUNT);
+		float snormError = maxAbsError(x);
+		pack(unit.data(), unorms.data(), COUNT);
+		unpack(unorms.data(), outX.data(), COUNT);
+		float unormError = maxAbsError(unit);
+		pack(normals.data(), octahedrals.data(), COUNT);
+		unpack(octahedrals.data(), normalsOut.data(), COUNT);
+		double octahedralError = 0.0;
+		for (size_t i = 0; i < COUNT; ++i) {
+			const Vec3& n = normals[i];
+			const Vec3& o = normalsOut[i];
+			double ax = (double)n.y * o.z - (double)n.z * o.y, ay = (double)n.z * o.x - (double)n.x * o.z, az = (double)n.x * o.y - (double)n.y * o.x;
+			double dot = (double)n.x * o.x + (double)n.y * o.y + (double)n.z * o.z;
+			octahedralError = std::max(octahedralError, std::atan2(std::sqrt(ax * ax + ay * ay + az * az), dot) * 180.0 / 3.141592653589793);
+		}
+		printf("  packing error: f16 %.3g relative, snorm16 %.3g, unorm8 %.3g, octahedral16 %.3g degrees\n", halfError, snormError, unormError, octahedralError);
+		size_t visibleSpheres = frustum.cullSpheres(cx.data(), cy.data(), cz.data(), ex.data(), VOLUMES, visibleBits.data(), visibleIndices.data());
+		size_t sphereMismatches = cullMismatches(sphereVisible, visibleSpheres);
+		size_t visibleBoxes = frustum.cullBoxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), VOLUMES, visibleBits.data(), visibleIndices.data());
+		printf("  cull visible / mismatches: spheres %zu / %zu, boxes %zu / %zu\n", visibleSpheres, sphereMismatches, visibleBoxes, cullMismatches(boxVisible, visibleBoxes));
+		printf("  (ns per op)\n");
+		printf("  Mat44 * Mat44        %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = a[i] * b[i]; }, COUNT));
+		printf("  Mat44 *= Mat44       %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] *= b[i]; }, COUNT));
+		printf("  Mat44::inversed      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = a[i].inversed(); }, COUNT));
+		printf("  inversed Precise     %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = a[i].inversed(EInversePrecision::Precise); }, COUNT));
+		printf("  inversedAffine       %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = a[i].inversedAffine(); }, COUNT));
+		printf("  inversedRigid        %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = rigid[i].inversedRigid(); }, COUNT));
+		printf("  inverse array        %6.2f\n", nsPerOp([&] { Mat44::inverse(a.data(), out.data(), COUNT); }, COUNT));
+		printf("  inverseAffine array  %6.2f\n", nsPerOp([&] { Mat44::inverseAffine(a.data(), out.data(), COUNT); }, COUNT));
+		printf("  inverseRigid array   %6.2f\n", nsPerOp([&] { Mat44::inverseRigid(rigid.data(), out.data(), COUNT); }, COUNT));
+		printf("  Mat44::transposed    %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = a[i].transposed(); }, COUNT));
+		printf("  Mat44::TRS           %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = Mat44::TRS(v[i], v[COUNT - 1 - i], Vec(1.0f)); }, COUNT));
+		printf("  composed TRS         %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = composedTRS(v[i], v[COUNT - 1 - i], Vec(1.0f), ERotateOrder::YXZ); }, COUNT));
+		printf("  Mat44::TRS Quat      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = Mat44::TRS(v[i], q[i], Vec(1.0f)); }, COUNT));
+		printf("  Mat44::decompose     %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) a[i].decompose(vOut[i], qOut[i], vOut[COUNT - 1 - i]); }, COUNT));
+		printf("  Quat * Quat          %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) qOut[i] = q[i] * q[COUNT - 1 - i]; }, COUNT));
+		printf("  Quat::slerp          %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) qOut[i] = Quat::slerp(q[i], q[COUNT - 1 - i], 0.3f); }, COUNT));
+		printf("  Quat::nlerp          %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) qOut[i] = Quat::nlerp(q[i], q[COUNT - 1 - i], 0.3f); }, COUNT));
+		printf("  Quat::toMat44        %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) out[i] = q[i].toMat44(); }, COUNT));
+		printf("  Quat::fromMat44      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) qOut[i] = Quat::fromMat44(b[i]); }, COUNT));
+		printf("  scalar sphere cull   %6.2f\n", nsPerOp([&] {
+			size_t n = 0;
+			for (size_t i = 0; i < VOLUMES; ++i) {
+				visibleIndices[n] = (unsigned int)i;
+				n += frustum.isSphereVisible(Vec(cx[i], cy[i], cz[i], 0.0f), ex[i]);
+			}
+		}, VOLUMES));
+		printf("  cullSpheres bits     %6.2f\n", nsPerOp([&] { frustum.cullSpheres(cx.data(), cy.data(), cz.data(), ex.data(), VOLUMES, visibleBits.data()); }, VOLUMES));
+		printf("  cullSpheres indices  %6.2f\n", nsPerOp([&] { frustum.cullSpheres(cx.data(), cy.data(), cz.data(), ex.data(), VOLUMES, nullptr, visibleIndices.data()); }, VOLUMES));
+		printf("  scalar box cull      %6.2f\n", nsPerOp([&] {
+			size_t n = 0;
+			for (size_t i = 0; i < VOLUMES; ++i) {
+				visibleIndices[n] = (unsigned int)i;
+				n += frustum.isBoxVisible(Vec(cx[i], cy[i], cz[i], 0.0f), Vec(ex[i], ey[i], ez[i], 0.0f));
+			}
+		}, VOLUMES));
+		printf("  cullBoxes bits       %6.2f\n", nsPerOp([&] { frustum.cullBoxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), VOLUMES, visibleBits.data()); }, VOLUMES));
+		printf("  cullBoxes indices    %6.2f\n", nsPerOp([&] { frustum.cullBoxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), VOLUMES, nullptr, visibleIndices.data()); }, VOLUMES));
+		printf("  sinf                 %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) outX[i] = sinf(angles[i]); }, COUNT));
+		printf("  TT::sin array        %6.2f\n", nsPerOp([&] { TT::sin(angles.data(), outX.data(), COUNT); }, COUNT));
+		printf("  TT::sincos array     %6.2f\n", nsPerOp([&] { TT::sincos(angles.data(), outX.data(), outY.data(), COUNT); }, COUNT));
+		printf("  TT::sin(Vec)         %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = TT::sin(v[i]); }, COUNT));
+		printf("  TT::sincos(Vec)      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) TT::sincos(v[i], vOut[i], vOut[COUNT - 1 - i]); }, COUNT));
+		printf("  expf                 %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) outX[i] = expf(angles[i]); }, COUNT));
+		printf("  TT::exp array        %6.2f\n", nsPerOp([&] { TT::exp(angles.data(), outX.data(), COUNT); }, COUNT));
+		printf("  TT::exp(Vec)         %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = TT::exp(v[i]); }, COUNT));
+		printf("  logf                 %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) outX[i] = logf(positive[i]); }, COUNT));
+		printf("  TT::log array        %6.2f\n", nsPerOp([&] { TT::log(positive.data(), outX.data(), COUNT); }, COUNT));
+		printf("  TT::log(Vec)         %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = TT::log(v[i]); }, COUNT));
+		printf("  atan2f               %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) outX[i] = atan2f(angles[i], x[i]); }, COUNT));
+		printf("  TT::atan2 array      %6.2f\n", nsPerOp([&] { TT::atan2(angles.data(), x.data(), outX.data(), COUNT); }, COUNT));
+		printf("  TT::atan2(Vec)       %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = TT::atan2(v[i], v[COUNT - 1 - i]); }, COUNT));
+		printf("  memcpy floats        %6.2f\n", nsPerOp([&] { memcpy(outX.data(), x.data(), COUNT * sizeof(float)); }, COUNT));
+		printf("  pack f16             %6.2f\n", nsPerOp([&] { pack(x.data(), halves.data(), COUNT); }, COUNT));
+		printf("  unpack f16           %6.2f\n", nsPerOp([&] { unpack(halves.data(), outX.data(), COUNT); }, COUNT));
+		printf("  pack snorm16         %6.2f\n", nsPerOp([&] { pack(x.data(), snorms.data(), COUNT); }, COUNT));
+		printf("  unpack snorm16       %6.2f\n", nsPerOp([&] { unpack(snorms.data(), outX.data(), COUNT); }, COUNT));
+		printf("  pack unorm8          %6.2f\n", nsPerOp([&] { pack(unit.data(), unorms.data(), COUNT); }, COUNT));
+		printf("  unpack unorm8        %6.2f\n", nsPerOp([&] { unpack(unorms.data(), outX.data(), COUNT); }, COUNT));
+		printf("  pack octahedral16    %6.2f\n", nsPerOp([&] { pack(normals.data(), octahedrals.data(), COUNT); }, COUNT));
+		printf("  unpack octahedral16  %6.2f\n", nsPerOp([&] { unpack(octahedrals.data(), normalsOut.data(), COUNT); }, COUNT));
+		printf("  Mat44 * Vec4         %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = a[i] * Vec4(v[i]); }, COUNT));
+		printf("  Vec + Vec            %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i] + v[COUNT - 1 - i]; }, COUNT));
+		printf("  Vec * Vec            %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i] * v[COUNT - 1 - i]; }, COUNT));
+		printf("  Vec::dot             %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i].dot(v[COUNT - 1 - i]); }, COUNT));
+		printf("  Vec::len             %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i].len(); }, COUNT));
+		printf("  Vec::normalized      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i].normalized(); }, COUNT));
+		printf("  Vec %% Vec            %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = v[i] % v[COUNT - 1 - i]; }, COUNT));
+		printf("  floor(Vec)           %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) vOut[i] = TT::floor(v[i]); }, COUNT));
+		printf("  transformPoints Vec3 %6.2f\n", nsPerOp([&] { a[0].transformPoints(points.data(), pointsOut.data(), COUNT); }, COUNT));
+		printf("  transformPoints xyz  %6.2f\n", nsPerOp([&] { a[0].transformPoints(x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), COUNT); }, COUNT));
+		sink = out[COUNT / 2].m[5] + vOut[COUNT / 2].x + pointsOut[COUNT / 2].y + outZ[COUNT / 2] + qOut[COUNT / 2].w;
+	}
+	setSimdPath(selected);
+
+	// Cross products and normalization of Vec3 arrays, with Vec per element or as SoA wide vectors loaded from and stored to the same arrays.
+	std::vector<Vec3> others(points.rbegin(), points.rend());
+	float wideError = 0.0f;
+	for (size_t i = 0; i < COUNT; i += Vec3xN::WIDTH)
+		Vec3xN::load(&points[i]).cross(Vec3xN::load(&others[i])).store(&pointsOut[i]);
+	for (size_t i = 0; i < COUNT; ++i) {
+		Vec3 expected = points[i].cross(others[i]);
+		wideError = std::max(wideError, fabsf(expected.x - pointsOut[i].x) + fabsf(expected.y - pointsOut[i].y) + fabsf(expected.z - pointsOut[i].z));
+	}
+	printf("\nVec3x%zu, cross error %g\n", Vec3xN::WIDTH, wideError);
+	printf("  (ns per vector)\n");
+	printf("  Vec3::cross          %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) pointsOut[i] = points[i].cross(others[i]); }, COUNT));
+	printf("  Vec3x4 cross         %6.2f\n", nsPerOp([&] {
+		for (size_t i = 0; i < COUNT; i += 4)
+			Vec3x4::load(&points[i]).cross(Vec3x4::load(&others[i])).store(&pointsOut[i]);
+	}, COUNT));
+	printf("  Vec3x4 cross xyz     %6.2f\n", nsPerOp([&] {
+		for (size_t i = 0; i < COUNT; i += 4)
+			Vec3x4::load(&x[i], &y[i], &z[i]).cross(Vec3x4::load(&z[i], &x[i], &y[i])).store(&outX[i], &outY[i], &outZ[i]);
+	}, COUNT));
+	printf("  Vec::normalized      %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; ++i) pointsOut[i] = points[i].normalized(); }, COUNT));
+	printf("  Vec3x4 normalized    %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; i += 4) Vec3x4::load(&points[i]).normalized().store(&pointsOut[i]); }, COUNT));
+#ifdef __AVX__
+	printf("  Vec3x8 cross         %6.2f\n", nsPerOp([&] {
+		for (size_t i = 0; i < COUNT; i += 8)
+			Vec3x8::load(&points[i]).cross(Vec3x8::load(&others[i])).store(&pointsOut[i]);
+	}, COUNT));
+	printf("  Vec3x8 normalized    %6.2f\n", nsPerOp([&] { for (size_t i = 0; i < COUNT; i += 8) Vec3x8::load(&points[i]).normalized().store(&pointsOut[i]); }, COUNT));
+#endif
+
+	// BVH over scattered small triangles, rays from a camera looking over them. The traversal does not depend on the SIMD path.
+	const size_t TRIANGLES = 1 << 20;
+	std::uniform_real_distribution<float> area(-200.0f, 200.0f), jitter(-0.5f, 0.5f);
+	std::vector<Vec> vertices(TRIANGLES * 3);
+	for (size_t i = 0; i < TRIANGLES; ++i) {
+		Vec center(area(rng), area(rng) * 0.1f, area(rng), 0.0f);
+		for (size_t k = 0; k < 3; ++k)
+			vertices[i * 3 + k] = Vec(center.x + jitter(rng), center.y + jitter(rng), center.z + jitter(rng), 0.0f);
+	}
+	BVH bvh;
+	auto buildStart = std::chrono::steady_clock::now();
+	bvh.buildTriangles(vertices.data(), nullptr, TRIANGLES);
+	double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	Mat44 camera = Mat44::rotateX(-0.5f) * Mat44::translate(0.0f, 100.0f, 250.0f);
+	Mat44 projection = Mat44::perspectiveY(1.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+	std::vector<Ray> rays;
+	for (int y = 0; y < 480; y += 8)
+		for (int x = 0; x < 640; x += 8)
+			for (int k = 0; k < 4; ++k)
+				rays.push_back(Ray::fromPixel((float)(x + (k & 1)), (float)(y + (k >> 1)), 640.0f, 480.0f, camera, projection));
+	std::vector<RayHit> hits(rays.size());
+	bvh.intersect(rays.data(), hits.data(), rays.size());
+	// Packets against single rays, and single rays against testing every triangle for a few rays.
+	size_t hitCount = 0, mismatches = 0;
+	for (size_t i = 0; i < rays.size(); ++i) {
+		RayHit single = bvh.intersect(rays[i]);
+		hitCount += single.hit();
+		mismatches += single.primitive != hits[i].primitive;
+	}
+	// Testing every triangle takes far too long to time repeatedly.
+	const size_t BRUTE_RAYS = 16;
+	auto bruteStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < BRUTE_RAYS; ++i) {
+		const Ray& ray = rays[i * rays.size() / BRUTE_RAYS];
+		RayHit brute = bruteIntersect(vertices, ray), single = bvh.intersect(ray);
+		mismatches += brute.primitive != single.primitive && fabsf(brute.distance - single.distance) > 1e-4f * brute.distance;
+	}
+	double bruteNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - bruteStart).count() / BRUTE_RAYS;
+	printf("\nBVH, %zu triangles\n", TRIANGLES);
+	printf("  build %.0f ms, %zu nodes, %zu / %zu rays hit, %zu mismatches\n", buildMs, bvh.nodeCount(), hitCount, rays.size(), mismatches);
+	printf("  (ns per ray)\n");
+	printf("  brute force          %6.0f\n", bruteNs);
+	printf("  single ray           %6.0f\n", nsPerOp([&] { for (const Ray& ray : rays) hits[0] = bvh.intersect(ray); }, rays.size()));
+	printf("  packets of 4         %6.0f\n", nsPerOp([&] { bvh.intersect(rays.data(), hits.data(), rays.size()); }, rays.size()));
+
+	// 10k animated nodes, translation and scale keyed at 30 per second, rotation at 20 uneven times, played back at 60 fps.
+	const size_t TRACKS = 10000, KEYS = 30, ROTATION_KEYS = 20;
+	std::vector<float> keyTimes(KEYS), rotationTimes(TRACKS * ROTATION_KEYS);
+	std::vector<Vec3> translationKeys(TRACKS * KEYS), scaleKeys(TRACKS * KEYS);
+	std::vector<Quat> rotationKeys(TRACKS * ROTATION_KEYS);
+	for (size_t k = 0; k < KEYS; ++k)
+		keyTimes[k] = (float)k / 30.0f;
+	AnimationClip clip;
+	TransformHierarchy animated;
+	animated.reserve(TRACKS);
+	for (size_t t = 0; t < TRACKS; ++t) {
+		for (size_t k = 0; k < KEYS; ++k) {
+			translationKeys[t * KEYS + k] = Vec3(random(rng), random(rng), random(rng)) * 10.0f;
+			scaleKeys[t * KEYS + k] = Vec3(1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f);
+		}
+		for (size_t k = 0; k < ROTATION_KEYS; ++k) {
+			rotationTimes[t * ROTATION_KEYS + k] = ((float)k + random(rng) * 0.4f) / 20.0f;
+			rotationKeys[t * ROTATION_KEYS + k] = Quat::euler(Vec(random(rng), random(rng), random(rng), 0.0f) * 3.0f);
+		}
+		unsigned int track = clip.addTrack(animated.add(t ? (unsigned int)(t - 1) / 4 : TransformHierarchy::NO_PARENT));
+		clip.setTranslations(track, keyTimes.data(), &translationKeys[t * KEYS], KEYS);
+		clip.setRotations(track, &rotationTimes[t * ROTATION_KEYS], &rotationKeys[t * ROTATION_KEYS], ROTATION_KEYS);
+		clip.setScales(track, keyTimes.data(), &scaleKeys[t * KEYS], KEYS);
+	}
+	// The reference: a binary search per channel, then lerp, Quat::slerp and Mat44::TRS per node.
+	auto scalarSample = [&](float time, Mat44* locals) {
+		auto find = [time](const float* times, size_t count, float& weight) {
+			size_t k = std::upper_bound(times, times + count, time) - times;
+			k = k ? k - 1 : 0;
+			size_t next = std::min(k + 1, count - 1);
+			weight = next != k ? std::clamp((time - times[k]) / (times[next] - times[k]), 0.0f, 1.0f) : 0.0f;
+			return k;
+		};
+		for (size_t t = 0; t < TRACKS; ++t) {
+			float w, rw;
+			size_t k = t * KEYS + find(keyTimes.data(), KEYS, w);
+			size_t r = t * ROTATION_KEYS + find(&rotationTimes[t * ROTATION_KEYS], ROTATION_KEYS, rw);
+			size_t kn = std::min(k + 1, t * KEYS + KEYS - 1), rn = std::min(r + 1, t * ROTATION_KEYS + ROTATION_KEYS - 1);
+			locals[t] = Mat44::TRS(lerp<Vec>(translationKeys[k], translationKeys[kn], w), Quat::slerp(rotationKeys[r], rotationKeys[rn], rw), lerp<Vec>(scaleKeys[k], scaleKeys[kn], w));
+		}
+	};
+	std::vector<Mat44> animatedLocals(TRACKS), referenceLocals(TRACKS);
+	AnimationCursor cursor;
+	float clock = 0.0f;
+	auto nextFrame = [&] {
+		clock += 1.0f / 60.0f;
+		if (clock > clip.duration())
+			clock -= clip.duration();
+		return clock;
+	};
+	printf("\nAnimation, %zu tracks\n", TRACKS);
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path))
+			continue;
+		float animationError = 0.0f;
+		for (float time = -0.1f; time < clip.duration() + 0.1f; time += 0.0137f) {
+			clip.sample(time, cursor, animatedLocals.data());
+			scalarSample(time, referenceLocals.data());
+			for (size_t t = 0; t < TRACKS; ++t)
+				animationError = std::max(animationError, maxDifference(animatedLocals[t], referenceLocals[t]));
+		}
+		printf("  %s, max difference to the reference %g\n", simdPathName(path), animationError);
+		printf("  (ns per track)\n");
+		printf("  scalar reference     %6.2f\n", nsPerOp([&] { scalarSample(nextFrame(), referenceLocals.data()); }, TRACKS));
+		printf("  sample to Mat44      %6.2f\n", nsPerOp([&] { clip.sample(nextFrame(), cursor, animatedLocals.data()); }, TRACKS));
+		printf("  sample to hierarchy  %6.2f\n", nsPerOp([&] { clip.sample(nextFrame(), cursor, animated); }, TRACKS));
+		printf("  sample + update      %6.2f\n", nsPerOp([&] { clip.sample(nextFrame(), cursor, animated); animated.update(); }, TRACKS));
+	}
+	setSimdPath(selected);
+
+	// A 100k vertex mesh on 64 joints, 1 to 4 influences per vertex.
+	const size_t VERTICES = 100000, JOINTS = 64;
+	std::vector<Mat44> palette(JOINTS);
+	for (Mat44& joint : palette)
+		joint = Mat44::TRS(Vec(random(rng), random(rng), random(rng), 0.0f) * 5.0f, Vec(random(rng), random(rng), random(rng), 0.0f) * 3.0f, Vec(1.0f + random(rng) * 0.2f));
+	std::vector<u16> joints(VERTICES * 4);
+	std::vector<float> weights(VERTICES * 4);
+	std::vector<Vec3> skinPositions(VERTICES), skinNormals(VERTICES), skinnedPositions(VERTICES), skinnedNormals(VERTICES), expectedPositions(VERTICES), expectedNormals(VERTICES);
+	std::uniform_int_distribution<int> jointIndex(0, (int)JOINTS - 1), influences(1, 4);
+	for (size_t i = 0; i < VERTICES; ++i) {
+		skinPositions[i] = Vec3(random(rng), random(rng), random(rng)) * 10.0f;
+		skinNormals[i] = Vec3(random(rng), random(rng), random(rng)).normalized();
+		int used = influences(rng);
+		float sum = 0.0f;
+		for (int k = 0; k < 4; ++k) {
+			joints[i * 4 + k] = k < used ? (u16)jointIndex(rng) : 0;
+			weights[i * 4 + k] = k < used ? random(rng) * 0.5f + 0.5f : 0.0f;
+			sum += weights[i * 4 + k];
+		}
+		for (int k = 0; k < 4; ++k)
+			weights[i * 4 + k] /= sum;
+	}
+	std::vector<float> skinStreams(VERTICES * 12);
+	const float* streamsIn[6];
+	float* streamsOut[6];
+	for (int c = 0; c < 6; ++c) {
+		float* stream = &skinStreams[VERTICES * c];
+		for (size_t i = 0; i < VERTICES; ++i)
+			stream[i] = (c < 3 ? skinPositions[i] : skinNormals[i])[c % 3];
+		streamsIn[c] = stream;
+		streamsOut[c] = &skinStreams[VERTICES * (6 + c)];
+	}
+	// The reference: each joint matrix applied to the vertex, the results blended.
+	auto scalarSkin = [&] {
+		for (size_t i = 0; i < VERTICES; ++i) {
+			Vec p(0.0f), n(0.0f);
+			for (int k = 0; k < 4; ++k) {
+				const Mat44& joint = palette[joints[i * 4 + k]];
+				float w = weights[i * 4 + k];
+				p = p + Vec(joint * Vec4(skinPositions[i].x, skinPositions[i].y, skinPositions[i].z, 1.0f)) * w;
+				n = n + Vec(joint * Vec4(skinNormals[i].x, skinNormals[i].y, skinNormals[i].z, 0.0f)) * w;
+			}
+			expectedPositions[i] = Vec3(p.x, p.y, p.z);
+			expectedNormals[i] = Vec3(n.x, n.y, n.z) * (1.0f / sqrtf(n.x * n.x + n.y * n.y + n.z * n.z));
+		}
+	};
+	scalarSkin();
+	printf("\nSkinning, %zu vertices\n", VERTICES);
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path))
+			continue;
+		skin(palette.data(), joints.data(), weights.data(), skinPositions.data(), skinNormals.data(), skinnedPositions.data(), skinnedNormals.data(), VERTICES);
+		skinParallel(palette.data(), joints.data(), weights.data(), streamsIn, streamsIn + 3, streamsOut, streamsOut + 3, VERTICES);
+		float positionError = 0.0f, normalError = 0.0f;
+		for (size_t i = 0; i < VERTICES; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				positionError = std::max({ positionError, fabsf(skinnedPositions[i][c] - expectedPositions[i][c]), fabsf(streamsOut[c][i] - expectedPositions[i][c]) });
+				normalError = std::max({ normalError, fabsf(skinnedNormals[i][c] - expectedNormals[i][c]), fabsf(streamsOut[3 + c][i] - expectedNormals[i][c]) });
+			}
+		}
+		printf("  %s, max difference to the reference: positions %g, normals %g\n", simdPathName(path), positionError, normalError);
+		printf("  (ns per vertex)\n");
+		printf("  4x Mat44 * Vec4      %6.2f\n", nsPerOp(scalarSkin, VERTICES));
+		printf("  skin Vec3            %6.2f\n", nsPerOp([&] { skin(palette.data(), joints.data(), weights.data(), skinPositions.data(), skinNormals.data(), skinnedPositions.data(), skinnedNormals.data(), VERTICES); }, VERTICES));
+		printf("  skin Vec3 positions  %6.2f\n", nsPerOp([&] { skin(palette.data(), joints.data(), weights.data(), skinPositions.data(), nullptr, skinnedPositions.data(), nullptr, VERTICES); }, VERTICES));
+		printf("  skin xyz             %6.2f\n", nsPerOp([&] { skin(palette.data(), joints.data(), weights.data(), streamsIn, streamsIn + 3, streamsOut, streamsOut + 3, VERTICES); }, VERTICES));
+		printf("  skinParallel Vec3    %6.2f (%u threads)\n", nsPerOp([&] {
+			skinParallel(palette.data(), joints.data(), weights.data(), skinPositions.data(), skinNormals.data(), skinnedPositions.data(), skinnedNormals.data(), VERTICES);
+		}, VERTICES), std::max(std::thread::hardware_concurrency(), 1u));
+	}
+	setSimdPath(selected);
+
+	// A bumpy 200x200 quad grid with texture coordinates as a triangle soup (6 vertices per quad), and a copy with 1e-6 of position noise.
+	struct MeshVertex {
+		float position[3];
+		float uv[2];
+	};
+	const int GRID = 200;
+	std::vector<MeshVertex> soup, noisySoup;
+	for (int y = 0; y < GRID; ++y) {
+		for (int x = 0; x < GRID; ++x) {
+			const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+			for (const int* c : corners) {
+				float u = (float)(x + c[0]), v = (float)(y + c[1]);
+				soup.push_back({ { u * 0.01f, v * 0.01f, 0.05f * sinf(u * 0.1f) * cosf(v * 0.13f) }, { u / GRID, v / GRID } });
+			}
+		}
+	}
+	noisySoup = soup;
+	for (MeshVertex& vertex : noisySoup)
+		for (float& c : vertex.position)
+			c += random(rng) * 1e-6f;
+	const size_t SOUP = soup.size();
+	std::vector<unsigned int> remap(SOUP);
+	size_t noisyUnique = weldVertices(noisySoup.data(), sizeof(MeshVertex), SOUP, 1e-5f, remap.data());
+	size_t noisyExact = weldVertices(noisySoup.data(), sizeof(MeshVertex), SOUP, 0.0f, remap.data());
+	size_t unique = weldVertices(soup.data(), sizeof(MeshVertex), SOUP, 0.0f, remap.data());
+	std::vector<MeshVertex> welded(unique);
+	std::vector<unsigned int> meshIndices(SOUP);
+	remapVertices(soup.data(), sizeof(MeshVertex), SOUP, remap.data(), welded.data());
+	remapIndices(nullptr, SOUP, remap.data(), meshIndices.data());
+	const size_t MESH_TRIANGLES = SOUP / 3;
+	std::vector<Vec3> meshPositions(unique), meshNormals(unique), expectedMeshNormals(unique);
+	std::vector<Vec2> meshUvs(unique);
+	std::vector<Vec4> meshTangents(unique);
+	for (size_t i = 0; i < unique; ++i) {
+		meshPositions[i] = Vec3(welded[i].position[0], welded[i].position[1], welded[i].position[2]);
+		meshUvs[i] = Vec2(welded[i].uv[0], welded[i].uv[1]);
+	}
+	// The references: a hash map from the vertex bytes, and normals summed one triangle at a time.
+	auto mapWeld = [&] {
+		std::unordered_map<std::string, unsigned int> map;
+		for (size_t i = 0; i < SOUP; ++i)
+			remap[i] = map.emplace(std::string((const char*)&soup[i], sizeof(MeshVertex)), (unsigned int)map.size()).first->second;
+	};
+	auto scalarNormals = [&] {
+		std::fill(expectedMeshNormals.begin(), expectedMeshNormals.end(), Vec3(0.0f));
+		for (size_t t = 0; t < MESH_TRIANGLES; ++t) {
+			const unsigned int* triangle = &meshIndices[3 * t];
+			Vec3 n = Vec3(meshPositions[triangle[1]] - meshPositions[triangle[0]]).cross(meshPositions[triangle[2]] - meshPositions[triangle[0]]);
+			for (int c = 0; c < 3; ++c)
+				expectedMeshNormals[triangle[c]] = expectedMeshNormals[triangle[c]] + n;
+		}
+		for (Vec3& n : expectedMeshNormals)
+			n = n * (1.0f / sqrtf(n.x * n.x + n.y * n.y + n.z * n.z));
+	};
+	scalarNormals();
+	computeNormals(meshPositions.data(), unique, meshIndices.data(), SOUP, meshNormals.data());
+	computeTangents(meshPositions.data(), meshUvs.data(), meshNormals.data(), unique, meshIndices.data(), SOUP, meshTangents.data());
+	float normalDifference = 0.0f, tangentError = 0.0f;
+	for (size_t i = 0; i < unique; ++i) {
+		const Vec3& n = meshNormals[i];
+		const Vec4& t = meshTangents[i];
+		for (int c = 0; c < 3; ++c)
+			normalDifference = std::max(normalDifference, fabsf(n[c] - expectedMeshNormals[i][c]));
+		tangentError = std::max({ tangentError, fabsf(n.x * t.x + n.y * t.y + n.z * t.z), fabsf(sqrtf(t.x * t.x + t.y * t.y + t.z * t.z) - 1.0f) });
+	}
+	// Triangles in random order as the worst case for the vertex cache.
+	std::vector<unsigned int> shuffled(SOUP), optimized(SOUP), order(MESH_TRIANGLES);
+	for (size_t t = 0; t < MESH_TRIANGLES; ++t)
+		order[t] = (unsigned int)t;
+	std::shuffle(order.begin(), order.end(), rng);
+	for (size_t t = 0; t < MESH_TRIANGLES; ++t)
+		std::copy(&meshIndices[3 * order[t]], &meshIndices[3 * order[t]] + 3, &shuffled[3 * t]);
+	optimizeVertexCache(shuffled.data(), SOUP, unique, optimized.data());
+
+	printf("\nMesh processing, %zu vertex triangle soup, %u threads\n", SOUP, std::max(std::thread::hardware_concurrency(), 1u));
+	printf("  welded to %zu vertices, with noise %zu (exact %zu)\n", unique, noisyUnique, noisyExact);
+	printf("  max difference to the reference: normals %g, tangent not orthonormal by %g\n", normalDifference, tangentError);
+	printf("  ACMR (FIFO 16): grid order %.3f, shuffled %.3f, optimized %.3f\n", averageCacheMissRatio(meshIndices.data(), SOUP, unique),
+		averageCacheMissRatio(shuffled.data(), SOUP, unique), averageCacheMissRatio(optimized.data(), SOUP, unique));
+	printf("  (ns per vertex)\n");
+	printf("  unordered_map weld   %6.2f\n", nsPerOp(mapWeld, SOUP));
+	printf("  weldVertices         %6.2f\n", nsPerOp([&] { weldVertices(soup.data(), sizeof(MeshVertex), SOUP, 0.0f, remap.data()); }, SOUP));
+	printf("  weldVertices epsilon %6.2f\n", nsPerOp([&] { weldVertices(noisySoup.data(), sizeof(MeshVertex), SOUP, 1e-5f, remap.data()); }, SOUP));
+	printf("  (ns per triangle)\n");
+	printf("  scalar normals       %6.2f\n", nsPerOp(scalarNormals, MESH_TRIANGLES));
+	printf("  computeNormals       %6.2f\n", nsPerOp([&] { computeNormals(meshPositions.data(), unique, meshIndices.data(), SOUP, meshNormals.data()); }, MESH_TRIANGLES));
+	printf("  computeTangents      %6.2f\n", nsPerOp([&] {
+		computeTangents(meshPositions.data(), meshUvs.data(), meshNormals.data(), unique, meshIndices.data(), SOUP, meshTangents.data());
+	}, MESH_TRIANGLES));
+	printf("  optimizeVertexCache  %6.2f\n", nsPerOp([&] { optimizeVertexCache(shuffled.data(), SOUP, unique, optimized.data()); }, MESH_TRIANGLES));
+	sink = hits[0].distance;
+	return 0;
+}
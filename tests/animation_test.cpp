@@ -0,0 +1,194 @@
+// AnimationClip::sample() at and between keys against per channel lerp, Quat::slerp and Mat44::TRS, on every SIMD path.
+#include "tt_animation.h"
+#include "tt_math.h"
+#include "tt_test.h"
+#include "tt_transform_hierarchy.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Not a multiple of 8, so the last step of tracks is partial.
+	const unsigned int TRACKS = 37;
+
+	template<typename T> struct Channel {
+		std::vector<float> times;
+		std::vector<T> values;
+	};
+
+	struct Track {
+		Channel<Vec3> translations;
+		Channel<Quat> rotations;
+		Channel<Vec3> scales;
+	};
+
+	float maxDifference(const Mat44& a, const Mat44& b) {
+		float d = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			d = std::max(d, fabsf(a.m[i] - b.m[i]));
+		return d;
+	}
+
+	// The keys around time and the weight of the second, holding the first and last key outside of them.
+	template<typename T> void find(const Channel<T>& channel, float time, size_t& k, size_t& next, float& weight) {
+		k = std::upper_bound(channel.times.begin(), channel.times.end(), time) - channel.times.begin();
+		k = k ? k - 1 : 0;
+		next = std::min(k + 1, channel.times.size() - 1);
+		weight = next != k ? std::clamp((time - channel.times[k]) / (channel.times[next] - channel.times[k]), 0.0f, 1.0f) : 0.0f;
+	}
+
+	Vec3 sampleVec3(const Channel<Vec3>& channel, float time, Vec3 identity) {
+		if (channel.times.empty())
+			return identity;
+		size_t k, next;
+		float w;
+		find(channel, time, k, next, w);
+		return lerp<Vec>(channel.values[k], channel.values[next], w);
+	}
+
+	Mat44 reference(const Track& track, float time) {
+		Quat rotation;
+		if (!track.rotations.times.empty()) {
+			size_t k, next;
+			float w;
+			find(track.rotations, time, k, next, w);
+			rotation = Quat::slerp(track.rotations.values[k], track.rotations.values[next], w);
+		}
+		return Mat44::TRS(sampleVec3(track.translations, time, Vec3(0.0f)), rotation, sampleVec3(track.scales, time, Vec3(1.0f, 1.0f, 1.0f)));
+	}
+
+	// Key counts from 0 to 6, each channel with its own times.
+	std::vector<Track> makeTracks() {
+		std::mt19937 rng(29);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		auto times = [&](size_t count) {
+			std::vector<float> t(count);
+			float time = random(rng) * 0.2f;
+			for (float& key : t) {
+				key = time;
+				time += 0.05f + (random(rng) + 1.0f) * 0.2f;
+			}
+			return t;
+		};
+		std::vector<Track> tracks(TRACKS);
+		for (unsigned int i = 0; i < TRACKS; ++i) {
+			Track& track = tracks[i];
+			track.translations.times = times(i % 7);
+			for (size_t k = 0; k < track.translations.times.size(); ++k)
+				track.translations.values.push_back(Vec3(random(rng), random(rng), random(rng)) * 10.0f);
+			track.rotations.times = times((i + 3) % 7);
+			for (size_t k = 0; k < track.rotations.times.size(); ++k) {
+				Quat q = Quat::euler(Vec(random(rng), random(rng), random(rng), 0.0f) * 3.0f);
+				// Keys on both sides of the double cover, the shortest arc is taken either way.
+				track.rotations.values.push_back(k % 2 ? Quat(-q.x, -q.y, -q.z, -q.w) : q);
+			}
+			track.scales.times = times((i + 5) % 7);
+			for (size_t k = 0; k < track.scales.times.size(); ++k)
+				track.scales.values.push_back(Vec3(1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f));
+		}
+		return tracks;
+	}
+
+	AnimationClip makeClip(const std::vector<Track>& tracks) {
+		AnimationClip clip;
+		for (unsigned int i = 0; i < TRACKS; ++i) {
+			const Track& track = tracks[i];
+			unsigned int index = clip.addTrack(TRACKS - 1 - i);
+			TT_CHECK(index == i);
+			clip.setTranslations(index, track.translations.times.data(), track.translations.values.data(), track.translations.times.size());
+			clip.setRotations(index, track.rotations.times.data(), track.rotations.values.data(), track.rotations.times.size());
+			clip.setScales(index, track.scales.times.data(), track.scales.values.data(), track.scales.times.size());
+		}
+		return clip;
+	}
+
+	float sampleError(const AnimationClip& clip, const std::vector<Track>& tracks, float time, AnimationCursor& cursor) {
+		std::vector<Mat44> locals(TRACKS);
+		clip.sample(time, cursor, locals.data());
+		float e = 0.0f;
+		for (unsigned int i = 0; i < TRACKS; ++i)
+			e = std::max(e, maxDifference(locals[i], reference(tracks[i], time)));
+		return e;
+	}
+
+	void testSampling() {
+		std::vector<Track> tracks = makeTracks();
+		AnimationClip clip = makeClip(tracks);
+		TT_CHECK(clip.trackCount() == TRACKS && clip.target(0) == TRACKS - 1);
+		float last = 0.0f;
+		for (const Track& track : tracks)
+			for (const std::vector<float>* times : { &track.translations.times, &track.rotations.times, &track.scales.times })
+				if (!times->empty())
+					last = std::max(last, times->back());
+		TT_CHECK(clip.duration() == last);
+
+		// At every key time of every channel.
+		AnimationCursor cursor;
+		float atKeys = 0.0f;
+		for (const Track& track : tracks)
+			for (float time : track.rotations.times)
+				atKeys = std::max(atKeys, sampleError(clip, tracks, time, cursor));
+		for (const Track& track : tracks)
+			for (float time : track.translations.times)
+				atKeys = std::max(atKeys, sampleError(clip, tracks, time, cursor));
+		TT_CHECK(atKeys < 1e-5f);
+
+		// Playing forward from before the first key to after the last, then stepping back, and with a fresh cursor.
+		float between = 0.0f;
+		AnimationCursor playing;
+		for (float time = -0.5f; time < clip.duration() + 0.5f; time += 0.0137f)
+			between = std::max(between, sampleError(clip, tracks, time, playing));
+		for (float time : { 1.0f, 0.3f, clip.duration() * 0.5f, -1.0f, clip.duration() * 2.0f })
+			between = std::max(between, sampleError(clip, tracks, time, playing));
+		AnimationCursor fresh;
+		between = std::max(between, sampleError(clip, tracks, clip.duration() * 0.7f, fresh));
+		TT_CHECK(between < 1e-5f);
+
+		// Into a hierarchy, through the targets.
+		TransformHierarchy hierarchy;
+		for (unsigned int i = 0; i < TRACKS; ++i)
+			hierarchy.add();
+		clip.sample(0.4f, cursor, hierarchy);
+		hierarchy.update();
+		float e = 0.0f;
+		for (unsigned int i = 0; i < TRACKS; ++i)
+			e = std::max(e, maxDifference(hierarchy.local(clip.target(i)), reference(tracks[i], 0.4f)));
+		TT_CHECK(e < 1e-5f);
+
+		clip.clear();
+		TT_CHECK(clip.trackCount() == 0 && clip.duration() == 0.0f);
+	}
+
+	void testSingleTrack() {
+		// A track without keys is at identity, one key holds it.
+		AnimationClip clip;
+		unsigned int empty = clip.addTrack(0);
+		unsigned int held = clip.addTrack(1);
+		float time = 2.0f;
+		Vec3 translation(1.0f, 2.0f, 3.0f);
+		clip.setTranslations(held, &time, &translation, 1);
+		Mat44 locals[2];
+		AnimationCursor cursor;
+		clip.sample(0.0f, cursor, locals);
+		TT_CHECK(maxDifference(locals[empty], MAT44_IDENTITY) == 0.0f && maxDifference(locals[held], Mat44::translate(1.0f, 2.0f, 3.0f)) < 1e-6f);
+		clip.sample(5.0f, cursor, locals);
+		TT_CHECK(maxDifference(locals[held], Mat44::translate(1.0f, 2.0f, 3.0f)) < 1e-6f && clip.duration() == 2.0f);
+	}
+}
+
+int main() {
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testSampling();
+		testSingleTrack();
+	}
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
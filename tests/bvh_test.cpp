@@ -0,0 +1,222 @@
+// BVH ray queries against testing every triangle or box, for single rays, packets and parallel builds.
+#include "tt_bvh.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Enough for the builder to split the top nodes on threads.
+	const size_t TRIANGLES = 40000;
+	const size_t BOXES = 20000;
+	const size_t RAYS = 501;
+
+	// Möller-Trumbore in double against every triangle.
+	RayHit bruteTriangles(const std::vector<Vec>& vertices, const std::vector<unsigned int>& indices, const Ray& ray, float maxDistance) {
+		RayHit hit;
+		double best = maxDistance;
+		double o[3] = { ray.origin.x, ray.origin.y, ray.origin.z }, d[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+		for (size_t t = 0; t < indices.size() / 3; ++t) {
+			const Vec& a = vertices[indices[t * 3]];
+			const Vec& b = vertices[indices[t * 3 + 1]];
+			const Vec& c = vertices[indices[t * 3 + 2]];
+			double e1[3] = { b.x - (double)a.x, b.y - (double)a.y, b.z - (double)a.z }, e2[3] = { c.x - (double)a.x, c.y - (double)a.y, c.z - (double)a.z };
+			double p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+			double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (fabs(det) < 1e-20)
+				continue;
+			double s[3] = { o[0] - a.x, o[1] - a.y, o[2] - a.z };
+			double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+			double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+			double v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / det;
+			double distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+			if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && distance >= 0.0 && distance < best) {
+				best = distance;
+				hit = { (float)distance, (unsigned int)t, (float)u, (float)v };
+			}
+		}
+		return hit;
+	}
+
+	// The slab test in double against every box, the distance is where the ray enters the box, 0 inside it.
+	RayHit bruteBoxes(const std::vector<Vec>& boxMin, const std::vector<Vec>& boxMax, const Ray& ray, float maxDistance) {
+		RayHit hit;
+		double best = maxDistance;
+		for (size_t b = 0; b < boxMin.size(); ++b) {
+			double enter = 0.0, exit = INFINITY;
+			for (int c = 0; c < 3; ++c) {
+				double t0 = (boxMin[b][c] - (double)ray.origin[c]) / ray.direction[c], t1 = (boxMax[b][c] - (double)ray.origin[c]) / ray.direction[c];
+				enter = std::max(enter, std::min(t0, t1));
+				exit = std::min(exit, std::max(t0, t1));
+			}
+			if (enter <= exit && enter < best) {
+				best = enter;
+				hit.distance = (float)enter;
+				hit.primitive = (unsigned int)b;
+			}
+		}
+		return hit;
+	}
+
+	// Both missed, or hit at the same distance. Triangles or boxes hit at almost the same distance may be reported either way.
+	bool sameHit(const RayHit& a, const RayHit& b) {
+		if (a.hit() != b.hit())
+			return false;
+		if (!a.hit())
+			return true;
+		float tolerance = 1e-4f * (1.0f + b.distance);
+		if (fabsf(a.distance - b.distance) > tolerance)
+			return false;
+		return a.primitive != b.primitive || (fabsf(a.u - b.u) < 1e-3f && fabsf(a.v - b.v) < 1e-3f);
+	}
+
+	std::vector<Ray> makeRays(std::mt19937& rng) {
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		std::vector<Ray> rays(RAYS);
+		// Most aim at the scene, every third one anywhere.
+		for (size_t i = 0; i < RAYS; ++i) {
+			float spread = i % 3 == 0 ? 150.0f : 40.0f;
+			Vec origin(random(rng) * 150.0f, random(rng) * 150.0f, random(rng) * 150.0f, 0.0f);
+			Vec target(random(rng) * spread, random(rng) * spread, random(rng) * spread, 0.0f);
+			rays[i] = Ray(origin, target - origin);
+		}
+		// Coherent packets, and rays along the axes whose inverse directions are infinite.
+		for (size_t i = 0; i < 8; ++i)
+			rays[i] = Ray(Vec(-200.0f, (float)i, 0.5f, 0.0f), Vec(1.0f, 0.0f, 0.0f, 0.0f));
+		rays[8] = Ray(Vec(0.0f, 0.0f, 0.0f, 0.0f), Vec(0.0f, -1.0f, 0.0f, 0.0f));
+		return rays;
+	}
+
+	struct Expected {
+		float maxDistance;
+		std::vector<RayHit> hits;
+	};
+
+	// The brute force results without and with a distance limit.
+	std::vector<Expected> expectHits(const std::vector<Ray>& rays, auto brute) {
+		std::vector<Expected> expected = { { INFINITY, {} }, { 120.0f, {} } };
+		for (Expected& e : expected) {
+			size_t hitCount = 0;
+			for (const Ray& ray : rays) {
+				e.hits.push_back(brute(ray, e.maxDistance));
+				hitCount += e.hits.back().hit();
+			}
+			TT_CHECK(hitCount > rays.size() / 4 && hitCount < rays.size());
+		}
+		return expected;
+	}
+
+	void checkQueries(const BVH& bvh, const std::vector<Ray>& rays, const std::vector<Expected>& expected) {
+		std::vector<RayHit> hits(RAYS);
+		for (const Expected& e : expected) {
+			size_t mismatches = 0;
+			for (size_t i = 0; i < RAYS; ++i)
+				mismatches += !sameHit(bvh.intersect(rays[i], e.maxDistance), e.hits[i]);
+			TT_CHECK(mismatches == 0);
+
+			// Packets of 4, and an array that ends with a partial packet.
+			mismatches = 0;
+			for (size_t i = 0; i + 4 <= RAYS; i += 4) {
+				bvh.intersect(&rays[i], &hits[i], e.maxDistance);
+				for (size_t j = i; j < i + 4; ++j)
+					mismatches += !sameHit(hits[j], e.hits[j]);
+			}
+			TT_CHECK(mismatches == 0);
+			bvh.intersect(rays.data(), hits.data(), RAYS, e.maxDistance);
+			for (size_t i = 0; i < RAYS; ++i)
+				mismatches += !sameHit(hits[i], e.hits[i]);
+			TT_CHECK(mismatches == 0);
+		}
+	}
+
+	void testTriangles() {
+		// Triangles of a few units scattered through a cube of 80 units, some of them long and thin.
+		std::mt19937 rng(13);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		std::vector<Vec> vertices;
+		std::vector<unsigned int> indices;
+		for (size_t t = 0; t < TRIANGLES; ++t) {
+			Vec center(random(rng) * 40.0f, random(rng) * 40.0f, random(rng) * 40.0f, 0.0f);
+			float size = t % 10 == 0 ? 10.0f : 1.5f;
+			for (int c = 0; c < 3; ++c) {
+				indices.push_back((unsigned int)vertices.size());
+				vertices.push_back(center + Vec(random(rng) * size, random(rng) * size, random(rng) * 1.5f, 0.0f));
+			}
+		}
+		// The same triangles through a shuffled index buffer.
+		std::vector<Vec> shuffled(vertices.size());
+		std::vector<unsigned int> order(vertices.size()), shuffledIndices(indices.size());
+		for (unsigned int i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), rng);
+		for (size_t i = 0; i < order.size(); ++i) {
+			shuffled[order[i]] = vertices[i];
+			shuffledIndices[i] = order[i];
+		}
+
+		std::vector<Ray> rays = makeRays(rng);
+		std::vector<Expected> expected = expectHits(rays, [&](const Ray& ray, float maxDistance) { return bruteTriangles(vertices, indices, ray, maxDistance); });
+		BVH bvh;
+		for (unsigned int threads : { 1u, 4u }) {
+			bvh.buildTriangles(vertices.data(), nullptr, TRIANGLES, threads);
+			TT_CHECK(bvh.nodeCount() > 1 && bvh.nodeCount() < 2 * TRIANGLES);
+			checkQueries(bvh, rays, expected);
+			bvh.buildTriangles(shuffled.data(), shuffledIndices.data(), TRIANGLES, threads);
+			checkQueries(bvh, rays, expected);
+		}
+
+		bvh.clear();
+		TT_CHECK(bvh.nodeCount() == 0 && !bvh.intersect(rays[0]).hit());
+		bvh.buildTriangles(vertices.data(), nullptr, 1);
+		// Distances are in multiples of the direction's length.
+		Vec centroid = (vertices[0] + vertices[1] + vertices[2]) * (1.0f / 3.0f);
+		RayHit hit = bvh.intersect(Ray(centroid + Vec(0.0f, 0.0f, 5.0f, 0.0f), Vec(0.0f, 0.0f, -2.0f, 0.0f)));
+		TT_CHECK(hit.hit() && hit.primitive == 0 && fabsf(hit.distance - 2.5f) < 1e-4f && fabsf(hit.u - 1.0f / 3.0f) < 1e-4f && fabsf(hit.v - 1.0f / 3.0f) < 1e-4f);
+	}
+
+	void testBoxes() {
+		std::mt19937 rng(17);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f), size(0.2f, 3.0f);
+		std::vector<Vec> boxMin(BOXES), boxMax(BOXES);
+		for (size_t b = 0; b < BOXES; ++b) {
+			Vec center(random(rng) * 40.0f, random(rng) * 40.0f, random(rng) * 40.0f, 0.0f);
+			Vec extent(size(rng), size(rng), size(rng), 0.0f);
+			boxMin[b] = center - extent;
+			boxMax[b] = center + extent;
+		}
+		std::vector<Ray> rays = makeRays(rng);
+		std::vector<Expected> expected = expectHits(rays, [&](const Ray& ray, float maxDistance) { return bruteBoxes(boxMin, boxMax, ray, maxDistance); });
+		BVH bvh;
+		for (unsigned int threads : { 1u, 4u }) {
+			bvh.buildBoxes(boxMin.data(), boxMax.data(), BOXES, threads);
+			checkQueries(bvh, rays, expected);
+		}
+		// Inside a box the hit is at 0.
+		RayHit hit = bvh.intersect(Ray((boxMin[7] + boxMax[7]) * 0.5f, Vec(1.0f, 0.0f, 0.0f, 0.0f)));
+		TT_CHECK(hit.hit() && hit.distance == 0.0f);
+	}
+
+	void testPixelRays() {
+		Mat44 camera = Mat44::translate(1.0f, 2.0f, 10.0f);
+		Mat44 projection = Mat44::perspectiveY(1.0f, 2.0f, 0.1f, 100.0f);
+		Ray center = Ray::fromPixel(400.0f, 200.0f, 800.0f, 400.0f, camera, projection);
+		TT_CHECK(fabsf(center.origin.x - 1.0f) < 1e-4f && fabsf(center.origin.y - 2.0f) < 1e-4f && fabsf(center.origin.z - 9.9f) < 1e-4f);
+		TT_CHECK(fabsf(center.direction.x) < 1e-5f && fabsf(center.direction.y) < 1e-5f && fabsf(center.direction.z + 1.0f) < 1e-5f);
+		// The top and right edges are half the field of view away from the center.
+		Ray top = Ray::fromPixel(400.0f, 0.0f, 800.0f, 400.0f, camera, projection);
+		Ray right = Ray::fromPixel(800.0f, 200.0f, 800.0f, 400.0f, camera, projection);
+		TT_CHECK(fabsf(top.direction.y / -top.direction.z - tanf(0.5f)) < 1e-4f && fabsf(top.direction.x) < 1e-5f);
+		TT_CHECK(fabsf(right.direction.x / -right.direction.z - 2.0f * tanf(0.5f)) < 1e-4f);
+		TT_CHECK(fabsf(right.direction.len().x - 1.0f) < 1e-5f && right.direction.w == 0.0f);
+	}
+}
+
+int main() {
+	testTriangles();
+	testBoxes();
+	testPixelRays();
+	return TT_TEST_RESULT;
+}
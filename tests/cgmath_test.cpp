@@ -0,0 +1,261 @@
+// Mat44 products, inverses and batch transforms on every SIMD path the CPU supports, against scalar double precision references.
+#include "tt_cgmath.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Not a multiple of 8, so the batch functions also run their tails.
+	const size_t COUNT = 1003;
+
+	struct Matrices {
+		std::vector<Mat44> rigid;
+		std::vector<Mat44> affine;
+		std::vector<Mat44> projective;
+	};
+
+	Matrices makeMatrices() {
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		Matrices m;
+		for (size_t i = 0; i < COUNT; ++i) {
+			Vec translate(random(rng) * 10.0f, random(rng) * 10.0f, random(rng) * 10.0f, 0.0f);
+			Vec radians(random(rng) * 3.0f, random(rng) * 3.0f, random(rng) * 3.0f, 0.0f);
+			Vec scale(1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 1.0f + random(rng) * 0.5f, 0.0f);
+			m.rigid.push_back(Mat44::TRS(translate, radians, Vec(1.0f)));
+			m.affine.push_back(Mat44::TRS(translate, radians, scale));
+			m.projective.push_back(m.rigid.back() * Mat44::perspectiveY(1.0f + random(rng) * 0.5f, 1.5f, 0.1f, 1000.0f));
+		}
+		return m;
+	}
+
+	// a * b as Mat44::operator* defines it, in double.
+	void multiplyDouble(const Mat44& a, const Mat44& b, double out[16]) {
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r) {
+				double sum = 0.0;
+				for (int k = 0; k < 4; ++k)
+					sum += (double)a.m[c * 4 + k] * b.m[k * 4 + r];
+				out[c * 4 + r] = sum;
+			}
+	}
+
+	// The largest difference of m * inverse to the identity, per element relative to the sum of the magnitudes of its products,
+	// which is what rounding the inverse to float costs even when it is exact.
+	double roundTripError(const Mat44& m, const Mat44& inverse) {
+		double e = 0.0;
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r) {
+				double sum = 0.0, magnitude = 0.0;
+				for (int k = 0; k < 4; ++k) {
+					sum += (double)m.m[c * 4 + k] * inverse.m[k * 4 + r];
+					magnitude += fabs((double)m.m[c * 4 + k] * inverse.m[k * 4 + r]);
+				}
+				e = std::max(e, fabs(sum - (c == r ? 1.0 : 0.0)) / std::max(magnitude, 1e-30));
+			}
+		return e;
+	}
+
+	void checkBound(const char* what, double error, double bound, int line) {
+		char text[128];
+		snprintf(text, sizeof(text), "%s %s error %g <= %g", simdPathName(simdPath()), what, error, bound);
+		TTTest::check(error <= bound, text, __FILE__, line);
+	}
+
+	void testMultiply(const Matrices& m) {
+		double e = 0.0;
+		for (size_t i = 0; i < COUNT; ++i) {
+			const Mat44& a = m.affine[i];
+			const Mat44& b = m.projective[COUNT - 1 - i];
+			double expected[16];
+			multiplyDouble(a, b, expected);
+			Mat44 product = a * b;
+			Mat44 inPlace = a;
+			inPlace *= b;
+			for (int k = 0; k < 16; ++k)
+				e = std::max({ e, fabs(product.m[k] - expected[k]) / (1.0 + fabs(expected[k])), fabs(inPlace.m[k] - expected[k]) / (1.0 + fabs(expected[k])) });
+		}
+		checkBound("Mat44 * Mat44", e, 1e-6, __LINE__);
+	}
+
+	void testInverses(const Matrices& m) {
+		std::vector<Mat44> batch(COUNT);
+		auto maxError = [](const std::vector<Mat44>& matrices, auto inverse) {
+			double e = 0.0;
+			for (const Mat44& matrix : matrices)
+				e = std::max(e, roundTripError(matrix, inverse(matrix)));
+			return e;
+		};
+		auto fast = [](const Mat44& a) { return a.inversed(); };
+		auto precise = [](const Mat44& a) { return a.inversed(EInversePrecision::Precise); };
+		auto affine = [](const Mat44& a) { return a.inversedAffine(); };
+		auto rigid = [](const Mat44& a) { return a.inversedRigid(); };
+		checkBound("inversed projective", maxError(m.projective, fast), 1e-4, __LINE__);
+		checkBound("inversed Precise projective", maxError(m.projective, precise), 5e-7, __LINE__);
+		checkBound("inversed affine", maxError(m.affine, fast), 2e-6, __LINE__);
+		checkBound("inversed Precise affine", maxError(m.affine, precise), 5e-7, __LINE__);
+		checkBound("inversedAffine", maxError(m.affine, affine), 1e-6, __LINE__);
+		checkBound("inversedAffine rigid", maxError(m.rigid, affine), 1e-6, __LINE__);
+		// Transposing keeps the rotation's own rounding, which is not orthonormal to float precision.
+		checkBound("inversedRigid", maxError(m.rigid, rigid), 1e-5, __LINE__);
+
+		// The array versions give the single matrix results, also in place.
+		auto maxDifference = [&batch](const std::vector<Mat44>& matrices, auto inverse) {
+			double e = 0.0;
+			for (size_t i = 0; i < COUNT; ++i) {
+				Mat44 single = inverse(matrices[i]);
+				for (int k = 0; k < 16; ++k)
+					e = std::max(e, fabs(batch[i].m[k] - single.m[k]) / (1.0 + fabs(single.m[k])));
+			}
+			return e;
+		};
+		Mat44::inverse(m.projective.data(), batch.data(), COUNT);
+		checkBound("inverse array", maxDifference(m.projective, fast), 1e-6, __LINE__);
+		Mat44::inverse(m.projective.data(), batch.data(), COUNT, EInversePrecision::Precise);
+		checkBound("inverse Precise array", maxDifference(m.projective, precise), 1e-6, __LINE__);
+		Mat44::inverseAffine(m.affine.data(), batch.data(), COUNT);
+		checkBound("inverseAffine array", maxDifference(m.affine, affine), 1e-6, __LINE__);
+		batch = m.rigid;
+		Mat44::inverseRigid(batch.data(), batch.data(), COUNT);
+		checkBound("inverseRigid array in place", maxDifference(m.rigid, rigid), 1e-6, __LINE__);
+
+		Mat44 inPlace = m.affine[0];
+		inPlace.inverse();
+		inPlace.inverse(EInversePrecision::Precise);
+		checkBound("inverse twice", roundTripError(inPlace, m.affine[0].inversedAffine()), 1e-6, __LINE__);
+	}
+
+	// m * (x, y, z, w) in double.
+	void transformDouble(const Mat44& m, const float v[4], double out[4]) {
+		for (int r = 0; r < 4; ++r)
+			out[r] = (double)m.m[r] * v[0] + (double)m.m[4 + r] * v[1] + (double)m.m[8 + r] * v[2] + (double)m.m[12 + r] * v[3];
+	}
+
+	void testTransforms(const Matrices& m) {
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> random(-20.0f, 20.0f);
+		std::vector<Vec4> vectors(COUNT), vectorsOut(COUNT);
+		std::vector<Vec3> points(COUNT), pointsOut(COUNT);
+		std::vector<float> x(COUNT), y(COUNT), z(COUNT), outX(COUNT), outY(COUNT), outZ(COUNT);
+		for (size_t i = 0; i < COUNT; ++i) {
+			vectors[i] = Vec4(random(rng), random(rng), random(rng), random(rng) * 0.1f);
+			points[i] = Vec3(random(rng), random(rng), random(rng));
+			x[i] = points[i].x;
+			y[i] = points[i].y;
+			z[i] = points[i].z;
+		}
+
+		// The difference to the reference relative to the sum of the magnitudes of the products, which bounds float rounding.
+		// Projected results relative to their size, after the divide the rounding of w and of the rest add up.
+		auto error = [](const Mat44& matrix, const float v[4], const float* result, int components, bool project) {
+			double expected[4];
+			transformDouble(matrix, v, expected);
+			double e = 0.0;
+			for (int c = 0; c < components; ++c) {
+				double magnitude = 0.0;
+				for (int k = 0; k < 4; ++k)
+					magnitude += fabs((double)matrix.m[k * 4 + c] * v[k]);
+				double reference = project ? expected[c] / expected[3] : expected[c];
+				e = std::max(e, fabs(result[c] - reference) / (project ? 1.0 + fabs(reference) : std::max(magnitude, 1e-30)));
+			}
+			return e;
+		};
+
+		const Mat44* matrices[] = { &m.affine[0], &m.affine[1], &m.projective[0], &m.projective[1] };
+		double e = 0.0, projected = 0.0;
+		bool zeroW = true;
+		for (const Mat44* matrix : matrices) {
+			bool projective = matrix == &m.projective[0] || matrix == &m.projective[1];
+			matrix->transform(vectors.data(), vectorsOut.data(), COUNT);
+			for (size_t i = 0; i < COUNT; ++i)
+				e = std::max(e, error(*matrix, &vectors[i].x, &vectorsOut[i].x, 4, false));
+
+			matrix->transformPoints(points.data(), pointsOut.data(), COUNT);
+			matrix->transformPoints(x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), COUNT);
+			for (size_t i = 0; i < COUNT; ++i) {
+				float v[4] = { points[i].x, points[i].y, points[i].z, 1.0f };
+				float streams[3] = { outX[i], outY[i], outZ[i] };
+				e = std::max({ e, error(*matrix, v, &pointsOut[i].x, 3, false), error(*matrix, v, streams, 3, false) });
+				zeroW = zeroW && pointsOut[i].w == 0.0f;
+			}
+
+			matrix->transformDirections(points.data(), pointsOut.data(), COUNT);
+			matrix->transformDirections(x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), COUNT);
+			for (size_t i = 0; i < COUNT; ++i) {
+				float v[4] = { points[i].x, points[i].y, points[i].z, 0.0f };
+				float streams[3] = { outX[i], outY[i], outZ[i] };
+				e = std::max({ e, error(*matrix, v, &pointsOut[i].x, 3, false), error(*matrix, v, streams, 3, false) });
+				zeroW = zeroW && pointsOut[i].w == 0.0f;
+			}
+
+			if (!projective)
+				continue;
+			matrix->projectPoints(points.data(), pointsOut.data(), COUNT);
+			matrix->projectPoints(x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), COUNT);
+			for (size_t i = 0; i < COUNT; ++i) {
+				float v[4] = { points[i].x, points[i].y, points[i].z, 1.0f };
+				double expected[4];
+				transformDouble(*matrix, v, expected);
+				// Points close to the eye plane have no meaningful projection in float.
+				if (fabs(expected[3]) < 0.5)
+					continue;
+				float streams[3] = { outX[i], outY[i], outZ[i] };
+				projected = std::max({ projected, error(*matrix, v, &pointsOut[i].x, 3, true), error(*matrix, v, streams, 3, true) });
+			}
+		}
+		checkBound("transforms", e, 1e-6, __LINE__);
+		checkBound("projectPoints", projected, 1e-5, __LINE__);
+		TT_CHECK(zeroW);
+
+		// In place.
+		std::vector<Vec4> copy = vectors;
+		m.affine[2].transform(copy.data(), copy.data(), COUNT);
+		m.affine[2].transform(vectors.data(), vectorsOut.data(), COUNT);
+		TT_CHECK(std::equal(copy.begin(), copy.end(), vectorsOut.begin()));
+	}
+
+	// Every path gives the same results up to rounding.
+	void testPathsAgree(const Matrices& m, ESimdPath other) {
+		ESimdPath path = simdPath();
+		std::vector<Mat44> inverses(COUNT), otherInverses(COUNT);
+		std::vector<Vec3> points(COUNT), pointsOut(COUNT), otherOut(COUNT);
+		for (size_t i = 0; i < COUNT; ++i)
+			points[i] = Vec3((float)i * 0.01f, 1.0f - (float)i * 0.02f, 0.5f);
+		Mat44::inverse(m.projective.data(), inverses.data(), COUNT);
+		m.projective[3].projectPoints(points.data(), pointsOut.data(), COUNT);
+		setSimdPath(other);
+		Mat44::inverse(m.projective.data(), otherInverses.data(), COUNT);
+		m.projective[3].projectPoints(points.data(), otherOut.data(), COUNT);
+		setSimdPath(path);
+		double e = 0.0;
+		for (size_t i = 0; i < COUNT; ++i) {
+			for (int k = 0; k < 16; ++k)
+				e = std::max(e, fabs(inverses[i].m[k] - otherInverses[i].m[k]) / (1.0 + fabs(inverses[i].m[k])));
+			for (int c = 0; c < 3; ++c)
+				e = std::max(e, fabs(pointsOut[i][c] - otherOut[i][c]) / (1.0 + fabs(pointsOut[i][c])));
+		}
+		checkBound("difference to the other path", e, 1e-4, __LINE__);
+	}
+}
+
+int main() {
+	Matrices matrices = makeMatrices();
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testMultiply(matrices);
+		testInverses(matrices);
+		testTransforms(matrices);
+	}
+	if (setSimdPath(ESimdPath::AVX2))
+		testPathsAgree(matrices, ESimdPath::SSE2);
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,112 @@
+// Diffing of reloaded config documents and the signals emitted by ConfigReloader::poll.
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "tt_config_reloader.h"
+#include "tt_test.h"
+
+using namespace TT;
+
+namespace {
+	typedef ConfigReloader::Change Change;
+
+	std::vector<ConfigReloader::Diff> diff(const TTJson::Value& before, const TTJson::Value& after) {
+		std::vector<ConfigReloader::Diff> changes;
+		ConfigReloader::diff(before, after, changes);
+		return changes;
+	}
+
+	bool has(const std::vector<ConfigReloader::Diff>& changes, const char* path, Change change) {
+		for (const ConfigReloader::Diff& diff : changes) {
+			if (diff.path == path && diff.change == change)
+				return true;
+		}
+		return false;
+	}
+
+	void testDiff() {
+		TTJson::Value before, after;
+		TTTest::parse(R"({"a": 1, "b": {"c": true, "d": [1, 2, 3]}, "e": "x", "n": NaN})", before);
+		TTTest::parse(R"({"a": 1, "b": {"c": false, "d": [1, 2]}, "f": null, "n": NaN})", after);
+		std::vector<ConfigReloader::Diff> changes = diff(before, after);
+		TT_CHECK(changes.size() == 4);
+		TT_CHECK(has(changes, "/b/c", Change::Modified));
+		TT_CHECK(has(changes, "/b/d/2", Change::Removed));
+		TT_CHECK(has(changes, "/e", Change::Removed));
+		TT_CHECK(has(changes, "/f", Change::Added));
+
+		// Diffs point into the compared trees.
+		for (const ConfigReloader::Diff& change : changes) {
+			if (change.path == "/b/c")
+				TT_CHECK(change.before->asBool() && !change.after->asBool());
+			if (change.path == "/f")
+				TT_CHECK(change.before == nullptr && change.after->isNull());
+		}
+
+		// Equal documents do not differ, a type change is reported at the changed value instead of inside it.
+		TT_CHECK(diff(before, before).empty());
+		TTJson::Value replaced;
+		TTTest::parse(R"({"a": 1, "b": 5, "e": "x", "n": NaN})", replaced);
+		changes = diff(before, replaced);
+		TT_CHECK(changes.size() == 1 && has(changes, "/b", Change::Modified));
+	}
+
+	void testPathEscaping() {
+		TTJson::str_t path;
+		TTJson::appendPathToken(path, TTJson::str_t("a/b~c"));
+		TT_CHECK(path == "/a~1b~0c");
+
+		TTJson::Value before, after;
+		TTTest::parse(R"({"x/y": 1})", before);
+		TTTest::parse(R"({"x/y": 2})", after);
+		TT_CHECK(has(diff(before, after), "/x~1y", Change::Modified));
+	}
+
+	long long shadowSize(const ConfigReloader& reloader) {
+		return reloader.document().asObject().get("render").asObject().get("shadows").asObject().get("size").asInt();
+	}
+
+	void testPoll() {
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "tt_config_reloader_test.json5";
+		auto write = [&path](const char* text) {
+			std::filesystem::file_time_type previous{};
+			if (std::filesystem::exists(path))
+				previous = std::filesystem::last_write_time(path);
+			std::ofstream(path, std::ios::binary) << text;
+			// Coarse file system timestamps could leave the write time unchanged.
+			if (std::filesystem::last_write_time(path) <= previous)
+				std::filesystem::last_write_time(path, previous + std::chrono::seconds(1));
+		};
+
+		write(R"({render: {shadows: {size: 1024}, vsync: true}})");
+		ConfigReloader reloader(path.string());
+		TT_CHECK(reloader.parseError().empty());
+		TT_CHECK(!reloader.poll());
+
+		std::vector<TTJson::str_t> all, watched;
+		reloader.changed.connect([&all](const ConfigReloader::Diff& diff) { all.push_back(diff.path); });
+		reloader.watch("/render/shadows").connect([&watched](const ConfigReloader::Diff& diff) { watched.push_back(diff.path); });
+
+		write(R"({render: {shadows: {size: 2048}, vsync: false}})");
+		TT_CHECK(reloader.poll());
+		TT_CHECK(all.size() == 2);
+		TT_CHECK(watched.size() == 1 && watched[0] == "/render/shadows/size");
+		TT_CHECK(shadowSize(reloader) == 2048);
+
+		// A file that fails to parse keeps the current document.
+		write(R"({render: {shadows: )");
+		TT_CHECK(!reloader.poll());
+		TT_CHECK(!reloader.parseError().empty());
+		TT_CHECK(shadowSize(reloader) == 2048);
+
+		std::filesystem::remove(path);
+	}
+}
+
+int main() {
+	testDiff();
+	testPathEscaping();
+	testPoll();
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,141 @@
+// Frustum planes against the clip space test, and the batch culls against the scalar tests on every SIMD path.
+#include "tt_frustum.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	const Mat44 VIEW_PROJECTION = Mat44::translate(-10.0f, -5.0f, 20.0f) * Mat44::rotateY(0.3f) * Mat44::perspectiveY(1.2f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	// Points are inside when -w <= x, y, z <= w in clip space. Returns false for points too close to a side to tell.
+	bool clipInside(const Mat44& viewProjection, Vec point, bool& inside) {
+		Vec4 clip = viewProjection * Vec4(point.x, point.y, point.z, 1.0f);
+		float margin = std::min({ clip.w - fabsf(clip.x), clip.w - fabsf(clip.y), clip.w - fabsf(clip.z) });
+		inside = margin >= 0.0f;
+		return fabsf(margin) > 1e-3f * (1.0f + fabsf(clip.w));
+	}
+
+	void testPlanes() {
+		const Mat44 projections[] = {
+			Mat44::perspectiveY(1.0f, 1.5f, 0.1f, 100.0f),
+			Mat44::frustum(-0.2f, 0.1f, -0.05f, 0.1f, 0.1f, 50.0f),
+			Mat44::orthoSymmetric(40.0f, 20.0f, 1.0f, 80.0f),
+			VIEW_PROJECTION,
+		};
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> random(-120.0f, 120.0f);
+		for (const Mat44& projection : projections) {
+			Frustum frustum(projection);
+			for (const Vec& plane : frustum.planes)
+				TT_CHECK(fabsf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z - 1.0f) < 1e-5f);
+			size_t tested = 0, inside = 0;
+			for (int i = 0; i < 20000; ++i) {
+				Vec point(random(rng), random(rng) * 0.5f, random(rng), 0.0f);
+				bool expected;
+				if (!clipInside(projection, point, expected))
+					continue;
+				++tested;
+				inside += expected;
+				TT_CHECK(frustum.isSphereVisible(point, 0.0f) == expected);
+				TT_CHECK(frustum.isBoxVisible(point, Vec(0.0f)) == expected);
+			}
+			TT_CHECK(tested > 15000 && inside > 100);
+		}
+	}
+
+	void testVolumes() {
+		// Looks down -z from the origin, the near plane is at z = -0.1 and the far plane at z = -100.
+		Frustum frustum(Mat44::perspectiveY(1.0f, 1.0f, 0.1f, 100.0f));
+		TT_CHECK(frustum.isSphereVisible(Vec(0.0f, 0.0f, -10.0f, 0.0f), 0.0f));
+		TT_CHECK(!frustum.isSphereVisible(Vec(0.0f, 0.0f, 10.0f, 0.0f), 1.0f));
+		TT_CHECK(!frustum.isSphereVisible(Vec(0.0f, 0.0f, -102.0f, 0.0f), 1.0f));
+		// Straddling the near, far and a side plane.
+		TT_CHECK(frustum.isSphereVisible(Vec(0.0f, 0.0f, 1.0f, 0.0f), 2.0f) && !frustum.isSphereVisible(Vec(0.0f, 0.0f, 1.0f, 0.0f), 0.5f));
+		TT_CHECK(frustum.isSphereVisible(Vec(0.0f, 0.0f, -101.0f, 0.0f), 2.0f));
+		TT_CHECK(frustum.isSphereVisible(Vec(12.0f, 0.0f, -10.0f, 0.0f), 7.0f) && !frustum.isSphereVisible(Vec(12.0f, 0.0f, -10.0f, 0.0f), 5.0f));
+		// tan(0.5) * 10 = 5.46 is the half width at z = -10, the box's x extent decides.
+		TT_CHECK(frustum.isBoxVisible(Vec(7.0f, 0.0f, -10.0f, 0.0f), Vec(2.0f, 0.1f, 0.1f, 0.0f)));
+		TT_CHECK(!frustum.isBoxVisible(Vec(7.0f, 0.0f, -10.0f, 0.0f), Vec(1.0f, 0.1f, 0.1f, 0.0f)));
+		TT_CHECK(!frustum.isBoxVisible(Vec(0.0f, 0.0f, 5.0f, 0.0f), Vec(1.0f, 1.0f, 4.0f, 0.0f)));
+		TT_CHECK(frustum.isBoxVisible(Vec(0.0f, 0.0f, 5.0f, 0.0f), Vec(1.0f, 1.0f, 6.0f, 0.0f)));
+	}
+
+	// The signed distance of a volume's closest point to the plane it is closest to crossing.
+	float boundaryDistance(const Frustum& frustum, Vec center, Vec extent, bool box) {
+		float d = INFINITY;
+		for (const Vec& p : frustum.planes) {
+			float radius = box ? fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z : extent.x;
+			d = std::min(d, fabsf(p.x * center.x + p.y * center.y + p.z * center.z + p.w + radius));
+		}
+		return d;
+	}
+
+	void testCulling() {
+		// Not a multiple of 32, so the last bit word and the last step are partial. Volumes within rounding of a plane are moved.
+		const size_t VOLUMES = 20011;
+		Frustum frustum(VIEW_PROJECTION);
+		std::mt19937 rng(9);
+		std::uniform_real_distribution<float> scene(-500.0f, 500.0f), size(0.5f, 5.0f);
+		std::vector<float> x(VOLUMES), y(VOLUMES), z(VOLUMES), ex(VOLUMES), ey(VOLUMES), ez(VOLUMES);
+		for (size_t i = 0; i < VOLUMES; ++i) {
+			do {
+				x[i] = scene(rng);
+				y[i] = scene(rng) * 0.1f;
+				z[i] = scene(rng);
+				ex[i] = size(rng);
+				ey[i] = size(rng);
+				ez[i] = size(rng);
+			} while (boundaryDistance(frustum, Vec(x[i], y[i], z[i], 0.0f), Vec(ex[i], ey[i], ez[i], 0.0f), false) < 1e-2f ||
+				boundaryDistance(frustum, Vec(x[i], y[i], z[i], 0.0f), Vec(ex[i], ey[i], ez[i], 0.0f), true) < 1e-2f);
+		}
+
+		for (bool box : { false, true }) {
+			std::vector<unsigned int> expected;
+			for (size_t i = 0; i < VOLUMES; ++i) {
+				Vec center(x[i], y[i], z[i], 0.0f);
+				if (box ? frustum.isBoxVisible(center, Vec(ex[i], ey[i], ez[i], 0.0f)) : frustum.isSphereVisible(center, ex[i]))
+					expected.push_back((unsigned int)i);
+			}
+			TT_CHECK(expected.size() > 1000 && expected.size() < VOLUMES / 2);
+
+			auto cull = [&](unsigned int* bits, unsigned int* indices) {
+				return box ? frustum.cullBoxes(x.data(), y.data(), z.data(), ex.data(), ey.data(), ez.data(), VOLUMES, bits, indices)
+					: frustum.cullSpheres(x.data(), y.data(), z.data(), ex.data(), VOLUMES, bits, indices);
+			};
+			std::vector<unsigned int> bits((VOLUMES + 31) / 32, ~0u), indices(VOLUMES);
+			TT_CHECK(cull(bits.data(), indices.data()) == expected.size());
+			TT_CHECK(std::equal(expected.begin(), expected.end(), indices.begin()));
+			std::vector<unsigned int> expectedBits((VOLUMES + 31) / 32);
+			for (unsigned int i : expected)
+				expectedBits[i / 32] |= 1u << (i % 32);
+			TT_CHECK(bits == expectedBits);
+
+			// Either output alone.
+			std::fill(bits.begin(), bits.end(), ~0u);
+			TT_CHECK(cull(bits.data(), nullptr) == expected.size() && bits == expectedBits);
+			std::fill(indices.begin(), indices.end(), 0u);
+			TT_CHECK(cull(nullptr, indices.data()) == expected.size() && std::equal(expected.begin(), expected.end(), indices.begin()));
+			TT_CHECK(cull(nullptr, nullptr) == expected.size());
+		}
+		TT_CHECK(frustum.cullSpheres(x.data(), y.data(), z.data(), ex.data(), 0, nullptr, nullptr) == 0);
+	}
+}
+
+int main() {
+	testPlanes();
+	testVolumes();
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testCulling();
+	}
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,576 @@
+// Parse options of tt_json5.h: every option must produce the same document as a plain parse, only stored differently.
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tt_test.h"
+
+using namespace TTJson;
+
+namespace {
+	void testLazyNumbers() {
+		ParseOptions lazy;
+		lazy.lazyNumbers = true;
+
+		const char* numbers = "[0, -0, 1, -17, 3.25, -1e3, 2E-2, .5, 5., 0x1F, +4, 9223372036854775807, -9223372036854775808]";
+		Value eager, deferred;
+		TT_CHECK(TTTest::parse(numbers, eager).empty());
+		TT_CHECK(TTTest::parse(numbers, deferred, lazy).empty());
+		const Array& a = eager.asArray();
+		// Read through a const reference, which converts and caches the number.
+		const Array& b = deferred.asArray();
+		TT_CHECK(a.size() == b.size());
+		for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+			TT_CHECK(a[i].getType() == b[i].getType());
+			if (a[i].isInt())
+				TT_CHECK(a[i].asInt() == b[i].asInt());
+			else
+				TT_CHECK(a[i].asDouble() == b[i].asDouble());
+		}
+		TT_CHECK(b[3].asInt() == -17 && b[4].asDouble() == 3.25);
+		TT_CHECK(b[11].asInt() == 9223372036854775807ll && b[12].asInt() == -9223372036854775807ll - 1);
+
+		// Copies of an unconverted number convert on their own.
+		Value document;
+		TT_CHECK(TTTest::parse("[42, 0.5]", document, lazy).empty());
+		Value copy = document;
+		TT_CHECK(copy.asArray()[0].asInt() == 42 && copy.asArray()[1].asDouble() == 0.5);
+		TT_CHECK(TTTest::serialize(document) == "[42,0.5]");
+	}
+
+	void testNumberLimits() {
+		ParseOptions lazy;
+		lazy.lazyNumbers = true;
+		for (const ParseOptions& options : { ParseOptions{}, lazy }) {
+			// Integers beyond long long become doubles instead of failing, doubles beyond the scalar range saturate.
+			Value document;
+			TT_CHECK(TTTest::parse("[9223372036854775808, -9223372036854775809, 1e400, -1e400, 1e-400]", document, options).empty());
+			const Array& array = document.asArray();
+			TT_CHECK(array[0].isDouble() && array[0].asDouble() == 9223372036854775808.0);
+			TT_CHECK(array[1].isDouble() && array[1].asDouble() == -9223372036854775808.0);
+			TT_CHECK(std::isinf(array[2].asDouble()) && array[2].asDouble() > 0);
+			TT_CHECK(std::isinf(array[3].asDouble()) && array[3].asDouble() < 0);
+			TT_CHECK(array[4].asDouble() == 0);
+		}
+	}
+
+	void testInvalidNumbers() {
+		ParseOptions lazy;
+		lazy.lazyNumbers = true;
+		for (const char* text : { "[-]", "[1e]", "[1e+]", "[01]", "[1.2.3]", "[0x]", "[+-1]", "[1e.5]", "[.]" }) {
+			Value eager, deferred;
+			TTJson::str_t eagerError = TTTest::parse(text, eager);
+			TT_CHECK(!eagerError.empty());
+			TT_CHECK(TTTest::parse(text, deferred, lazy) == eagerError);
+		}
+	}
+
+	TTJson::str_t nested(size_t depth, const char* open, const char* value, const char* close) {
+		TTJson::str_t text;
+		for (size_t i = 0; i < depth; ++i)
+			text += open;
+		text += value;
+		for (size_t i = 0; i < depth; ++i)
+			text += close;
+		return text;
+	}
+
+	bool contains(const TTJson::str_t& text, const char* part) {
+		return text.find(part) != TTJson::str_t::npos;
+	}
+
+	struct CountingHandler : SaxHandler {
+		size_t containers = 0;
+		size_t depth = 0;
+		size_t maxDepth = 0;
+		void beginObject() override { ++containers; maxDepth = std::max(maxDepth, ++depth); }
+		void beginArray() override { ++containers; maxDepth = std::max(maxDepth, ++depth); }
+		void endObject() override { --depth; }
+		void endArray() override { --depth; }
+	};
+
+	void testDepth() {
+		// Far deeper than the call stack would allow when parsing or destroying recursively.
+		const size_t deep = 200000;
+		ParseOptions unlimited;
+		unlimited.maxDepth = deep;
+		{
+			Value document;
+			TT_CHECK(TTTest::parse(nested(deep, "[", "1", "]"), document, unlimited).empty());
+			const Value* inner = &document;
+			size_t depth = 0;
+			while (inner->isArray()) {
+				inner = &inner->asArray()[0];
+				++depth;
+			}
+			TT_CHECK(depth == deep && inner->asInt() == 1);
+		}
+		{
+			Value document;
+			TT_CHECK(TTTest::parse(nested(deep, "{\"a\":", "null", "}"), document, unlimited).empty());
+			TT_CHECK(document.asObject().get("a").asObject().size() == 1);
+		}
+
+		// maxDepth counts the containers, one more than allowed fails with the same error for documents and events.
+		ParseOptions limited;
+		limited.maxDepth = 3;
+		Value document;
+		TT_CHECK(TTTest::parse(nested(3, "[", "", "]"), document, limited).empty());
+		TTJson::str_t error = TTTest::parse(nested(4, "[", "", "]"), document, limited);
+		TT_CHECK(contains(error, "Exceeded maximum nesting depth."));
+
+		CountingHandler handler;
+		TTJson::sstr_t stream(nested(4, "{\"k\":[", "", "]}"));
+		Parser parser(limited);
+		parser.parse(stream, handler);
+		TT_CHECK(parser.hasError() && contains(parser.error(), "Exceeded maximum nesting depth."));
+
+		CountingHandler deepHandler;
+		TTJson::sstr_t deepStream(nested(deep, "[", "", "]"));
+		Parser deepParser(unlimited);
+		deepParser.parse(deepStream, deepHandler);
+		TT_CHECK(!deepParser.hasError() && deepHandler.containers == deep && deepHandler.maxDepth == deep && deepHandler.depth == 0);
+	}
+
+	void testWide() {
+		TTJson::str_t text = "[";
+		for (int i = 0; i < 100000; ++i)
+			text += "{\"i\": " + std::to_string(i) + "},";
+		text += "]";
+		Value document;
+		TT_CHECK(TTTest::parse(text, document).empty());
+		TT_CHECK(document.asArray().size() == 100000 && document.asArray()[99999].asObject().get("i").asInt() == 99999);
+	}
+
+	void testErrors() {
+		// Messages and positions of the state machine, for documents and for events.
+		const char* cases[][2] = {
+			{ "[1 2]", "Expected ']' instead of '2'." },
+			{ "{\"a\" 1}", "Expected ':' instead of '1'." },
+			{ "{\"a\": 1 \"b\": 2}", "Expected '}' instead of '\"'." },
+			{ "[1] 2", "Unexpected '2' after value. Expected end of file." },
+		};
+		for (const auto& testCase : cases) {
+			Value document;
+			TTJson::str_t error = TTTest::parse(testCase[0], document);
+			TT_CHECK(contains(error, testCase[1]));
+
+			SaxHandler handler;
+			TTJson::sstr_t stream(testCase[0]);
+			Parser parser;
+			parser.parse(stream, handler);
+			TT_CHECK(parser.hasError() && parser.error() == error);
+		}
+	}
+
+	// Writes every event as text, to compare the events of the parser with those visit() produces for the parsed document.
+	struct RecordingHandler : SaxHandler {
+		std::string events;
+		void null() override { events += "null "; }
+		void boolean(bool value) override { events += value ? "true " : "false "; }
+		void integer(long long value) override { events += "i" + std::to_string(value) + " "; }
+		void number(scalar value) override { events += "d" + std::to_string(value) + " "; }
+		void string(const TTJson::str_t& value) override { events += "s" + value + " "; }
+		void key(const TTJson::str_t& key) override { events += "k" + key + " "; }
+		void beginObject() override { events += "{ "; }
+		void endObject() override { events += "} "; }
+		void beginArray() override { events += "[ "; }
+		void endArray() override { events += "] "; }
+	};
+
+	void testEvents() {
+		// Every number is parsed into the same value by the event parser, none may see the digits of the one before.
+		// Objects have a single key, visit() emits members in map order.
+		const char* texts[] = {
+			"[5, 0x10]",
+			"[0x1F, -0x10, 1.5, 7, 0xff, -2, 0X0]",
+			"[{\"a\": [1, 0x2, 3.5]}, {\"b\": {\"c\": 0x10}}, [true, null, -0.25, \"x\"]]",
+		};
+		ParseOptions lazy;
+		lazy.lazyNumbers = true;
+		for (const char* text : texts) {
+			for (const ParseOptions& options : { ParseOptions{}, lazy }) {
+				Value document;
+				TT_CHECK(TTTest::parse(text, document, options).empty());
+				RecordingHandler fromDocument;
+				visit(document, fromDocument);
+
+				RecordingHandler fromText;
+				TTJson::sstr_t stream(text);
+				Parser parser(options);
+				parser.parse(stream, fromText);
+				TT_CHECK(!parser.hasError() && fromText.events == fromDocument.events);
+			}
+		}
+
+		Value document;
+		TT_CHECK(TTTest::parse(texts[1], document).empty());
+		const Array& numbers = document.asArray();
+		TT_CHECK(numbers[0].asInt() == 31 && numbers[1].asInt() == -16 && numbers[4].asInt() == 255 && numbers[6].asInt() == 0);
+	}
+
+	void testShapedArrays() {
+		ParseOptions shaped;
+		shaped.shapedArrays = true;
+		const char* text = R"([{"id": 1, "name": "a", "tags": [1, 2]}, {"name": "b", "id": 2, "tags": []}, {"id": 3, "name": "c", "tags": [3]}])";
+		Value plain, document;
+		TT_CHECK(TTTest::parse(text, plain).empty());
+		TT_CHECK(TTTest::parse(text, document, shaped).empty());
+		TT_CHECK(TTTest::equal(plain, document));
+		TT_CHECK(TTTest::serialize(document) == TTTest::serialize(Value(document)));
+
+		const std::vector<Value>* ids = document.column("id");
+		TT_CHECK(ids && ids->size() == 3 && (*ids)[2].asInt() == 3);
+		TT_CHECK(document.column("missing") == nullptr && !document.isPacked());
+
+		// The elements are regular objects once the array is read.
+		const Array& array = document.asArray();
+		TT_CHECK(document.column("id") == nullptr);
+		TT_CHECK(array.size() == 3 && array[1].asObject().get("name").asString() == "b" && array[1].asObject().size() == 3);
+		TT_CHECK(TTTest::equal(plain, document));
+
+		// Mixed arrays are regular.
+		Value mixed;
+		TT_CHECK(TTTest::parse(R"([{"a": 1}, {"b": 2}, 3])", mixed, shaped).empty());
+		TT_CHECK(mixed.column("a") == nullptr && mixed.asArray()[1].asObject().get("b").asInt() == 2);
+	}
+
+	void testShapedCopies() {
+		ParseOptions shaped;
+		shaped.shapedArrays = true;
+		Value document;
+		TT_CHECK(TTTest::parse(R"({"rows": [{"x": 1, "y": 2}, {"x": 3, "y": 4}]})", document, shaped).empty());
+		const Value original = document;
+		const Value& rows = document.asObject().get("rows");
+
+		// A copied document has its own columns, writing through it does not change the original.
+		Value copy = document;
+		Value& copiedRows = copy.asObject().get("rows");
+		TT_CHECK(copiedRows.column("x") && copiedRows.column("x") != rows.column("x"));
+		copiedRows.asArray()[0].asObject()["x"] = Value(10ll);
+		copiedRows.asArray()[1].asObject().get("y").asInt() = 40;
+		TT_CHECK(copiedRows.asArray()[0].asObject().get("x").asInt() == 10 && rows.column("x") && (*rows.column("x"))[0].asInt() == 1);
+		TT_CHECK(TTTest::equal(document, original));
+
+		Value assigned;
+		assigned = document;
+		assigned.asObject().get("rows").asArray()[1].asObject()["x"] = Value(30ll);
+		TT_CHECK(TTTest::equal(document, original));
+
+		// Moving keeps the columns.
+		Value moved = std::move(copy);
+		TT_CHECK(moved.asObject().get("rows").asArray().size() == 2 && original.asObject().get("rows").column("y"));
+	}
+
+	void testShapedModification() {
+		ParseOptions shaped;
+		shaped.shapedArrays = true;
+		const char* text = R"([{"x": 1, "y": 2}, {"x": 3, "y": 4}, {"x": 5, "y": 6}])";
+
+		// The converted elements work like those of any array, including through a std::vector reference.
+		Value document;
+		TT_CHECK(TTTest::parse(text, document, shaped).empty());
+		std::vector<Value>& elements = document.asArray();
+		TT_CHECK(elements.size() == 3 && elements[2].asObject().get("y").asInt() == 6);
+		elements[0].asObject()["z"] = Value(true);
+		elements.erase(elements.begin() + 1);
+		elements.push_back(Value(7ll));
+		TT_CHECK(elements.size() == 3);
+		TT_CHECK(elements[0].asObject().size() == 3 && elements[1].asObject().get("x").asInt() == 5 && elements[2].asInt() == 7);
+
+		// Assigning over a shaped array or one of its elements replaces it.
+		Value replaced;
+		TT_CHECK(TTTest::parse(text, replaced, shaped).empty());
+		replaced.asArray()[1] = Value(Object());
+		TT_CHECK(replaced.asArray()[1].asObject().empty() && replaced.asArray()[2].asObject().get("x").asInt() == 5);
+		Value overwritten;
+		TT_CHECK(TTTest::parse(text, overwritten, shaped).empty());
+		overwritten = Value(1ll);
+		TT_CHECK(overwritten.column("x") == nullptr && overwritten.asInt() == 1);
+		TT_CHECK(TTTest::parse(text, overwritten, shaped).empty() && overwritten.column("x"));
+		overwritten = overwritten.column("y")->at(1);
+		TT_CHECK(overwritten.isInt() && overwritten.asInt() == 4);
+	}
+
+	void testPackedArrays() {
+		ParseOptions packed;
+		packed.packedNumericArrays = true;
+		ParseOptions both = packed;
+		both.shapedArrays = true;
+		ParseOptions all = both;
+		all.lazyNumbers = true;
+
+		const char* texts[] = {
+			"[1, 2, 3]",
+			"[1, 2.5, -3]",
+			"[0.5, 1, 2]",
+			"[1, \"x\", 2]",
+			"[1, {\"a\": 1}, {\"a\": 2}]",
+			"[{\"a\": [1, 2]}, {\"a\": [3]}]",
+			"[[1, 2], [3, 4]]",
+			"[9007199254740993, 0.5]",
+			"[]",
+		};
+		for (const char* text : texts) {
+			Value plain;
+			TT_CHECK(TTTest::parse(text, plain).empty());
+			for (const ParseOptions& options : { packed, both, all }) {
+				Value document;
+				TT_CHECK(TTTest::parse(text, document, options).empty());
+				TT_CHECK(TTTest::equal(plain, document));
+				TT_CHECK(TTTest::serialize(plain) == TTTest::serialize(document));
+			}
+		}
+
+		// Both options on an array of numbers only packs it.
+		Value document;
+		TT_CHECK(TTTest::parse("[1,2,3]", document, both).empty());
+		TT_CHECK(document.isPacked() && document.ints().size() == 3 && document.ints()[2] == 3 && document.column("a") == nullptr);
+
+		// Reading the elements converts them, size(), operator[] and iteration all see the numbers.
+		const Array& ints = document.asArray();
+		TT_CHECK(!document.isPacked() && document.ints().empty());
+		TT_CHECK(ints.size() == 3 && ints[0].asInt() == 1 && ints[2].asInt() == 3);
+		long long sum = 0;
+		for (const Value& element : ints)
+			sum += element.asInt();
+		TT_CHECK(sum == 6 && TTTest::serialize(document) == "[1,2,3]");
+
+		Value mixed;
+		TT_CHECK(TTTest::parse("[1, 2.5, -3]", mixed, both).empty());
+		TT_CHECK(mixed.isPacked() && mixed.ints().empty() && mixed.doubles().size() == 3);
+		TT_CHECK(TTTest::serialize(mixed) == "[1,2.5,-3]");
+		TT_CHECK(mixed.asArray()[0].isInt() && mixed.asArray()[1].asDouble() == 2.5);
+
+		// Integers a double can not hold exactly stay regular elements.
+		Value large;
+		TT_CHECK(TTTest::parse("[9007199254740993, 0.5]", large, both).empty());
+		TT_CHECK(!large.isPacked() && large.asArray()[0].asInt() == 9007199254740993ll);
+
+		Value nested;
+		TT_CHECK(TTTest::parse(R"([{"a": [1, 2]}, {"a": [3]}])", nested, both).empty());
+		const std::vector<Value>* column = nested.column("a");
+		TT_CHECK(column && (*column)[0].isPacked() && (*column)[1].ints()[0] == 3);
+	}
+
+	void testPackedCopies() {
+		ParseOptions packed;
+		packed.packedNumericArrays = true;
+		Value document;
+		TT_CHECK(TTTest::parse("[1, 2, 3]", document, packed).empty());
+
+		Value copy = document;
+		TT_CHECK(copy.isPacked() && copy.ints().data() != document.ints().data());
+		copy.asArray().push_back(Value(4ll));
+		TT_CHECK(!copy.isPacked() && copy.asArray().size() == 4 && copy.asArray()[3].asInt() == 4);
+		TT_CHECK(document.isPacked() && document.ints().size() == 3);
+
+		Array elements = document.asArray();
+		elements.erase(elements.begin());
+		TT_CHECK(elements.size() == 2 && elements[0].asInt() == 2);
+		TT_CHECK(TTTest::serialize(document) == "[1,2,3]");
+	}
+
+	void testHashedKeys() {
+		ParseOptions shaped;
+		shaped.shapedArrays = true;
+		StringPool pool;
+		ParseOptions pooled;
+		pooled.stringPool = &pool;
+
+		const char* text = R"([{"width": 640, "height": 480.5, "name": "main", "flags": [1], "size": {"w": 1}, "on": true}, {"width": 800, "height": 600.0, "name": "b", "flags": [], "size": {}, "on": false}])";
+		for (const ParseOptions& options : { ParseOptions{}, shaped, pooled }) {
+			Value document;
+			TT_CHECK(TTTest::parse(text, document, options).empty());
+			const Object& object = document.asArray()[0].asObject();
+			TT_CHECK(object.tryGetInt(TT_HASHED_STRING("width")) && *object.tryGetInt(TT_HASHED_STRING("width")) == 640);
+			TT_CHECK(object.tryGetDouble(TT_HASHED_STRING("height")) && *object.tryGetDouble(TT_HASHED_STRING("height")) == 480.5);
+			TT_CHECK(object.tryGetString(TT_HASHED_STRING("name")) && *object.tryGetString(TT_HASHED_STRING("name")) == "main");
+			TT_CHECK(object.tryGetArray(TT_HASHED_STRING("flags")) && object.tryGetObject(TT_HASHED_STRING("size")));
+			TT_CHECK(object.tryGetBool(TT_HASHED_STRING("on")) && *object.tryGetBool(TT_HASHED_STRING("on")));
+			TT_CHECK(object.get(TT_HASHED_STRING("width")).asInt() == object.get("width").asInt());
+			TT_CHECK(&object.get(TT_HASHED_STRING("name")) == object.tryGet("name"));
+
+			// Misses and type mismatches.
+			TT_CHECK(object.tryGet(TT_HASHED_STRING("depth")) == nullptr && object.tryGet(TT_HASHED_STRING("Width")) == nullptr);
+			TT_CHECK(object.tryGetInt(TT_HASHED_STRING("name")) == nullptr && object.tryGetString(TT_HASHED_STRING("width")) == nullptr);
+			TT_CHECK(object.get(TT_HASHED_STRING("depth")).isNull());
+
+			// Writes through the hashed lookup are visible to string lookups.
+			Value& width = document.asArray()[1].asObject().get(TT_HASHED_STRING("width"));
+			width.asInt() = 1024;
+			TT_CHECK(*document.asArray()[1].asObject().tryGetInt("width") == 1024);
+		}
+
+		// The parsed key's crc matches the compile time hash, for every length the runtime crc splits into 8 and 4 byte steps.
+		ObjectKey key(TTJson::str_t("width"));
+		TT_CHECK(key.crc == TT_STRING_HASH("width"));
+		TT_CHECK(ObjectKey(TTJson::str_t("shadowCascadeCount")).crc == TT_STRING_HASH("shadowCascadeCount"));
+		TT_CHECK(ObjectKey(TTJson::str_t("maxAnisotropy")).crc == TT_STRING_HASH("maxAnisotropy"));
+		TT_CHECK(ObjectKey(TTJson::str_t("")).crc == TT_STRING_HASH(""));
+		Object object;
+		object["height"] = Value(2ll);
+		TT_CHECK(object.tryGetInt(TT_HASHED_STRING("height")) && *object.tryGetInt(TT_HASHED_STRING("height")) == 2);
+
+		// These two keys have the same crc32, release builds only compare that, debug builds also compare the text.
+		object["plumless"] = Value(3ll);
+		TT_CHECK(TT_STRING_HASH("plumless") == TT_STRING_HASH("buckeroo"));
+		TT_CHECK(object.tryGet("buckeroo") == nullptr);
+#ifdef _DEBUG
+		TT_CHECK(object.tryGet(TT_HASHED_STRING("buckeroo")) == nullptr);
+#else
+		TT_CHECK(object.tryGet(TT_HASHED_STRING("buckeroo")) == object.tryGet("plumless"));
+#endif
+	}
+
+	void testStringPool() {
+		StringPool pool;
+		ParseOptions pooled;
+		pooled.stringPool = &pool;
+		pooled.internMaxLength = 8;
+
+		const char* text = R"([{"type": "mesh", "name": "a long mesh name"}, {"type": "mesh", "name": "light"}, {"type": "light", "name": "a long mesh name"}])";
+		Value plain, document;
+		TT_CHECK(TTTest::parse(text, plain).empty());
+		TT_CHECK(TTTest::parse(text, document, pooled).empty());
+		TT_CHECK(TTTest::equal(plain, document));
+		// "type", "name", "mesh" and "light", the long name is not interned.
+		TT_CHECK(pool.size() == 4);
+
+		// Equal strings share the pooled text until one of them is modified.
+		const Array& array = document.asArray();
+		TT_CHECK(&array[0].asObject().get("type").asString() == &array[1].asObject().get("type").asString());
+		TT_CHECK(&array[0].asObject().get("name").asString() != &array[2].asObject().get("name").asString());
+		Value& type = document.asArray()[1].asObject().get("type");
+		type.asString() += "es";
+		TT_CHECK(type.asString() == "meshes" && array[0].asObject().get("type").asString() == "mesh");
+		TT_CHECK(pool.size() == 4);
+
+		// Pools can be shared by documents, combined with the other options.
+		ParseOptions combined = pooled;
+		combined.shapedArrays = true;
+		combined.packedNumericArrays = true;
+		combined.lazyNumbers = true;
+		Value second;
+		TT_CHECK(TTTest::parse(R"([{"type": "mesh", "size": [1, 2]}, {"type": "camera", "size": [3]}])", second, combined).empty());
+		TT_CHECK(pool.size() == 6);
+		const std::vector<Value>* types = second.column("type");
+		TT_CHECK(types && (*types)[1].asString() == "camera");
+		TT_CHECK(&(*types)[0].asString() == &array[0].asObject().get("type").asString());
+
+		// Copies reference the same pool.
+		Value copy = second;
+		TT_CHECK(TTTest::equal(copy, second) && copy.asArray()[0].asObject().get("type").asString() == "mesh");
+		TT_CHECK(&std::as_const(copy).asArray()[1].asObject().get("type").asString() == &(*types)[1].asString());
+	}
+	bool sameSpan(const SourceSpan& a, const SourceSpan& b) {
+		if (a.length != b.length || a.offsets != b.offsets || a.keys != b.keys || a.children.size() != b.children.size())
+			return false;
+		for (size_t i = 0; i < a.children.size(); ++i) {
+			if (!sameSpan(a.children[i], b.children[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// Replaces removed characters at offset with inserted ones and reparses, the document and map must match a fresh parse of the new text.
+	// Returns the reparse error.
+	str_t edit(const char* before, size_t offset, size_t removed, const char* inserted, const ParseOptions& base = {}) {
+		ParseOptions options = base;
+		SourceMap map;
+		options.sourceMap = &map;
+		Value document;
+		TT_CHECK(TTTest::parse(before, document, options).empty());
+
+		str_t text = before;
+		text.replace(offset, removed, inserted);
+		Parser parser(options);
+		parser.reparse(text, offset, removed, str_t(inserted).size(), document, map);
+		SourceMap freshMap;
+		options.sourceMap = &freshMap;
+		Value fresh;
+		const str_t error = TTTest::parse(text, fresh, options);
+		TT_CHECK(parser.hasError() == !error.empty());
+		if (parser.hasError()) {
+			// On error the document and map are left unchanged.
+			SourceMap originalMap;
+			options.sourceMap = &originalMap;
+			Value original;
+			TTTest::parse(before, original, options);
+			TT_CHECK(TTTest::equal(document, original) && map.offset == originalMap.offset && sameSpan(map.root, originalMap.root));
+			return parser.error();
+		}
+		TT_CHECK(TTTest::equal(document, fresh));
+		TT_CHECK(map.offset == freshMap.offset && sameSpan(map.root, freshMap.root));
+		return {};
+	}
+
+	void testReparse() {
+		const char* text = R"({"name": "mesh", "size": [1, 22, 333], "nested": {"a": [true, {"b": null}], "c": 4.5}})";
+		// Inside scalars, including extending them at either end.
+		TT_CHECK(edit(text, 10, 4, "light").empty());
+		TT_CHECK(edit(text, 34, 0, "3").empty());
+		TT_CHECK(edit(text, 33, 3, "-0.5e2").empty());
+		TT_CHECK(edit(text, 84, 0, "25").empty());
+		TT_CHECK(edit(text, 31, 2, "").empty());
+
+		// Between array elements: adding, removing and replacing elements.
+		TT_CHECK(edit(text, 26, 0, "0, ").empty());
+		TT_CHECK(edit(text, 36, 0, ", 4444").empty());
+		TT_CHECK(edit(text, 26, 3, "").empty());
+		TT_CHECK(edit(text, 29, 7, "[], {}").empty());
+		TT_CHECK(edit(text, 26, 10, "").empty());
+		TT_CHECK(edit("[]", 1, 0, "1, 2").empty());
+		TT_CHECK(edit("[[1], [2], [3]]", 6, 3, "[2, 2]").empty());
+
+		// Objects: values, keys and members.
+		TT_CHECK(edit(text, 56, 4, "false").empty());
+		TT_CHECK(edit(text, 51, 1, "renamed").empty());
+		TT_CHECK(edit(text, 17, 22, "").empty());
+		TT_CHECK(edit(text, 50, 0, "\"z\": {}, ").empty());
+		TT_CHECK(edit(R"({"a": 1, "a": 2})", 6, 1, "3").empty());
+		TT_CHECK(edit(R"({"a": 1, "a": 2})", 14, 1, "3").empty());
+
+		// Edits that change the structure around them are reparsed by an enclosing value, or the whole text.
+		TT_CHECK(edit(text, 25, 12, "{\"x\": 1}").empty());
+		TT_CHECK(edit(text, 0, 0, " ").empty());
+		TT_CHECK(edit(text, 0, 86, "[1]").empty());
+		TT_CHECK(edit("[1, 2]", 5, 1, ", 3]").empty());
+		TT_CHECK(edit("\"x\"", 0, 3, "{}").empty());
+
+		// Errors leave the document alone.
+		TT_CHECK(!edit(text, 10, 0, "\"").empty());
+		TT_CHECK(!edit(text, 26, 1, "x").empty());
+		TT_CHECK(!edit(text, 25, 1, "{\"x\": ").empty());
+		TT_CHECK(!edit(text, 85, 1, "").empty());
+		TT_CHECK(!edit("[1, 2]", 2, 2, "]").empty());
+
+		// Together with the options that change how values are stored.
+		ParseOptions options;
+		options.lazyNumbers = true;
+		options.shapedArrays = true;
+		options.packedNumericArrays = true;
+		TT_CHECK(edit(R"([{"x": 1, "y": 2}, {"x": 3, "y": 4}])", 7, 1, "10", options).empty());
+		TT_CHECK(edit(R"({"p": [1.5, 2.5, 3.5]})", 12, 3, "7", options).empty());
+	}
+}
+
+int main() {
+	testLazyNumbers();
+	testNumberLimits();
+	testInvalidNumbers();
+	testDepth();
+	testWide();
+	testErrors();
+	testEvents();
+	testShapedArrays();
+	testShapedCopies();
+	testShapedModification();
+	testPackedArrays();
+	testPackedCopies();
+	testHashedKeys();
+	testStringPool();
+	testReparse();
+	return TT_TEST_RESULT;
+}
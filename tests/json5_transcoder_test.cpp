@@ -0,0 +1,74 @@
+// transcodeJson5() against expected output, and against the document parser for the same input.
+#include "tt_json5_transcoder.h"
+#include "tt_test.h"
+
+using namespace TT;
+
+namespace {
+	std::string transcode(const std::string& input, Json5Output format = Json5Output::Json) {
+		std::string output;
+		std::string error;
+		bool success = transcodeJson5(input, output, format, &error);
+		TT_CHECK(success == error.empty());
+		return success ? output : "error: " + error;
+	}
+
+	void testConversion() {
+		TT_CHECK(transcode("{ a: 1, 'b': \"x\", // comment\n c: [true, false, null,], /* block */ }") == R"({"a":1,"b":"x","c":[true,false,null]})");
+		TT_CHECK(transcode("['it\\'s', \"\\x41\\u0042\", 'line\\\ncontinued']") == R"(["it's","\u0041\u0042","linecontinued"])");
+		TT_CHECK(transcode("[0x1F, -0x10, +1, .5, 5., -.5e3, 0, -0, 0.25, 1e+2]") == "[31,-16,1,0.5,5.0,-0.5e3,0,-0,0.25,1e+2]");
+		TT_CHECK(transcode("[0x1F, +1, .5, 5., Infinity, -NaN]", Json5Output::Json5) == "[0x1F,+1,.5,5.,Infinity,-NaN]");
+		TT_CHECK(transcode("{}") == "{}" && transcode(" [ ] ") == "[]" && transcode("\"\"") == R"("")");
+
+		// The document parser reads the same values from the input and the json output.
+		const char* inputs[] = { "{ a: { b: [1, 2.5, 'three'] }, c: -.5, d: {}, }", "[[[]], [{}], 'x\\ty', 1e-3]" };
+		for (const char* input : inputs) {
+			TTJson::Value expected;
+			TTJson::Value actual;
+			TT_CHECK(TTTest::parse(input, expected).empty());
+			TT_CHECK(TTTest::parse(transcode(input), actual).empty());
+			TT_CHECK(TTTest::equal(expected, actual));
+		}
+	}
+
+	void testInvalidNumbers() {
+		TT_CHECK(transcode("[01]") == "error: line: 1, column: 3. Leading zeros are not allowed.");
+		TT_CHECK(transcode("[00.5]") == "error: line: 1, column: 3. Leading zeros are not allowed.");
+		TT_CHECK(transcode("[-012]") == "error: line: 1, column: 4. Leading zeros are not allowed.");
+		TT_CHECK(transcode("{a: +00}", Json5Output::Json5) == "error: line: 1, column: 7. Leading zeros are not allowed.");
+		TT_CHECK(transcode("[0x]") == "error: line: 1, column: 4. Expected hexadecimal digits.");
+		TT_CHECK(transcode("[1e]") == "error: line: 1, column: 4. Expected exponent digits.");
+		TT_CHECK(transcode("[.]") == "error: line: 1, column: 2. Unexpected character.");
+		TT_CHECK(transcode("[0x10000000000000000]").find("Hexadecimal number is too large.") != std::string::npos);
+		TT_CHECK(transcode("[Infinity]") == "error: line: 1, column: 2. Infinity and NaN can not be represented in json.");
+	}
+
+	void testInvalidInput() {
+		// The output is left as is on failure.
+		std::string output = "kept";
+		TT_CHECK(!transcodeJson5("[1, 2", output) && output == "kept");
+
+		// Every truncation of a valid document fails.
+		const std::string document = "{ a: [1, 'two', { b: null }], /* c */ d: 0x1, }";
+		TT_CHECK(!transcode(document).starts_with("error"));
+		for (size_t length = 0; length < document.size() - 1; ++length)
+			TT_CHECK(transcode(document.substr(0, length)).starts_with("error"));
+
+		TT_CHECK(transcode("") == "error: line: 1, column: 1. Unexpected end of input.");
+		TT_CHECK(transcode("[1,\n 2") == "error: line: 2, column: 3. Unexpected end of input.");
+		TT_CHECK(transcode("/* open") == "error: line: 1, column: 1. Unterminated block comment.");
+		TT_CHECK(transcode("['open") == "error: line: 1, column: 7. Unterminated string.");
+		TT_CHECK(transcode("[1] 2") == "error: line: 1, column: 5. Unexpected '2' after value. Expected end of file.");
+		TT_CHECK(transcode("{a 1}") == "error: line: 1, column: 4. Expected ':'.");
+		TT_CHECK(transcode("[1 2]") == "error: line: 1, column: 4. Expected ',' or ']'.");
+		TT_CHECK(transcode("[}") == "error: line: 1, column: 2. Expected ',' or ']'.");
+		TT_CHECK(transcode("['\\1']") == "error: line: 1, column: 4. Octal escape sequences are not allowed.");
+	}
+}
+
+int main() {
+	testConversion();
+	testInvalidNumbers();
+	testInvalidInput();
+	return TT_TEST_RESULT;
+}
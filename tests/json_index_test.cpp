@@ -0,0 +1,106 @@
+// JsonIndex over files written to the temp directory.
+#include "tt_json_index.h"
+#include "tt_test.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace TT;
+
+namespace {
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tt_json_index_test.json5";
+
+	void write(const std::string& text) {
+		std::ofstream(path, std::ios::binary) << text;
+	}
+
+	// The build error, or "" on success.
+	std::string build(const std::string& text, JsonIndex& index, size_t maxDepth = 2) {
+		write(text);
+		std::string error;
+		bool success = index.build(path.string(), maxDepth, &error);
+		TT_CHECK(success == error.empty());
+		return error;
+	}
+
+	std::string build(const std::string& text) {
+		JsonIndex index;
+		return build(text, index);
+	}
+
+	void testRead() {
+		JsonIndex index;
+		TT_CHECK(build(R"({
+  // Comments and json5 syntax are skipped by the scanner.
+  "a/b": { 'c~d': [1, 2, { deep: "A😀" }] },
+  list: [10, 20, 30], /* block */
+})", index).empty());
+		TT_CHECK(index.find("") && index.find("/a~1b") && index.find("/a~1b/c~0d") && index.find("/list/2"));
+		TT_CHECK(!index.find("/a~1b/c~0d/2") && !index.find("/list/3"));
+
+		std::string text;
+		TT_CHECK(index.readText("/list", text) && text == "[10, 20, 30]");
+		TT_CHECK(index.readText("/list/1", text) && text == "20");
+
+		// Values deeper than maxDepth are read from their closest indexed parent.
+		TTJson::Value value;
+		TT_CHECK(index.read("/a~1b/c~0d/2/deep", value) && value.isString() && value.asString() == "A\xF0\x9F\x98\x80");
+		TTJson::Value list;
+		TT_CHECK(index.read("/list", list) && list.isArray() && list.asArray().size() == 3);
+
+		// Indices must be plain decimal numbers.
+		std::string error;
+		for (const char* missing : { "/a~1b/c~0d/3", "/a~1b/c~0d/01", "/a~1b/c~0d/+1", "/a~1b/c~0d/x", "/a~1b/c~0d/99999999999999999999999", "/nothing" }) {
+			TTJson::Value result;
+			TT_CHECK(!index.read(missing, result, {}, &error) && !error.empty());
+		}
+	}
+
+	void testOpen() {
+		const std::string indexPath = path.string() + ".index";
+		std::filesystem::remove(indexPath);
+		write(R"({"x": [1, 2], "y": "z"})");
+
+		JsonIndex built;
+		TT_CHECK(built.open(path.string(), 1));
+		TT_CHECK(std::filesystem::exists(indexPath));
+		JsonIndex loaded;
+		TT_CHECK(loaded.load(indexPath, path.string()));
+		TT_CHECK(loaded.entries().size() == built.entries().size() && loaded.depth() == 1);
+		std::string text;
+		TT_CHECK(loaded.readText("/y", text) && text == "\"z\"");
+
+		// A changed file needs a new index.
+		write(R"({"x": [1, 2, 3], "y": "z"})");
+		TT_CHECK(!loaded.load(indexPath, path.string()));
+		std::filesystem::remove(indexPath);
+	}
+
+	void testTruncation() {
+		TT_CHECK(build("{/* open") == "Offset 8. Unterminated comment.");
+		TT_CHECK(build("{\"key\" /") == "Offset 7. Expected ':'.");
+		TT_CHECK(build("{\"key\" /* open") == "Offset 14. Unterminated comment.");
+		TT_CHECK(build("[\"ab\\") == "Offset 5. Unterminated string.");
+		TT_CHECK(build("['\\u12") == "Offset 6. Unterminated string.");
+		TT_CHECK(build("{'k") == "Offset 3. Unterminated string.");
+		TT_CHECK(build("[1, 2") == "Offset 5. Unexpected end of file.");
+		TT_CHECK(build("") == "Offset 0. Unexpected end of file.");
+
+		// Every truncation of a valid document fails at or before its end.
+		const std::string document = R"({"a": ['x\'y', "😀", /* c */ {b: 1}], // line
+"c\\": 2})";
+		TT_CHECK(build(document).empty());
+		for (size_t length = 0; length < document.size(); ++length) {
+			const std::string error = build(document.substr(0, length));
+			TT_CHECK(!error.empty());
+			TT_CHECK(std::stoull(error.substr(7)) <= length);
+		}
+		std::filesystem::remove(path);
+	}
+}
+
+int main() {
+	testRead();
+	testOpen();
+	testTruncation();
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,114 @@
+// JsonSchema validation of documents and of parse events, which must report the same errors.
+#include "tt_json_schema.h"
+#include "tt_test.h"
+
+using namespace TT;
+
+namespace {
+	JsonSchema compile(const char* text) {
+		TTJson::Value schema;
+		TT_CHECK(TTTest::parse(text, schema).empty());
+		return JsonSchema(schema);
+	}
+
+	// Validates text as a document and as events, returns the message if both agree.
+	TTJson::str_t validate(const JsonSchema& schema, const char* text) {
+		TTJson::Value document;
+		TT_CHECK(TTTest::parse(text, document).empty());
+		TTJson::str_t domMessage;
+		bool domValid = schema.validate(document, &domMessage);
+
+		TTJson::sstr_t stream(text);
+		TTJson::str_t eventMessage;
+		bool eventValid = schema.validate(stream, &eventMessage);
+		TT_CHECK(domValid == eventValid && domMessage == eventMessage);
+		TT_CHECK(domValid == domMessage.empty());
+		return eventMessage;
+	}
+
+	void testNestedFailure() {
+		// The path of a failure refers to the keys of every open object, which the parser keeps alive while deeper keys are parsed.
+		JsonSchema schema = compile(R"({
+      "type": "object",
+      "properties": {
+        "render": { "type": "object", "properties": {
+          "shadows": { "type": "object", "properties": {
+            "size": { "type": "integer" }
+          } }
+        } }
+      }
+    })");
+		TT_CHECK(schema.compileError().empty());
+		TT_CHECK(validate(schema, R"({"render": {"shadows": {"size": 1024}}})").empty());
+		TT_CHECK(validate(schema, R"({"render": {"shadows": {"size": "large"}}})") == "/render/shadows/size: expected type integer.");
+		TT_CHECK(validate(schema, R"({"a": 1, "render": {"b": [1, {"c": 2}], "shadows": {"d": {"e": {}}, "size": 1.5}}})") ==
+			"/render/shadows/size: expected type integer.");
+	}
+
+	void testKeywords() {
+		JsonSchema schema = compile(R"({
+      "type": "object",
+      "required": ["name", "list"],
+      "additionalProperties": false,
+      "properties": {
+        "name": { "type": "string", "minLength": 2, "maxLength": 4 },
+        "list": { "type": "array", "maxItems": 3, "items": { "type": "number", "minimum": 0, "exclusiveMaximum": 10 } },
+        "mode": { "enum": ["fast", "slow", null] },
+        "a/b": { "const": true },
+        "step": { "multipleOf": 0.5 }
+      }
+    })");
+		TT_CHECK(schema.compileError().empty());
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [0, 9.5], "mode": null, "a/b": true, "step": 1.5})").empty());
+		TT_CHECK(validate(schema, R"({"list": []})") == ": missing required property \"name\".");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [], "other": 1})") == "/other: additional property is not allowed.");
+		TT_CHECK(validate(schema, R"({"name": "a", "list": []})") == "/name: shorter than minLength 2.");
+		TT_CHECK(validate(schema, R"({"name": "abcde", "list": []})") == "/name: longer than maxLength 4.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [1, 2, 10]})") == "/list/2: not less than exclusiveMaximum 10.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [1, -1]})") == "/list/1: less than minimum 0.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [1, 2, 3, 4]})") == "/list: more items than maxItems 3.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [], "mode": "medium"})") == "/mode: not one of the allowed values.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [], "a/b": false})") == "/a~1b: not one of the allowed values.");
+		TT_CHECK(validate(schema, R"({"name": "ab", "list": [], "step": 0.25})") == "/step: not a multiple of 0.5.");
+		TT_CHECK(validate(schema, R"([])") == ": expected type object.");
+	}
+
+	void testRequiredWithoutProperty() {
+		// A name that is only required is not a declared property, its value is validated against additionalProperties.
+		JsonSchema closed = compile(R"({"required": ["x"], "additionalProperties": false})");
+		TT_CHECK(validate(closed, R"({"x": 1})") == "/x: additional property is not allowed.");
+		TT_CHECK(validate(closed, R"({})") == ": missing required property \"x\".");
+
+		JsonSchema typed = compile(R"({"required": ["x", "x"], "properties": {"y": {}}, "additionalProperties": {"type": "string"}})");
+		TT_CHECK(validate(typed, R"({"x": "a", "y": 1})").empty());
+		TT_CHECK(validate(typed, R"({"y": 1, "x": 2})") == "/x: expected type string.");
+
+		JsonSchema open = compile(R"({"required": ["x"]})");
+		TT_CHECK(validate(open, R"({"x": [1]})").empty());
+	}
+
+	void testCompileErrors() {
+		TT_CHECK(compile(R"({"properties": {"x": {"anyOf": []}}})").compileError() == "/properties/x/anyOf: keyword is not supported.");
+		TT_CHECK(compile(R"({"items": [{}]})").compileError() == "/items: tuple validation is not supported.");
+		TT_CHECK(compile(R"({"type": "float"})").compileError() == "/type: unknown type.");
+
+		// Every document fails against a schema that did not compile.
+		JsonSchema invalid = compile(R"({"pattern": "x"})");
+		TTJson::Value document;
+		TTJson::str_t message;
+		TT_CHECK(!invalid.validate(document, &message) && message == invalid.compileError());
+
+		// Parse errors are validation errors.
+		JsonSchema any = compile("true");
+		TTJson::sstr_t stream("[1,");
+		TT_CHECK(!any.validate(stream, &message) && !message.empty());
+	}
+}
+
+int main() {
+	testNestedFailure();
+	testKeywords();
+	testRequiredWithoutProperty();
+	testCompileErrors();
+	return TT_TEST_RESULT;
+}
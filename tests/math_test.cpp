@@ -0,0 +1,159 @@
+// The SIMD transcendentals against double precision over the ranges tt_math.h documents, on every SIMD path the CPU supports.
+#include "tt_math.h"
+#include "tt_test.h"
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	const size_t SAMPLES = 1 << 20;
+
+	// count floats spread evenly over [low, high], or evenly over their logarithms for the geometric ones (low > 0).
+	std::vector<float> linear(float low, float high, size_t count = SAMPLES) {
+		std::vector<float> values(count);
+		for (size_t i = 0; i < count; ++i)
+			values[i] = (float)(low + (high - (double)low) * (i + 0.5) / count);
+		return values;
+	}
+
+	std::vector<float> geometric(float low, float high, size_t count = SAMPLES) {
+		std::vector<float> values(count);
+		for (size_t i = 0; i < count; ++i)
+			values[i] = (float)(low * std::pow(high / (double)low, (i + 0.5) / count));
+		return values;
+	}
+
+	// The error in units in the last place of the correctly rounded result.
+	double ulp(float value, double reference) {
+		float rounded = fabsf((float)reference);
+		return fabs(value - reference) / (double)(std::nextafter(rounded, INFINITY) - rounded);
+	}
+
+	template<typename R> double maxUlp(const std::vector<float>& in, const std::vector<float>& out, R reference) {
+		double e = 0.0;
+		for (size_t i = 0; i < in.size(); ++i)
+			e = std::max(e, ulp(out[i], reference((double)in[i])));
+		return e;
+	}
+
+	template<typename R> double maxAbsError(const std::vector<float>& in, const std::vector<float>& out, R reference) {
+		double e = 0.0;
+		for (size_t i = 0; i < in.size(); ++i)
+			e = std::max(e, fabs(out[i] - reference((double)in[i])));
+		return e;
+	}
+
+	// Reports the measured error with the failure.
+	void checkBound(const char* what, double error, double bound, int line) {
+		char text[128];
+		snprintf(text, sizeof(text), "%s %s error %g <= %g", simdPathName(simdPath()), what, error, bound);
+		TTTest::check(error <= bound, text, __FILE__, line);
+	}
+
+	// The single vector forms, 4 values per call.
+	template<typename F> std::vector<float> byVec(const std::vector<float>& in, F f) {
+		std::vector<float> out(in.size());
+		for (size_t i = 0; i + 4 <= in.size(); i += 4)
+			_mm_storeu_ps(&out[i], f(Vec(_mm_loadu_ps(&in[i]))));
+		return out;
+	}
+
+	double sinRef(double a) { return std::sin(a); }
+	double cosRef(double a) { return std::cos(a); }
+
+	void testSinCos() {
+		std::vector<float> in = linear(-3.14159265f, 3.14159265f), sinOut(SAMPLES), cosOut(SAMPLES);
+		sin(in.data(), sinOut.data(), SAMPLES);
+		cos(in.data(), cosOut.data(), SAMPLES);
+		checkBound("sin ulp |a| <= pi", maxUlp(in, sinOut, sinRef), 1.5, __LINE__);
+		checkBound("cos ulp |a| <= pi", maxUlp(in, cosOut, cosRef), 1.5, __LINE__);
+		sincos(in.data(), sinOut.data(), cosOut.data(), SAMPLES);
+		checkBound("sincos sin ulp |a| <= pi", maxUlp(in, sinOut, sinRef), 1.5, __LINE__);
+		checkBound("sincos cos ulp |a| <= pi", maxUlp(in, cosOut, cosRef), 1.5, __LINE__);
+
+		in = linear(-8192.0f, 8192.0f);
+		sin(in.data(), sinOut.data(), SAMPLES);
+		cos(in.data(), cosOut.data(), SAMPLES);
+		checkBound("sin absolute |a| < 8192", maxAbsError(in, sinOut, sinRef), 1e-7, __LINE__);
+		checkBound("cos absolute |a| < 8192", maxAbsError(in, cosOut, cosRef), 1e-7, __LINE__);
+	}
+
+	void testExpLog() {
+		// Results from the smallest normal float to the largest.
+		std::vector<float> in = linear(-87.33f, 88.72f), out(SAMPLES);
+		exp(in.data(), out.data(), SAMPLES);
+		checkBound("exp ulp", maxUlp(in, out, [](double a) { return std::exp(a); }), 1.0, __LINE__);
+
+		in = geometric(FLT_MIN, FLT_MAX);
+		log(in.data(), out.data(), SAMPLES);
+		checkBound("log ulp", maxUlp(in, out, [](double a) { return std::log(a); }), 1.0, __LINE__);
+		in = linear(0.5f, 2.0f);
+		log(in.data(), out.data(), SAMPLES);
+		checkBound("log ulp near 1", maxUlp(in, out, [](double a) { return std::log(a); }), 1.0, __LINE__);
+	}
+
+	void testAtan2() {
+		// Every direction at lengths from 1e-3 to 1e3.
+		std::vector<float> angles = linear(-3.14159265f, 3.14159265f), lengths = geometric(1e-3f, 1e3f);
+		std::vector<float> y(SAMPLES), x(SAMPLES), out(SAMPLES);
+		for (size_t i = 0; i < SAMPLES; ++i) {
+			float length = lengths[i * 7919 % SAMPLES];
+			y[i] = length * std::sin(angles[i]);
+			x[i] = length * std::cos(angles[i]);
+		}
+		atan2(y.data(), x.data(), out.data(), SAMPLES);
+		double e = 0.0;
+		for (size_t i = 0; i < SAMPLES; ++i)
+			e = std::max(e, ulp(out[i], std::atan2((double)y[i], (double)x[i])));
+		checkBound("atan2 ulp", e, 2.6, __LINE__);
+	}
+
+	void testSpecialValues() {
+		const float nan = NAN;
+		float in[] = { INFINITY, -INFINITY, 0.0f, -0.0f, -1.0f, nan, 1.0f, FLT_MAX };
+		float out[8];
+		exp(in, out, 8);
+		TT_CHECK(out[0] == INFINITY && out[1] == 0.0f && out[2] == 1.0f && out[3] == 1.0f && std::isnan(out[5]) && out[7] == INFINITY);
+		log(in, out, 8);
+		TT_CHECK(out[0] == INFINITY && std::isnan(out[1]) && out[2] == -INFINITY && out[3] == -INFINITY && std::isnan(out[4]) && std::isnan(out[5]) && out[6] == 0.0f);
+		sin(in, out, 8);
+		TT_CHECK(std::isnan(out[0]) && std::isnan(out[1]) && out[2] == 0.0f && std::signbit(out[3]) && std::isnan(out[5]));
+		float y[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.0f, 0.0f, nan, 1.0f };
+		float x[] = { -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, INFINITY };
+		atan2(y, x, out, 8);
+		TT_CHECK(out[0] == (float)3.141592653589793 && out[1] == -(float)3.141592653589793);
+		TT_CHECK(out[2] == (float)1.5707963267948966 && out[3] == -(float)1.5707963267948966);
+		TT_CHECK(out[4] == 0.0f && out[5] == 0.0f && std::isnan(out[6]) && out[7] == 0.0f);
+	}
+
+	// The __m128 forms are not dispatched, they use the polynomials of the array forms with 4 lanes.
+	void testVectors() {
+		std::vector<float> in = linear(-3.14159265f, 3.14159265f);
+		checkBound("sin(Vec) ulp |a| <= pi", maxUlp(in, byVec(in, [](Vec a) { return TT::sin(a); }), sinRef), 1.5, __LINE__);
+		checkBound("cos(Vec) ulp |a| <= pi", maxUlp(in, byVec(in, [](Vec a) { return TT::cos(a); }), cosRef), 1.5, __LINE__);
+		in = linear(-87.33f, 88.72f);
+		checkBound("exp(Vec) ulp", maxUlp(in, byVec(in, [](Vec a) { return TT::exp(a); }), [](double a) { return std::exp(a); }), 1.0, __LINE__);
+		in = geometric(FLT_MIN, FLT_MAX);
+		checkBound("log(Vec) ulp", maxUlp(in, byVec(in, [](Vec a) { return TT::log(a); }), [](double a) { return std::log(a); }), 1.0, __LINE__);
+		checkBound("rsqrt(Vec) ulp", maxUlp(in, byVec(in, [](Vec a) { return TT::rsqrt(a); }), [](double a) { return 1.0 / std::sqrt(a); }), 4.0, __LINE__);
+	}
+}
+
+int main() {
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testSinCos();
+		testExpLog();
+		testAtan2();
+		testSpecialValues();
+	}
+	setSimdPath(selected);
+	testVectors();
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,245 @@
+// Welding, normals, tangents and vertex cache order against simple references, and the same results on 1 and several threads.
+#include "tt_mesh_processing.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Large enough for several threads in every function, more triangles than the vertex cache optimizes in one piece.
+	const int GRID = 200;
+	const unsigned int THREADS[] = { 1, 4 };
+
+	struct MeshVertex {
+		float position[3];
+		float uv[2];
+	};
+
+	// A wavy grid as a triangle soup, 6 vertices per cell.
+	std::vector<MeshVertex> makeSoup() {
+		std::vector<MeshVertex> soup;
+		const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+		for (int y = 0; y < GRID; ++y)
+			for (int x = 0; x < GRID; ++x)
+				for (const int* c : corners) {
+					float u = (float)(x + c[0]), v = (float)(y + c[1]);
+					soup.push_back({ { u * 0.01f, v * 0.01f, 0.05f * sinf(u * 0.1f) * cosf(v * 0.13f) }, { u / GRID, v / GRID } });
+				}
+		return soup;
+	}
+
+	std::vector<unsigned int> weld(const std::vector<MeshVertex>& vertices, float epsilon, unsigned int threads, size_t& unique) {
+		std::vector<unsigned int> remap(vertices.size());
+		unique = weldVertices(vertices.data(), sizeof(MeshVertex), vertices.size(), epsilon, remap.data(), threads);
+		return remap;
+	}
+
+	void testWeld() {
+		std::vector<MeshVertex> soup = makeSoup();
+		// The reference: a hash map from the vertex bytes.
+		std::unordered_map<std::string, unsigned int> map;
+		std::vector<unsigned int> expected(soup.size());
+		for (size_t i = 0; i < soup.size(); ++i)
+			expected[i] = map.emplace(std::string((const char*)&soup[i], sizeof(MeshVertex)), (unsigned int)map.size()).first->second;
+		TT_CHECK(map.size() == (size_t)(GRID + 1) * (GRID + 1));
+
+		// Noise well below epsilon keeps the same vertices together, and only those.
+		std::vector<MeshVertex> noisy = soup;
+		std::mt19937 rng(37);
+		std::uniform_real_distribution<float> noise(-1e-6f, 1e-6f);
+		for (MeshVertex& vertex : noisy)
+			for (float& c : vertex.position)
+				c += noise(rng);
+		for (unsigned int threads : THREADS) {
+			size_t unique;
+			TT_CHECK(weld(soup, 0.0f, threads, unique) == expected && unique == map.size());
+			TT_CHECK(weld(soup, 1e-5f, threads, unique) == expected && unique == map.size());
+			TT_CHECK(weld(noisy, 1e-5f, threads, unique) == expected && unique == map.size());
+			std::vector<unsigned int> noisyExact = weld(noisy, 0.0f, threads, unique);
+			TT_CHECK(unique > map.size() && noisyExact == weld(noisy, 0.0f, 1, unique));
+		}
+
+		// The remaining bytes must be equal, a chain of close vertices merges into its first.
+		std::vector<MeshVertex> chain = { { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } }, { { 0.8f, 0.0f, 0.0f }, { 0.0f, 0.0f } }, { { 1.6f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+			{ { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.0f } } };
+		size_t unique;
+		TT_CHECK(weld(chain, 1.0f, 1, unique) == std::vector<unsigned int>({ 0, 0, 0, 1 }) && unique == 2);
+
+		// Non-finite positions stay unique with epsilon, huge ones still merge. Exact welding compares bytes.
+		const float inf = INFINITY, nan = NAN;
+		std::vector<MeshVertex> odd = { { { nan, 0.0f, 0.0f }, {} }, { { nan, 0.0f, 0.0f }, {} }, { { inf, 1.0f, 0.0f }, {} }, { { inf, 1.0f, 0.0f }, {} },
+			{ { -inf, -inf, nan }, {} }, { { 1e38f, -1e38f, 0.0f }, {} }, { { 1e38f, -1e38f, 0.0f }, {} }, { { 0.0f, 0.0f, 0.0f }, {} } };
+		TT_CHECK(weld(odd, 1e-3f, 1, unique) == std::vector<unsigned int>({ 0, 1, 2, 3, 4, 5, 5, 6 }) && unique == 7);
+		TT_CHECK(weld(odd, 0.0f, 1, unique) == std::vector<unsigned int>({ 0, 0, 1, 1, 2, 3, 3, 4 }) && unique == 5);
+		TT_CHECK(weldVertices(nullptr, sizeof(MeshVertex), 0, 1e-5f, nullptr) == 0 && weldVertices(nullptr, sizeof(MeshVertex), 0, 0.0f, nullptr) == 0);
+
+		// The unique vertices are the first of each, the indices follow the remap.
+		std::vector<MeshVertex> welded(map.size());
+		remapVertices(soup.data(), sizeof(MeshVertex), soup.size(), expected.data(), welded.data());
+		std::vector<bool> seen(map.size());
+		size_t mismatches = 0;
+		for (size_t i = 0; i < soup.size(); ++i) {
+			if (!seen[expected[i]])
+				mismatches += memcmp(&welded[expected[i]], &soup[i], sizeof(MeshVertex)) != 0;
+			seen[expected[i]] = true;
+		}
+		TT_CHECK(mismatches == 0);
+		std::vector<unsigned int> indices(soup.size());
+		remapIndices(nullptr, soup.size(), expected.data(), indices.data());
+		TT_CHECK(indices == expected);
+		std::vector<unsigned int> reversed(soup.size()), expectedReversed(soup.size());
+		for (size_t i = 0; i < soup.size(); ++i) {
+			reversed[i] = (unsigned int)(soup.size() - 1 - i);
+			expectedReversed[i] = expected[reversed[i]];
+		}
+		remapIndices(reversed.data(), reversed.size(), expected.data(), reversed.data());
+		TT_CHECK(reversed == expectedReversed);
+	}
+
+	// The welded grid: positions, uvs and indices, with one vertex no triangle uses at the end.
+	struct Mesh {
+		std::vector<Vec3> positions;
+		std::vector<Vec2> uvs;
+		std::vector<unsigned int> indices;
+	};
+
+	Mesh makeMesh() {
+		std::vector<MeshVertex> soup = makeSoup();
+		Mesh mesh;
+		mesh.indices.resize(soup.size());
+		size_t unique = weldVertices(soup.data(), sizeof(MeshVertex), soup.size(), 0.0f, mesh.indices.data());
+		std::vector<MeshVertex> welded(unique);
+		remapVertices(soup.data(), sizeof(MeshVertex), soup.size(), mesh.indices.data(), welded.data());
+		for (const MeshVertex& vertex : welded) {
+			mesh.positions.push_back(Vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+			mesh.uvs.push_back(Vec2(vertex.uv[0], vertex.uv[1]));
+		}
+		mesh.positions.push_back(Vec3(5.0f, 5.0f, 5.0f));
+		mesh.uvs.push_back(Vec2(0.0f, 0.0f));
+		return mesh;
+	}
+
+	bool same(const void* a, const void* b, size_t bytes) {
+		return memcmp(a, b, bytes) == 0;
+	}
+
+	void testNormalsAndTangents(const Mesh& mesh) {
+		const size_t vertices = mesh.positions.size();
+		// The reference: the cross products summed one triangle at a time in double.
+		std::vector<double> sums(3 * vertices);
+		for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+			const Vec3& a = mesh.positions[mesh.indices[t]];
+			const Vec3& b = mesh.positions[mesh.indices[t + 1]];
+			const Vec3& c = mesh.positions[mesh.indices[t + 2]];
+			double e1[3] = { (double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z }, e2[3] = { (double)c.x - a.x, (double)c.y - a.y, (double)c.z - a.z };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			for (int corner = 0; corner < 3; ++corner)
+				for (int k = 0; k < 3; ++k)
+					sums[3 * mesh.indices[t + corner] + k] += n[k];
+		}
+
+		std::vector<Vec3> normals(vertices);
+		std::vector<Vec4> tangents(vertices);
+		computeNormals(mesh.positions.data(), vertices, mesh.indices.data(), mesh.indices.size(), normals.data(), 1);
+		double normalError = 0.0;
+		for (size_t v = 0; v + 1 < vertices; ++v) {
+			double length = std::sqrt(sums[3 * v] * sums[3 * v] + sums[3 * v + 1] * sums[3 * v + 1] + sums[3 * v + 2] * sums[3 * v + 2]);
+			for (int k = 0; k < 3; ++k)
+				normalError = std::max(normalError, fabs(normals[v][k] - sums[3 * v + k] / length));
+		}
+		TT_CHECK(normalError < 1e-5);
+		TT_CHECK(normals.back().x == 0.0f && normals.back().y == 0.0f && normals.back().z == 0.0f);
+
+		// u grows along x and v along y on a grid facing +z, so the tangents point along x with handedness 1.
+		computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertices, mesh.indices.data(), mesh.indices.size(), tangents.data(), 1);
+		size_t wrong = 0;
+		for (size_t v = 0; v + 1 < vertices; ++v) {
+			const Vec3& n = normals[v];
+			const Vec4& t = tangents[v];
+			wrong += fabsf(sqrtf(t.x * t.x + t.y * t.y + t.z * t.z) - 1.0f) > 1e-5f || fabsf(n.x * t.x + n.y * t.y + n.z * t.z) > 1e-5f || t.x < 0.8f || t.w != 1.0f;
+		}
+		TT_CHECK(wrong == 0);
+		TT_CHECK(fabsf(tangents.back().w) == 1.0f);
+
+		for (unsigned int threads : THREADS) {
+			std::vector<Vec3> parallelNormals(vertices);
+			std::vector<Vec4> parallelTangents(vertices);
+			computeNormals(mesh.positions.data(), vertices, mesh.indices.data(), mesh.indices.size(), parallelNormals.data(), threads);
+			computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertices, mesh.indices.data(), mesh.indices.size(), parallelTangents.data(), threads);
+			TT_CHECK(same(parallelNormals.data(), normals.data(), vertices * sizeof(Vec3)) && same(parallelTangents.data(), tangents.data(), vertices * sizeof(Vec4)));
+		}
+
+		// Nothing to do, through the null data() of empty arrays.
+		std::vector<Vec3> none;
+		std::vector<Vec4> noTangents;
+		computeNormals(none.data(), 0, nullptr, 0, none.data());
+		computeTangents(none.data(), nullptr, none.data(), 0, nullptr, 0, noTangents.data());
+	}
+
+	// The triangles, each rotated to start at its lowest index, sorted.
+	std::vector<unsigned int> canonicalTriangles(const std::vector<unsigned int>& indices) {
+		std::vector<std::array<unsigned int, 3>> triangles;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			const unsigned int* i = &indices[t];
+			int first = i[0] <= i[1] && i[0] <= i[2] ? 0 : i[1] <= i[2] ? 1 : 2;
+			triangles.push_back({ i[first], i[(first + 1) % 3], i[(first + 2) % 3] });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		std::vector<unsigned int> flat;
+		for (const auto& triangle : triangles)
+			flat.insert(flat.end(), triangle.begin(), triangle.end());
+		return flat;
+	}
+
+	void testVertexCache(const Mesh& mesh) {
+		// One triangle misses 3 times, a second one on the same edge once more. Repeating the first then misses 3 times with a FIFO of 3, not at all with 4.
+		const unsigned int pair[] = { 0, 1, 2, 2, 1, 3, 0, 1, 2 };
+		TT_CHECK(averageCacheMissRatio(pair, 3, 4) == 3.0f && averageCacheMissRatio(pair, 6, 4) == 2.0f);
+		TT_CHECK(fabsf(averageCacheMissRatio(pair, 9, 4, 3) - 7.0f / 3.0f) < 1e-6f && fabsf(averageCacheMissRatio(pair, 9, 4, 4) - 4.0f / 3.0f) < 1e-6f);
+		TT_CHECK(averageCacheMissRatio(pair, 0, 4) == 0.0f);
+
+		// Triangles in random order as the worst case.
+		const size_t vertices = mesh.positions.size(), triangles = mesh.indices.size() / 3;
+		std::vector<unsigned int> order(triangles), shuffled(mesh.indices.size());
+		for (size_t t = 0; t < triangles; ++t)
+			order[t] = (unsigned int)t;
+		std::mt19937 rng(41);
+		std::shuffle(order.begin(), order.end(), rng);
+		for (size_t t = 0; t < triangles; ++t)
+			std::copy(&mesh.indices[3 * order[t]], &mesh.indices[3 * order[t]] + 3, &shuffled[3 * t]);
+		TT_CHECK(averageCacheMissRatio(shuffled.data(), shuffled.size(), vertices) > 2.0f);
+
+		std::vector<unsigned int> expected = canonicalTriangles(mesh.indices), first;
+		for (unsigned int threads : THREADS) {
+			std::vector<unsigned int> optimized(shuffled.size());
+			optimizeVertexCache(shuffled.data(), shuffled.size(), vertices, optimized.data(), threads);
+			if (first.empty()) {
+				first = optimized;
+				TT_CHECK(canonicalTriangles(optimized) == expected);
+				TT_CHECK(averageCacheMissRatio(optimized.data(), optimized.size(), vertices) < 0.8f);
+			}
+			TT_CHECK(optimized == first);
+		}
+
+		// Small enough for a single piece.
+		std::vector<unsigned int> small(shuffled.begin(), shuffled.begin() + 3000), optimized(small.size());
+		optimizeVertexCache(small.data(), small.size(), vertices, optimized.data(), 4);
+		TT_CHECK(canonicalTriangles(optimized) == canonicalTriangles(small));
+		TT_CHECK(averageCacheMissRatio(optimized.data(), optimized.size(), vertices) < averageCacheMissRatio(small.data(), small.size(), vertices));
+	}
+}
+
+int main() {
+	testWeld();
+	Mesh mesh = makeMesh();
+	testNormalsAndTangents(mesh);
+	testVertexCache(mesh);
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,159 @@
+// Round trips and error bounds of the packed types, the array conversions against the scalar ones on every SIMD path.
+#include "tt_packing.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Not a multiple of 8, so the array conversions also run their tails.
+	const size_t COUNT = 10007;
+
+	// The value of a half, decoded field by field.
+	double halfValue(u16 bits) {
+		int exponent = (bits >> 10) & 31, mantissa = bits & 1023;
+		double magnitude = exponent == 0 ? std::ldexp(mantissa, -24) : exponent == 31 ? (mantissa ? NAN : INFINITY) : std::ldexp(1024 + mantissa, exponent - 25);
+		return bits & 0x8000 ? -magnitude : magnitude;
+	}
+
+	void testHalves() {
+		// Every half converts to its exact value and back, NaNs stay NaNs.
+		std::vector<f16> halves(65536), packed(65536);
+		std::vector<float> floats(65536);
+		for (unsigned int i = 0; i < 65536; ++i)
+			halves[i].bits = (u16)i;
+		unpack(halves.data(), floats.data(), 65536);
+		pack(floats.data(), packed.data(), 65536);
+		size_t mismatches = 0;
+		for (unsigned int i = 0; i < 65536; ++i) {
+			double expected = halfValue((u16)i);
+			float scalar = toFloat(halves[i]);
+			if (std::isnan(expected)) {
+				mismatches += !std::isnan(floats[i]) || !std::isnan(scalar) || (packed[i].bits & 0x7c00) != 0x7c00 || !(packed[i].bits & 1023);
+				continue;
+			}
+			mismatches += floats[i] != expected || scalar != expected || std::signbit(floats[i]) != (bool)(i & 0x8000);
+			mismatches += packed[i].bits != i || toF16(floats[i]).bits != i;
+		}
+		TT_CHECK(mismatches == 0);
+
+		// Floats round to the nearest half, ties to even, within the documented bounds.
+		std::mt19937 rng(19);
+		std::uniform_real_distribution<float> exponent(-30.0f, 17.0f);
+		std::vector<float> in(COUNT), out(COUNT);
+		for (size_t i = 0; i < COUNT; ++i)
+			in[i] = (i % 2 ? -1.0f : 1.0f) * std::exp2(exponent(rng));
+		in[0] = 65504.0f;
+		in[1] = 65519.0f;
+		in[2] = 65520.0f;
+		in[3] = 1.0f + std::ldexp(1.0f, -11);
+		in[4] = 1.0f + 3.0f * std::ldexp(1.0f, -11);
+		in[5] = std::ldexp(1.0f, -25);
+		std::vector<f16> arrayHalves(COUNT);
+		pack(in.data(), arrayHalves.data(), COUNT);
+		unpack(arrayHalves.data(), out.data(), COUNT);
+		mismatches = 0;
+		double relative = 0.0, absolute = 0.0;
+		for (size_t i = 0; i < COUNT; ++i) {
+			f16 h = toF16(in[i]);
+			mismatches += h.bits != arrayHalves[i].bits || toFloat(h) != out[i];
+			double value = halfValue(h.bits), error = fabs(value - in[i]);
+			if (std::isinf(value)) {
+				mismatches += fabsf(in[i]) < 65520.0f;
+				continue;
+			}
+			for (int step : { -1, 1 }) {
+				u16 neighbour = (u16)(h.bits + step);
+				if ((neighbour & 0x8000) == (h.bits & 0x8000) && (neighbour & 0x7c00) != 0x7c00) {
+					double other = fabs(halfValue(neighbour) - in[i]);
+					mismatches += other < error || (other == error && (h.bits & 1));
+				}
+			}
+			if (fabs(value) >= 6.103515625e-5)
+				relative = std::max(relative, error / fabsf(in[i]));
+			else
+				absolute = std::max(absolute, error);
+		}
+		TT_CHECK(mismatches == 0);
+		TT_CHECK(relative <= std::ldexp(1.0, -11) && absolute <= std::ldexp(1.0, -25));
+		TT_CHECK(toF16(65504.0f).bits == 0x7bff && toF16(65519.0f).bits == 0x7bff && toF16(65520.0f).bits == 0x7c00);
+		TT_CHECK(toF16(in[3]).bits == 0x3c00 && toF16(in[4]).bits == 0x3c02 && toF16(in[5]).bits == 0 && toF16(-in[5]).bits == 0x8000);
+	}
+
+	void testNormalized() {
+		std::vector<float> in(COUNT), out(COUNT);
+		std::vector<snorm16> snorms(COUNT);
+		std::vector<unorm8> unorms(COUNT);
+		for (size_t i = 0; i < COUNT; ++i)
+			in[i] = -1.25f + 2.5f * (float)i / (COUNT - 1);
+		pack(in.data(), snorms.data(), COUNT);
+		unpack(snorms.data(), out.data(), COUNT);
+		size_t mismatches = 0;
+		float e = 0.0f;
+		for (size_t i = 0; i < COUNT; ++i) {
+			mismatches += snorms[i].value != toSnorm16(in[i]).value || out[i] != toFloat(snorms[i]);
+			e = std::max(e, fabsf(out[i] - std::clamp(in[i], -1.0f, 1.0f)));
+		}
+		TT_CHECK(mismatches == 0 && e <= 1.54e-5f);
+		TT_CHECK(toSnorm16(-1.0f).value == -32767 && toSnorm16(2.0f).value == 32767 && toSnorm16(0.0f).value == 0 && toFloat(snorm16{ -32768 }) == -1.0f);
+
+		pack(in.data(), unorms.data(), COUNT);
+		unpack(unorms.data(), out.data(), COUNT);
+		e = 0.0f;
+		for (size_t i = 0; i < COUNT; ++i) {
+			mismatches += unorms[i].value != toUnorm8(in[i]).value || out[i] != toFloat(unorms[i]);
+			e = std::max(e, fabsf(out[i] - std::clamp(in[i], 0.0f, 1.0f)));
+		}
+		TT_CHECK(mismatches == 0 && e <= 1.97e-3f);
+		TT_CHECK(toUnorm8(-1.0f).value == 0 && toUnorm8(1.0f).value == 255 && toUnorm8(0.5f).value == 128 && toFloat(unorm8{ 255 }) == 1.0f);
+	}
+
+	void testOctahedral() {
+		// Random directions, the axes and the diagonals, where the octahedron folds.
+		std::mt19937 rng(23);
+		std::normal_distribution<float> random;
+		std::vector<Vec3> in(COUNT), out(COUNT);
+		for (size_t i = 0; i < COUNT; ++i)
+			in[i] = Vec3(random(rng), random(rng), random(rng)).normalized();
+		const Vec3 special[] = { Vec3(1.0f, 0.0f, 0.0f), Vec3(-1.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f),
+			Vec3(0.0f, 0.0f, 1.0f), Vec3(0.0f, 0.0f, -1.0f), Vec3(1.0f, 1.0f, -1.0f).normalized(), Vec3(-1.0f, -1.0f, -1.0f).normalized() };
+		std::copy(std::begin(special), std::end(special), in.begin());
+		std::vector<octahedral16> packed(COUNT);
+		pack(in.data(), packed.data(), COUNT);
+		unpack(packed.data(), out.data(), COUNT);
+		size_t mismatches = 0;
+		double degrees = 0.0, length = 0.0;
+		for (size_t i = 0; i < COUNT; ++i) {
+			octahedral16 scalar = toOctahedral16(in[i]);
+			Vec3 decoded = toVec3(scalar);
+			mismatches += scalar.x.value != packed[i].x.value || scalar.y.value != packed[i].y.value;
+			mismatches += fabsf(decoded.x - out[i].x) > 1e-6f || fabsf(decoded.y - out[i].y) > 1e-6f || fabsf(decoded.z - out[i].z) > 1e-6f;
+			const Vec3& n = in[i];
+			const Vec3& o = out[i];
+			double cx = (double)n.y * o.z - (double)n.z * o.y, cy = (double)n.z * o.x - (double)n.x * o.z, cz = (double)n.x * o.y - (double)n.y * o.x;
+			double dot = (double)n.x * o.x + (double)n.y * o.y + (double)n.z * o.z;
+			degrees = std::max(degrees, std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.141592653589793);
+			length = std::max(length, fabs(std::sqrt((double)o.x * o.x + (double)o.y * o.y + (double)o.z * o.z) - 1.0));
+		}
+		TT_CHECK(mismatches == 0);
+		TT_CHECK(degrees <= 0.004 && length < 1e-6);
+	}
+}
+
+int main() {
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testHalves();
+		testNormalized();
+		testOctahedral();
+	}
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
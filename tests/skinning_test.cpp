@@ -0,0 +1,185 @@
+// skin() against blending the joint transforms in double, and skinParallel() against skin(), on every SIMD path.
+#include "tt_skinning.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	// Several parallel chunks, and not a multiple of 8, so the last step is partial.
+	const size_t VERTICES = 40003, JOINTS = 64;
+
+	struct Mesh {
+		std::vector<Mat44> palette;
+		std::vector<u16> joints;
+		std::vector<float> weights;
+		std::vector<Vec3> positions, normals, expectedPositions, expectedNormals;
+	};
+
+	// 1 to 4 influences per vertex, unused entries on joint 0 with weight 0.
+	Mesh makeMesh() {
+		std::mt19937 rng(31);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		std::uniform_int_distribution<int> jointIndex(0, (int)JOINTS - 1), influences(1, 4);
+		Mesh mesh;
+		for (size_t j = 0; j < JOINTS; ++j)
+			mesh.palette.push_back(Mat44::TRS(Vec(random(rng), random(rng), random(rng), 0.0f) * 5.0f, Vec(random(rng), random(rng), random(rng), 0.0f) * 3.0f,
+				Vec(1.0f + random(rng) * 0.2f)));
+		mesh.joints.resize(VERTICES * 4);
+		mesh.weights.resize(VERTICES * 4);
+		for (size_t i = 0; i < VERTICES; ++i) {
+			mesh.positions.push_back(Vec3(random(rng), random(rng), random(rng)) * 10.0f);
+			mesh.normals.push_back(Vec3(random(rng), random(rng), random(rng)).normalized());
+			int used = influences(rng);
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k) {
+				mesh.joints[i * 4 + k] = k < used ? (u16)jointIndex(rng) : 0;
+				mesh.weights[i * 4 + k] = k < used ? random(rng) * 0.5f + 0.5f : 0.0f;
+				sum += mesh.weights[i * 4 + k];
+			}
+			for (int k = 0; k < 4; ++k)
+				mesh.weights[i * 4 + k] /= sum;
+		}
+
+		// Each joint matrix applied to the vertex in double, the results blended.
+		for (size_t i = 0; i < VERTICES; ++i) {
+			double p[3] = {}, n[3] = {};
+			for (int k = 0; k < 4; ++k) {
+				const Mat44& joint = mesh.palette[mesh.joints[i * 4 + k]];
+				double w = mesh.weights[i * 4 + k];
+				for (int r = 0; r < 3; ++r) {
+					double tp = joint.m[12 + r], tn = 0.0;
+					for (int c = 0; c < 3; ++c) {
+						tp += (double)joint.m[c * 4 + r] * mesh.positions[i][c];
+						tn += (double)joint.m[c * 4 + r] * mesh.normals[i][c];
+					}
+					p[r] += w * tp;
+					n[r] += w * tn;
+				}
+			}
+			double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			mesh.expectedPositions.push_back(Vec3((float)p[0], (float)p[1], (float)p[2]));
+			mesh.expectedNormals.push_back(Vec3((float)(n[0] / length), (float)(n[1] / length), (float)(n[2] / length)));
+		}
+		return mesh;
+	}
+
+	void checkBound(const char* what, double error, double bound, int line) {
+		char text[128];
+		snprintf(text, sizeof(text), "%s %s error %g <= %g", simdPathName(simdPath()), what, error, bound);
+		TTTest::check(error <= bound, text, __FILE__, line);
+	}
+
+	// The largest difference to the expected vectors relative to their size, and whether every w is 0.
+	double maxError(const Vec3* vectors, const std::vector<Vec3>& expected, bool& zeroW) {
+		double e = 0.0;
+		zeroW = true;
+		for (size_t i = 0; i < expected.size(); ++i) {
+			double length = std::sqrt((double)expected[i].x * expected[i].x + (double)expected[i].y * expected[i].y + (double)expected[i].z * expected[i].z);
+			for (int c = 0; c < 3; ++c)
+				e = std::max(e, fabs((double)vectors[i][c] - expected[i][c]) / (1.0 + length));
+			zeroW &= vectors[i].w == 0.0f;
+		}
+		return e;
+	}
+
+	bool same(const std::vector<Vec3>& a, const std::vector<Vec3>& b) {
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(Vec3)) == 0;
+	}
+
+	void testVec3(const Mesh& mesh) {
+		std::vector<Vec3> positions(VERTICES), normals(VERTICES);
+		skin(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), mesh.positions.data(), mesh.normals.data(), positions.data(), normals.data(), VERTICES);
+		bool zeroW, zeroNormalW;
+		checkBound("skin positions", maxError(positions.data(), mesh.expectedPositions, zeroW), 1e-6, __LINE__);
+		checkBound("skin normals", maxError(normals.data(), mesh.expectedNormals, zeroNormalW), 1e-6, __LINE__);
+		TT_CHECK(zeroW && zeroNormalW);
+
+		// Without normals the positions are the same and the normal outputs are left alone.
+		std::vector<Vec3> positionsOnly(VERTICES), untouched(VERTICES, Vec3(7.0f));
+		skin(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), mesh.positions.data(), nullptr, positionsOnly.data(), nullptr, VERTICES);
+		TT_CHECK(same(positionsOnly, positions));
+		std::fill(positionsOnly.begin(), positionsOnly.end(), Vec3(0.0f));
+		skin(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), mesh.positions.data(), mesh.normals.data(), positionsOnly.data(), nullptr, VERTICES);
+		TT_CHECK(same(positionsOnly, positions));
+
+		// Every chunking gives the same results as one call, as does skinning from an offset.
+		for (unsigned int threads : { 1u, 3u, 0u }) {
+			std::vector<Vec3> parallelPositions(VERTICES), parallelNormals(VERTICES);
+			skinParallel(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), mesh.positions.data(), mesh.normals.data(), parallelPositions.data(),
+				parallelNormals.data(), VERTICES, threads);
+			TT_CHECK(same(parallelPositions, positions) && same(parallelNormals, normals));
+			skinParallel(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), mesh.positions.data(), nullptr, parallelPositions.data(), untouched.data(),
+				VERTICES, threads);
+			TT_CHECK(same(parallelPositions, positions) && std::all_of(untouched.begin(), untouched.end(), [](const Vec3& v) { return v.x == 7.0f && v.w == 7.0f; }));
+		}
+		const size_t OFFSET = 5;
+		std::vector<Vec3> tail(VERTICES - OFFSET);
+		skin(mesh.palette.data(), mesh.joints.data() + 4 * OFFSET, mesh.weights.data() + 4 * OFFSET, mesh.positions.data() + OFFSET, nullptr, tail.data(), nullptr, tail.size());
+		TT_CHECK(std::equal(tail.begin(), tail.end(), positions.begin() + OFFSET, [](const Vec3& a, const Vec3& b) { return memcmp(&a, &b, sizeof(Vec3)) == 0; }));
+
+		// Nothing to skin, through the null data() of empty arrays.
+		std::vector<Vec3> empty;
+		skin(mesh.palette.data(), nullptr, nullptr, empty.data(), empty.data(), empty.data(), empty.data(), 0);
+		skinParallel(mesh.palette.data(), nullptr, nullptr, empty.data(), empty.data(), empty.data(), empty.data(), 0);
+	}
+
+	void testStreams(const Mesh& mesh) {
+		std::vector<float> in(VERTICES * 6);
+		const float* inStreams[6];
+		for (int c = 0; c < 6; ++c) {
+			for (size_t i = 0; i < VERTICES; ++i)
+				in[VERTICES * c + i] = (c < 3 ? mesh.positions[i] : mesh.normals[i])[c % 3];
+			inStreams[c] = &in[VERTICES * c];
+		}
+		auto run = [&](bool parallel, unsigned int threads, bool normals, std::vector<Vec3>& positions, std::vector<Vec3>& outNormals) {
+			std::vector<float> out(VERTICES * 6, 7.0f);
+			float* outStreams[6];
+			for (int c = 0; c < 6; ++c)
+				outStreams[c] = &out[VERTICES * c];
+			if (parallel)
+				skinParallel(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), inStreams, normals ? inStreams + 3 : nullptr, outStreams,
+					normals ? outStreams + 3 : nullptr, VERTICES, threads);
+			else
+				skin(mesh.palette.data(), mesh.joints.data(), mesh.weights.data(), inStreams, normals ? inStreams + 3 : nullptr, outStreams, normals ? outStreams + 3 : nullptr, VERTICES);
+			positions.resize(VERTICES);
+			outNormals.resize(VERTICES);
+			for (size_t i = 0; i < VERTICES; ++i) {
+				positions[i] = Vec3(out[i], out[VERTICES + i], out[VERTICES * 2 + i]);
+				outNormals[i] = Vec3(out[VERTICES * 3 + i], out[VERTICES * 4 + i], out[VERTICES * 5 + i]);
+			}
+		};
+		std::vector<Vec3> positions, normals;
+		run(false, 1, true, positions, normals);
+		bool zeroW;
+		checkBound("skin xyz positions", maxError(positions.data(), mesh.expectedPositions, zeroW), 1e-6, __LINE__);
+		checkBound("skin xyz normals", maxError(normals.data(), mesh.expectedNormals, zeroW), 1e-6, __LINE__);
+
+		for (unsigned int threads : { 1u, 3u, 0u }) {
+			std::vector<Vec3> parallelPositions, parallelNormals;
+			run(true, threads, true, parallelPositions, parallelNormals);
+			TT_CHECK(same(parallelPositions, positions) && same(parallelNormals, normals));
+			run(true, threads, false, parallelPositions, parallelNormals);
+			TT_CHECK(same(parallelPositions, positions) && std::all_of(parallelNormals.begin(), parallelNormals.end(), [](const Vec3& v) { return v.x == 7.0f; }));
+		}
+	}
+}
+
+int main() {
+	Mesh mesh = makeMesh();
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testVec3(mesh);
+		testStreams(mesh);
+	}
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
@@ -0,0 +1,122 @@
+// TransformHierarchy::update() against multiplying every node's local matrix with its parent's world matrix, on every SIMD path.
+#include "tt_transform_hierarchy.h"
+#include "tt_test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace TT;
+
+namespace {
+	const unsigned int NODES = 2000;
+
+	float maxDifference(const Mat44& a, const Mat44& b) {
+		float d = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			d = std::max(d, fabsf(a.m[i] - b.m[i]) / (1.0f + fabsf(b.m[i])));
+		return d;
+	}
+
+	// The largest difference of the world matrices to the naive products.
+	float worldError(const TransformHierarchy& hierarchy) {
+		std::vector<Mat44> worlds(hierarchy.size());
+		float e = 0.0f;
+		for (unsigned int i = 0; i < hierarchy.size(); ++i) {
+			unsigned int parent = hierarchy.parent(i);
+			worlds[i] = parent == TransformHierarchy::NO_PARENT ? hierarchy.local(i) : hierarchy.local(i) * worlds[parent];
+			e = std::max(e, maxDifference(hierarchy.world(i), worlds[i]));
+		}
+		return e;
+	}
+
+	Vec randomVec(std::mt19937& rng, float low, float high) {
+		std::uniform_real_distribution<float> random(low, high);
+		return Vec(random(rng), random(rng), random(rng), 0.0f);
+	}
+
+	// A forest of a few roots with random depth, every node's parent picked from the nodes before it.
+	void build(TransformHierarchy& hierarchy, std::mt19937& rng) {
+		hierarchy.clear();
+		hierarchy.reserve(NODES);
+		for (unsigned int i = 0; i < NODES; ++i) {
+			unsigned int parent = i % 500 == 0 ? TransformHierarchy::NO_PARENT : (unsigned int)(rng() % i);
+			hierarchy.add(parent, randomVec(rng, -5.0f, 5.0f), randomVec(rng, -3.0f, 3.0f), randomVec(rng, 0.8f, 1.2f));
+		}
+	}
+
+	unsigned int subtreeSize(const TransformHierarchy& hierarchy, unsigned int root) {
+		std::vector<bool> inside(hierarchy.size());
+		unsigned int count = 0;
+		for (unsigned int i = root; i < hierarchy.size(); ++i) {
+			unsigned int parent = hierarchy.parent(i);
+			inside[i] = i == root || (parent != TransformHierarchy::NO_PARENT && parent >= root && inside[parent]);
+			count += inside[i];
+		}
+		return count;
+	}
+
+	void testUpdate() {
+		std::mt19937 rng(3);
+		TransformHierarchy hierarchy;
+		build(hierarchy, rng);
+		TT_CHECK(hierarchy.update() == NODES);
+		TT_CHECK(worldError(hierarchy) < 1e-5f);
+		TT_CHECK(hierarchy.update() == 0);
+
+		// Only the changed subtrees are recomputed.
+		for (unsigned int node : { 1u, 17u, 600u, NODES - 1 }) {
+			hierarchy.setTranslation(node, randomVec(rng, -5.0f, 5.0f));
+			TT_CHECK(hierarchy.update() == subtreeSize(hierarchy, node));
+			TT_CHECK(worldError(hierarchy) < 1e-5f);
+		}
+		hierarchy.setRotation(3, randomVec(rng, -3.0f, 3.0f));
+		hierarchy.setScale(900, randomVec(rng, 0.5f, 2.0f));
+		hierarchy.setLocal(1500, Mat44::translate(1.0f, 2.0f, 3.0f));
+		size_t expected = subtreeSize(hierarchy, 3) + subtreeSize(hierarchy, 900) + subtreeSize(hierarchy, 1500);
+		TT_CHECK(hierarchy.update() <= expected && worldError(hierarchy) < 1e-5f);
+		TT_CHECK(hierarchy.update() == 0);
+	}
+
+	void testLocals() {
+		TransformHierarchy hierarchy;
+		unsigned int root = hierarchy.add();
+		unsigned int child = hierarchy.add(root, Vec(1.0f, 2.0f, 3.0f, 0.0f), Vec(0.0f, 0.5f, 0.0f, 0.0f), Vec(2.0f, 2.0f, 2.0f, 0.0f));
+		TT_CHECK(root == 0 && child == 1 && hierarchy.size() == 2 && hierarchy.parent(child) == root);
+		TT_CHECK(hierarchy.translation(child) == Vec(1.0f, 2.0f, 3.0f, 0.0f) && hierarchy.scale(root) == Vec(1.0f, 1.0f, 1.0f, 0.0f));
+		hierarchy.update();
+		TT_CHECK(maxDifference(hierarchy.local(child), Mat44::TRS(Vec(1.0f, 2.0f, 3.0f, 0.0f), Vec(0.0f, 0.5f, 0.0f, 0.0f), Vec(2.0f, 2.0f, 2.0f, 0.0f))) == 0.0f);
+
+		// setLocal() replaces a TRS set before it, a TRS set after it wins.
+		hierarchy.setTranslation(child, Vec(5.0f, 0.0f, 0.0f, 0.0f));
+		hierarchy.setLocal(child, Mat44::scale(3.0f, 3.0f, 3.0f));
+		hierarchy.setLocal(root, Mat44::translate(0.0f, 1.0f, 0.0f));
+		TT_CHECK(hierarchy.update() == 2);
+		TT_CHECK(maxDifference(hierarchy.world(child), Mat44::scale(3.0f, 3.0f, 3.0f) * Mat44::translate(0.0f, 1.0f, 0.0f)) == 0.0f);
+		hierarchy.setTranslation(child, Vec(5.0f, 0.0f, 0.0f, 0.0f));
+		TT_CHECK(hierarchy.update() == 1 && hierarchy.world(child).m[12] == 5.0f && hierarchy.world(child).m[13] == 1.0f);
+		TT_CHECK(hierarchy.worldMatrices() == &hierarchy.world(0));
+
+		hierarchy.clear();
+		TT_CHECK(hierarchy.size() == 0 && hierarchy.update() == 0 && hierarchy.add() == 0);
+#ifdef NDEBUG
+		// Parents must exist, debug builds assert.
+		TT_CHECK(hierarchy.add(1) == TransformHierarchy::NO_PARENT && hierarchy.add(7, Vec(0.0f), Vec(0.0f), Vec(1.0f)) == TransformHierarchy::NO_PARENT);
+		TT_CHECK(hierarchy.size() == 1);
+#endif
+	}
+}
+
+int main() {
+	ESimdPath selected = simdPath();
+	for (ESimdPath path : { ESimdPath::SSE2, ESimdPath::AVX2 }) {
+		if (!setSimdPath(path)) {
+			printf("%s: not supported, skipped\n", simdPathName(path));
+			continue;
+		}
+		testUpdate();
+		testLocals();
+	}
+	setSimdPath(selected);
+	return TT_TEST_RESULT;
+}
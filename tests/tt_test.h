@@ -0,0 +1,79 @@
+#pragma once
+
+// Minimal checks for the test executables: failed checks are printed and counted, and main returns TT_TEST_RESULT so ctest sees the failure.
+#include <cstdio>
+#include <string>
+#include "tt_json5.h"
+
+namespace TTTest {
+	inline int failures = 0;
+
+	inline bool check(bool passed, const char* expression, const char* file, int line) {
+		if (!passed) {
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+			++failures;
+		}
+		return passed;
+	}
+
+	// Parses text into a document, returns the parse error or an empty string.
+	inline TTJson::str_t parse(const TTJson::str_t& text, TTJson::Value& result, const TTJson::ParseOptions& options = {}) {
+		TTJson::sstr_t stream(text);
+		TTJson::Parser parser(options);
+		parser.parse(stream, result);
+		return parser.hasError() ? parser.error() : TTJson::str_t{};
+	}
+
+	// Compares documents by value, whatever their storage: packed, shaped, lazy or pooled.
+	inline bool equal(const TTJson::Value& a, const TTJson::Value& b) {
+		if (a.getType() != b.getType())
+			return false;
+		switch (a.getType()) {
+		case TTJson::ValueType::Null:
+			return true;
+		case TTJson::ValueType::Bool:
+			return a.asBool() == b.asBool();
+		case TTJson::ValueType::Int:
+			return a.asInt() == b.asInt();
+		case TTJson::ValueType::Double:
+			return a.asDouble() == b.asDouble() || (a.asDouble() != a.asDouble() && b.asDouble() != b.asDouble());
+		case TTJson::ValueType::String:
+			return a.asString() == b.asString();
+		case TTJson::ValueType::Array: {
+			// Compare copies, asArray() converts packed and shaped arrays.
+			const TTJson::Value copyA = a;
+			const TTJson::Value copyB = b;
+			const TTJson::Array& x = copyA.asArray();
+			const TTJson::Array& y = copyB.asArray();
+			if (x.size() != y.size())
+				return false;
+			for (size_t i = 0; i < x.size(); ++i) {
+				if (!equal(x[i], y[i]))
+					return false;
+			}
+			return true;
+		}
+		case TTJson::ValueType::Object: {
+			const TTJson::Object& y = b.asObject();
+			if (a.asObject().size() != y.size())
+				return false;
+			for (const auto& pair : a.asObject()) {
+				const TTJson::Value* other = y.tryGet(pair.first);
+				if (!other || !equal(pair.second, *other))
+					return false;
+			}
+			return true;
+		}
+		}
+		return false;
+	}
+
+	inline TTJson::str_t serialize(const TTJson::Value& value) {
+		TTJson::sstr_t out;
+		TTJson::serialize(value, out);
+		return out.str();
+	}
+}
+
+#define TT_CHECK(expression) TTTest::check((expression), #expression, __FILE__, __LINE__)
+#define TT_TEST_RESULT (TTTest::failures == 0 ? 0 : 1)
@@ -0,0 +1,127 @@
+#include "tt_animation.h"
+#include <algorithm>
+#include "tt_cgmath_kernels.h"
+#include "tt_transform_hierarchy.h"
+
+namespace TT {
+	namespace {
+		// Tracks are gathered into streams and sampled this many at a time, so the streams stay in L1.
+		constexpr size_t BLOCK = 64;
+		typedef float Streams[SAMPLE_STREAMS][BLOCK];
+
+		const float IDENTITY_TRANSLATION[3] = { 0.0f, 0.0f, 0.0f };
+		const float IDENTITY_ROTATION[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const float IDENTITY_SCALE[3] = { 1.0f, 1.0f, 1.0f };
+
+		// Finds the keys around time, stepping forward from the cursor's key when time did not go back, and writes both keys
+		// and the weight between them to the streams starting at stream (a components, b components, weight), at index i.
+		template<int componentCount> void gather(const float* times, const float* values, unsigned int first, unsigned int count,
+			unsigned int& cursor, float time, const float* identity, Streams& streams, int stream, size_t i) {
+			float* a = &streams[stream][i];
+			float* b = &streams[stream + componentCount][i];
+			if (count == 0) {
+				for (int c = 0; c < componentCount; ++c)
+					a[c * BLOCK] = b[c * BLOCK] = identity[c];
+				streams[stream + 2 * componentCount][i] = 0.0f;
+				return;
+			}
+			const float* t = times + first;
+			unsigned int k = cursor;
+			if (k >= count || t[k] > time) {
+				k = (unsigned int)(std::upper_bound(t, t + count, time) - t);
+				k = k ? k - 1 : 0;
+			} else {
+				while (k + 1 < count && t[k + 1] <= time)
+					++k;
+			}
+			cursor = k;
+			unsigned int next = k + 1 < count ? k + 1 : k;
+			// Before the first key the weight clamps to 0, past the last both keys are the last.
+			float weight = next != k ? std::clamp((time - t[k]) / (t[next] - t[k]), 0.0f, 1.0f) : 0.0f;
+			const float* keyA = values + (first + k) * componentCount;
+			const float* keyB = values + (first + next) * componentCount;
+			for (int c = 0; c < componentCount; ++c) {
+				a[c * BLOCK] = keyA[c];
+				b[c * BLOCK] = keyB[c];
+			}
+			streams[stream + 2 * componentCount][i] = weight;
+		}
+	}
+
+	unsigned int AnimationClip::addTrack(unsigned int target) {
+		unsigned int track = (unsigned int)targets.size();
+		targets.push_back(target);
+		channels.resize(channels.size() + 3);
+		return track;
+	}
+
+	void AnimationClip::setKeys(Keys& keys, Channel& channel, const float* times, const float* values, size_t stride, int components, size_t count) {
+		channel.first = (unsigned int)keys.times.size();
+		channel.count = (unsigned int)count;
+		keys.times.insert(keys.times.end(), times, times + count);
+		keys.values.reserve(keys.values.size() + count * components);
+		for (size_t i = 0; i < count; ++i)
+			keys.values.insert(keys.values.end(), values + i * stride, values + i * stride + components);
+		if (count)
+			end = std::max(end, times[count - 1]);
+	}
+
+	void AnimationClip::setTranslations(unsigned int track, const float* times, const Vec3* values, size_t count) {
+		setKeys(translations, channels[3 * track], times, reinterpret_cast<const float*>(values), sizeof(Vec3) / sizeof(float), 3, count);
+	}
+
+	void AnimationClip::setRotations(unsigned int track, const float* times, const Quat* values, size_t count) {
+		setKeys(rotations, channels[3 * track + 1], times, reinterpret_cast<const float*>(values), sizeof(Quat) / sizeof(float), 4, count);
+	}
+
+	void AnimationClip::setScales(unsigned int track, const float* times, const Vec3* values, size_t count) {
+		setKeys(scales, channels[3 * track + 2], times, reinterpret_cast<const float*>(values), sizeof(Vec3) / sizeof(float), 3, count);
+	}
+
+	void AnimationClip::clear() {
+		targets.clear();
+		channels.clear();
+		for (Keys* keys : { &translations, &rotations, &scales }) {
+			keys->times.clear();
+			keys->values.clear();
+		}
+		end = 0.0f;
+	}
+
+	void AnimationClip::sample(float time, AnimationCursor& cursor, Mat44* locals) const {
+		sample(time, cursor, locals, nullptr);
+	}
+
+	void AnimationClip::sample(float time, AnimationCursor& cursor, TransformHierarchy& hierarchy) const {
+		sample(time, cursor, nullptr, &hierarchy);
+	}
+
+	void AnimationClip::sample(float time, AnimationCursor& cursor, Mat44* locals, TransformHierarchy* hierarchy) const {
+		if (cursor.keys.size() != channels.size())
+			cursor.keys.assign(channels.size(), 0);
+		alignas(32) Streams streams;
+		const float* streamPointers[SAMPLE_STREAMS];
+		for (int s = 0; s < SAMPLE_STREAMS; ++s)
+			streamPointers[s] = streams[s];
+		Mat44 block[BLOCK];
+
+		const size_t count = targets.size();
+		for (size_t first = 0; first < count; first += BLOCK) {
+			size_t n = std::min(BLOCK, count - first);
+			for (size_t i = 0; i < n; ++i) {
+				const Channel* channel = &channels[3 * (first + i)];
+				unsigned int* keys = &cursor.keys[3 * (first + i)];
+				gather<3>(translations.times.data(), translations.values.data(), channel[0].first, channel[0].count, keys[0], time, IDENTITY_TRANSLATION, streams, TRANSLATION_A, i);
+				gather<4>(rotations.times.data(), rotations.values.data(), channel[1].first, channel[1].count, keys[1], time, IDENTITY_ROTATION, streams, ROTATION_A, i);
+				gather<3>(scales.times.data(), scales.values.data(), channel[2].first, channel[2].count, keys[2], time, IDENTITY_SCALE, streams, SCALE_A, i);
+			}
+			if (hierarchy) {
+				cgmathKernels->sampleTRS(streamPointers, n, block);
+				for (size_t i = 0; i < n; ++i)
+					hierarchy->setLocal(targets[first + i], block[i]);
+			} else {
+				cgmathKernels->sampleTRS(streamPointers, n, locals + first);
+			}
+		}
+	}
+}
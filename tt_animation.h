@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include "tt_cgmath.h"
+
+namespace TT {
+	struct TransformHierarchy;
+
+	// Playback position in a clip: per channel the key last sampled, so the next sample at a later time only steps forward from it.
+	// Keep one per playing instance of a clip, it is sized on first use.
+	struct AnimationCursor {
+		std::vector<unsigned int> keys;
+	};
+
+	// Keyframe animation of many transforms. Each track has translation, rotation and scale channels with their own key times,
+	// stored per kind of channel for all tracks together. sample() gathers the keys around the time into structure of arrays streams
+	// and interpolates 8 or 4 tracks per step depending on the SIMD path (lerp for translation and scale, slerp for rotation), writing local matrices.
+	struct AnimationClip {
+		// target is up to the caller, sampling into a TransformHierarchy uses it as the node. Returns the new track's index.
+		unsigned int addTrack(unsigned int target);
+		// Key times are in seconds and increasing. A channel without keys stays at identity, one with a single key holds it.
+		// Set each channel once, setting it again leaves the old keys unused until clear().
+		void setTranslations(unsigned int track, const float* times, const Vec3* values, size_t count);
+		void setRotations(unsigned int track, const float* times, const Quat* values, size_t count);
+		void setScales(unsigned int track, const float* times, const Vec3* values, size_t count);
+		void clear();
+		size_t trackCount() const { return targets.size(); }
+		unsigned int target(unsigned int track) const { return targets[track]; }
+		// The last key time of all channels.
+		float duration() const { return end; }
+
+		// Samples every track at time and writes the local matrix of track n (Mat44::TRS of the interpolated values) to locals[n].
+		// Times before the first or after the last key of a channel hold that key, wrap time yourself for looping.
+		// Stepping backwards in time (e.g. when looping) searches the keys again instead of stepping forward.
+		void sample(float time, AnimationCursor& cursor, Mat44* locals) const;
+		// The same, setting the local matrix of each track's target node.
+		void sample(float time, AnimationCursor& cursor, TransformHierarchy& hierarchy) const;
+
+	private:
+		struct Channel {
+			unsigned int first = 0;
+			unsigned int count = 0;
+		};
+		// The keys of all channels of one kind: a time stream for the searches and the values, each key's components together
+		// so a pair of keys shares a cache line or two when they are gathered.
+		struct Keys {
+			std::vector<float> times;
+			std::vector<float> values;
+		};
+
+		std::vector<unsigned int> targets;
+		// Translation, rotation and scale of each track.
+		std::vector<Channel> channels;
+		Keys translations;
+		Keys rotations;
+		Keys scales;
+		float end = 0.0f;
+
+		void setKeys(Keys& keys, Channel& channel, const float* times, const float* values, size_t stride, int components, size_t count);
+		void sample(float time, AnimationCursor& cursor, Mat44* locals, TransformHierarchy* hierarchy) const;
+	};
+}
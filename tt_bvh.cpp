@@ -0,0 +1,637 @@
+#include "tt_bvh.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include "tt_parallel.h"
+
+namespace TT {
+	namespace {
+		// Large nodes are binned finer, for small ones the fixed cost of the bins dominates the build.
+		const int BINS = 16;
+		const int SMALL_NODE_BINS = 8;
+		const unsigned int SMALL_NODE = 256;
+		const unsigned int MAX_LEAF = 4;
+		// Traversal keeps the far children on a stack of this size. Splits deeper than MAX_SAH_DEPTH are made at the object median,
+		// which halves the primitives, so no path gets longer than MAX_SAH_DEPTH + 32 nodes.
+		const unsigned int TRAVERSAL_STACK = 128;
+		const unsigned int MAX_SAH_DEPTH = 64;
+
+		struct Bounds {
+			__m128 min;
+			__m128 max;
+		};
+
+		Bounds emptyBounds() { return { _mm_set1_ps(INFINITY), _mm_set1_ps(-INFINITY) }; }
+
+		void grow(Bounds& bounds, const Bounds& other) {
+			bounds.min = _mm_min_ps(bounds.min, other.min);
+			bounds.max = _mm_max_ps(bounds.max, other.max);
+		}
+
+		void grow(Bounds& bounds, __m128 point) {
+			bounds.min = _mm_min_ps(bounds.min, point);
+			bounds.max = _mm_max_ps(bounds.max, point);
+		}
+
+		__m128 centroid(const Bounds& bounds) { return _mm_mul_ps(_mm_add_ps(bounds.min, bounds.max), _mm_set1_ps(0.5f)); }
+
+		// Half the surface area, which is all the SAH needs. Empty bounds have none.
+		float halfArea(const Bounds& bounds) {
+			Vec e = _mm_max_ps(_mm_sub_ps(bounds.max, bounds.min), _mm_setzero_ps());
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+
+		__m128 hmin(__m128 v) {
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		}
+
+		__m128 hmax(__m128 v) {
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		}
+
+		// Nodes keep first or count in lane 3, which would be a denormal (and slow) as a float. Single ray node tests work on x, y, z, x instead.
+		__m128 xyzx(__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 2, 1, 0)); }
+
+		__m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+		// 1 / d, with components too close to 0 replaced by a tiny value of the same sign so no inf * 0 = NaN comes up in the slab test.
+		__m128 safeInverse(Vec d) {
+			for (int i = 0; i < 3; ++i) {
+				if (fabsf(d[i]) < 1e-20f)
+					d[i] = copysignf(1e-20f, d[i]);
+			}
+			d.w = 1.0f;
+			return _mm_div_ps(_mm_set1_ps(1.0f), d.m);
+		}
+
+		// The structure of arrays form of rays and primitives: each lane holds another ray (packets) or another primitive (single rays).
+		struct Lanes3 {
+			__m128 x, y, z;
+		};
+
+		Lanes3 broadcast(__m128 v) {
+			return { _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)) };
+		}
+
+		Lanes3 transpose(__m128 a, __m128 b, __m128 c, __m128 d) {
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			return { a, b, c };
+		}
+
+		Lanes3 operator-(const Lanes3& a, const Lanes3& b) { return { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) }; }
+
+		__m128 dot(const Lanes3& a, const Lanes3& b) { return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z)); }
+
+		Lanes3 cross(const Lanes3& a, const Lanes3& b) {
+			return {
+				_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+				_mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+				_mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)),
+			};
+		}
+
+		// Möller-Trumbore per lane, returns the lanes hitting in [0, best). Degenerate triangles give NaN, which fails the comparisons.
+		__m128 intersectTriangles(const Lanes3& origin, const Lanes3& direction, const Lanes3& a, const Lanes3& b, const Lanes3& c, __m128 best, __m128& t, __m128& u, __m128& v) {
+			Lanes3 e1 = b - a;
+			Lanes3 e2 = c - a;
+			Lanes3 p = cross(direction, e2);
+			__m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), dot(e1, p));
+			Lanes3 s = origin - a;
+			u = _mm_mul_ps(dot(s, p), inverseDet);
+			Lanes3 q = cross(s, e1);
+			v = _mm_mul_ps(dot(direction, q), inverseDet);
+			t = _mm_mul_ps(dot(e2, q), inverseDet);
+			__m128 zero = _mm_setzero_ps();
+			__m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+			return _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, best)));
+		}
+
+		// The slab test per lane, returns the lanes entering the box before best, with the entry distance (0 inside the box) in t.
+		__m128 intersectBoxes(const Lanes3& origin, const Lanes3& inverseDirection, const Lanes3& min, const Lanes3& max, __m128 best, __m128& t) {
+			Lanes3 t1 = min - origin;
+			Lanes3 t2 = max - origin;
+			t1 = { _mm_mul_ps(t1.x, inverseDirection.x), _mm_mul_ps(t1.y, inverseDirection.y), _mm_mul_ps(t1.z, inverseDirection.z) };
+			t2 = { _mm_mul_ps(t2.x, inverseDirection.x), _mm_mul_ps(t2.y, inverseDirection.y), _mm_mul_ps(t2.z, inverseDirection.z) };
+			__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1.x, t2.x), _mm_min_ps(t1.y, t2.y)), _mm_max_ps(_mm_min_ps(t1.z, t2.z), _mm_setzero_ps()));
+			__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1.x, t2.x), _mm_max_ps(t1.y, t2.y)), _mm_max_ps(t1.z, t2.z));
+			t = entry;
+			return _mm_and_ps(_mm_cmple_ps(entry, exit), _mm_cmplt_ps(entry, best));
+		}
+	}
+
+	Ray::Ray() {}
+
+	Ray::Ray(Vec origin, Vec direction) : origin(origin), direction(direction) {}
+
+	Ray Ray::fromPixel(float x, float y, float width, float height, const Mat44& camera, const Mat44& projection) {
+		// From normalized device coordinates to the camera's space, then to the world. Projections are badly conditioned, hence the precise inverse.
+		Mat44 unproject = projection.inversed(EInversePrecision::Precise) * camera;
+		float ndcX = 2.0f * x / width - 1.0f;
+		float ndcY = 1.0f - 2.0f * y / height;
+		Vec nearPoint = unproject * Vec4(ndcX, ndcY, -1.0f, 1.0f);
+		Vec farPoint = unproject * Vec4(ndcX, ndcY, 1.0f, 1.0f);
+		nearPoint = nearPoint / _mm_shuffle_ps(nearPoint.m, nearPoint.m, _MM_SHUFFLE(3, 3, 3, 3));
+		farPoint = farPoint / _mm_shuffle_ps(farPoint.m, farPoint.m, _MM_SHUFFLE(3, 3, 3, 3));
+		Vec direction = _mm_and_ps(farPoint - nearPoint, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		nearPoint.w = 0.0f;
+		return Ray(nearPoint, direction / direction.len());
+	}
+
+	struct BVH::Builder {
+		// bounds[i] belongs to primitives[i], both are reordered together so the passes over a node read memory in order.
+		Bounds* bounds;
+		unsigned int* primitives;
+		// Splits above this depth run their left half on a new thread.
+		unsigned int parallelDepth;
+
+		struct Bin {
+			Bounds bounds = emptyBounds();
+			unsigned int count = 0;
+		};
+
+		static Bounds nodeBounds(const Node& node) { return { xyzx(_mm_load_ps(node.min)), xyzx(_mm_load_ps(node.max)) }; }
+
+		static void setBounds(Node& node, const Bounds& bounds) {
+			Vec min = bounds.min, max = bounds.max;
+			for (int i = 0; i < 3; ++i) {
+				node.min[i] = min[i];
+				node.max[i] = max[i];
+			}
+		}
+
+		// The bin of a centroid on each axis, the same computation is used for binning and partitioning so both agree.
+		static __m128i binIndices(__m128 centroid, __m128 centroidMin, __m128 scale, int binCount) {
+			__m128i bin = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(centroid, centroidMin), scale));
+			__m128i last = _mm_set1_epi32(binCount - 1);
+			__m128i over = _mm_cmpgt_epi32(bin, last);
+			return _mm_or_si128(_mm_and_si128(over, last), _mm_andnot_si128(over, bin));
+		}
+
+		void subdivide(std::vector<Node>& nodes, unsigned int index, const Bounds& centroids, unsigned int depth) {
+			const Node node = nodes[index];
+			if (node.count <= 1)
+				return;
+			Vec extent = _mm_sub_ps(centroids.max, centroids.min);
+			bool binnable = extent.x > 0.0f || extent.y > 0.0f || extent.z > 0.0f;
+			if (depth >= MAX_SAH_DEPTH || !binnable) {
+				if (node.count > MAX_LEAF)
+					medianSplit(nodes, index, depth);
+				return;
+			}
+
+			const int binCount = node.count > SMALL_NODE ? BINS : SMALL_NODE_BINS;
+			Vec scale(0.0f);
+			for (int axis = 0; axis < 3; ++axis)
+				scale[axis] = extent[axis] > 0.0f ? binCount * 0.99999f / extent[axis] : 0.0f;
+			Bin bins[3][BINS];
+			for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+				const Bounds& b = bounds[i];
+				__m128 c = centroid(b);
+				alignas(16) int bin[4];
+				_mm_store_si128((__m128i*)bin, binIndices(c, centroids.min, scale.m, binCount));
+				for (int axis = 0; axis < 3; ++axis) {
+					Bin& target = bins[axis][bin[axis]];
+					grow(target.bounds, b);
+					++target.count;
+				}
+			}
+
+			// Sweep the planes between the bins from both sides, the cost of a split is count * half area summed over both halves.
+			int bestAxis = -1, bestPlane = 0;
+			float bestCost = INFINITY;
+			for (int axis = 0; axis < 3; ++axis) {
+				if (extent[axis] <= 0.0f)
+					continue;
+				float leftCost[BINS];
+				Bounds left = emptyBounds();
+				unsigned int leftCount = 0;
+				for (int plane = 1; plane < binCount; ++plane) {
+					grow(left, bins[axis][plane - 1].bounds);
+					leftCount += bins[axis][plane - 1].count;
+					leftCost[plane] = leftCount ? leftCount * halfArea(left) : INFINITY;
+				}
+				Bounds right = emptyBounds();
+				unsigned int rightCount = 0;
+				for (int plane = binCount - 1; plane > 0; --plane) {
+					grow(right, bins[axis][plane].bounds);
+					rightCount += bins[axis][plane].count;
+					float cost = leftCost[plane] + (rightCount ? rightCount * halfArea(right) : INFINITY);
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestPlane = plane;
+					}
+				}
+			}
+			if (bestAxis < 0) {
+				if (node.count > MAX_LEAF)
+					medianSplit(nodes, index, depth);
+				return;
+			}
+			// Small nodes stay leaves unless splitting saves more than the cost of visiting another node.
+			float nodeArea = halfArea(nodeBounds(node));
+			if (node.count <= MAX_LEAF && bestCost + nodeArea >= node.count * nodeArea)
+				return;
+
+			// The partition also collects the centroid bounds of both halves, the bins only keep what the SAH needs.
+			Bounds childCentroids[2] = { emptyBounds(), emptyBounds() };
+			unsigned int middle = node.first, end = node.first + node.count;
+			while (middle < end) {
+				__m128 c = centroid(bounds[middle]);
+				alignas(16) int bin[4];
+				_mm_store_si128((__m128i*)bin, binIndices(c, centroids.min, scale.m, binCount));
+				if (bin[bestAxis] < bestPlane) {
+					grow(childCentroids[0], c);
+					++middle;
+				} else {
+					grow(childCentroids[1], c);
+					--end;
+					std::swap(bounds[middle], bounds[end]);
+					std::swap(primitives[middle], primitives[end]);
+				}
+			}
+			Bounds childBounds[2] = { emptyBounds(), emptyBounds() };
+			for (int bin = 0; bin < binCount; ++bin)
+				grow(childBounds[bin < bestPlane ? 0 : 1], bins[bestAxis][bin].bounds);
+			split(nodes, index, middle - node.first, childBounds, childCentroids, depth);
+		}
+
+		// Splits at the median centroid along the longest axis, for nodes the SAH can't split or that are too deep.
+		void medianSplit(std::vector<Node>& nodes, unsigned int index, unsigned int depth) {
+			const Node node = nodes[index];
+			Bounds centroids = emptyBounds();
+			for (unsigned int i = node.first; i < node.first + node.count; ++i)
+				grow(centroids, centroid(bounds[i]));
+			Vec extent = _mm_sub_ps(centroids.max, centroids.min);
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+			struct Item {
+				Bounds bounds;
+				unsigned int primitive;
+			};
+			std::vector<Item> items(node.count);
+			for (unsigned int i = 0; i < node.count; ++i)
+				items[i] = { bounds[node.first + i], primitives[node.first + i] };
+			unsigned int leftCount = node.count / 2;
+			std::nth_element(items.begin(), items.begin() + leftCount, items.end(), [&](const Item& a, const Item& b) {
+				return Vec(centroid(a.bounds))[axis] < Vec(centroid(b.bounds))[axis];
+			});
+			Bounds childBounds[2] = { emptyBounds(), emptyBounds() };
+			Bounds childCentroids[2] = { emptyBounds(), emptyBounds() };
+			for (unsigned int i = 0; i < node.count; ++i) {
+				int side = i < leftCount ? 0 : 1;
+				bounds[node.first + i] = items[i].bounds;
+				primitives[node.first + i] = items[i].primitive;
+				grow(childBounds[side], items[i].bounds);
+				grow(childCentroids[side], centroid(items[i].bounds));
+			}
+			split(nodes, index, leftCount, childBounds, childCentroids, depth);
+		}
+
+		void split(std::vector<Node>& nodes, unsigned int index, unsigned int leftCount, const Bounds childBounds[2], const Bounds childCentroids[2], unsigned int depth) {
+			unsigned int first = nodes[index].first;
+			unsigned int count = nodes[index].count;
+			unsigned int left = (unsigned int)nodes.size();
+			nodes.resize(nodes.size() + 2);
+			setBounds(nodes[left], childBounds[0]);
+			nodes[left].first = first;
+			nodes[left].count = leftCount;
+			setBounds(nodes[left + 1], childBounds[1]);
+			nodes[left + 1].first = first + leftCount;
+			nodes[left + 1].count = count - leftCount;
+			nodes[index].first = left;
+			nodes[index].count = 0;
+
+			if (depth >= parallelDepth || count < PARALLEL_MIN) {
+				subdivide(nodes, left, childCentroids[0], depth + 1);
+				subdivide(nodes, left + 1, childCentroids[1], depth + 1);
+				return;
+			}
+			// The left subtree grows its own node array on another thread and is appended afterwards.
+			std::vector<Node> leftNodes(1, nodes[left]);
+			std::thread worker([&] { subdivide(leftNodes, 0, childCentroids[0], depth + 1); });
+			subdivide(nodes, left + 1, childCentroids[1], depth + 1);
+			worker.join();
+			unsigned int offset = (unsigned int)nodes.size() - 1;
+			for (Node& n : leftNodes) {
+				if (n.count == 0)
+					n.first += offset;
+			}
+			nodes[left] = leftNodes[0];
+			nodes.insert(nodes.end(), leftNodes.begin() + 1, leftNodes.end());
+		}
+	};
+
+	void BVH::buildTriangles(const Vec* vertices, const unsigned int* indices, size_t triangleCount, unsigned int threads) {
+		this->vertices = vertices;
+		this->indices = indices;
+		boxMin = nullptr;
+		boxMax = nullptr;
+		build(triangleCount, threads);
+	}
+
+	void BVH::buildBoxes(const Vec* boxMin, const Vec* boxMax, size_t boxCount, unsigned int threads) {
+		vertices = nullptr;
+		indices = nullptr;
+		this->boxMin = boxMin;
+		this->boxMax = boxMax;
+		build(boxCount, threads);
+	}
+
+	void BVH::clear() {
+		nodes.clear();
+		primitives.clear();
+		vertices = nullptr;
+		indices = nullptr;
+		boxMin = nullptr;
+		boxMax = nullptr;
+	}
+
+	void BVH::build(size_t count, unsigned int threads) {
+		nodes.clear();
+		primitives.resize(count);
+		if (count == 0)
+			return;
+		if (threads == 0)
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		// Bounds of every primitive, and the bounds and centroid bounds of everything for the root.
+		std::vector<Bounds> bounds(count);
+		std::mutex mutex;
+		Bounds rootBounds = emptyBounds(), rootCentroids = emptyBounds();
+		parallelFor(count, threads, [&](size_t begin, size_t end) {
+			Bounds all = emptyBounds(), centroids = emptyBounds();
+			for (size_t i = begin; i < end; ++i) {
+				Bounds& b = bounds[i];
+				if (vertices) {
+					size_t v = i * 3;
+					__m128 a = vertices[indices ? indices[v] : v].m;
+					__m128 b1 = vertices[indices ? indices[v + 1] : v + 1].m;
+					__m128 c = vertices[indices ? indices[v + 2] : v + 2].m;
+					b.min = _mm_min_ps(_mm_min_ps(a, b1), c);
+					b.max = _mm_max_ps(_mm_max_ps(a, b1), c);
+				} else {
+					b.min = boxMin[i].m;
+					b.max = boxMax[i].m;
+				}
+				primitives[i] = (unsigned int)i;
+				grow(all, b);
+				grow(centroids, centroid(b));
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			grow(rootBounds, all);
+			grow(rootCentroids, centroids);
+		});
+
+		nodes.reserve(count + count / 4);
+		nodes.resize(1);
+		Builder::setBounds(nodes[0], rootBounds);
+		nodes[0].first = 0;
+		nodes[0].count = (unsigned int)count;
+		unsigned int parallelDepth = 0;
+		while ((1u << parallelDepth) < threads)
+			++parallelDepth;
+		Builder builder = { bounds.data(), primitives.data(), parallelDepth };
+		builder.subdivide(nodes, 0, rootCentroids, 0);
+	}
+
+	struct BVH::Traversal {
+		// Up to 4 primitives of a leaf in lanes, missing ones repeat the last.
+		static void gatherTriangles(const BVH& bvh, const Node& node, Lanes3& a, Lanes3& b, Lanes3& c) {
+			__m128 v[3][4];
+			for (unsigned int i = 0; i < 4; ++i) {
+				size_t t = (size_t)bvh.primitives[node.first + std::min(i, node.count - 1)] * 3;
+				for (int k = 0; k < 3; ++k)
+					v[k][i] = bvh.vertices[bvh.indices ? bvh.indices[t + k] : t + k].m;
+			}
+			a = transpose(v[0][0], v[0][1], v[0][2], v[0][3]);
+			b = transpose(v[1][0], v[1][1], v[1][2], v[1][3]);
+			c = transpose(v[2][0], v[2][1], v[2][2], v[2][3]);
+		}
+
+		static void gatherBoxes(const BVH& bvh, const Node& node, Lanes3& min, Lanes3& max) {
+			__m128 v[2][4];
+			for (unsigned int i = 0; i < 4; ++i) {
+				unsigned int p = bvh.primitives[node.first + std::min(i, node.count - 1)];
+				v[0][i] = bvh.boxMin[p].m;
+				v[1][i] = bvh.boxMax[p].m;
+			}
+			min = transpose(v[0][0], v[0][1], v[0][2], v[0][3]);
+			max = transpose(v[1][0], v[1][1], v[1][2], v[1][3]);
+		}
+
+		// Entry distance of a single ray into a node, INFINITY if it misses or enters after best. origin and inverseDirection are in xyzx() form.
+		static float enter(const Node& node, __m128 origin, __m128 inverseDirection, float best) {
+			Bounds bounds = Builder::nodeBounds(node);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(bounds.min, origin), inverseDirection);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(bounds.max, origin), inverseDirection);
+			__m128 entry = _mm_min_ps(t1, t2);
+			__m128 exit = _mm_max_ps(t1, t2);
+			float n = std::max(_mm_cvtss_f32(hmax(entry)), 0.0f);
+			float f = _mm_cvtss_f32(hmin(exit));
+			return n <= f && n < best ? n : INFINITY;
+		}
+
+		static void intersectLeaf(const BVH& bvh, const Node& node, const Lanes3& origin, const Lanes3& direction, const Lanes3& inverseDirection, RayHit& hit) {
+			alignas(16) float t[4], u[4], v[4];
+			__m128 tLanes, uLanes = _mm_setzero_ps(), vLanes = _mm_setzero_ps();
+			__m128 mask;
+			if (bvh.vertices) {
+				Lanes3 a, b, c;
+				gatherTriangles(bvh, node, a, b, c);
+				mask = intersectTriangles(origin, direction, a, b, c, _mm_set1_ps(hit.distance), tLanes, uLanes, vLanes);
+			} else {
+				Lanes3 min, max;
+				gatherBoxes(bvh, node, min, max);
+				mask = intersectBoxes(origin, inverseDirection, min, max, _mm_set1_ps(hit.distance), tLanes);
+			}
+			unsigned int bits = (unsigned int)_mm_movemask_ps(mask) & ((1u << node.count) - 1);
+			if (!bits)
+				return;
+			_mm_store_ps(t, tLanes);
+			_mm_store_ps(u, uLanes);
+			_mm_store_ps(v, vLanes);
+			for (unsigned int i = 0; i < node.count; ++i) {
+				if ((bits >> i) & 1 && t[i] < hit.distance) {
+					hit.distance = t[i];
+					hit.primitive = bvh.primitives[node.first + i];
+					hit.u = u[i];
+					hit.v = v[i];
+				}
+			}
+		}
+
+		// 4 rays in lanes.
+		struct Packet {
+			Lanes3 origin;
+			Lanes3 direction;
+			Lanes3 inverseDirection;
+			__m128 best;
+			__m128 primitive;
+			__m128 u;
+			__m128 v;
+		};
+
+		static __m128 enter(const Node& node, const Packet& packet, __m128& t) {
+			Bounds bounds = Builder::nodeBounds(node);
+			Lanes3 min = broadcast(bounds.min);
+			Lanes3 max = broadcast(bounds.max);
+			return intersectBoxes(packet.origin, packet.inverseDirection, min, max, packet.best, t);
+		}
+
+		static void intersectLeaf(const BVH& bvh, const Node& node, Packet& packet) {
+			for (unsigned int i = 0; i < node.count; ++i) {
+				unsigned int p = bvh.primitives[node.first + i];
+				__m128 t, u = _mm_setzero_ps(), v = _mm_setzero_ps(), mask;
+				if (bvh.vertices) {
+					size_t k = (size_t)p * 3;
+					Lanes3 a = broadcast(bvh.vertices[bvh.indices ? bvh.indices[k] : k].m);
+					Lanes3 b = broadcast(bvh.vertices[bvh.indices ? bvh.indices[k + 1] : k + 1].m);
+					Lanes3 c = broadcast(bvh.vertices[bvh.indices ? bvh.indices[k + 2] : k + 2].m);
+					mask = intersectTriangles(packet.origin, packet.direction, a, b, c, packet.best, t, u, v);
+				} else {
+					mask = intersectBoxes(packet.origin, packet.inverseDirection, broadcast(bvh.boxMin[p].m), broadcast(bvh.boxMax[p].m), packet.best, t);
+				}
+				packet.best = select(mask, t, packet.best);
+				packet.primitive = select(mask, _mm_castsi128_ps(_mm_set1_epi32((int)p)), packet.primitive);
+				packet.u = select(mask, u, packet.u);
+				packet.v = select(mask, v, packet.v);
+			}
+		}
+	};
+
+	RayHit BVH::intersect(const Ray& ray, float maxDistance) const {
+		RayHit hit;
+		hit.distance = maxDistance;
+		if (nodes.empty())
+			return hit;
+		__m128 inverseDirection = xyzx(safeInverse(ray.direction));
+		__m128 nodeOrigin = xyzx(ray.origin.m);
+		Lanes3 origin = broadcast(ray.origin.m);
+		Lanes3 direction = broadcast(ray.direction.m);
+		Lanes3 inverseDirections = broadcast(inverseDirection);
+
+		struct Entry {
+			unsigned int node;
+			float distance;
+		};
+		Entry stack[TRAVERSAL_STACK];
+		unsigned int size = 0;
+		if (Traversal::enter(nodes[0], nodeOrigin, inverseDirection, hit.distance) == INFINITY)
+			return hit;
+		unsigned int node = 0;
+		for (;;) {
+			const Node& n = nodes[node];
+			if (n.count) {
+				Traversal::intersectLeaf(*this, n, origin, direction, inverseDirections, hit);
+			} else {
+				float d0 = Traversal::enter(nodes[n.first], nodeOrigin, inverseDirection, hit.distance);
+				float d1 = Traversal::enter(nodes[n.first + 1], nodeOrigin, inverseDirection, hit.distance);
+				if (d0 != INFINITY || d1 != INFINITY) {
+					// Nearer child first, the other one waits on the stack.
+					bool leftFirst = d0 <= d1;
+					node = leftFirst ? n.first : n.first + 1;
+					float farDistance = leftFirst ? d1 : d0;
+					if (farDistance != INFINITY)
+						stack[size++] = { leftFirst ? n.first + 1 : n.first, farDistance };
+					continue;
+				}
+			}
+			// Skip nodes that are entered after the closest hit found since they were pushed.
+			while (size && stack[size - 1].distance >= hit.distance)
+				--size;
+			if (!size)
+				break;
+			node = stack[--size].node;
+		}
+		return hit;
+	}
+
+	void BVH::intersect(const Ray rays[4], RayHit hits[4], float maxDistance) const {
+		for (int i = 0; i < 4; ++i) {
+			hits[i] = RayHit();
+			hits[i].distance = maxDistance;
+		}
+		if (nodes.empty())
+			return;
+		Traversal::Packet packet;
+		packet.origin = transpose(rays[0].origin.m, rays[1].origin.m, rays[2].origin.m, rays[3].origin.m);
+		packet.direction = transpose(rays[0].direction.m, rays[1].direction.m, rays[2].direction.m, rays[3].direction.m);
+		packet.inverseDirection = transpose(safeInverse(rays[0].direction), safeInverse(rays[1].direction), safeInverse(rays[2].direction), safeInverse(rays[3].direction));
+		packet.best = _mm_set1_ps(maxDistance);
+		packet.primitive = _mm_castsi128_ps(_mm_set1_epi32((int)RayHit::NO_HIT));
+		packet.u = _mm_setzero_ps();
+		packet.v = _mm_setzero_ps();
+
+		struct Entry {
+			unsigned int node;
+			float distance;
+		};
+		Entry stack[TRAVERSAL_STACK];
+		unsigned int size = 0;
+		__m128 t;
+		if (!_mm_movemask_ps(Traversal::enter(nodes[0], packet, t)))
+			return;
+		unsigned int node = 0;
+		for (;;) {
+			const Node& n = nodes[node];
+			if (n.count) {
+				Traversal::intersectLeaf(*this, n, packet);
+			} else {
+				__m128 t0, t1;
+				__m128 hit0 = Traversal::enter(nodes[n.first], packet, t0);
+				__m128 hit1 = Traversal::enter(nodes[n.first + 1], packet, t1);
+				// The first entry of any ray that hits decides the order.
+				float d0 = _mm_cvtss_f32(hmin(select(hit0, t0, _mm_set1_ps(INFINITY))));
+				float d1 = _mm_cvtss_f32(hmin(select(hit1, t1, _mm_set1_ps(INFINITY))));
+				if (d0 != INFINITY || d1 != INFINITY) {
+					bool leftFirst = d0 <= d1;
+					node = leftFirst ? n.first : n.first + 1;
+					float farDistance = leftFirst ? d1 : d0;
+					if (farDistance != INFINITY)
+						stack[size++] = { leftFirst ? n.first + 1 : n.first, farDistance };
+					continue;
+				}
+			}
+			float farthest = _mm_cvtss_f32(hmax(packet.best));
+			while (size && stack[size - 1].distance >= farthest)
+				--size;
+			if (!size)
+				break;
+			node = stack[--size].node;
+		}
+
+		alignas(16) float best[4], u[4], v[4];
+		alignas(16) unsigned int primitive[4];
+		_mm_store_ps(best, packet.best);
+		_mm_store_ps((float*)primitive, packet.primitive);
+		_mm_store_ps(u, packet.u);
+		_mm_store_ps(v, packet.v);
+		for (int i = 0; i < 4; ++i) {
+			if (primitive[i] == RayHit::NO_HIT)
+				continue;
+			hits[i].distance = best[i];
+			hits[i].primitive = primitive[i];
+			hits[i].u = u[i];
+			hits[i].v = v[i];
+		}
+	}
+
+	void BVH::intersect(const Ray* rays, RayHit* hits, size_t count, float maxDistance) const {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			intersect(rays + i, hits + i, maxDistance);
+		if (i < count) {
+			// Pad the last packet with copies of the last ray.
+			Ray tail[4];
+			RayHit tailHits[4];
+			for (size_t j = 0; j < 4; ++j)
+				tail[j] = rays[std::min(i + j, count - 1)];
+			intersect(tail, tailHits, maxDistance);
+			for (size_t j = 0; i + j < count; ++j)
+				hits[i + j] = tailHits[j];
+		}
+	}
+}
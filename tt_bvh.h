@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include "tt_cgmath.h"
+
+namespace TT {
+	struct Ray {
+		Vec origin;
+		// Need not be normalized, hit distances are in multiples of its length.
+		Vec direction;
+
+		Ray();
+		Ray(Vec origin, Vec direction);
+		// The ray through a pixel of a width x height viewport, (0, 0) is the top left corner. camera is the camera's local matrix
+		// (e.g. OrbitCameraControl::localMatrix()) and projection the matrix used for drawing. The direction is normalized.
+		static Ray fromPixel(float x, float y, float width, float height, const Mat44& camera, const Mat44& projection);
+	};
+
+	struct RayHit {
+		static constexpr unsigned int NO_HIT = ~0u;
+
+		float distance = INFINITY;
+		// Triangle or box index.
+		unsigned int primitive = NO_HIT;
+		// Barycentric coordinates of a triangle hit, the point is v0 * (1 - u - v) + v1 * u + v2 * v.
+		float u = 0.0f;
+		float v = 0.0f;
+
+		bool hit() const { return primitive != NO_HIT; }
+	};
+
+	// Bounding volume hierarchy over triangles or axis aligned boxes for ray queries, built with the binned surface area heuristic.
+	// It only references the geometry: vertices, indices or boxes must stay alive and unchanged while the BVH is used.
+	struct BVH {
+		// Triangle n has the vertices indices[3n], indices[3n + 1] and indices[3n + 2], or 3n, 3n + 1 and 3n + 2 without indices.
+		// threads = 0 uses all hardware threads.
+		void buildTriangles(const Vec* vertices, const unsigned int* indices, size_t triangleCount, unsigned int threads = 0);
+		void buildBoxes(const Vec* boxMin, const Vec* boxMax, size_t boxCount, unsigned int threads = 0);
+		void clear();
+		size_t nodeCount() const { return nodes.size(); }
+
+		// The closest hit with a distance in [0, maxDistance).
+		RayHit intersect(const Ray& ray, float maxDistance = INFINITY) const;
+		// 4 rays traversed together, faster than single rays when they are coherent (e.g. neighbouring pixels).
+		void intersect(const Ray rays[4], RayHit hits[4], float maxDistance = INFINITY) const;
+		// Any number of rays, as packets of 4 in the given order.
+		void intersect(const Ray* rays, RayHit* hits, size_t count, float maxDistance = INFINITY) const;
+
+	private:
+		// Inner nodes (count 0) have their children at first and first + 1, leaves hold primitives[first] to primitives[first + count - 1].
+		struct alignas(16) Node {
+			float min[3];
+			unsigned int first;
+			float max[3];
+			unsigned int count;
+		};
+		struct Builder;
+		struct Traversal;
+
+		std::vector<Node> nodes;
+		std::vector<unsigned int> primitives;
+		const Vec* vertices = nullptr;
+		const unsigned int* indices = nullptr;
+		const Vec* boxMin = nullptr;
+		const Vec* boxMax = nullptr;
+
+		void build(size_t count, unsigned int threads);
+	};
+}
@@ -1,4 +1,10 @@
+#include <cfloat>
 #include "tt_cgmath.h"
+#include "tt_cgmath_kernels.h"
+#include "tt_cgmath_lanes.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace TT {
 	Mat44 Mat44::frustum(float left, float right, float top, float bottom, float near, float far) {
@@ -87,11 +93,184 @@ namespace TT {
 		};
 	}
 
-	Mat44 Mat44::rotate(float radiansX, float radiansY, float radiansZ, ERotateOrder order) {
-		Mat44 rotations[3] = {
-			Mat44::rotateX(radiansX),
-			Mat44::rotateY(radiansY),
-			Mat44::rotateZ(radiansZ) 
+	namespace {
+		// rotateX/Y/Z multiplied out for each order, so rotate() and TRS() need one SIMD sincos and no matrix products.
+		Mat44 rotateScale(float radiansX, float radiansY, float radiansZ, float scaleX, float scaleY, float scaleZ, ERotateOrder order) {
+			__m128 sines, cosines;
+			sinCosLanes<Lanes4>(_mm_setr_ps(radiansX, radiansY, radiansZ, 0.0f), &sines, &cosines);
+			alignas(16) float s[4], c[4];
+			_mm_store_ps(s, sines);
+			_mm_store_ps(c, cosines);
+			float sx = s[0], cx = c[0];
+			float sy = s[1], cy = c[1];
+			float sz = s[2], cz = c[2];
+			switch (order) {
+				case ERotateOrder::XYZ: return {
+					(cy * cz) * scaleX, (cy * sz) * scaleX, (-sy) * scaleX, 0.0f,
+					(-cx * sz + cz * sx * sy) * scaleY, (cx * cz + sx * sy * sz) * scaleY, (cy * sx) * scaleY, 0.0f,
+					(cx * cz * sy + sx * sz) * scaleZ, (cx * sy * sz - cz * sx) * scaleZ, (cx * cy) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+				case ERotateOrder::XZY: return {
+					(cy * cz) * scaleX, (sz) * scaleX, (-cz * sy) * scaleX, 0.0f,
+					(-cx * cy * sz + sx * sy) * scaleY, (cx * cz) * scaleY, (cx * sy * sz + cy * sx) * scaleY, 0.0f,
+					(cx * sy + cy * sx * sz) * scaleZ, (-cz * sx) * scaleZ, (cx * cy - sx * sy * sz) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+				case ERotateOrder::YXZ: return {
+					(cy * cz - sx * sy * sz) * scaleX, (cy * sz + cz * sx * sy) * scaleX, (-cx * sy) * scaleX, 0.0f,
+					(-cx * sz) * scaleY, (cx * cz) * scaleY, (sx) * scaleY, 0.0f,
+					(cy * sx * sz + cz * sy) * scaleZ, (-cy * cz * sx + sy * sz) * scaleZ, (cx * cy) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+				case ERotateOrder::YZX: return {
+					(cy * cz) * scaleX, (cx * cy * sz + sx * sy) * scaleX, (-cx * sy + cy * sx * sz) * scaleX, 0.0f,
+					(-sz) * scaleY, (cx * cz) * scaleY, (cz * sx) * scaleY, 0.0f,
+					(cz * sy) * scaleZ, (cx * sy * sz - cy * sx) * scaleZ, (cx * cy + sx * sy * sz) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+				case ERotateOrder::ZXY: return {
+					(cy * cz + sx * sy * sz) * scaleX, (cx * sz) * scaleX, (cy * sx * sz - cz * sy) * scaleX, 0.0f,
+					(-cy * sz + cz * sx * sy) * scaleY, (cx * cz) * scaleY, (cy * cz * sx + sy * sz) * scaleY, 0.0f,
+					(cx * sy) * scaleZ, (-sx) * scaleZ, (cx * cy) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+				case ERotateOrder::ZYX: return {
+					(cy * cz) * scaleX, (cx * sz + cz * sx * sy) * scaleX, (-cx * cz * sy + sx * sz) * scaleX, 0.0f,
+					(-cy * sz) * scaleY, (cx * cz - sx * sy * sz) * scaleY, (cx * sy * sz + cz * sx) * scaleY, 0.0f,
+					(sy) * scaleZ, (-cy * sx) * scaleZ, (cx * cy) * scaleZ, 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f,
+				};
+			}
+			return MAT44_IDENTITY;
+		}
+	}
+
+	Mat44 Mat44::rotate(float radiansX, float radiansY, float radiansZ, ERotateOrder order) { return rotateScale(radiansX, radiansY, radiansZ, 1.0f, 1.0f, 1.0f, order); }
+
+	Mat44 Mat44::rotate(Vec radians, ERotateOrder order) { return Mat44::rotate(radians.x, radians.y, radians.z, order); }
+
+	Mat44 Mat44::TRS(float x, float y, float z, float radiansX, float radiansY, float radiansZ, float sx, float sy, float sz, ERotateOrder order) {
+		Mat44 r = rotateScale(radiansX, radiansY, radiansZ, sx, sy, sz, order);
+		r.m[12] = x;
+		r.m[13] = y;
+		r.m[14] = z;
+		return r;
+	}
+
+	Mat44 Mat44::TRS(Vec translate, Vec radians, Vec scale, ERotateOrder order) { return Mat44::TRS(translate.x, translate.y, translate.z, radians.x, radians.y, radians.z, scale.x, scale.y, scale.z, order); }
+
+	Mat44 Mat44::rotate(const Quat& rotation) { return rotation.toMat44(); }
+
+	Mat44 Mat44::TRS(Vec translate, const Quat& rotation, Vec scale) {
+		Mat44 r = rotation.toMat44();
+		r.col[0] = _mm_mul_ps(r.col[0], _mm_shuffle_ps(scale.m, scale.m, _MM_SHUFFLE(0, 0, 0, 0)));
+		r.col[1] = _mm_mul_ps(r.col[1], _mm_shuffle_ps(scale.m, scale.m, _MM_SHUFFLE(1, 1, 1, 1)));
+		r.col[2] = _mm_mul_ps(r.col[2], _mm_shuffle_ps(scale.m, scale.m, _MM_SHUFFLE(2, 2, 2, 2)));
+		r.m[12] = translate.x;
+		r.m[13] = translate.y;
+		r.m[14] = translate.z;
+		return r;
+	}
+
+	namespace {
+		// Removes the scale from the first three columns of a TRS matrix, leaving its rotation in rotation.
+		Vec unscale(const Mat44& matrix, Mat44& rotation) {
+			Vec scale(0.0f);
+			for (int c = 0; c < 3; ++c) {
+				__m128 column = matrix.col[c];
+				__m128 d = _mm_mul_ps(column, column);
+				float length = sqrtf(_mm_cvtss_f32(d) + _mm_cvtss_f32(_mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))) + _mm_cvtss_f32(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2))));
+				scale[c] = length;
+				rotation.col[c] = _mm_mul_ps(column, _mm_set1_ps(length > 0.0f ? 1.0f / length : 0.0f));
+			}
+			rotation.col[3] = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+			// A mirrored matrix can't be a rotation, put the mirror into the x scale.
+			const float* m = rotation.m;
+			float determinant = m[0] * (m[5] * m[10] - m[6] * m[9]) - m[4] * (m[1] * m[10] - m[2] * m[9]) + m[8] * (m[1] * m[6] - m[2] * m[5]);
+			if (determinant < 0.0f) {
+				scale.x = -scale.x;
+				rotation.col[0] = _mm_sub_ps(_mm_setzero_ps(), rotation.col[0]);
+			}
+			return scale;
+		}
+
+		// Where rotateScale() puts the sines and cosines of an order, as indices into Mat44::m with a sign.
+		// The first and third angles come from entries that are scaled by the cosine of the middle angle. When that is 0
+		// (gimbal lock) the third angle is taken as 0 and the first one is read from lockSin / lockCos instead,
+		// where lockSin is additionally scaled by the middle sine if lockTimesSinMid is set.
+		struct EulerLayout {
+			int sinMid; float sinMidSign;
+			int sinFirst; float sinFirstSign; int cosFirst;
+			int sinThird; float sinThirdSign; int cosThird;
+			int lockSin; float lockSinSign; bool lockTimesSinMid; int lockCos;
+		};
+
+		EulerLayout eulerLayout(ERotateOrder order) {
+			switch (order) {
+				case ERotateOrder::XYZ: return { 2, -1.0f, 6, 1.0f, 10, 1, 1.0f, 0, 9, -1.0f, false, 5 };
+				case ERotateOrder::XZY: return { 1, 1.0f, 9, -1.0f, 5, 2, -1.0f, 0, 6, 1.0f, false, 10 };
+				case ERotateOrder::YXZ: return { 6, 1.0f, 2, -1.0f, 10, 4, -1.0f, 5, 1, 1.0f, true, 0 };
+				case ERotateOrder::YZX: return { 4, -1.0f, 8, 1.0f, 0, 6, 1.0f, 5, 2, -1.0f, false, 10 };
+				case ERotateOrder::ZXY: return { 9, -1.0f, 1, 1.0f, 5, 8, 1.0f, 10, 2, 1.0f, true, 0 };
+				case ERotateOrder::ZYX: return { 8, 1.0f, 4, -1.0f, 0, 9, -1.0f, 10, 6, 1.0f, true, 5 };
+			}
+			return {};
+		}
+	}
+
+	void Mat44::decompose(Vec& translate, Quat& rotation, Vec& scale) const {
+		Mat44 r;
+		scale = unscale(*this, r);
+		rotation = Quat::fromMat44(r);
+		translate = Vec(m[12], m[13], m[14], 0.0f);
+	}
+
+	void Mat44::decompose(Vec& translate, Vec& radians, Vec& scale, ERotateOrder order) const {
+		Mat44 r;
+		scale = unscale(*this, r);
+		translate = Vec(m[12], m[13], m[14], 0.0f);
+
+		EulerLayout e = eulerLayout(order);
+		float sinMid = r.m[e.sinMid] * e.sinMidSign;
+		// Read from the same entries as the third angle, which is far more precise near the lock than sqrt(1 - sinMid^2).
+		float cosMid = hypotf(r.m[e.sinThird], r.m[e.cosThird]);
+		float first, third;
+		if (cosMid > 16.0f * FLT_EPSILON) {
+			first = atan2f(r.m[e.sinFirst] * e.sinFirstSign, r.m[e.cosFirst]);
+			third = atan2f(r.m[e.sinThird] * e.sinThirdSign, r.m[e.cosThird]);
+		} else {
+			first = atan2f(r.m[e.lockSin] * e.lockSinSign * (e.lockTimesSinMid ? sinMid : 1.0f), r.m[e.lockCos]);
+			third = 0.0f;
+		}
+		radians = Vec(0.0f);
+		radians[((int)order >> 4) & 0b11] = first;
+		radians[((int)order >> 2) & 0b11] = atan2f(sinMid, cosMid);
+		radians[(int)order & 0b11] = third;
+	}
+
+	Quat::Quat() : m(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f)) {}
+
+	Quat::Quat(float x, float y, float z, float w) : m(_mm_set_ps(w, z, y, x)) {}
+
+	Quat::Quat(__m128 m) : m(m) {}
+
+	Quat Quat::axisAngle(Vec axis, float radians) {
+		float length = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		float s = length > 0.0f ? sinf(radians * 0.5f) / length : 0.0f;
+		return Quat(axis.x * s, axis.y * s, axis.z * s, cosf(radians * 0.5f));
+	}
+
+	Quat Quat::euler(Vec radians, ERotateOrder order) {
+		__m128 sines, cosines;
+		sinCosLanes<Lanes4>(_mm_mul_ps(radians.m, _mm_set1_ps(0.5f)), &sines, &cosines);
+		alignas(16) float s[4], c[4];
+		_mm_store_ps(s, sines);
+		_mm_store_ps(c, cosines);
+		Quat rotations[3] = {
+			Quat(s[0], 0.0f, 0.0f, c[0]),
+			Quat(0.0f, s[1], 0.0f, c[1]),
+			Quat(0.0f, 0.0f, s[2], c[2]),
 		};
 		int first = (((int)order >> 4) & 0b11);
 		int second = (((int)order >> 2) & 0b11);
@@ -99,68 +278,116 @@ namespace TT {
 		return rotations[first] * rotations[second] * rotations[third];
 	}
 
-	Mat44 Mat44::rotate(Vec radians, ERotateOrder order) { return Mat44::rotate(radians.x, radians.y, radians.z, order); }
+	Quat Quat::fromMat44(const Mat44& matrix) {
+		// Shepperd's method: start from the largest of w, x, y and z, which keeps the division well conditioned.
+		const float* m = matrix.m;
+		float trace = m[0] + m[5] + m[10];
+		if (trace > 0.0f) {
+			float s = 0.5f / sqrtf(trace + 1.0f);
+			return Quat((m[6] - m[9]) * s, (m[8] - m[2]) * s, (m[1] - m[4]) * s, 0.25f / s);
+		}
+		if (m[0] > m[5] && m[0] > m[10]) {
+			float s = 0.5f / sqrtf(1.0f + m[0] - m[5] - m[10]);
+			return Quat(0.25f / s, (m[4] + m[1]) * s, (m[8] + m[2]) * s, (m[6] - m[9]) * s);
+		}
+		if (m[5] > m[10]) {
+			float s = 0.5f / sqrtf(1.0f + m[5] - m[0] - m[10]);
+			return Quat((m[4] + m[1]) * s, 0.25f / s, (m[9] + m[6]) * s, (m[8] - m[2]) * s);
+		}
+		float s = 0.5f / sqrtf(1.0f + m[10] - m[0] - m[5]);
+		return Quat((m[8] + m[2]) * s, (m[9] + m[6]) * s, 0.25f / s, (m[1] - m[4]) * s);
+	}
 
-	Mat44 Mat44::TRS(float x, float y, float z, float radiansX, float radiansY, float radiansZ, float sx, float sy, float sz, ERotateOrder order) {
-        Mat44 r = rotate(radiansX, radiansY, radiansZ, order);;
-        r = scale(sx, sy, sz) * r;
-		r.col[3].m128_f32[0] = x;
-		r.col[3].m128_f32[1] = y;
-		r.col[3].m128_f32[2] = z;
+	Mat44 Quat::toMat44() const {
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+		return {
+			1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+			2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+			2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f,
+		};
+	}
+
+	Quat Quat::operator*(const Quat& other) const {
+		// The Hamilton product other x this, written as this quaternion's lanes shuffled and sign flipped, scaled by the other's x, y, z and w.
+		__m128 p = other.m;
+		__m128 q = m;
+		__m128 r = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)), q);
+		__m128 qx = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 1, 2, 3)), _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+		__m128 qy = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f));
+		__m128 qz = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), qx));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), qy));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), qz));
 		return r;
 	}
 
-	Mat44 Mat44::TRS(Vec translate, Vec radians, Vec scale, ERotateOrder order) { return Mat44::TRS(translate.x, translate.y, translate.z, radians.x, radians.y, radians.z, scale.x, scale.y, scale.z, order); }
+	Quat& Quat::operator*=(const Quat& other) {
+		*this = *this * other;
+		return *this;
+	}
 
-	Mat44& Mat44::operator*=(const Mat44& parent) {
-		__m128 x = _mm_shuffle_ps(col[0], col[0], _MM_SHUFFLE(0, 0, 0, 0));
-		__m128 y = _mm_shuffle_ps(col[0], col[0], _MM_SHUFFLE(1, 1, 1, 1));
-		__m128 z = _mm_shuffle_ps(col[0], col[0], _MM_SHUFFLE(2, 2, 2, 2));
-		__m128 w = _mm_shuffle_ps(col[0], col[0], _MM_SHUFFLE(3, 3, 3, 3));
-		col[0] = _mm_add_ps(
-			_mm_add_ps(
-				_mm_mul_ps(x, parent.col[0]),
-				_mm_mul_ps(y, parent.col[1])
-			),
-			_mm_add_ps(
-				_mm_mul_ps(z, parent.col[2]),
-				_mm_mul_ps(w, parent.col[3])
-			)
-		);
-
-		x = _mm_shuffle_ps(col[1], col[1], _MM_SHUFFLE(0, 0, 0, 0));
-		y = _mm_shuffle_ps(col[1], col[1], _MM_SHUFFLE(1, 1, 1, 1));
-		z = _mm_shuffle_ps(col[1], col[1], _MM_SHUFFLE(2, 2, 2, 2));
-		w = _mm_shuffle_ps(col[1], col[1], _MM_SHUFFLE(3, 3, 3, 3));
-		col[1] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, parent.col[0]),
-			_mm_mul_ps(y, parent.col[1])),
-			_mm_add_ps(_mm_mul_ps(z, parent.col[2]),
-				_mm_mul_ps(w, parent.col[3])));
-
-		x = _mm_shuffle_ps(col[2], col[2], _MM_SHUFFLE(0, 0, 0, 0));
-		y = _mm_shuffle_ps(col[2], col[2], _MM_SHUFFLE(1, 1, 1, 1));
-		z = _mm_shuffle_ps(col[2], col[2], _MM_SHUFFLE(2, 2, 2, 2));
-		w = _mm_shuffle_ps(col[2], col[2], _MM_SHUFFLE(3, 3, 3, 3));
-		col[2] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, parent.col[0]),
-			_mm_mul_ps(y, parent.col[1])),
-			_mm_add_ps(_mm_mul_ps(z, parent.col[2]),
-				_mm_mul_ps(w, parent.col[3])));
-
-		x = _mm_shuffle_ps(col[3], col[3], _MM_SHUFFLE(0, 0, 0, 0));
-		y = _mm_shuffle_ps(col[3], col[3], _MM_SHUFFLE(1, 1, 1, 1));
-		z = _mm_shuffle_ps(col[3], col[3], _MM_SHUFFLE(2, 2, 2, 2));
-		w = _mm_shuffle_ps(col[3], col[3], _MM_SHUFFLE(3, 3, 3, 3));
-		col[3] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, parent.col[0]),
-			_mm_mul_ps(y, parent.col[1])),
-			_mm_add_ps(_mm_mul_ps(z, parent.col[2]),
-				_mm_mul_ps(w, parent.col[3])));
+	float Quat::dot(const Quat& other) const {
+		__m128 d = _mm_mul_ps(m, other.m);
+		d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+		d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(d);
+	}
+
+	Quat Quat::normalized() const {
+		// Full precision, rsqrt's 12 bits would let the scale drift over repeated products.
+		return _mm_div_ps(m, _mm_sqrt_ps(_mm_set1_ps(dot(*this))));
+	}
+
+	Quat Quat::inversed() const { return _mm_xor_ps(m, _mm_set_ps(0.0f, -0.0f, -0.0f, -0.0f)); }
+
+	Vec3 Quat::rotate(Vec3 v) const {
+		// v + 2w (u x v) + 2u x (u x v), with u the imaginary part.
+		__m128 u = _mm_and_ps(m, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		__m128 w = _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3));
+		auto cross = [](__m128 a, __m128 b) {
+			__m128 ayzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 bzxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+			__m128 azxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+			__m128 byzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			return _mm_sub_ps(_mm_mul_ps(ayzx, bzxy), _mm_mul_ps(azxy, byzx));
+		};
+		__m128 t = cross(u, v.m);
+		t = _mm_add_ps(t, t);
+		return _mm_add_ps(_mm_add_ps(v.m, _mm_mul_ps(w, t)), cross(u, t));
+	}
+
+	Quat Quat::nlerp(const Quat& a, const Quat& b, float t) {
+		// Flipping b to the same hemisphere as a takes the shorter of the two arcs.
+		__m128 sign = _mm_and_ps(_mm_set1_ps(a.dot(b)), _mm_set1_ps(-0.0f));
+		__m128 to = _mm_xor_ps(b.m, sign);
+		return Quat(_mm_add_ps(a.m, _mm_mul_ps(_mm_sub_ps(to, a.m), _mm_set1_ps(t)))).normalized();
+	}
+
+	Quat Quat::slerp(const Quat& a, const Quat& b, float t) {
+		float d = a.dot(b);
+		__m128 to = d < 0.0f ? _mm_xor_ps(b.m, _mm_set1_ps(-0.0f)) : b.m;
+		d = fabsf(d);
+		// Nearly equal rotations divide by sin(angle) ~ 0, where nlerp is exact enough.
+		if (d > 0.9995f)
+			return nlerp(a, Quat(to), t);
+		float angle = acosf(d);
+		float s = 1.0f / sinf(angle);
+		__m128 wa = _mm_set1_ps(sinf((1.0f - t) * angle) * s);
+		__m128 wb = _mm_set1_ps(sinf(t * angle) * s);
+		return _mm_add_ps(_mm_mul_ps(a.m, wa), _mm_mul_ps(to, wb));
+	}
 
+	Mat44& Mat44::operator*=(const Mat44& parent) {
+		cgmathKernels->multiply(*this, parent, *this);
 		return *this;
 	}
 
 	Mat44 Mat44::operator*(const Mat44& parent) const {
-		Mat44 c = *this;
-		c *= parent;
+		Mat44 c;
+		cgmathKernels->multiply(*this, parent, c);
 		return c;
 	}
 
@@ -174,104 +401,65 @@ namespace TT {
 		return r;
 	}
 
-	void Mat44::inverse() {
-		__m128 minor0, minor1, minor2, minor3;
-		__m128 row0, row1, row2, row3;
-		__m128 det, tmp1;
-		tmp1 = _mm_shuffle_ps(col[0], col[1], _MM_SHUFFLE(1, 0, 1, 0));
-		//tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (__m64*)(m)), (__m64*)(m + 4));
-		row1 = _mm_shuffle_ps(col[2], col[3], _MM_SHUFFLE(1, 0, 1, 0));
-		//row1 = _mm_loadh_pi(_mm_loadl_pi(row1, (__m64*)(m + 8)), (__m64*)(m + 12));
-		row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
-		row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
-		tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (__m64*)(m + 2)), (__m64*)(m + 6));
-		row3 = _mm_shuffle_ps(col[2], col[3], _MM_SHUFFLE(3, 2, 3, 2));
-		//row3 = _mm_loadh_pi(_mm_loadl_pi(row3, (__m64*)(m + 10)), (__m64*)(m + 14));
-		row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
-		row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(row2, row3);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		minor0 = _mm_mul_ps(row1, tmp1);
-		minor1 = _mm_mul_ps(row0, tmp1);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
-		minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
-		minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(row1, row2);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
-		minor3 = _mm_mul_ps(row0, tmp1);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
-		minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
-		minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		row2 = _mm_shuffle_ps(row2, row2, 0x4E);
-		minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
-		minor2 = _mm_mul_ps(row0, tmp1);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
-		minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
-		minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(row0, row1);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
-		minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
-		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(row0, row3);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
-		minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
-		minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
-		// -----------------------------------------------
-		tmp1 = _mm_mul_ps(row0, row2);
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
-		minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
-		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
-		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
-		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
-		minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
-		// -----------------------------------------------
-		det = _mm_mul_ps(row0, minor0);
-		det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
-		det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
-		tmp1 = _mm_rcp_ss(det);
-		det = _mm_sub_ss(_mm_add_ss(tmp1, tmp1), _mm_mul_ss(det, _mm_mul_ss(tmp1, tmp1)));
-		det = _mm_shuffle_ps(det, det, 0x00);
-		minor0 = _mm_mul_ps(det, minor0);
-		_mm_storel_pi((__m64*)(m), minor0);
-		_mm_storeh_pi((__m64*)(m + 2), minor0);
-		minor1 = _mm_mul_ps(det, minor1);
-		_mm_storel_pi((__m64*)(m + 4), minor1);
-		_mm_storeh_pi((__m64*)(m + 6), minor1);
-		minor2 = _mm_mul_ps(det, minor2);
-		_mm_storel_pi((__m64*)(m + 8), minor2);
-		_mm_storeh_pi((__m64*)(m + 10), minor2);
-		minor3 = _mm_mul_ps(det, minor3);
-		_mm_storel_pi((__m64*)(m + 12), minor3);
-		_mm_storeh_pi((__m64*)(m + 14), minor3);
+	void Mat44::transform(const Vec4* in, Vec4* out, size_t count) const { cgmathKernels->transform(*this, &in->x, &out->x, count); }
+	void Mat44::transformPoints(const Vec3* in, Vec3* out, size_t count) const { cgmathKernels->transformPoints(*this, &in->x, &out->x, count); }
+	void Mat44::transformDirections(const Vec3* in, Vec3* out, size_t count) const { cgmathKernels->transformDirections(*this, &in->x, &out->x, count); }
+	void Mat44::projectPoints(const Vec3* in, Vec3* out, size_t count) const { cgmathKernels->projectPoints(*this, &in->x, &out->x, count); }
+
+	void Mat44::transformPoints(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const {
+		cgmathKernels->transformPointStreams(*this, x, y, z, outX, outY, outZ, count);
+	}
+
+	void Mat44::transformDirections(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const {
+		cgmathKernels->transformDirectionStreams(*this, x, y, z, outX, outY, outZ, count);
+	}
+
+	void Mat44::projectPoints(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const {
+		cgmathKernels->projectPointStreams(*this, x, y, z, outX, outY, outZ, count);
+	}
+
+	void Mat44::inverse(EInversePrecision precision) {
+		(precision == EInversePrecision::Precise ? cgmathKernels->inversePrecise : cgmathKernels->inverse)(*this, *this);
+	}
+
+	void Mat44::inverseAffine() {
+		cgmathKernels->inverseAffine(*this, *this);
+	}
+
+	void Mat44::inverseRigid() {
+		cgmathKernels->inverseRigid(*this, *this);
 	}
 
 	void Mat44::transpose() {
 		_MM_TRANSPOSE4_PS(col[0], col[1], col[2], col[3]);
 	}
 
-	Mat44 Mat44::inversed() const {
-		Mat44 a = *this;
-		a.inverse();
+	Mat44 Mat44::inversed(EInversePrecision precision) const {
+		Mat44 a;
+		(precision == EInversePrecision::Precise ? cgmathKernels->inversePrecise : cgmathKernels->inverse)(*this, a);
+		return a;
+	}
+
+	Mat44 Mat44::inversedAffine() const {
+		Mat44 a;
+		cgmathKernels->inverseAffine(*this, a);
+		return a;
+	}
+
+	Mat44 Mat44::inversedRigid() const {
+		Mat44 a;
+		cgmathKernels->inverseRigid(*this, a);
 		return a;
 	}
 
+	void Mat44::inverse(const Mat44* in, Mat44* out, size_t count, EInversePrecision precision) {
+		(precision == EInversePrecision::Precise ? cgmathKernels->inversePreciseArray : cgmathKernels->inverseArray)(in, out, count);
+	}
+
+	void Mat44::inverseAffine(const Mat44* in, Mat44* out, size_t count) { cgmathKernels->inverseAffineArray(in, out, count); }
+
+	void Mat44::inverseRigid(const Mat44* in, Mat44* out, size_t count) { cgmathKernels->inverseRigidArray(in, out, count); }
+
 	Mat44 Mat44::transposed() const {
 		Mat44 a = *this;
 		a.transpose();
@@ -320,12 +508,12 @@ namespace TT {
 	Vec Vec::operator/(float other) const { return _mm_div_ps(m, _mm_set_ps1(other)); }
 	Vec Vec::operator+(float other) const { return _mm_add_ps(m, _mm_set_ps1(other)); }
 	Vec Vec::operator-(float other) const { return _mm_sub_ps(m, _mm_set_ps1(other)); }
-	Vec Vec::operator%(float other) const { __m128 tmp = _mm_set_ps1(other); return _mm_sub_ps(m, _mm_mul_ps(tmp, _mm_floor_ps(_mm_div_ps(m, tmp)))); }
+	Vec Vec::operator%(float other) const { return cgmathKernels->mod(m, _mm_set_ps1(other)); }
 	Vec Vec::operator*(__m128 other) const { return _mm_mul_ps(m, other); }
 	Vec Vec::operator/(__m128 other) const { return _mm_div_ps(m, other); }
 	Vec Vec::operator+(__m128 other) const { return _mm_add_ps(m, other); }
 	Vec Vec::operator-(__m128 other) const { return _mm_sub_ps(m, other); }
-	Vec Vec::operator%(__m128 other) const { return _mm_sub_ps(m, _mm_mul_ps(other, _mm_floor_ps(_mm_div_ps(m, other)))); }
+	Vec Vec::operator%(__m128 other) const { return cgmathKernels->mod(m, other); }
 
 	Vec Vec::operator<(__m128 other) const { return _mm_cmpnge_ps(m, other); }
 	Vec Vec::operator>(__m128 other) const { return _mm_cmpnle_ps(m, other); }
@@ -346,7 +534,7 @@ namespace TT {
 	Vec& Vec::operator-=(__m128 other) { m = *this - other; return *this; }
 	Vec& Vec::operator%=(__m128 other) { m = *this % other; return *this; }
 	Vec Vec::swizzle(unsigned char a, unsigned char b, unsigned char c, unsigned char d) const { 
-		return _mm_set_ps(m.m128_f32[d], m.m128_f32[c], m.m128_f32[b], m.m128_f32[a]);
+		return _mm_set_ps((*this)[d], (*this)[c], (*this)[b], (*this)[a]);
 	}
 
 	const float PI = 3.141592653589f;
@@ -356,6 +544,55 @@ namespace TT {
 	const double TAUd = PId + PId;
 	const double DEG2RADd = PId / 180.0;
 	const Mat44 MAT44_IDENTITY = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// Constant initialized, so code running during static initialization in other files safely uses SSE2 until the detection below ran.
+	const CGMathKernels* cgmathKernels = &CGMATH_KERNELS_SSE2;
+
+	namespace {
+		ESimdPath detectSimdPath() {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return ESimdPath::SSE2;
+			__cpuid(info, 1);
+			bool fma = (info[2] & (1 << 12)) != 0;
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			bool f16c = (info[2] & (1 << 29)) != 0;
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			// The OS must also save the ymm registers on context switches.
+			bool ymm = osxsave && (_xgetbv(0) & 0b110) == 0b110;
+			return avx && avx2 && fma && f16c && ymm ? ESimdPath::AVX2 : ESimdPath::SSE2;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c") ? ESimdPath::AVX2 : ESimdPath::SSE2;
+#endif
+		}
+
+		const ESimdPath supportedSimdPath = detectSimdPath();
+		ESimdPath activeSimdPath = ESimdPath::SSE2;
+		const bool simdPathSelected = setSimdPath(supportedSimdPath);
+	}
+
+	ESimdPath simdPath() { return activeSimdPath; }
+
+	bool setSimdPath(ESimdPath path) {
+		if (path > supportedSimdPath)
+			return false;
+		activeSimdPath = path;
+		cgmathKernels = path == ESimdPath::AVX2 ? &CGMATH_KERNELS_AVX2 : &CGMATH_KERNELS_SSE2;
+		return true;
+	}
+
+	const char* simdPathName(ESimdPath path) {
+		switch (path) {
+			case ESimdPath::SSE2: return "SSE2";
+			case ESimdPath::AVX2: return "AVX2+FMA";
+		}
+		return "?";
+	}
 }
 
 #if 0
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstring>
 #include <xmmintrin.h>
 #include <smmintrin.h>
 
@@ -14,7 +15,7 @@ namespace TT {
 		ZYX = 0b10'01'00,
 	};
 
-	__declspec(align(16)) struct Vec {
+	struct alignas(16) Vec {
 		union {
 			struct {
 				float x;
@@ -66,8 +67,8 @@ namespace TT {
 		Vec swizzle(unsigned char a, unsigned char b, unsigned char c, unsigned char d) const;
         bool operator==(const Vec& rhs) const { return memcmp(&m, &rhs.m, sizeof(__m128)) == 0; }
         bool operator!=(const Vec& rhs) const { return !(*this == rhs); }
-        float operator[](size_t index) const { return m.m128_f32[index]; }
-        float& operator[](size_t index) { return m.m128_f32[index]; }
+        float operator[](size_t index) const { return (&x)[index]; }
+        float& operator[](size_t index) { return (&x)[index]; }
 	};
 
 	struct Vec2 : public Vec {
@@ -96,28 +97,80 @@ namespace TT {
 		Vec4(Vec m) : Vec(m.m) {}
 	};
 
-	__declspec(align(16))
-	struct Mat22 {
+	struct Mat44;
+
+	// Fast loses precision to cancellation on badly conditioned matrices (about 5e-6 relative on projections), Precise computes in double.
+	enum class EInversePrecision {
+		Fast,
+		Precise,
+	};
+
+	// Rotation as a unit quaternion, x, y and z are the imaginary part. Products follow the Mat44 order: a * b rotates by a, then by b.
+	struct alignas(16) Quat {
+		union {
+			struct {
+				float x;
+				float y;
+				float z;
+				float w;
+			};
+			__m128 m;
+		};
+		// Identity.
+		Quat();
+		Quat(float x, float y, float z, float w);
+		Quat(__m128 m);
+		static Quat axisAngle(Vec axis, float radians);
+		// The same rotation as Mat44::rotate(radians, order).
+		static Quat euler(Vec radians, ERotateOrder order = ERotateOrder::YXZ);
+		// Reads the rotation of a matrix without scale or shear, use Mat44::decompose() for other matrices.
+		static Quat fromMat44(const Mat44& matrix);
+		Mat44 toMat44() const;
+		Quat operator*(const Quat& other) const;
+		Quat& operator*=(const Quat& other);
+		float dot(const Quat& other) const;
+		Quat normalized() const;
+		// The conjugate, which is the inverse of a unit quaternion.
+		Quat inversed() const;
+		Vec3 rotate(Vec3 v) const;
+		// Both interpolate along the shortest arc. nlerp is cheaper but does not keep a constant angular velocity.
+		static Quat nlerp(const Quat& a, const Quat& b, float t);
+		static Quat slerp(const Quat& a, const Quat& b, float t);
+	};
+
+	struct alignas(16) Mat22 {
 		__m128 m;
 	};
 
-	__declspec(align(16))
-	struct Mat33 {
+	struct alignas(16) Mat33 {
 		float m[9];
 	};
 
-	__declspec(align(16))
-	struct Mat44 {
+	struct alignas(16) Mat44 {
 		union {
 			// the gl spec writes down columns
 			// but in memory they are stored column major
-			__m128 col[4];
+			// m comes first so Mat44 can be brace initialized with 16 floats on every compiler
 			float m[16];
+			__m128 col[4];
 		};
 
 		Mat44& operator*=(const Mat44& b);
 		Mat44 operator*(const Mat44& b) const;
 		Vec4 operator*(const Vec4& b) const;
+
+		// Batch versions of operator*(Vec4). in and out may be the same array but must not otherwise overlap.
+		// Points are transformed with w = 1, directions with w = 0 (so without translation), projected points with w = 1 followed by the divide by w.
+		// Vec3 results have w = 0.
+		void transform(const Vec4* in, Vec4* out, size_t count) const;
+		void transformPoints(const Vec3* in, Vec3* out, size_t count) const;
+		void transformDirections(const Vec3* in, Vec3* out, size_t count) const;
+		void projectPoints(const Vec3* in, Vec3* out, size_t count) const;
+		// The same for separate x, y and z streams, which need no shuffles and are the fastest for large counts.
+		void transformPoints(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const;
+		void transformDirections(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const;
+		void projectPoints(const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) const;
+
 		static Mat44 frustum(float left, float right, float top, float bottom, float near, float far);
 		static Mat44 orthoSymmetric(float width, float height, float near, float far);
 		static Mat44 perspectiveY(float fovRadians, float aspect, float near, float far);
@@ -131,11 +184,35 @@ namespace TT {
 		static Mat44 rotate(Vec radians, ERotateOrder order = ERotateOrder::YXZ);
 		static Mat44 TRS(float x = 0.0f, float y = 0.0f, float z = 0.0f, float radiansX = 0.0f, float radiansY = 0.0f, float radiansZ = 0.0f, float sx = 1.0f, float sy = 1.0f, float sz = 1.0f, ERotateOrder order = ERotateOrder::YXZ);
 		static Mat44 TRS(Vec translate, Vec radians, Vec scale, ERotateOrder order = ERotateOrder::YXZ);
-		void inverse();
+		static Mat44 rotate(const Quat& rotation);
+		static Mat44 TRS(Vec translate, const Quat& rotation, Vec scale);
+		// Splits a TRS matrix (no shear or projection) back into its parts, a negative determinant is returned as a negative x scale.
+		void decompose(Vec& translate, Quat& rotation, Vec& scale) const;
+		void decompose(Vec& translate, Vec& radians, Vec& scale, ERotateOrder order = ERotateOrder::YXZ) const;
+		void inverse(EInversePrecision precision = EInversePrecision::Fast);
+		// Much cheaper when the matrix is known to be affine (last row 0, 0, 0, 1) or rigid (rotation and translation only).
+		void inverseAffine();
+		void inverseRigid();
 		void transpose();
-		Mat44 inversed() const;
+		Mat44 inversed(EInversePrecision precision = EInversePrecision::Fast) const;
+		Mat44 inversedAffine() const;
+		Mat44 inversedRigid() const;
 		Mat44 transposed() const;
+		// Inverts count matrices, out may be in.
+		static void inverse(const Mat44* in, Mat44* out, size_t count, EInversePrecision precision = EInversePrecision::Fast);
+		static void inverseAffine(const Mat44* in, Mat44* out, size_t count);
+		static void inverseRigid(const Mat44* in, Mat44* out, size_t count);
+	};
+
+	// Instruction sets for Mat44 products and inverses, Vec modulo and the batch functions. The best one the CPU supports is picked at startup.
+	enum class ESimdPath {
+		SSE2,
+		AVX2, // AVX2, FMA and F16C, 256-bit registers hold two columns or points.
 	};
+	ESimdPath simdPath();
+	// Forces a path, e.g. to compare them. Returns false if the CPU does not support it.
+	bool setSimdPath(ESimdPath path);
+	const char* simdPathName(ESimdPath path);
 
 	extern const float PI;
 	extern const float TAU;
@@ -0,0 +1,1152 @@
+#include "tt_cgmath_kernels.h"
+#include "tt_cgmath_lanes.h"
+#include "tt_math.h"
+#include <cfloat>
+#include <immintrin.h>
+
+#ifdef TT_CGMATH_KERNELS_AVX2_BUILD
+#ifndef TT_CGMATH_AVX2
+#error "tt_cgmath_kernels_avx2.cpp must be compiled with /arch:AVX2 (or -mavx2 -mfma -mf16c)"
+#endif
+#define TT_CGMATH_KERNELS CGMATH_KERNELS_AVX2
+#else
+// Also used when the whole program targets AVX2, the CPU must support it then anyway.
+#define TT_CGMATH_KERNELS CGMATH_KERNELS_SSE2
+#endif
+
+namespace TT {
+	namespace {
+		// a * b + c, a * b - c and c - a * b, fused when FMA is available.
+		inline __m128 mulAdd(__m128 a, __m128 b, __m128 c) {
+#ifdef TT_CGMATH_AVX2
+			return _mm_fmadd_ps(a, b, c);
+#else
+			return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+		}
+
+		inline __m128 mulSub(__m128 a, __m128 b, __m128 c) {
+#ifdef TT_CGMATH_AVX2
+			return _mm_fmsub_ps(a, b, c);
+#else
+			return _mm_sub_ps(_mm_mul_ps(a, b), c);
+#endif
+		}
+
+		inline __m128 negMulAdd(__m128 a, __m128 b, __m128 c) {
+#ifdef TT_CGMATH_AVX2
+			return _mm_fnmadd_ps(a, b, c);
+#else
+			return _mm_sub_ps(c, _mm_mul_ps(a, b));
+#endif
+		}
+
+		inline __m128 floor4(__m128 x) {
+#ifdef TT_CGMATH_AVX2
+			return _mm_floor_ps(x);
+#else
+			// SSE2 has no floor: truncate, step negative fractions down and keep values that are already integers
+			// (|x| >= 2^23, which may not fit an int) or NaN as they are.
+			__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+			t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+			__m128 keep = _mm_cmpnlt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), x), _mm_set1_ps(8388608.0f));
+			return _mm_or_ps(_mm_and_ps(keep, x), _mm_andnot_ps(keep, t));
+#endif
+		}
+
+		__m128 floor(__m128 a) { return floor4(a); }
+
+		__m128 ceil(__m128 a) {
+#ifdef TT_CGMATH_AVX2
+			return _mm_ceil_ps(a);
+#else
+			return _mm_sub_ps(_mm_setzero_ps(), floor4(_mm_sub_ps(_mm_setzero_ps(), a)));
+#endif
+		}
+
+		__m128 mod(__m128 a, __m128 b) {
+			return negMulAdd(b, floor4(_mm_div_ps(a, b)), a);
+		}
+
+		inline void multiplyInline(const Mat44& a, const Mat44& b, Mat44& out) {
+#ifdef TT_CGMATH_AVX2
+			// Two columns of a per register, b's columns are repeated in both halves.
+			__m256 b0 = _mm256_broadcast_ps(&b.col[0]);
+			__m256 b1 = _mm256_broadcast_ps(&b.col[1]);
+			__m256 b2 = _mm256_broadcast_ps(&b.col[2]);
+			__m256 b3 = _mm256_broadcast_ps(&b.col[3]);
+			__m256 a01 = _mm256_loadu_ps(a.m);
+			__m256 a23 = _mm256_loadu_ps(a.m + 8);
+			__m256 r01 = _mm256_mul_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(3, 3, 3, 3)), b3);
+			__m256 r23 = _mm256_mul_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(3, 3, 3, 3)), b3);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2)), b2, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(2, 2, 2, 2)), b2, r23);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1)), b1, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(1, 1, 1, 1)), b1, r23);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0)), b0, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(0, 0, 0, 0)), b0, r23);
+			_mm256_storeu_ps(out.m, r01);
+			_mm256_storeu_ps(out.m + 8, r23);
+#else
+			__m128 b0 = b.col[0], b1 = b.col[1], b2 = b.col[2], b3 = b.col[3];
+			__m128 r[4];
+			for (int i = 0; i < 4; ++i) {
+				__m128 c = a.col[i];
+				__m128 x = _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0));
+				__m128 y = _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1));
+				__m128 z = _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2));
+				__m128 w = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+				r[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, b0), _mm_mul_ps(y, b1)), _mm_add_ps(_mm_mul_ps(z, b2), _mm_mul_ps(w, b3)));
+			}
+			for (int i = 0; i < 4; ++i)
+				out.col[i] = r[i];
+#endif
+		}
+
+		void multiply(const Mat44& a, const Mat44& b, Mat44& out) { multiplyInline(a, b, out); }
+
+		void multiplyHierarchy(const Mat44* locals, const unsigned int* parents, Mat44* worlds, const unsigned int* nodes, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				unsigned int node = nodes[i];
+				unsigned int parent = parents[node];
+				if (parent == ~0u)
+					worlds[node] = locals[node];
+				else
+					multiplyInline(locals[node], worlds[parent], worlds[node]);
+			}
+		}
+
+		// Cramer's rule on 2x2 sub-determinants, after Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix".
+		inline void inverseInline(const Mat44& in, Mat44& out) {
+			const float* m = in.m;
+			__m128 minor0, minor1, minor2, minor3;
+			__m128 row0, row1, row2, row3;
+			__m128 det, tmp1;
+			tmp1 = _mm_shuffle_ps(in.col[0], in.col[1], _MM_SHUFFLE(1, 0, 1, 0));
+			row1 = _mm_shuffle_ps(in.col[2], in.col[3], _MM_SHUFFLE(1, 0, 1, 0));
+			row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+			row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+			tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (const __m64*)(m + 2)), (const __m64*)(m + 6));
+			row3 = _mm_shuffle_ps(in.col[2], in.col[3], _MM_SHUFFLE(3, 2, 3, 2));
+			row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+			row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(row2, row3);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			minor0 = _mm_mul_ps(row1, tmp1);
+			minor1 = _mm_mul_ps(row0, tmp1);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor0 = mulSub(row1, tmp1, minor0);
+			minor1 = mulSub(row0, tmp1, minor1);
+			minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(row1, row2);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			minor0 = mulAdd(row3, tmp1, minor0);
+			minor3 = _mm_mul_ps(row0, tmp1);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor0 = negMulAdd(row3, tmp1, minor0);
+			minor3 = mulSub(row0, tmp1, minor3);
+			minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+			minor0 = mulAdd(row2, tmp1, minor0);
+			minor2 = _mm_mul_ps(row0, tmp1);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor0 = negMulAdd(row2, tmp1, minor0);
+			minor2 = mulSub(row0, tmp1, minor2);
+			minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(row0, row1);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			minor2 = mulAdd(row3, tmp1, minor2);
+			minor3 = mulSub(row2, tmp1, minor3);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor2 = mulSub(row3, tmp1, minor2);
+			minor3 = negMulAdd(row2, tmp1, minor3);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(row0, row3);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			minor1 = negMulAdd(row2, tmp1, minor1);
+			minor2 = mulAdd(row1, tmp1, minor2);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor1 = mulAdd(row2, tmp1, minor1);
+			minor2 = negMulAdd(row1, tmp1, minor2);
+			// -----------------------------------------------
+			tmp1 = _mm_mul_ps(row0, row2);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+			minor1 = mulAdd(row3, tmp1, minor1);
+			minor3 = negMulAdd(row1, tmp1, minor3);
+			tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+			minor1 = negMulAdd(row3, tmp1, minor1);
+			minor3 = mulAdd(row1, tmp1, minor3);
+			// -----------------------------------------------
+			det = _mm_mul_ps(row0, minor0);
+			det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+			det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+			tmp1 = _mm_rcp_ss(det);
+			det = _mm_sub_ss(_mm_add_ss(tmp1, tmp1), _mm_mul_ss(det, _mm_mul_ss(tmp1, tmp1)));
+			det = _mm_shuffle_ps(det, det, 0x00);
+			out.col[0] = _mm_mul_ps(det, minor0);
+			out.col[1] = _mm_mul_ps(det, minor1);
+			out.col[2] = _mm_mul_ps(det, minor2);
+			out.col[3] = _mm_mul_ps(det, minor3);
+		}
+
+		// (a.y * b.z - a.z * b.y, ...) with w = 0 for w = 0 inputs, shuffling the difference once instead of both products.
+		inline __m128 cross3(__m128 a, __m128 b) {
+			__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 c = mulSub(a, bYZX, _mm_mul_ps(aYZX, b));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		// Translation of the inverse, -(c0 * t.x + c1 * t.y + c2 * t.z) with w = 1, where c are the inverse's columns.
+		inline __m128 inverseTranslation(__m128 c0, __m128 c1, __m128 c2, __m128 t) {
+			__m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)));
+			r = mulAdd(c1, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)), r);
+			r = mulAdd(c2, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2)), r);
+			return _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f), r);
+		}
+
+		// A function rather than a constant: a namespace scope __m128 is initialized at startup, with AVX2 instructions in the AVX2 build.
+		inline __m128 maskXYZ() { return _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)); }
+
+		// The last row is taken as (0, 0, 0, 1). The rows of the 3x3 inverse are the cross products of the columns over the determinant.
+		inline void inverseAffineInline(const Mat44& in, Mat44& out) {
+			__m128 c0 = _mm_and_ps(in.col[0], maskXYZ());
+			__m128 c1 = _mm_and_ps(in.col[1], maskXYZ());
+			__m128 c2 = _mm_and_ps(in.col[2], maskXYZ());
+			__m128 t = in.col[3];
+			__m128 r0 = cross3(c1, c2);
+			__m128 r1 = cross3(c2, c0);
+			__m128 r2 = cross3(c0, c1);
+			__m128 det = _mm_mul_ps(c0, r0);
+			det = _mm_add_ps(_mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(3, 0, 2, 1))), _mm_shuffle_ps(det, det, _MM_SHUFFLE(3, 1, 0, 2)));
+			det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)));
+			r0 = _mm_mul_ps(r0, det);
+			r1 = _mm_mul_ps(r1, det);
+			r2 = _mm_mul_ps(r2, det);
+			__m128 r3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			out.col[0] = r0;
+			out.col[1] = r1;
+			out.col[2] = r2;
+			out.col[3] = inverseTranslation(r0, r1, r2, t);
+		}
+
+		// Rotation and translation only: the rotation's inverse is its transpose.
+		inline void inverseRigidInline(const Mat44& in, Mat44& out) {
+			__m128 c0 = _mm_and_ps(in.col[0], maskXYZ());
+			__m128 c1 = _mm_and_ps(in.col[1], maskXYZ());
+			__m128 c2 = _mm_and_ps(in.col[2], maskXYZ());
+			__m128 t = in.col[3];
+			__m128 c3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			out.col[0] = c0;
+			out.col[1] = c1;
+			out.col[2] = c2;
+			out.col[3] = inverseTranslation(c0, c1, c2, t);
+		}
+
+		void inverse(const Mat44& in, Mat44& out) { inverseInline(in, out); }
+		// The same cofactors in double. Products of two floats are exact in double, so the 2x2 sub-determinants
+		// do not cancel and the result is nearly correctly rounded even for badly conditioned matrices (projections).
+		inline void inversePreciseInline(const Mat44& in, Mat44& out) {
+			double a[16];
+			for (int i = 0; i < 16; ++i)
+				a[i] = in.m[i];
+			double s0 = a[0] * a[5] - a[4] * a[1];
+			double s1 = a[0] * a[6] - a[4] * a[2];
+			double s2 = a[0] * a[7] - a[4] * a[3];
+			double s3 = a[1] * a[6] - a[5] * a[2];
+			double s4 = a[1] * a[7] - a[5] * a[3];
+			double s5 = a[2] * a[7] - a[6] * a[3];
+			double c5 = a[10] * a[15] - a[14] * a[11];
+			double c4 = a[9] * a[15] - a[13] * a[11];
+			double c3 = a[9] * a[14] - a[13] * a[10];
+			double c2 = a[8] * a[15] - a[12] * a[11];
+			double c1 = a[8] * a[14] - a[12] * a[10];
+			double c0 = a[8] * a[13] - a[12] * a[9];
+			double invDet = 1.0 / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+			double r[16] = {
+				a[5] * c5 - a[6] * c4 + a[7] * c3,
+				-a[1] * c5 + a[2] * c4 - a[3] * c3,
+				a[13] * s5 - a[14] * s4 + a[15] * s3,
+				-a[9] * s5 + a[10] * s4 - a[11] * s3,
+				-a[4] * c5 + a[6] * c2 - a[7] * c1,
+				a[0] * c5 - a[2] * c2 + a[3] * c1,
+				-a[12] * s5 + a[14] * s2 - a[15] * s1,
+				a[8] * s5 - a[10] * s2 + a[11] * s1,
+				a[4] * c4 - a[5] * c2 + a[7] * c0,
+				-a[0] * c4 + a[1] * c2 - a[3] * c0,
+				a[12] * s4 - a[13] * s2 + a[15] * s0,
+				-a[8] * s4 + a[9] * s2 - a[11] * s0,
+				-a[4] * c3 + a[5] * c1 - a[6] * c0,
+				a[0] * c3 - a[1] * c1 + a[2] * c0,
+				-a[12] * s3 + a[13] * s1 - a[14] * s0,
+				a[8] * s3 - a[9] * s1 + a[10] * s0,
+			};
+			for (int i = 0; i < 16; ++i)
+				out.m[i] = (float)(r[i] * invDet);
+		}
+
+		void inversePrecise(const Mat44& in, Mat44& out) { inversePreciseInline(in, out); }
+		void inverseAffine(const Mat44& in, Mat44& out) { inverseAffineInline(in, out); }
+		void inverseRigid(const Mat44& in, Mat44& out) { inverseRigidInline(in, out); }
+
+		template<void (*f)(const Mat44&, Mat44&)> void inverseArray(const Mat44* in, Mat44* out, size_t count) {
+			for (size_t i = 0; i < count; ++i)
+				f(in[i], out[i]);
+		}
+
+		enum class Mode {
+			Full, // Vec4 with its own w.
+			Point, // w = 1
+			Direction, // w = 0
+			Project, // w = 1, divided by the resulting w.
+		};
+
+		// Vec3 results get w = 0 for free by clearing the w row of the matrix, projections need the w row for the divide and clear it afterwards.
+		template<Mode mode> void loadColumns(const Mat44& matrix, __m128 columns[4]) {
+			for (int i = 0; i < 4; ++i)
+				columns[i] = mode == Mode::Point || mode == Mode::Direction ? _mm_and_ps(matrix.col[i], maskXYZ()) : matrix.col[i];
+		}
+
+		template<Mode mode> __m128 transform4(const __m128 columns[4], __m128 p) {
+			__m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 z = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2));
+			__m128 r = _mm_add_ps(_mm_mul_ps(x, columns[0]), _mm_mul_ps(y, columns[1]));
+			if constexpr (mode == Mode::Full) {
+				__m128 w = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+				return _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(z, columns[2]), _mm_mul_ps(w, columns[3])));
+			} else if constexpr (mode == Mode::Direction) {
+				return _mm_add_ps(r, _mm_mul_ps(z, columns[2]));
+			} else {
+				r = _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(z, columns[2]), columns[3]));
+				if constexpr (mode == Mode::Project)
+					r = _mm_and_ps(_mm_div_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3))), maskXYZ());
+				return r;
+			}
+		}
+
+#ifdef TT_CGMATH_AVX2
+		// Two points per register, the in-lane permutes broadcast each point's components within its half.
+		template<Mode mode> __m256 transform8(const __m256 columns[4], __m256 p) {
+			__m256 x = _mm256_permute_ps(p, _MM_SHUFFLE(0, 0, 0, 0));
+			__m256 y = _mm256_permute_ps(p, _MM_SHUFFLE(1, 1, 1, 1));
+			__m256 z = _mm256_permute_ps(p, _MM_SHUFFLE(2, 2, 2, 2));
+			__m256 r;
+			if constexpr (mode == Mode::Full)
+				r = _mm256_fmadd_ps(z, columns[2], _mm256_mul_ps(_mm256_permute_ps(p, _MM_SHUFFLE(3, 3, 3, 3)), columns[3]));
+			else if constexpr (mode == Mode::Direction)
+				r = _mm256_mul_ps(z, columns[2]);
+			else
+				r = _mm256_fmadd_ps(z, columns[2], columns[3]);
+			r = _mm256_fmadd_ps(x, columns[0], _mm256_fmadd_ps(y, columns[1], r));
+			if constexpr (mode == Mode::Project)
+				r = _mm256_and_ps(_mm256_div_ps(r, _mm256_permute_ps(r, _MM_SHUFFLE(3, 3, 3, 3))), _mm256_set_m128(maskXYZ(), maskXYZ()));
+			return r;
+		}
+#endif
+
+		template<Mode mode> void transformArray(const Mat44& matrix, const float* in, float* out, size_t count) {
+			__m128 columns[4];
+			loadColumns<mode>(matrix, columns);
+			size_t i = 0;
+
+#ifdef TT_CGMATH_AVX2
+			__m256 columns8[4];
+			for (int c = 0; c < 4; ++c)
+				columns8[c] = _mm256_set_m128(columns[c], columns[c]);
+			for (; i + 8 <= count; i += 8) {
+				const float* src = in + i * 4;
+				__m256 a = _mm256_loadu_ps(src);
+				__m256 b = _mm256_loadu_ps(src + 8);
+				__m256 c = _mm256_loadu_ps(src + 16);
+				__m256 d = _mm256_loadu_ps(src + 24);
+				float* dst = out + i * 4;
+				_mm256_storeu_ps(dst, transform8<mode>(columns8, a));
+				_mm256_storeu_ps(dst + 8, transform8<mode>(columns8, b));
+				_mm256_storeu_ps(dst + 16, transform8<mode>(columns8, c));
+				_mm256_storeu_ps(dst + 24, transform8<mode>(columns8, d));
+			}
+#endif
+
+			for (; i + 4 <= count; i += 4) {
+				const float* src = in + i * 4;
+				__m128 a = _mm_load_ps(src);
+				__m128 b = _mm_load_ps(src + 4);
+				__m128 c = _mm_load_ps(src + 8);
+				__m128 d = _mm_load_ps(src + 12);
+				float* dst = out + i * 4;
+				_mm_store_ps(dst, transform4<mode>(columns, a));
+				_mm_store_ps(dst + 4, transform4<mode>(columns, b));
+				_mm_store_ps(dst + 8, transform4<mode>(columns, c));
+				_mm_store_ps(dst + 12, transform4<mode>(columns, d));
+			}
+			for (; i < count; ++i)
+				_mm_store_ps(out + i * 4, transform4<mode>(columns, _mm_load_ps(in + i * 4)));
+		}
+
+		// Structure of arrays, each register holds the same component of 4 (or 8) points and the matrix elements are broadcast once.
+		template<Mode mode> void transformStreams(const Mat44& matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count) {
+			const float* m = matrix.m;
+			size_t i = 0;
+
+#ifdef TT_CGMATH_AVX2
+			__m256 m8[16];
+			for (int e = 0; e < 16; ++e)
+				m8[e] = _mm256_set1_ps(m[e]);
+			for (; i + 8 <= count; i += 8) {
+				__m256 px = _mm256_loadu_ps(x + i);
+				__m256 py = _mm256_loadu_ps(y + i);
+				__m256 pz = _mm256_loadu_ps(z + i);
+				__m256 rx, ry, rz;
+				if constexpr (mode == Mode::Direction) {
+					rx = _mm256_mul_ps(pz, m8[8]);
+					ry = _mm256_mul_ps(pz, m8[9]);
+					rz = _mm256_mul_ps(pz, m8[10]);
+				} else {
+					rx = _mm256_fmadd_ps(pz, m8[8], m8[12]);
+					ry = _mm256_fmadd_ps(pz, m8[9], m8[13]);
+					rz = _mm256_fmadd_ps(pz, m8[10], m8[14]);
+				}
+				rx = _mm256_fmadd_ps(px, m8[0], _mm256_fmadd_ps(py, m8[4], rx));
+				ry = _mm256_fmadd_ps(px, m8[1], _mm256_fmadd_ps(py, m8[5], ry));
+				rz = _mm256_fmadd_ps(px, m8[2], _mm256_fmadd_ps(py, m8[6], rz));
+				if constexpr (mode == Mode::Project) {
+					__m256 rw = _mm256_fmadd_ps(px, m8[3], _mm256_fmadd_ps(py, m8[7], _mm256_fmadd_ps(pz, m8[11], m8[15])));
+					rx = _mm256_div_ps(rx, rw);
+					ry = _mm256_div_ps(ry, rw);
+					rz = _mm256_div_ps(rz, rw);
+				}
+				_mm256_storeu_ps(outX + i, rx);
+				_mm256_storeu_ps(outY + i, ry);
+				_mm256_storeu_ps(outZ + i, rz);
+			}
+#endif
+
+			__m128 m4[16];
+			for (int e = 0; e < 16; ++e)
+				m4[e] = _mm_set1_ps(m[e]);
+			for (; i + 4 <= count; i += 4) {
+				__m128 px = _mm_loadu_ps(x + i);
+				__m128 py = _mm_loadu_ps(y + i);
+				__m128 pz = _mm_loadu_ps(z + i);
+				__m128 rx = _mm_add_ps(_mm_mul_ps(px, m4[0]), _mm_mul_ps(py, m4[4]));
+				__m128 ry = _mm_add_ps(_mm_mul_ps(px, m4[1]), _mm_mul_ps(py, m4[5]));
+				__m128 rz = _mm_add_ps(_mm_mul_ps(px, m4[2]), _mm_mul_ps(py, m4[6]));
+				rx = _mm_add_ps(rx, _mm_mul_ps(pz, m4[8]));
+				ry = _mm_add_ps(ry, _mm_mul_ps(pz, m4[9]));
+				rz = _mm_add_ps(rz, _mm_mul_ps(pz, m4[10]));
+				if constexpr (mode != Mode::Direction) {
+					rx = _mm_add_ps(rx, m4[12]);
+					ry = _mm_add_ps(ry, m4[13]);
+					rz = _mm_add_ps(rz, m4[14]);
+				}
+				if constexpr (mode == Mode::Project) {
+					__m128 rw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m4[3]), _mm_mul_ps(py, m4[7])), _mm_add_ps(_mm_mul_ps(pz, m4[11]), m4[15]));
+					rx = _mm_div_ps(rx, rw);
+					ry = _mm_div_ps(ry, rw);
+					rz = _mm_div_ps(rz, rw);
+				}
+				_mm_storeu_ps(outX + i, rx);
+				_mm_storeu_ps(outY + i, ry);
+				_mm_storeu_ps(outZ + i, rz);
+			}
+
+			for (; i < count; ++i) {
+				float px = x[i], py = y[i], pz = z[i];
+				float w = mode == Mode::Direction ? 0.0f : 1.0f;
+				float rx = m[0] * px + m[4] * py + m[8] * pz + m[12] * w;
+				float ry = m[1] * px + m[5] * py + m[9] * pz + m[13] * w;
+				float rz = m[2] * px + m[6] * py + m[10] * pz + m[14] * w;
+				if constexpr (mode == Mode::Project) {
+					float rw = m[3] * px + m[7] * py + m[11] * pz + m[15];
+					rx /= rw;
+					ry /= rw;
+					rz /= rw;
+				}
+				outX[i] = rx;
+				outY[i] = ry;
+				outZ[i] = rz;
+			}
+		}
+	}
+
+	namespace {
+		// Culling runs on as many volumes as fit a register.
+#ifdef TT_CGMATH_AVX2
+		typedef __m256 Wide;
+		const size_t WIDE = 8;
+		inline Wide wideLoad(const float* p) { return _mm256_loadu_ps(p); }
+		inline Wide wideSet(float s) { return _mm256_set1_ps(s); }
+		inline Wide wideMulAdd(Wide a, Wide b, Wide c) { return _mm256_fmadd_ps(a, b, c); }
+		inline Wide wideAdd(Wide a, Wide b) { return _mm256_add_ps(a, b); }
+		inline Wide wideAnd(Wide a, Wide b) { return _mm256_and_ps(a, b); }
+		inline Wide wideNotNegative(Wide a) { return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ); }
+		inline unsigned int wideMask(Wide a) { return (unsigned int)_mm256_movemask_ps(a); }
+#else
+		typedef __m128 Wide;
+		const size_t WIDE = 4;
+		inline Wide wideLoad(const float* p) { return _mm_loadu_ps(p); }
+		inline Wide wideSet(float s) { return _mm_set1_ps(s); }
+		inline Wide wideMulAdd(Wide a, Wide b, Wide c) { return mulAdd(a, b, c); }
+		inline Wide wideAdd(Wide a, Wide b) { return _mm_add_ps(a, b); }
+		inline Wide wideAnd(Wide a, Wide b) { return _mm_and_ps(a, b); }
+		inline Wide wideNotNegative(Wide a) { return _mm_cmpge_ps(a, _mm_setzero_ps()); }
+		inline unsigned int wideMask(Wide a) { return (unsigned int)_mm_movemask_ps(a); }
+#endif
+
+		// Plane coefficients broadcast to all lanes, with the absolute normals for boxes.
+		struct WidePlanes {
+			Wide p[6][4];
+			Wide absNormal[6][3];
+		};
+
+		// One bit per volume starting at streams[n] + i, set when it is on the inner side of all planes.
+		template<bool box> inline unsigned int visibleMask(const WidePlanes& planes, const float* const* streams, size_t i) {
+			Wide x = wideLoad(streams[0] + i);
+			Wide y = wideLoad(streams[1] + i);
+			Wide z = wideLoad(streams[2] + i);
+			Wide a = wideLoad(streams[3] + i);
+			Wide b = box ? wideLoad(streams[4] + i) : a;
+			Wide c = box ? wideLoad(streams[5] + i) : a;
+			Wide inside;
+			for (int n = 0; n < 6; ++n) {
+				const Wide* p = planes.p[n];
+				Wide d = wideMulAdd(p[0], x, wideMulAdd(p[1], y, wideMulAdd(p[2], z, p[3])));
+				// The box's extent projected on the normal works as the sphere radius.
+				if constexpr (box)
+					d = wideMulAdd(planes.absNormal[n][0], a, wideMulAdd(planes.absNormal[n][1], b, wideMulAdd(planes.absNormal[n][2], c, d)));
+				else
+					d = wideAdd(d, a);
+				inside = n == 0 ? wideNotNegative(d) : wideAnd(inside, wideNotNegative(d));
+			}
+			return wideMask(inside);
+		}
+
+		// std::popcount would be instantiated (as a weak symbol) with AVX2 instructions in the AVX2 build.
+		inline unsigned int bitCount(unsigned int x) {
+			x = x - ((x >> 1) & 0x55555555u);
+			x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+			return (((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+		}
+
+		template<bool box> size_t cull(const Vec* planes, const float* const* streams, size_t count, unsigned int* visibleBits, unsigned int* visibleIndices) {
+			constexpr int STREAMS = box ? 6 : 4;
+			WidePlanes wide;
+			for (int n = 0; n < 6; ++n) {
+				for (int c = 0; c < 4; ++c)
+					wide.p[n][c] = wideSet((&planes[n].x)[c]);
+				for (int c = 0; c < 3; ++c)
+					wide.absNormal[n][c] = wideSet(fabsf((&planes[n].x)[c]));
+			}
+
+			size_t visible = 0;
+			auto output = [&](size_t first, unsigned int mask, size_t lanes) {
+				// WIDE divides 32, so each word starts at the beginning of a step.
+				if (visibleBits) {
+					if (first % 32 == 0)
+						visibleBits[first / 32] = mask;
+					else
+						visibleBits[first / 32] |= mask << (first % 32);
+				}
+				if (visibleIndices) {
+					// Without branches: every index is written, but only the visible ones advance. visible <= first + j, so this stays in bounds.
+					for (size_t j = 0; j < lanes; ++j) {
+						visibleIndices[visible] = (unsigned int)(first + j);
+						visible += (mask >> j) & 1;
+					}
+				} else {
+					visible += bitCount(mask);
+				}
+			};
+
+			size_t i = 0;
+			for (; i + WIDE <= count; i += WIDE)
+				output(i, visibleMask<box>(wide, streams, i), WIDE);
+			if (i < count) {
+				// Pad the last step with zeros, the padded lanes are masked off.
+				size_t lanes = count - i;
+				float tail[STREAMS][WIDE] = {};
+				const float* tailStreams[STREAMS];
+				for (int s = 0; s < STREAMS; ++s) {
+					for (size_t j = 0; j < lanes; ++j)
+						tail[s][j] = streams[s][i + j];
+					tailStreams[s] = tail[s];
+				}
+				output(i, visibleMask<box>(wide, tailStreams, 0) & ((1u << lanes) - 1), lanes);
+			}
+			return visible;
+		}
+	}
+
+	namespace {
+#ifdef TT_CGMATH_AVX2
+		typedef Lanes8 WideLanes;
+#else
+		typedef Lanes4 WideLanes;
+#endif
+
+		// Arrays run as many lanes as fit a register, the tail through a zero padded copy.
+		template<typename WideLanes::R (*f)(typename WideLanes::R)> void mapArray(const float* in, float* out, size_t count) {
+			const size_t lanes = sizeof(typename WideLanes::R) / sizeof(float);
+			size_t i = 0;
+			for (; i + lanes <= count; i += lanes)
+				WideLanes::store(out + i, f(WideLanes::load(in + i)));
+			if (i < count) {
+				float tail[lanes] = {};
+				memcpy(tail, in + i, (count - i) * sizeof(float));
+				WideLanes::store(tail, f(WideLanes::load(tail)));
+				memcpy(out + i, tail, (count - i) * sizeof(float));
+			}
+		}
+
+		void sincosArray(const float* in, float* sinOut, float* cosOut, size_t count) {
+			const size_t lanes = sizeof(WideLanes::R) / sizeof(float);
+			WideLanes::R s, c;
+			size_t i = 0;
+			for (; i + lanes <= count; i += lanes) {
+				sinCosLanes<WideLanes>(WideLanes::load(in + i), &s, &c);
+				WideLanes::store(sinOut + i, s);
+				WideLanes::store(cosOut + i, c);
+			}
+			if (i < count) {
+				float tail[lanes] = {}, tailCos[lanes];
+				memcpy(tail, in + i, (count - i) * sizeof(float));
+				sinCosLanes<WideLanes>(WideLanes::load(tail), &s, &c);
+				WideLanes::store(tail, s);
+				WideLanes::store(tailCos, c);
+				memcpy(sinOut + i, tail, (count - i) * sizeof(float));
+				memcpy(cosOut + i, tailCos, (count - i) * sizeof(float));
+			}
+		}
+
+		void atan2Array(const float* y, const float* x, float* out, size_t count) {
+			const size_t lanes = sizeof(WideLanes::R) / sizeof(float);
+			size_t i = 0;
+			for (; i + lanes <= count; i += lanes)
+				WideLanes::store(out + i, atan2Lanes<WideLanes>(WideLanes::load(y + i), WideLanes::load(x + i)));
+			if (i < count) {
+				float tailY[lanes] = {}, tailX[lanes] = {};
+				memcpy(tailY, y + i, (count - i) * sizeof(float));
+				memcpy(tailX, x + i, (count - i) * sizeof(float));
+				WideLanes::store(tailY, atan2Lanes<WideLanes>(WideLanes::load(tailY), WideLanes::load(tailX)));
+				memcpy(out + i, tailY, (count - i) * sizeof(float));
+			}
+		}
+	}
+
+	namespace {
+		inline __m128i selectInt(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+		// 8 values per step, the tail through zero padded copies.
+		template<typename In, typename Out, void (*step)(const In* in, Out* out)> void convertArray(const In* in, Out* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				step(in + i, out + i);
+			if (i < count) {
+				In tailIn[8] = {};
+				Out tailOut[8];
+				memcpy(tailIn, in + i, (count - i) * sizeof(In));
+				step(tailIn, tailOut);
+				memcpy(out + i, tailOut, (count - i) * sizeof(Out));
+			}
+		}
+
+#ifndef TT_CGMATH_AVX2
+		// Rounds to nearest even and handles NaNs like F16C, on the float's bits (after Fabian Giesen's float_to_half_fast3_rtne).
+		inline __m128i floatToHalf4(__m128 a) {
+			__m128i f = _mm_castps_si128(a);
+			__m128i sign = _mm_and_si128(f, _mm_set1_epi32((int)0x80000000));
+			f = _mm_xor_si128(f, sign);
+			// 65536 and up (rounding makes 65520 and up inf too), inf and NaN. NaNs keep the top of their payload and become quiet.
+			__m128i overflow = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x477fffff));
+			__m128i nan = _mm_or_si128(_mm_set1_epi32(0x7e00), _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(0x3ff)));
+			__m128i infNan = selectInt(_mm_cmpgt_epi32(f, _mm_set1_epi32(0x7f800000)), nan, _mm_set1_epi32(0x7c00));
+			// Below the smallest normal half the float adder does the rounding: adding 0.5 moves the bits to the bottom of the mantissa.
+			__m128i small = _mm_cmplt_epi32(f, _mm_set1_epi32(0x38800000));
+			__m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+			// Rebias the exponent, add just under half an ulp and the lowest kept bit (ties to even), then drop 13 mantissa bits.
+			__m128i odd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+			__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, _mm_set1_epi32((int)0xc8000fff)), odd), 13);
+			__m128i h = selectInt(overflow, infNan, selectInt(small, denormal, normal));
+			return _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+		}
+
+		inline __m128 halfToFloat4(__m128i h) {
+			__m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+			__m128i exponent = _mm_and_si128(o, _mm_set1_epi32(0x0f800000));
+			o = _mm_add_epi32(o, _mm_set1_epi32(0x38000000));
+			// inf and NaN get the maximum exponent, zeros and denormals are normalized by the float subtraction.
+			__m128i infNan = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x0f800000));
+			o = _mm_add_epi32(o, _mm_and_si128(infNan, _mm_set1_epi32(0x38000000)));
+			__m128i denormal = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(0x38800000))));
+			o = selectInt(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), denormal, o);
+			__m128i nan = _mm_cmpgt_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), _mm_set1_epi32(0x7c00));
+			o = _mm_or_si128(o, _mm_and_si128(nan, _mm_set1_epi32(0x00400000)));
+			return _mm_castsi128_ps(_mm_or_si128(o, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+		}
+
+		// packs_epi32 saturates signed values, so the 16 bit results are sign extended first.
+		inline __m128i packLow16(__m128i a, __m128i b) {
+			return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+		}
+#endif
+
+		void floatToHalfStep(const float* in, f16* out) {
+#ifdef TT_CGMATH_AVX2
+			_mm_storeu_si128((__m128i*)out, _mm256_cvtps_ph(_mm256_loadu_ps(in), _MM_FROUND_TO_NEAREST_INT));
+#else
+			_mm_storeu_si128((__m128i*)out, packLow16(floatToHalf4(_mm_loadu_ps(in)), floatToHalf4(_mm_loadu_ps(in + 4))));
+#endif
+		}
+
+		void halfToFloatStep(const f16* in, float* out) {
+			__m128i h = _mm_loadu_si128((const __m128i*)in);
+#ifdef TT_CGMATH_AVX2
+			_mm256_storeu_ps(out, _mm256_cvtph_ps(h));
+#else
+			_mm_storeu_ps(out, halfToFloat4(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+			_mm_storeu_ps(out + 4, halfToFloat4(_mm_unpackhi_epi16(h, _mm_setzero_si128())));
+#endif
+		}
+
+		// Sign extended 16 bit integers as floats.
+		inline __m128 lowInt16ToFloat(__m128i v) { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)); }
+		inline __m128 highInt16ToFloat(__m128i v) { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)); }
+
+		inline __m128i quantize(__m128 a, float low, float scale) {
+			return _mm_cvtps_epi32(_mm_mul_ps(_mm_max_ps(_mm_min_ps(a, _mm_set1_ps(1.0f)), _mm_set1_ps(low)), _mm_set1_ps(scale)));
+		}
+
+		void floatToSnormStep(const float* in, snorm16* out) {
+			_mm_storeu_si128((__m128i*)out, _mm_packs_epi32(quantize(_mm_loadu_ps(in), -1.0f, 32767.0f), quantize(_mm_loadu_ps(in + 4), -1.0f, 32767.0f)));
+		}
+
+		void snormToFloatStep(const snorm16* in, float* out) {
+			__m128i v = _mm_loadu_si128((const __m128i*)in);
+			// -32768 also decodes to -1.
+			_mm_storeu_ps(out, _mm_max_ps(_mm_mul_ps(lowInt16ToFloat(v), _mm_set1_ps(1.0f / 32767.0f)), _mm_set1_ps(-1.0f)));
+			_mm_storeu_ps(out + 4, _mm_max_ps(_mm_mul_ps(highInt16ToFloat(v), _mm_set1_ps(1.0f / 32767.0f)), _mm_set1_ps(-1.0f)));
+		}
+
+		void floatToUnormStep(const float* in, unorm8* out) {
+			__m128i words = _mm_packs_epi32(quantize(_mm_loadu_ps(in), 0.0f, 255.0f), quantize(_mm_loadu_ps(in + 4), 0.0f, 255.0f));
+			_mm_storel_epi64((__m128i*)out, _mm_packus_epi16(words, words));
+		}
+
+		void unormToFloatStep(const unorm8* in, float* out) {
+			__m128i words = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)in), _mm_setzero_si128());
+			_mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128())), _mm_set1_ps(1.0f / 255.0f)));
+			_mm_storeu_ps(out + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, _mm_setzero_si128())), _mm_set1_ps(1.0f / 255.0f)));
+		}
+
+		// 1 or -1 by the sign bit, so -0 counts as negative.
+		inline __m128 signNotZero(__m128 a) { return _mm_or_ps(_mm_and_ps(a, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f)); }
+		inline __m128 absolute(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+		// Projects 4 unit vectors onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the diagonals.
+		void encodeOctahedralStep(const Vec3* in, octahedral16* out) {
+			__m128 x = _mm_load_ps(&in[0].x), y = _mm_load_ps(&in[1].x), z = _mm_load_ps(&in[2].x), w = _mm_load_ps(&in[3].x);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			__m128 sum = _mm_add_ps(_mm_add_ps(absolute(x), absolute(y)), absolute(z));
+			// Zero vectors become (0, 0), which decodes to +z.
+			__m128 nonZero = _mm_cmpgt_ps(sum, _mm_setzero_ps());
+			__m128 inverse = _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), sum));
+			__m128 px = _mm_mul_ps(x, inverse);
+			__m128 py = _mm_mul_ps(y, inverse);
+			__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+			__m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absolute(py)), signNotZero(px));
+			__m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absolute(px)), signNotZero(py));
+			__m128i ix = quantize(_mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, px)), -1.0f, 32767.0f);
+			__m128i iy = quantize(_mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, py)), -1.0f, 32767.0f);
+			_mm_storeu_si128((__m128i*)out, _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy)));
+		}
+
+		void decodeOctahedralStep(const octahedral16* in, Vec3* out) {
+			__m128i v = _mm_loadu_si128((const __m128i*)in);
+			__m128 low = lowInt16ToFloat(v), high = highInt16ToFloat(v);
+			__m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+			__m128 x = _mm_max_ps(_mm_mul_ps(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)), scale), _mm_set1_ps(-1.0f));
+			__m128 y = _mm_max_ps(_mm_mul_ps(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)), scale), _mm_set1_ps(-1.0f));
+			__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absolute(x)), absolute(y));
+			// Unfold the lower half: move x and y towards 0 by how far z is below 0.
+			__m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+			x = _mm_sub_ps(x, _mm_or_ps(t, _mm_and_ps(x, _mm_set1_ps(-0.0f))));
+			y = _mm_sub_ps(y, _mm_or_ps(t, _mm_and_ps(y, _mm_set1_ps(-0.0f))));
+			__m128 length = _mm_sqrt_ps(mulAdd(x, x, mulAdd(y, y, _mm_mul_ps(z, z))));
+			x = _mm_div_ps(x, length);
+			y = _mm_div_ps(y, length);
+			z = _mm_div_ps(z, length);
+			__m128 w = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_store_ps(&out[0].x, x);
+			_mm_store_ps(&out[1].x, y);
+			_mm_store_ps(&out[2].x, z);
+			_mm_store_ps(&out[3].x, w);
+		}
+
+		// The octahedral steps take 4 vectors, the tail copies are aligned for their Vec3 loads and stores.
+		// They are plain bytes, arrays of Vec3 would call its (shared, inline) constructor, which must not be emitted here with AVX2 instructions.
+		template<typename In, typename Out, void (*step)(const In* in, Out* out)> void convertArray4(const In* in, Out* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				step(in + i, out + i);
+			if (i < count) {
+				alignas(16) unsigned char tailIn[4 * sizeof(In)] = {};
+				alignas(16) unsigned char tailOut[4 * sizeof(Out)];
+				memcpy(tailIn, in + i, (count - i) * sizeof(In));
+				step(reinterpret_cast<const In*>(tailIn), reinterpret_cast<Out*>(tailOut));
+				memcpy(out + i, tailOut, (count - i) * sizeof(Out));
+			}
+		}
+	}
+
+	namespace {
+		// Writes the 16 elements of 4 matrices (lane n of m[e] is element e of out[n]) as the matrices.
+		inline void storeMatrices(const __m128* m, Mat44* out) {
+			for (int c = 0; c < 4; ++c) {
+				__m128 r0 = m[4 * c], r1 = m[4 * c + 1], r2 = m[4 * c + 2], r3 = m[4 * c + 3];
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				out[0].col[c] = r0;
+				out[1].col[c] = r1;
+				out[2].col[c] = r2;
+				out[3].col[c] = r3;
+			}
+		}
+
+#ifdef TT_CGMATH_AVX2
+		// The same for 8 matrices, transposing within the 128 bit halves so the high halves hold matrices 4 to 7.
+		inline void storeMatrices(const __m256* m, Mat44* out) {
+			for (int c = 0; c < 4; ++c) {
+				__m256 t0 = _mm256_unpacklo_ps(m[4 * c], m[4 * c + 1]);
+				__m256 t1 = _mm256_unpackhi_ps(m[4 * c], m[4 * c + 1]);
+				__m256 t2 = _mm256_unpacklo_ps(m[4 * c + 2], m[4 * c + 3]);
+				__m256 t3 = _mm256_unpackhi_ps(m[4 * c + 2], m[4 * c + 3]);
+				__m256 r[4] = {
+					_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+					_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+					_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+					_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+				};
+				for (int n = 0; n < 4; ++n) {
+					out[n].col[c] = _mm256_castps256_ps128(r[n]);
+					out[n + 4].col[c] = _mm256_extractf128_ps(r[n], 1);
+				}
+			}
+		}
+#endif
+
+		template<typename L> typename L::R lerpLanes(typename L::R a, typename L::R b, typename L::R w) {
+			return L::mulAdd(L::sub(b, a), w, a);
+		}
+
+		// Quat::slerp per lane. Keys closer than Quat::slerp's threshold use nlerp,
+		// and every result is normalized, which also cleans up slightly denormalized keys.
+		template<typename L> void slerpLanes(const typename L::R* a, const typename L::R* b, typename L::R w, typename L::R* out) {
+			typedef typename L::R R;
+			R one = L::set(1.0f);
+			R d = L::mulAdd(a[3], b[3], L::mulAdd(a[2], b[2], L::mulAdd(a[1], b[1], L::mul(a[0], b[0]))));
+			// Along the shortest arc: flip b where the dot is negative.
+			R flip = L::bitAnd(d, L::set(-0.0f));
+			d = L::bitXor(d, flip);
+			// acos(d) for d in [0, 1] as sqrt(1 - d) times a polynomial (Abramowitz and Stegun 4.4.46, error below 2e-8).
+			R p = L::mulAdd(L::set(-0.0012624911f), d, L::set(0.0066700901f));
+			p = L::mulAdd(p, d, L::set(-0.0170881256f));
+			p = L::mulAdd(p, d, L::set(0.0308918810f));
+			p = L::mulAdd(p, d, L::set(-0.0501743046f));
+			p = L::mulAdd(p, d, L::set(0.0889789874f));
+			p = L::mulAdd(p, d, L::set(-0.2145988016f));
+			p = L::mulAdd(p, d, L::set(1.5707963050f));
+			R angle = L::mul(L::sqrt(L::max(L::sub(one, d), L::set(0.0f))), p);
+			R sinAngle = L::sqrt(L::max(L::negMulAdd(d, d, one), L::set(0.0f)));
+			// wb = sin(w angle) / sin(angle), wa = sin((1 - w) angle) / sin(angle) expanded to cos(w angle) - cos(angle) wb, so one sincos does.
+			R s, c;
+			sinCosLanes<L>(L::mul(w, angle), &s, &c);
+			R nearlyEqual = L::greater(d, L::set(0.9995f));
+			R wb = L::div(s, sinAngle);
+			R wa = L::select(nearlyEqual, L::sub(one, w), L::negMulAdd(d, wb, c));
+			wb = L::select(nearlyEqual, w, wb);
+			wb = L::bitXor(wb, flip);
+			R q[4];
+			for (int c = 0; c < 4; ++c)
+				q[c] = L::mulAdd(b[c], wb, L::mul(a[c], wa));
+			R length = L::sqrt(L::mulAdd(q[3], q[3], L::mulAdd(q[2], q[2], L::mulAdd(q[1], q[1], L::mul(q[0], q[0])))));
+			R inverseLength = L::div(one, length);
+			for (int c = 0; c < 4; ++c)
+				out[c] = L::mul(q[c], inverseLength);
+		}
+
+		// One step of sampleTRS: interpolates lanes i to i + lanes - 1 and builds their matrices like Quat::toMat44 and Mat44::TRS.
+		template<typename L> void sampleTRSStep(const float* const* streams, size_t i, Mat44* out) {
+			typedef typename L::R R;
+			auto load = [&](int stream) { return L::load(streams[stream] + i); };
+			R translation[3], scale[3], a[4], b[4], q[4];
+			R translationWeight = load(TRANSLATION_WEIGHT);
+			R scaleWeight = load(SCALE_WEIGHT);
+			for (int c = 0; c < 3; ++c) {
+				translation[c] = lerpLanes<L>(load(TRANSLATION_A + c), load(TRANSLATION_B + c), translationWeight);
+				scale[c] = lerpLanes<L>(load(SCALE_A + c), load(SCALE_B + c), scaleWeight);
+			}
+			for (int c = 0; c < 4; ++c) {
+				a[c] = load(ROTATION_A + c);
+				b[c] = load(ROTATION_B + c);
+			}
+			slerpLanes<L>(a, b, load(ROTATION_WEIGHT), q);
+
+			R one = L::set(1.0f), two = L::set(2.0f), zero = L::set(0.0f);
+			R x2 = L::mul(q[0], two), y2 = L::mul(q[1], two), z2 = L::mul(q[2], two);
+			R xx = L::mul(q[0], x2), yy = L::mul(q[1], y2), zz = L::mul(q[2], z2);
+			R xy = L::mul(q[0], y2), xz = L::mul(q[0], z2), yz = L::mul(q[1], z2);
+			R wx = L::mul(q[3], x2), wy = L::mul(q[3], y2), wz = L::mul(q[3], z2);
+			R m[16] = {
+				L::mul(L::sub(one, L::add(yy, zz)), scale[0]), L::mul(L::add(xy, wz), scale[0]), L::mul(L::sub(xz, wy), scale[0]), zero,
+				L::mul(L::sub(xy, wz), scale[1]), L::mul(L::sub(one, L::add(xx, zz)), scale[1]), L::mul(L::add(yz, wx), scale[1]), zero,
+				L::mul(L::add(xz, wy), scale[2]), L::mul(L::sub(yz, wx), scale[2]), L::mul(L::sub(one, L::add(xx, yy)), scale[2]), zero,
+				translation[0], translation[1], translation[2], one,
+			};
+			storeMatrices(m, out);
+		}
+
+		void sampleTRS(const float* const* streams, size_t count, Mat44* out) {
+			const size_t lanes = sizeof(WideLanes::R) / sizeof(float);
+			size_t i = 0;
+			for (; i + lanes <= count; i += lanes)
+				sampleTRSStep<WideLanes>(streams, i, out + i);
+			if (i < count) {
+				// Pad the last step with copies of its first track so every lane stays finite.
+				float tail[SAMPLE_STREAMS][8];
+				const float* tailStreams[SAMPLE_STREAMS];
+				for (int s = 0; s < SAMPLE_STREAMS; ++s) {
+					for (size_t j = 0; j < lanes; ++j)
+						tail[s][j] = streams[s][i + (i + j < count ? j : 0)];
+					tailStreams[s] = tail[s];
+				}
+				Mat44 tailOut[8];
+				sampleTRSStep<WideLanes>(tailStreams, 0, tailOut);
+				memcpy(out + i, tailOut, (count - i) * sizeof(Mat44));
+			}
+		}
+	}
+
+	namespace {
+		// Linear blend skinning: the columns of the weighted sum of a vertex's 4 joint matrices.
+		inline void blendJoints(const Mat44* palette, const u16* joints, const float* weights, __m128 columns[4]) {
+			__m128 w = _mm_loadu_ps(weights);
+			__m128 w0 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 w1 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 w2 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 2, 2));
+			__m128 w3 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 3, 3));
+			const Mat44& a = palette[joints[0]];
+			const Mat44& b = palette[joints[1]];
+			const Mat44& c = palette[joints[2]];
+			const Mat44& d = palette[joints[3]];
+			for (int i = 0; i < 4; ++i)
+				columns[i] = mulAdd(d.col[i], w3, mulAdd(c.col[i], w2, mulAdd(b.col[i], w1, _mm_mul_ps(a.col[i], w0))));
+		}
+
+		// n with w = 0 scaled to length 1, zero stays zero.
+		inline __m128 normalize3(__m128 n) {
+			__m128 d = _mm_mul_ps(n, n);
+			d = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2)));
+			return _mm_div_ps(n, _mm_sqrt_ps(_mm_max_ps(d, _mm_set1_ps(FLT_MIN))));
+		}
+
+		// Skins 4 vertices, each position and normal one register. The AVX2 build blends and transforms two vertices per register.
+		template<bool normals> void skin4(const Mat44* palette, const u16* joints, const float* weights, const __m128* p, const __m128* n, __m128* outP, __m128* outN) {
+#ifdef TT_CGMATH_AVX2
+			const __m256 maskXYZ8 = _mm256_set_m128(maskXYZ(), maskXYZ());
+			for (int v = 0; v < 4; v += 2) {
+				const u16* j = joints + 4 * v;
+				__m256 w = _mm256_loadu_ps(weights + 4 * v);
+				__m256 w0 = _mm256_permute_ps(w, _MM_SHUFFLE(0, 0, 0, 0));
+				__m256 w1 = _mm256_permute_ps(w, _MM_SHUFFLE(1, 1, 1, 1));
+				__m256 w2 = _mm256_permute_ps(w, _MM_SHUFFLE(2, 2, 2, 2));
+				__m256 w3 = _mm256_permute_ps(w, _MM_SHUFFLE(3, 3, 3, 3));
+				auto joint = [&](int k, int c) { return _mm256_set_m128(palette[j[4 + k]].col[c], palette[j[k]].col[c]); };
+				__m256 columns[4];
+				for (int c = 0; c < 4; ++c)
+					columns[c] = _mm256_fmadd_ps(joint(3, c), w3, _mm256_fmadd_ps(joint(2, c), w2, _mm256_fmadd_ps(joint(1, c), w1, _mm256_mul_ps(joint(0, c), w0))));
+				__m256 position = _mm256_and_ps(transform8<Mode::Point>(columns, _mm256_set_m128(p[v + 1], p[v])), maskXYZ8);
+				outP[v] = _mm256_castps256_ps128(position);
+				outP[v + 1] = _mm256_extractf128_ps(position, 1);
+				if constexpr (normals) {
+					__m256 normal = _mm256_and_ps(transform8<Mode::Direction>(columns, _mm256_set_m128(n[v + 1], n[v])), maskXYZ8);
+					normal = _mm256_div_ps(normal, _mm256_sqrt_ps(_mm256_max_ps(_mm256_dp_ps(normal, normal, 0x7f), _mm256_set1_ps(FLT_MIN))));
+					outN[v] = _mm256_castps256_ps128(normal);
+					outN[v + 1] = _mm256_extractf128_ps(normal, 1);
+				}
+			}
+#else
+			for (int v = 0; v < 4; ++v) {
+				__m128 columns[4];
+				blendJoints(palette, joints + 4 * v, weights + 4 * v, columns);
+				outP[v] = _mm_and_ps(transform4<Mode::Point>(columns, p[v]), maskXYZ());
+				if constexpr (normals)
+					outN[v] = normalize3(_mm_and_ps(transform4<Mode::Direction>(columns, n[v]), maskXYZ()));
+			}
+#endif
+		}
+
+		template<bool normals> void skinArray(const Mat44* palette, const u16* joints, const float* weights, const float* positions, const float* normalsIn, float* outPositions, float* outNormals, size_t count) {
+			__m128 p[4], n[4], outP[4], outN[4];
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				for (int v = 0; v < 4; ++v) {
+					p[v] = _mm_load_ps(positions + 4 * (i + v));
+					if constexpr (normals)
+						n[v] = _mm_load_ps(normalsIn + 4 * (i + v));
+				}
+				skin4<normals>(palette, joints + 4 * i, weights + 4 * i, p, n, outP, outN);
+				for (int v = 0; v < 4; ++v) {
+					_mm_store_ps(outPositions + 4 * (i + v), outP[v]);
+					if constexpr (normals)
+						_mm_store_ps(outNormals + 4 * (i + v), outN[v]);
+				}
+			}
+			if (i < count) {
+				// Pad the last step with weightless vertices of joint 0, which skin to zero.
+				size_t lanes = count - i;
+				u16 tailJoints[16] = {};
+				float tailWeights[16] = {};
+				memcpy(tailJoints, joints + 4 * i, lanes * 4 * sizeof(u16));
+				memcpy(tailWeights, weights + 4 * i, lanes * 4 * sizeof(float));
+				for (size_t v = 0; v < 4; ++v) {
+					p[v] = v < lanes ? _mm_load_ps(positions + 4 * (i + v)) : _mm_setzero_ps();
+					n[v] = normals && v < lanes ? _mm_load_ps(normalsIn + 4 * (i + v)) : _mm_setzero_ps();
+				}
+				skin4<normals>(palette, tailJoints, tailWeights, p, n, outP, outN);
+				for (size_t v = 0; v < lanes; ++v) {
+					_mm_store_ps(outPositions + 4 * (i + v), outP[v]);
+					if constexpr (normals)
+						_mm_store_ps(outNormals + 4 * (i + v), outN[v]);
+				}
+			}
+		}
+
+		void skin(const Mat44* palette, const u16* joints, const float* weights, const float* positions, const float* normals, float* outPositions, float* outNormals, size_t count) {
+			if (normals && outNormals)
+				skinArray<true>(palette, joints, weights, positions, normals, outPositions, outNormals, count);
+			else
+				skinArray<false>(palette, joints, weights, positions, nullptr, outPositions, nullptr, count);
+		}
+
+		// Structure of arrays: 4 vertices per step, transposed to one register per vertex and back.
+		template<bool normals> void skinStreamStep(const Mat44* palette, const u16* joints, const float* weights, const float* const* in, size_t i, float* const* out, size_t o) {
+			__m128 p[4], n[4], outP[4], outN[4];
+			p[0] = _mm_loadu_ps(in[0] + i);
+			p[1] = _mm_loadu_ps(in[1] + i);
+			p[2] = _mm_loadu_ps(in[2] + i);
+			p[3] = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+			if constexpr (normals) {
+				n[0] = _mm_loadu_ps(in[3] + i);
+				n[1] = _mm_loadu_ps(in[4] + i);
+				n[2] = _mm_loadu_ps(in[5] + i);
+				n[3] = _mm_setzero_ps();
+				_MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+			}
+			skin4<normals>(palette, joints, weights, p, n, outP, outN);
+			_MM_TRANSPOSE4_PS(outP[0], outP[1], outP[2], outP[3]);
+			for (int c = 0; c < 3; ++c)
+				_mm_storeu_ps(out[c] + o, outP[c]);
+			if constexpr (normals) {
+				_MM_TRANSPOSE4_PS(outN[0], outN[1], outN[2], outN[3]);
+				for (int c = 0; c < 3; ++c)
+					_mm_storeu_ps(out[3 + c] + o, outN[c]);
+			}
+		}
+
+		template<bool normals> void skinStreamArray(const Mat44* palette, const u16* joints, const float* weights, const float* const* in, float* const* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				skinStreamStep<normals>(palette, joints + 4 * i, weights + 4 * i, in, i, out, i);
+			if (i < count) {
+				constexpr int STREAMS = normals ? 6 : 3;
+				size_t lanes = count - i;
+				float tail[STREAMS][4] = {};
+				float tailOut[STREAMS][4];
+				const float* tailIn[STREAMS];
+				float* tailOutStreams[STREAMS];
+				for (int s = 0; s < STREAMS; ++s) {
+					for (size_t j = 0; j < lanes; ++j)
+						tail[s][j] = in[s][i + j];
+					tailIn[s] = tail[s];
+					tailOutStreams[s] = tailOut[s];
+				}
+				u16 tailJoints[16] = {};
+				float tailWeights[16] = {};
+				memcpy(tailJoints, joints + 4 * i, lanes * 4 * sizeof(u16));
+				memcpy(tailWeights, weights + 4 * i, lanes * 4 * sizeof(float));
+				skinStreamStep<normals>(palette, tailJoints, tailWeights, tailIn, 0, tailOutStreams, 0);
+				for (int s = 0; s < STREAMS; ++s)
+					memcpy(out[s] + i, tailOut[s], lanes * sizeof(float));
+			}
+		}
+
+		void skinStreams(const Mat44* palette, const u16* joints, const float* weights, const float* const* in, float* const* out, bool normals, size_t count) {
+			if (normals)
+				skinStreamArray<true>(palette, joints, weights, in, out, count);
+			else
+				skinStreamArray<false>(palette, joints, weights, in, out, count);
+		}
+	}
+
+#ifdef TT_CGMATH_KERNELS_AVX2_BUILD
+	// The __m256 versions declared in tt_math.h for files compiled with AVX.
+	template<> __m256 sin(__m256 a) { return sinLanes<Lanes8>(a); }
+	template<> __m256 cos(__m256 a) { return cosLanes<Lanes8>(a); }
+	template<> void sincos(__m256 a, __m256& s, __m256& c) { sinCosLanes<Lanes8>(a, &s, &c); }
+	template<> __m256 exp(__m256 a) { return expLanes<Lanes8>(a); }
+	template<> __m256 log(__m256 a) { return logLanes<Lanes8>(a); }
+	template<> __m256 atan2(__m256 y, __m256 x) { return atan2Lanes<Lanes8>(y, x); }
+#endif
+
+	const CGMathKernels TT_CGMATH_KERNELS = {
+		multiply,
+		inverse,
+		inversePrecise,
+		inverseAffine,
+		inverseRigid,
+		inverseArray<inverseInline>,
+		inverseArray<inversePreciseInline>,
+		inverseArray<inverseAffineInline>,
+		inverseArray<inverseRigidInline>,
+		floor,
+		ceil,
+		mod,
+		transformArray<Mode::Full>,
+		transformArray<Mode::Point>,
+		transformArray<Mode::Direction>,
+		transformArray<Mode::Project>,
+		transformStreams<Mode::Point>,
+		transformStreams<Mode::Direction>,
+		transformStreams<Mode::Project>,
+		cull<false>,
+		cull<true>,
+		multiplyHierarchy,
+		mapArray<sinLanes<WideLanes>>,
+		mapArray<cosLanes<WideLanes>>,
+		sincosArray,
+		mapArray<expLanes<WideLanes>>,
+		mapArray<logLanes<WideLanes>>,
+		atan2Array,
+		convertArray<float, f16, floatToHalfStep>,
+		convertArray<f16, float, halfToFloatStep>,
+		convertArray<float, snorm16, floatToSnormStep>,
+		convertArray<snorm16, float, snormToFloatStep>,
+		convertArray<float, unorm8, floatToUnormStep>,
+		convertArray<unorm8, float, unormToFloatStep>,
+		convertArray4<Vec3, octahedral16, encodeOctahedralStep>,
+		convertArray4<octahedral16, Vec3, decodeOctahedralStep>,
+		sampleTRS,
+		skin,
+		skinStreams,
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "tt_cgmath.h"
+#include "tt_numerictypes.h"
+
+// Internal to cgmath. tt_cgmath_kernels.cpp is compiled twice, as the SSE2 baseline and (via tt_cgmath_kernels_avx2.cpp) with AVX2 / FMA enabled,
+// each filling one of these tables. tt_cgmath.cpp points cgmathKernels at the best table the CPU supports at startup.
+namespace TT {
+	struct CGMathKernels {
+		// out = a * b, out may be a or b.
+		void (*multiply)(const Mat44& a, const Mat44& b, Mat44& out);
+		// out may be in. inversePrecise computes in double.
+		void (*inverse)(const Mat44& in, Mat44& out);
+		void (*inversePrecise)(const Mat44& in, Mat44& out);
+		void (*inverseAffine)(const Mat44& in, Mat44& out);
+		void (*inverseRigid)(const Mat44& in, Mat44& out);
+		// The same on arrays, out may be in.
+		void (*inverseArray)(const Mat44* in, Mat44* out, size_t count);
+		void (*inversePreciseArray)(const Mat44* in, Mat44* out, size_t count);
+		void (*inverseAffineArray)(const Mat44* in, Mat44* out, size_t count);
+		void (*inverseRigidArray)(const Mat44* in, Mat44* out, size_t count);
+		__m128 (*floor)(__m128 a);
+		__m128 (*ceil)(__m128 a);
+		// glsl mod, a - b * floor(a / b).
+		__m128 (*mod)(__m128 a, __m128 b);
+
+		// The Mat44 batch functions, on arrays of 4 floats per element or on separate x, y and z streams.
+		void (*transform)(const Mat44& matrix, const float* in, float* out, size_t count);
+		void (*transformPoints)(const Mat44& matrix, const float* in, float* out, size_t count);
+		void (*transformDirections)(const Mat44& matrix, const float* in, float* out, size_t count);
+		void (*projectPoints)(const Mat44& matrix, const float* in, float* out, size_t count);
+		void (*transformPointStreams)(const Mat44& matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count);
+		void (*transformDirectionStreams)(const Mat44& matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count);
+		void (*projectPointStreams)(const Mat44& matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count);
+
+		// Frustum culling against 6 planes (normal, distance) of streams x, y, z, radius or center x, y, z, extent x, y, z. See Frustum.
+		size_t (*cullSpheres)(const Vec* planes, const float* const* streams, size_t count, unsigned int* visibleBits, unsigned int* visibleIndices);
+		size_t (*cullBoxes)(const Vec* planes, const float* const* streams, size_t count, unsigned int* visibleBits, unsigned int* visibleIndices);
+
+		// worlds[n] = locals[n] * worlds[parents[n]] for each n in nodes, in order. Nodes whose parent is ~0u copy their local matrix.
+		void (*multiplyHierarchy)(const Mat44* locals, const unsigned int* parents, Mat44* worlds, const unsigned int* nodes, size_t count);
+
+		// Transcendentals on arrays, see tt_math.h for their accuracy. out may be an input.
+		// Single vectors inline the 4 lane version of tt_cgmath_lanes.h instead, a call through the table costs more than the polynomial.
+		void (*sinArray)(const float* in, float* out, size_t count);
+		void (*cosArray)(const float* in, float* out, size_t count);
+		void (*sincosArray)(const float* in, float* sinOut, float* cosOut, size_t count);
+		void (*expArray)(const float* in, float* out, size_t count);
+		void (*logArray)(const float* in, float* out, size_t count);
+		void (*atan2Array)(const float* y, const float* x, float* out, size_t count);
+
+		// Compact vertex data, see tt_packing.h.
+		void (*floatToF16)(const float* in, f16* out, size_t count);
+		void (*f16ToFloat)(const f16* in, float* out, size_t count);
+		void (*floatToSnorm16)(const float* in, snorm16* out, size_t count);
+		void (*snorm16ToFloat)(const snorm16* in, float* out, size_t count);
+		void (*floatToUnorm8)(const float* in, unorm8* out, size_t count);
+		void (*unorm8ToFloat)(const unorm8* in, float* out, size_t count);
+		void (*encodeOctahedral)(const Vec3* in, octahedral16* out, size_t count);
+		void (*decodeOctahedral)(const octahedral16* in, Vec3* out, size_t count);
+
+		// Animation sampling, see AnimationClip. Per track the SAMPLE_STREAMS streams hold two keys and the weight between them
+		// for translation, rotation and scale, out[n] = Mat44::TRS(lerp(translation), slerp(rotation), lerp(scale)) of track n.
+		void (*sampleTRS)(const float* const* streams, size_t count, Mat44* out);
+
+		// Linear blend skinning, see tt_skinning.h. Positions and normals have 4 floats per vertex, normals are skipped when either is null.
+		void (*skin)(const Mat44* palette, const u16* joints, const float* weights, const float* positions, const float* normals, float* outPositions, float* outNormals, size_t count);
+		// The same on streams, in and out hold x, y and z of the positions, followed by those of the normals when normals is set.
+		void (*skinStreams)(const Mat44* palette, const u16* joints, const float* weights, const float* const* in, float* const* out, bool normals, size_t count);
+	};
+
+	// Stream indices of sampleTRS, the first of each x, y, z(, w) group.
+	enum SampleStream {
+		TRANSLATION_A = 0,
+		TRANSLATION_B = 3,
+		TRANSLATION_WEIGHT = 6,
+		ROTATION_A = 7,
+		ROTATION_B = 11,
+		ROTATION_WEIGHT = 15,
+		SCALE_A = 16,
+		SCALE_B = 19,
+		SCALE_WEIGHT = 22,
+		SAMPLE_STREAMS = 23,
+	};
+
+	extern const CGMathKernels CGMATH_KERNELS_SSE2;
+	extern const CGMathKernels CGMATH_KERNELS_AVX2;
+	extern const CGMathKernels* cgmathKernels;
+}
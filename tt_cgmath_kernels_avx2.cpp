@@ -0,0 +1,7 @@
+// The AVX2 / FMA build of tt_cgmath_kernels.cpp, this file must be compiled with /arch:AVX2 (or -mavx2 -mfma -mf16c).
+// Only cgmath code reached through CGMATH_KERNELS_AVX2 may live here: anything inline shared with other files could be
+// emitted with AVX2 instructions here and picked by the linker for the whole program. That includes std templates (std::copy,
+// std::popcount) and inline members of the cgmath types that are not inlined in debug builds, and namespace scope SIMD constants,
+// which are initialized at startup. `nm -C` on the object should list no weak (W) symbols and no _GLOBAL__sub_I initializer.
+#define TT_CGMATH_KERNELS_AVX2_BUILD
+#include "tt_cgmath_kernels.cpp"
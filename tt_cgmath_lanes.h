@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cmath>
+#include <immintrin.h>
+
+// The SIMD polynomials behind TT::sin, cos, sincos, exp, log and atan2, shared by tt_math.cpp (4 lanes, inlined for single vectors)
+// and the kernels (the array forms, 8 lanes in the AVX2 build). Internal to cgmath, include it only from .cpp files.
+
+// MSVC does not define __FMA__ and __F16C__, /arch:AVX2 implies them.
+#if defined(__AVX2__) && ((defined(__FMA__) && defined(__F16C__)) || defined(_MSC_VER))
+#define TT_CGMATH_AVX2
+#endif
+
+namespace TT {
+	// Internal linkage, so every file gets its own copy for the instruction set it is compiled for, see tt_cgmath_kernels_avx2.cpp.
+	namespace {
+		// The transcendentals are written once against these lane types: 4 lanes, and 8 in the AVX2 build.
+		struct Lanes4 {
+			typedef __m128 R;
+			typedef __m128i I;
+			static R set(float s) { return _mm_set1_ps(s); }
+			static I setInt(int s) { return _mm_set1_epi32(s); }
+			static R load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, R a) { _mm_storeu_ps(p, a); }
+			static R add(R a, R b) { return _mm_add_ps(a, b); }
+			static R sub(R a, R b) { return _mm_sub_ps(a, b); }
+			static R mul(R a, R b) { return _mm_mul_ps(a, b); }
+			static R div(R a, R b) { return _mm_div_ps(a, b); }
+			static R sqrt(R a) { return _mm_sqrt_ps(a); }
+#ifdef TT_CGMATH_AVX2
+			static R mulAdd(R a, R b, R c) { return _mm_fmadd_ps(a, b, c); }
+			static R negMulAdd(R a, R b, R c) { return _mm_fnmadd_ps(a, b, c); }
+#else
+			static R mulAdd(R a, R b, R c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+			static R negMulAdd(R a, R b, R c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+#endif
+			static R min(R a, R b) { return _mm_min_ps(a, b); }
+			static R max(R a, R b) { return _mm_max_ps(a, b); }
+			static R bitAnd(R a, R b) { return _mm_and_ps(a, b); }
+			static R bitAndNot(R a, R b) { return _mm_andnot_ps(a, b); }
+			static R bitXor(R a, R b) { return _mm_xor_ps(a, b); }
+			static R less(R a, R b) { return _mm_cmplt_ps(a, b); }
+			static R greater(R a, R b) { return _mm_cmpgt_ps(a, b); }
+			static R equal(R a, R b) { return _mm_cmpeq_ps(a, b); }
+			static R unordered(R a, R b) { return _mm_cmpunord_ps(a, b); }
+			// Lanes of a where mask is set, else of b.
+			static R select(R mask, R a, R b) {
+#ifdef TT_CGMATH_AVX2
+				return _mm_blendv_ps(b, a, mask);
+#else
+				return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+#endif
+			}
+			static I truncate(R a) { return _mm_cvttps_epi32(a); }
+			static I round(R a) { return _mm_cvtps_epi32(a); }
+			static R toFloat(I a) { return _mm_cvtepi32_ps(a); }
+			static R asFloat(I a) { return _mm_castsi128_ps(a); }
+			static I asInt(R a) { return _mm_castps_si128(a); }
+			static I addInt(I a, I b) { return _mm_add_epi32(a, b); }
+			static I subInt(I a, I b) { return _mm_sub_epi32(a, b); }
+			static I andInt(I a, I b) { return _mm_and_si128(a, b); }
+			static I andNotInt(I a, I b) { return _mm_andnot_si128(a, b); }
+			static I equalInt(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+			template<int n> static I shiftLeft(I a) { return _mm_slli_epi32(a, n); }
+			template<int n> static I shiftRight(I a) { return _mm_srli_epi32(a, n); }
+			template<int n> static I shiftRightSigned(I a) { return _mm_srai_epi32(a, n); }
+		};
+
+#ifdef TT_CGMATH_AVX2
+		struct Lanes8 {
+			typedef __m256 R;
+			typedef __m256i I;
+			static R set(float s) { return _mm256_set1_ps(s); }
+			static I setInt(int s) { return _mm256_set1_epi32(s); }
+			static R load(const float* p) { return _mm256_loadu_ps(p); }
+			static void store(float* p, R a) { _mm256_storeu_ps(p, a); }
+			static R add(R a, R b) { return _mm256_add_ps(a, b); }
+			static R sub(R a, R b) { return _mm256_sub_ps(a, b); }
+			static R mul(R a, R b) { return _mm256_mul_ps(a, b); }
+			static R div(R a, R b) { return _mm256_div_ps(a, b); }
+			static R sqrt(R a) { return _mm256_sqrt_ps(a); }
+			static R mulAdd(R a, R b, R c) { return _mm256_fmadd_ps(a, b, c); }
+			static R negMulAdd(R a, R b, R c) { return _mm256_fnmadd_ps(a, b, c); }
+			static R min(R a, R b) { return _mm256_min_ps(a, b); }
+			static R max(R a, R b) { return _mm256_max_ps(a, b); }
+			static R bitAnd(R a, R b) { return _mm256_and_ps(a, b); }
+			static R bitAndNot(R a, R b) { return _mm256_andnot_ps(a, b); }
+			static R bitXor(R a, R b) { return _mm256_xor_ps(a, b); }
+			static R less(R a, R b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static R greater(R a, R b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static R equal(R a, R b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+			static R unordered(R a, R b) { return _mm256_cmp_ps(a, b, _CMP_UNORD_Q); }
+			static R select(R mask, R a, R b) { return _mm256_blendv_ps(b, a, mask); }
+			static I truncate(R a) { return _mm256_cvttps_epi32(a); }
+			static I round(R a) { return _mm256_cvtps_epi32(a); }
+			static R toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+			static R asFloat(I a) { return _mm256_castsi256_ps(a); }
+			static I asInt(R a) { return _mm256_castps_si256(a); }
+			static I addInt(I a, I b) { return _mm256_add_epi32(a, b); }
+			static I subInt(I a, I b) { return _mm256_sub_epi32(a, b); }
+			static I andInt(I a, I b) { return _mm256_and_si256(a, b); }
+			static I andNotInt(I a, I b) { return _mm256_andnot_si256(a, b); }
+			static I equalInt(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+			template<int n> static I shiftLeft(I a) { return _mm256_slli_epi32(a, n); }
+			template<int n> static I shiftRight(I a) { return _mm256_srli_epi32(a, n); }
+			template<int n> static I shiftRightSigned(I a) { return _mm256_srai_epi32(a, n); }
+		};
+#endif
+
+		// Cephes style: reduce to [-pi/4, pi/4] around the nearest multiple of pi/2 (with pi/4 split in three so the reduction is exact
+		// for |a| below about 8192) and evaluate the sine or cosine polynomial depending on the octant.
+		template<typename L> void sinCosLanes(typename L::R a, typename L::R* sinOut, typename L::R* cosOut) {
+			typedef typename L::R R;
+			typedef typename L::I I;
+			R signMask = L::set(-0.0f);
+			R x = L::bitAndNot(signMask, a);
+			I octant = L::truncate(L::mul(x, L::set(1.27323954473516f)));
+			octant = L::andInt(L::addInt(octant, L::setInt(1)), L::setInt(~1));
+			R y = L::toFloat(octant);
+			x = L::negMulAdd(y, L::set(0.78515625f), x);
+			x = L::negMulAdd(y, L::set(2.4187564849853515625e-4f), x);
+			x = L::negMulAdd(y, L::set(3.77489497744594108e-8f), x);
+			R z = L::mul(x, x);
+
+			R s = L::mulAdd(L::mulAdd(L::set(-1.9515295891e-4f), z, L::set(8.3321608736e-3f)), z, L::set(-1.6666654611e-1f));
+			s = L::mulAdd(L::mul(s, z), x, x);
+			R c = L::mulAdd(L::mulAdd(L::set(2.443315711809948e-5f), z, L::set(-1.388731625493765e-3f)), z, L::set(4.166664568298827e-2f));
+			c = L::add(L::negMulAdd(L::set(0.5f), z, L::mul(L::mul(c, z), z)), L::set(1.0f));
+
+			// Octants 2 and 6 (after rounding up to even) swap the polynomials, 4 and 6 flip the sine, 2 and 4 the cosine.
+			R swap = L::asFloat(L::equalInt(L::andInt(octant, L::setInt(2)), L::setInt(2)));
+			if (sinOut) {
+				R sign = L::bitXor(L::bitAnd(a, signMask), L::asFloat(L::template shiftLeft<29>(L::andInt(octant, L::setInt(4)))));
+				*sinOut = L::bitXor(L::select(swap, c, s), sign);
+			}
+			if (cosOut) {
+				R sign = L::asFloat(L::template shiftLeft<29>(L::andNotInt(L::subInt(octant, L::setInt(2)), L::setInt(4))));
+				*cosOut = L::bitXor(L::select(swap, s, c), sign);
+			}
+		}
+
+		template<typename L> typename L::R sinLanes(typename L::R a) {
+			typename L::R s;
+			sinCosLanes<L>(a, &s, nullptr);
+			return s;
+		}
+
+		template<typename L> typename L::R cosLanes(typename L::R a) {
+			typename L::R c;
+			sinCosLanes<L>(a, nullptr, &c);
+			return c;
+		}
+
+		// 2^n * e^r with |r| <= ln(2) / 2. 2^n is applied in two steps so results down to the denormals and up to the overflow are exact.
+		template<typename L> typename L::R expLanes(typename L::R a) {
+			typedef typename L::R R;
+			typedef typename L::I I;
+			R x = L::min(L::max(a, L::set(-104.0f)), L::set(89.0f));
+			I n = L::round(L::mul(x, L::set(1.44269504088896341f)));
+			R fn = L::toFloat(n);
+			x = L::negMulAdd(fn, L::set(0.693359375f), x);
+			x = L::negMulAdd(fn, L::set(-2.12194440e-4f), x);
+			R p = L::mulAdd(L::set(1.9875691500e-4f), x, L::set(1.3981999507e-3f));
+			p = L::mulAdd(p, x, L::set(8.3334519073e-3f));
+			p = L::mulAdd(p, x, L::set(4.1665795894e-2f));
+			p = L::mulAdd(p, x, L::set(1.6666665459e-1f));
+			p = L::mulAdd(p, x, L::set(5.0000001201e-1f));
+			p = L::add(L::mulAdd(p, L::mul(x, x), x), L::set(1.0f));
+			I half = L::template shiftRightSigned<1>(n);
+			R scaleA = L::asFloat(L::template shiftLeft<23>(L::addInt(half, L::setInt(127))));
+			R scaleB = L::asFloat(L::template shiftLeft<23>(L::addInt(L::subInt(n, half), L::setInt(127))));
+			R e = L::mul(L::mul(p, scaleA), scaleB);
+			return L::select(L::unordered(a, a), a, e);
+		}
+
+		// Splits a into 2^e * m with m in [sqrt(0.5), sqrt(2)) and evaluates log(m) with a polynomial in m - 1.
+		template<typename L> typename L::R logLanes(typename L::R a) {
+			typedef typename L::R R;
+			typedef typename L::I I;
+			// Denormals are scaled into the normal range first.
+			R denormal = L::less(a, L::set(1.17549435e-38f));
+			R x = L::select(denormal, L::mul(a, L::set(8388608.0f)), a);
+			I bits = L::asInt(x);
+			R e = L::toFloat(L::subInt(L::template shiftRight<23>(bits), L::setInt(126)));
+			e = L::select(denormal, L::sub(e, L::set(23.0f)), e);
+			R m = L::asFloat(L::addInt(L::andInt(bits, L::setInt(0x007fffff)), L::setInt(0x3f000000)));
+			R small = L::less(m, L::set(0.707106781186547524f));
+			e = L::select(small, L::sub(e, L::set(1.0f)), e);
+			x = L::sub(L::add(m, L::bitAnd(small, m)), L::set(1.0f));
+			R z = L::mul(x, x);
+			R p = L::mulAdd(L::set(7.0376836292e-2f), x, L::set(-1.1514610310e-1f));
+			p = L::mulAdd(p, x, L::set(1.1676998740e-1f));
+			p = L::mulAdd(p, x, L::set(-1.2420140846e-1f));
+			p = L::mulAdd(p, x, L::set(1.4249322787e-1f));
+			p = L::mulAdd(p, x, L::set(-1.6668057665e-1f));
+			p = L::mulAdd(p, x, L::set(2.0000714765e-1f));
+			p = L::mulAdd(p, x, L::set(-2.4999993993e-1f));
+			p = L::mulAdd(p, x, L::set(3.3333331174e-1f));
+			R y = L::mul(L::mul(p, x), z);
+			y = L::mulAdd(e, L::set(-2.12194440e-4f), y);
+			y = L::negMulAdd(L::set(0.5f), z, y);
+			R r = L::mulAdd(e, L::set(0.693359375f), L::add(x, y));
+			// log(0) = -inf, log(inf) = inf, negative numbers and NaN give NaN.
+			r = L::select(L::equal(a, L::set(0.0f)), L::set(-INFINITY), r);
+			r = L::select(L::equal(a, L::set(INFINITY)), a, r);
+			return L::select(L::less(a, L::set(0.0f)), L::set(NAN), L::select(L::unordered(a, a), a, r));
+		}
+
+		// atan of min(|x|, |y|) / max(|x|, |y|) in [0, 1], mirrored into the right octant.
+		template<typename L> typename L::R atan2Lanes(typename L::R y, typename L::R x) {
+			typedef typename L::R R;
+			R signMask = L::set(-0.0f);
+			R ax = L::bitAndNot(signMask, x);
+			R ay = L::bitAndNot(signMask, y);
+			R low = L::min(ax, ay);
+			R high = L::max(ax, ay);
+			// 0 / 0 gives 0 and inf / inf 1, like atan2 does for those.
+			R t = L::div(low, high);
+			t = L::select(L::equal(low, high), L::set(1.0f), t);
+			t = L::select(L::equal(high, L::set(0.0f)), L::set(0.0f), t);
+			R upper = L::greater(t, L::set(0.4142135623730950f));
+			R offset = L::bitAnd(upper, L::set(0.785398163397448f));
+			t = L::select(upper, L::div(L::sub(t, L::set(1.0f)), L::add(t, L::set(1.0f))), t);
+			R z = L::mul(t, t);
+			R p = L::mulAdd(L::set(8.05374449538e-2f), z, L::set(-1.38776856032e-1f));
+			p = L::mulAdd(p, z, L::set(1.99777106478e-1f));
+			p = L::mulAdd(p, z, L::set(-3.33329491539e-1f));
+			// The constants are split into the nearest float and its rounding error, which is added to the small term first.
+			R r = L::add(offset, L::add(L::mulAdd(L::mul(p, z), t, t), L::bitAnd(upper, L::set(-2.18556950e-8f))));
+			r = L::select(L::greater(ay, ax), L::add(L::sub(L::set(1.57079632679489662f), r), L::set(-4.37113901e-8f)), r);
+			// Sign bit of x spread over the lane, so -0 counts as negative.
+			R negativeX = L::asFloat(L::template shiftRightSigned<31>(L::asInt(x)));
+			r = L::select(negativeX, L::add(L::sub(L::set(3.14159265358979324f), r), L::set(-8.74227801e-8f)), r);
+			r = L::bitXor(r, L::bitAnd(y, signMask));
+			return L::select(L::unordered(x, y), L::add(x, y), r);
+		}
+	}
+}
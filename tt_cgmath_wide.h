@@ -0,0 +1,210 @@
+#pragma once
+
+#include <immintrin.h>
+#include "tt_cgmath.h"
+
+// Structure of arrays vectors: 4 or 8 Vec3s as separate x, y and z registers, so every lane does useful work
+// instead of 3 of 4 as with Vec. Use them for kernels over many vectors (particles, skinning, collision).
+// Defined inline, their functions are only a few instructions each.
+//
+// Vec3x8 needs AVX in the including translation unit (/arch:AVX2, -mavx2 or TT_NATIVE) and a CPU that runs it,
+// Vec3xN is the widest type the translation unit is compiled for.
+namespace TT {
+	struct Vec3x4 {
+		static constexpr size_t WIDTH = 4;
+
+		__m128 x;
+		__m128 y;
+		__m128 z;
+
+		Vec3x4() : x(_mm_setzero_ps()), y(_mm_setzero_ps()), z(_mm_setzero_ps()) {}
+		Vec3x4(__m128 x, __m128 y, __m128 z) : x(x), y(y), z(z) {}
+		// All lanes the same vector.
+		explicit Vec3x4(const Vec& v) : x(_mm_set_ps1(v.x)), y(_mm_set_ps1(v.y)), z(_mm_set_ps1(v.z)) {}
+
+		// From and to AoS arrays, count < WIDTH handles the tail of an array, missing lanes load as 0 and are not stored.
+		static Vec3x4 load(const Vec3* v) {
+			return transposed(_mm_load_ps(&v[0].x), _mm_load_ps(&v[1].x), _mm_load_ps(&v[2].x), _mm_load_ps(&v[3].x));
+		}
+		static Vec3x4 load(const Vec3* v, size_t count) {
+			__m128 lanes[WIDTH] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (size_t i = 0; i < count && i < WIDTH; ++i)
+				lanes[i] = _mm_load_ps(&v[i].x);
+			return transposed(lanes[0], lanes[1], lanes[2], lanes[3]);
+		}
+		// Writes w = 0. The Vec constructors and conversions are not inline, so the arrays are accessed through their floats.
+		void store(Vec3* v) const {
+			__m128 a = x, b = y, c = z, d = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			_mm_store_ps(&v[0].x, a);
+			_mm_store_ps(&v[1].x, b);
+			_mm_store_ps(&v[2].x, c);
+			_mm_store_ps(&v[3].x, d);
+		}
+		void store(Vec3* v, size_t count) const {
+			__m128 lanes[WIDTH] = { x, y, z, _mm_setzero_ps() };
+			_MM_TRANSPOSE4_PS(lanes[0], lanes[1], lanes[2], lanes[3]);
+			for (size_t i = 0; i < count && i < WIDTH; ++i)
+				_mm_store_ps(&v[i].x, lanes[i]);
+		}
+		// From and to separate x, y and z streams, which need no transpose.
+		static Vec3x4 load(const float* x, const float* y, const float* z) { return { _mm_loadu_ps(x), _mm_loadu_ps(y), _mm_loadu_ps(z) }; }
+		void store(float* outX, float* outY, float* outZ) const {
+			_mm_storeu_ps(outX, x);
+			_mm_storeu_ps(outY, y);
+			_mm_storeu_ps(outZ, z);
+		}
+		// Lane i of the result is (a[i], b[i], c[i]), the w of the inputs is ignored.
+		static Vec3x4 transposed(__m128 a, __m128 b, __m128 c, __m128 d) {
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			return { a, b, c };
+		}
+		Vec3 lane(size_t i) const {
+			alignas(16) float lx[WIDTH], ly[WIDTH], lz[WIDTH];
+			_mm_store_ps(lx, x);
+			_mm_store_ps(ly, y);
+			_mm_store_ps(lz, z);
+			return Vec3(lx[i], ly[i], lz[i]);
+		}
+
+		Vec3x4 operator-() const { return { _mm_sub_ps(_mm_setzero_ps(), x), _mm_sub_ps(_mm_setzero_ps(), y), _mm_sub_ps(_mm_setzero_ps(), z) }; }
+		Vec3x4 operator+(const Vec3x4& b) const { return { _mm_add_ps(x, b.x), _mm_add_ps(y, b.y), _mm_add_ps(z, b.z) }; }
+		Vec3x4 operator-(const Vec3x4& b) const { return { _mm_sub_ps(x, b.x), _mm_sub_ps(y, b.y), _mm_sub_ps(z, b.z) }; }
+		Vec3x4 operator*(const Vec3x4& b) const { return { _mm_mul_ps(x, b.x), _mm_mul_ps(y, b.y), _mm_mul_ps(z, b.z) }; }
+		Vec3x4 operator/(const Vec3x4& b) const { return { _mm_div_ps(x, b.x), _mm_div_ps(y, b.y), _mm_div_ps(z, b.z) }; }
+		// Per lane scalars.
+		Vec3x4 operator*(__m128 s) const { return { _mm_mul_ps(x, s), _mm_mul_ps(y, s), _mm_mul_ps(z, s) }; }
+		Vec3x4 operator/(__m128 s) const { return { _mm_div_ps(x, s), _mm_div_ps(y, s), _mm_div_ps(z, s) }; }
+		Vec3x4 operator*(float s) const { return *this * _mm_set_ps1(s); }
+		Vec3x4 operator/(float s) const { return *this * _mm_set_ps1(1.0f / s); }
+		Vec3x4& operator+=(const Vec3x4& b) { return *this = *this + b; }
+		Vec3x4& operator-=(const Vec3x4& b) { return *this = *this - b; }
+		Vec3x4& operator*=(const Vec3x4& b) { return *this = *this * b; }
+		Vec3x4& operator*=(__m128 s) { return *this = *this * s; }
+		Vec3x4& operator*=(float s) { return *this = *this * s; }
+
+		__m128 dot(const Vec3x4& b) const { return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, b.x), _mm_mul_ps(y, b.y)), _mm_mul_ps(z, b.z)); }
+		Vec3x4 cross(const Vec3x4& b) const {
+			return {
+				_mm_sub_ps(_mm_mul_ps(y, b.z), _mm_mul_ps(z, b.y)),
+				_mm_sub_ps(_mm_mul_ps(z, b.x), _mm_mul_ps(x, b.z)),
+				_mm_sub_ps(_mm_mul_ps(x, b.y), _mm_mul_ps(y, b.x)),
+			};
+		}
+		__m128 sqrLen() const { return dot(*this); }
+		__m128 len() const { return _mm_sqrt_ps(sqrLen()); }
+		// rsqrt with a Newton step (about 22 bits), zero vectors become NaN like Vec::normalized().
+		Vec3x4 normalized() const {
+			__m128 sq = sqrLen();
+			__m128 r = _mm_rsqrt_ps(sq);
+			r = _mm_mul_ps(_mm_mul_ps(_mm_set_ps1(0.5f), r), _mm_sub_ps(_mm_set_ps1(3.0f), _mm_mul_ps(_mm_mul_ps(sq, r), r)));
+			return *this * r;
+		}
+		Vec3x4 min(const Vec3x4& b) const { return { _mm_min_ps(x, b.x), _mm_min_ps(y, b.y), _mm_min_ps(z, b.z) }; }
+		Vec3x4 max(const Vec3x4& b) const { return { _mm_max_ps(x, b.x), _mm_max_ps(y, b.y), _mm_max_ps(z, b.z) }; }
+		static Vec3x4 lerp(const Vec3x4& a, const Vec3x4& b, __m128 t) { return a + (b - a) * t; }
+		static Vec3x4 lerp(const Vec3x4& a, const Vec3x4& b, float t) { return lerp(a, b, _mm_set_ps1(t)); }
+		// Lanes of a where mask is all 1 bits (e.g. from _mm_cmplt_ps), else of b.
+		static Vec3x4 select(__m128 mask, const Vec3x4& a, const Vec3x4& b) {
+			return { _mm_or_ps(_mm_and_ps(mask, a.x), _mm_andnot_ps(mask, b.x)), _mm_or_ps(_mm_and_ps(mask, a.y), _mm_andnot_ps(mask, b.y)), _mm_or_ps(_mm_and_ps(mask, a.z), _mm_andnot_ps(mask, b.z)) };
+		}
+	};
+
+#ifdef __AVX__
+	struct Vec3x8 {
+		static constexpr size_t WIDTH = 8;
+
+		__m256 x;
+		__m256 y;
+		__m256 z;
+
+		Vec3x8() : x(_mm256_setzero_ps()), y(_mm256_setzero_ps()), z(_mm256_setzero_ps()) {}
+		Vec3x8(__m256 x, __m256 y, __m256 z) : x(x), y(y), z(z) {}
+		explicit Vec3x8(const Vec& v) : x(_mm256_set1_ps(v.x)), y(_mm256_set1_ps(v.y)), z(_mm256_set1_ps(v.z)) {}
+		// Lanes 0-3 from low, 4-7 from high.
+		Vec3x8(const Vec3x4& low, const Vec3x4& high) :
+			x(_mm256_insertf128_ps(_mm256_castps128_ps256(low.x), high.x, 1)),
+			y(_mm256_insertf128_ps(_mm256_castps128_ps256(low.y), high.y, 1)),
+			z(_mm256_insertf128_ps(_mm256_castps128_ps256(low.z), high.z, 1)) {}
+
+		static Vec3x8 load(const Vec3* v) {
+			// Vectors i and i + 4 share a register, so one in-lane 4x4 transpose handles both halves.
+			__m256 a = _mm256_loadu2_m128(&v[4].x, &v[0].x), b = _mm256_loadu2_m128(&v[5].x, &v[1].x);
+			__m256 c = _mm256_loadu2_m128(&v[6].x, &v[2].x), d = _mm256_loadu2_m128(&v[7].x, &v[3].x);
+			__m256 ab0 = _mm256_unpacklo_ps(a, b), ab1 = _mm256_unpackhi_ps(a, b);
+			__m256 cd0 = _mm256_unpacklo_ps(c, d), cd1 = _mm256_unpackhi_ps(c, d);
+			return { _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2)), _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0)) };
+		}
+		static Vec3x8 load(const Vec3* v, size_t count) {
+			return count >= WIDTH ? load(v) : Vec3x8(Vec3x4::load(v, count), count > 4 ? Vec3x4::load(v + 4, count - 4) : Vec3x4());
+		}
+		void store(Vec3* v) const {
+			__m256 xy0 = _mm256_unpacklo_ps(x, y), xy1 = _mm256_unpackhi_ps(x, y);
+			__m256 z0 = _mm256_unpacklo_ps(z, _mm256_setzero_ps()), z1 = _mm256_unpackhi_ps(z, _mm256_setzero_ps());
+			__m256 a = _mm256_shuffle_ps(xy0, z0, _MM_SHUFFLE(1, 0, 1, 0)), b = _mm256_shuffle_ps(xy0, z0, _MM_SHUFFLE(3, 2, 3, 2));
+			__m256 c = _mm256_shuffle_ps(xy1, z1, _MM_SHUFFLE(1, 0, 1, 0)), d = _mm256_shuffle_ps(xy1, z1, _MM_SHUFFLE(3, 2, 3, 2));
+			_mm256_storeu2_m128(&v[4].x, &v[0].x, a);
+			_mm256_storeu2_m128(&v[5].x, &v[1].x, b);
+			_mm256_storeu2_m128(&v[6].x, &v[2].x, c);
+			_mm256_storeu2_m128(&v[7].x, &v[3].x, d);
+		}
+		void store(Vec3* v, size_t count) const {
+			if (count >= WIDTH)
+				return store(v);
+			low().store(v, count);
+			if (count > 4)
+				high().store(v + 4, count - 4);
+		}
+		static Vec3x8 load(const float* x, const float* y, const float* z) { return { _mm256_loadu_ps(x), _mm256_loadu_ps(y), _mm256_loadu_ps(z) }; }
+		void store(float* outX, float* outY, float* outZ) const {
+			_mm256_storeu_ps(outX, x);
+			_mm256_storeu_ps(outY, y);
+			_mm256_storeu_ps(outZ, z);
+		}
+		Vec3x4 low() const { return { _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z) }; }
+		Vec3x4 high() const { return { _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1) }; }
+		Vec3 lane(size_t i) const { return i < 4 ? low().lane(i) : high().lane(i - 4); }
+
+		Vec3x8 operator-() const { return { _mm256_sub_ps(_mm256_setzero_ps(), x), _mm256_sub_ps(_mm256_setzero_ps(), y), _mm256_sub_ps(_mm256_setzero_ps(), z) }; }
+		Vec3x8 operator+(const Vec3x8& b) const { return { _mm256_add_ps(x, b.x), _mm256_add_ps(y, b.y), _mm256_add_ps(z, b.z) }; }
+		Vec3x8 operator-(const Vec3x8& b) const { return { _mm256_sub_ps(x, b.x), _mm256_sub_ps(y, b.y), _mm256_sub_ps(z, b.z) }; }
+		Vec3x8 operator*(const Vec3x8& b) const { return { _mm256_mul_ps(x, b.x), _mm256_mul_ps(y, b.y), _mm256_mul_ps(z, b.z) }; }
+		Vec3x8 operator/(const Vec3x8& b) const { return { _mm256_div_ps(x, b.x), _mm256_div_ps(y, b.y), _mm256_div_ps(z, b.z) }; }
+		Vec3x8 operator*(__m256 s) const { return { _mm256_mul_ps(x, s), _mm256_mul_ps(y, s), _mm256_mul_ps(z, s) }; }
+		Vec3x8 operator/(__m256 s) const { return { _mm256_div_ps(x, s), _mm256_div_ps(y, s), _mm256_div_ps(z, s) }; }
+		Vec3x8 operator*(float s) const { return *this * _mm256_set1_ps(s); }
+		Vec3x8 operator/(float s) const { return *this * _mm256_set1_ps(1.0f / s); }
+		Vec3x8& operator+=(const Vec3x8& b) { return *this = *this + b; }
+		Vec3x8& operator-=(const Vec3x8& b) { return *this = *this - b; }
+		Vec3x8& operator*=(const Vec3x8& b) { return *this = *this * b; }
+		Vec3x8& operator*=(__m256 s) { return *this = *this * s; }
+		Vec3x8& operator*=(float s) { return *this = *this * s; }
+
+		__m256 dot(const Vec3x8& b) const { return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, b.x), _mm256_mul_ps(y, b.y)), _mm256_mul_ps(z, b.z)); }
+		Vec3x8 cross(const Vec3x8& b) const {
+			return {
+				_mm256_sub_ps(_mm256_mul_ps(y, b.z), _mm256_mul_ps(z, b.y)),
+				_mm256_sub_ps(_mm256_mul_ps(z, b.x), _mm256_mul_ps(x, b.z)),
+				_mm256_sub_ps(_mm256_mul_ps(x, b.y), _mm256_mul_ps(y, b.x)),
+			};
+		}
+		__m256 sqrLen() const { return dot(*this); }
+		__m256 len() const { return _mm256_sqrt_ps(sqrLen()); }
+		Vec3x8 normalized() const {
+			__m256 sq = sqrLen();
+			__m256 r = _mm256_rsqrt_ps(sq);
+			r = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), r), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(sq, r), r)));
+			return *this * r;
+		}
+		Vec3x8 min(const Vec3x8& b) const { return { _mm256_min_ps(x, b.x), _mm256_min_ps(y, b.y), _mm256_min_ps(z, b.z) }; }
+		Vec3x8 max(const Vec3x8& b) const { return { _mm256_max_ps(x, b.x), _mm256_max_ps(y, b.y), _mm256_max_ps(z, b.z) }; }
+		static Vec3x8 lerp(const Vec3x8& a, const Vec3x8& b, __m256 t) { return a + (b - a) * t; }
+		static Vec3x8 lerp(const Vec3x8& a, const Vec3x8& b, float t) { return lerp(a, b, _mm256_set1_ps(t)); }
+		static Vec3x8 select(__m256 mask, const Vec3x8& a, const Vec3x8& b) { return { _mm256_blendv_ps(b.x, a.x, mask), _mm256_blendv_ps(b.y, a.y, mask), _mm256_blendv_ps(b.z, a.z, mask) }; }
+	};
+
+	using Vec3xN = Vec3x8;
+#else
+	using Vec3xN = Vec3x4;
+#endif
+}
@@ -0,0 +1,163 @@
+#include "tt_config_reloader.h"
+#include "tt_files.h"
+#include <algorithm>
+
+namespace {
+	bool scalarEquals(const TTJson::Value& a, const TTJson::Value& b) {
+		switch (a.getType()) {
+		case TTJson::ValueType::Bool:
+			return a.asBool() == b.asBool();
+		case TTJson::ValueType::Int:
+			return a.asInt() == b.asInt();
+		case TTJson::ValueType::Double: {
+			// NaN never equals itself, but reloading a file containing NaN is not a change.
+			TTJson::scalar x = a.asDouble();
+			TTJson::scalar y = b.asDouble();
+			return x == y || (x != x && y != y);
+		}
+		case TTJson::ValueType::String:
+			return a.asString() == b.asString();
+		default:
+			return true;
+		}
+	}
+
+	TTJson::str_t indexToken(size_t index) {
+#ifdef TT_JSON5_USE_WSTR
+		return std::to_wstring(index);
+#else
+		return std::to_string(index);
+#endif
+	}
+
+	// The path is a scratch buffer that is restored before returning,
+	// so walking a large document does not allocate a string per node.
+	void diffRecursive(const TTJson::Value& before, const TTJson::Value& after, std::vector<TT::ConfigReloader::Diff>& outChanges, TTJson::str_t& path) {
+		typedef TT::ConfigReloader::Change Change;
+
+		if (before.getType() != after.getType()) {
+			outChanges.push_back({ path, Change::Modified, &before, &after });
+			return;
+		}
+
+		size_t pathSize = path.size();
+		if (before.isArray()) {
+			// Packed numbers are compared and reported as a whole instead of converting them to a Value per element.
+			if (before.isPacked() || after.isPacked()) {
+				bool equal = before.isPacked() && after.isPacked() &&
+					std::equal(before.ints().begin(), before.ints().end(), after.ints().begin(), after.ints().end()) &&
+					std::equal(before.doubles().begin(), before.doubles().end(), after.doubles().begin(), after.doubles().end());
+				if (!equal)
+					outChanges.push_back({ path, Change::Modified, &before, &after });
+				return;
+			}
+			const TTJson::Array& a = before.asArray();
+			const TTJson::Array& b = after.asArray();
+			size_t n = a.size() < b.size() ? a.size() : b.size();
+			for (size_t i = 0; i < n; ++i) {
+				TTJson::appendPathToken(path, indexToken(i));
+				diffRecursive(a[i], b[i], outChanges, path);
+				path.resize(pathSize);
+			}
+			for (size_t i = n; i < a.size(); ++i) {
+				TTJson::appendPathToken(path, indexToken(i));
+				outChanges.push_back({ path, Change::Removed, &a[i], nullptr });
+				path.resize(pathSize);
+			}
+			for (size_t i = n; i < b.size(); ++i) {
+				TTJson::appendPathToken(path, indexToken(i));
+				outChanges.push_back({ path, Change::Added, nullptr, &b[i] });
+				path.resize(pathSize);
+			}
+			return;
+		}
+
+		if (before.isObject()) {
+			const TTJson::Object& a = before.asObject();
+			const TTJson::Object& b = after.asObject();
+			for (const auto& pair : a) {
+				TTJson::appendPathToken(path, pair.first.str());
+				auto it = b.find(pair.first);
+				if (it == b.end())
+					outChanges.push_back({ path, Change::Removed, &pair.second, nullptr });
+				else
+					diffRecursive(pair.second, it->second, outChanges, path);
+				path.resize(pathSize);
+			}
+			for (const auto& pair : b) {
+				if (a.find(pair.first) != a.end())
+					continue;
+				TTJson::appendPathToken(path, pair.first.str());
+				outChanges.push_back({ path, Change::Added, nullptr, &pair.second });
+				path.resize(pathSize);
+			}
+			return;
+		}
+
+		if (!scalarEquals(before, after))
+			outChanges.push_back({ path, Change::Modified, &before, &after });
+	}
+
+	// True if one path is the other, or a parent of the other.
+	bool isRelated(const TTJson::str_t& a, const TTJson::str_t& b) {
+		const TTJson::str_t& shorter = a.size() < b.size() ? a : b;
+		const TTJson::str_t& longer = a.size() < b.size() ? b : a;
+		if (longer.compare(0, shorter.size(), shorter) != 0)
+			return false;
+		return longer.size() == shorter.size() || longer[shorter.size()] == '/';
+	}
+}
+
+namespace TT {
+	ConfigReloader::ConfigReloader(const std::string_view filePath) : filePath(filePath) {
+		lastWriteTime = fileLastWriteTime(this->filePath);
+		load(current);
+	}
+
+	bool ConfigReloader::load(TTJson::Value& result) {
+		TTJson::ifstream_t stream(filePath, std::ios::binary | std::ios::in);
+		TTJson::Parser parser;
+		parser.parse(stream, result);
+		if (parser.hasError()) {
+			error = parser.error();
+			return false;
+		}
+		error.clear();
+		return true;
+	}
+
+	bool ConfigReloader::poll() {
+		unsigned long long writeTime = fileLastWriteTime(filePath);
+		if (writeTime == lastWriteTime)
+			return false;
+		lastWriteTime = writeTime;
+
+		TTJson::Value next;
+		if (!load(next))
+			return false;
+
+		// Keep the previous document alive while emitting, the diffs point into it.
+		TTJson::Value previous = std::move(current);
+		current = std::move(next);
+
+		std::vector<Diff> changes;
+		diff(previous, current, changes);
+		for (const Diff& change : changes) {
+			changed.emit(change);
+			for (auto& pair : watchers) {
+				if (isRelated(pair.first, change.path))
+					pair.second.emit(change);
+			}
+		}
+		return !changes.empty();
+	}
+
+	ConfigReloader::DiffSignal& ConfigReloader::watch(const TTJson::str_t& path) {
+		return watchers[path];
+	}
+
+	void ConfigReloader::diff(const TTJson::Value& before, const TTJson::Value& after, std::vector<Diff>& outChanges, const TTJson::str_t& path) {
+		TTJson::str_t scratch = path;
+		diffRecursive(before, after, outChanges, scratch);
+	}
+}
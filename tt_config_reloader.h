@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "tt_json5.h"
+#include "tt_signals.h"
+
+namespace TT {
+	// Polls a json5 file and reloads it when its last write time changes.
+	// Instead of handing consumers a whole new tree, the old and new documents are diffed
+	// and a signal is emitted for every json pointer path that actually changed, e.g. "/render/shadows/size".
+	struct ConfigReloader {
+		enum class Change {
+			Added,
+			Removed,
+			Modified,
+		};
+
+		struct Diff {
+			// Json pointer (RFC 6901) to the changed value, the root is "".
+			TTJson::str_t path;
+			Change change;
+			// Null when the value was added.
+			const TTJson::Value* before;
+			// Null when the value was removed.
+			const TTJson::Value* after;
+		};
+
+		typedef Signal<const Diff&> DiffSignal;
+
+		// Loads the file immediately, nothing is emitted for the initial load.
+		ConfigReloader(const std::string_view filePath);
+
+		// Reloads the file if it was written to since the last poll and emits the differences.
+		// Returns true if anything changed. If the new file fails to parse the current document is kept
+		// and parseError() describes the problem, which is useful while someone is still typing in the file.
+		bool poll();
+
+		const TTJson::Value& document() const { return current; }
+		const TTJson::str_t& parseError() const { return error; }
+
+		// Emitted for every change.
+		DiffSignal changed;
+
+		// Returns a signal that is emitted only for changes at this path, inside this path,
+		// or to a parent of this path (e.g. when the containing object was replaced by a number).
+		DiffSignal& watch(const TTJson::str_t& path);
+
+		// Appends the minimal set of paths at which before and after differ.
+		// Diff pointers reference the given trees so they must outlive the result.
+		static void diff(const TTJson::Value& before, const TTJson::Value& after, std::vector<Diff>& outChanges, const TTJson::str_t& path = {});
+
+	private:
+		bool load(TTJson::Value& result);
+
+		std::string filePath;
+		unsigned long long lastWriteTime = 0;
+		TTJson::Value current;
+		TTJson::str_t error;
+		std::unordered_map<TTJson::str_t, DiffSignal> watchers;
+	};
+}
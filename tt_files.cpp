@@ -1,11 +1,13 @@
-#pragma once
-
 #include <unordered_set>
 #include <unordered_map>
 #include "tt_messages.h"
 #include "tt_files.h"
 #include "tt_strings.h"
+#ifdef _WIN32
 #include "windont.h"
+#else
+#include <filesystem>
+#endif
 
 namespace TT {
     std::string readAllBytes(const std::string_view filename) {
@@ -85,16 +87,29 @@ namespace TT {
     bool fileExists(const std::string_view filename) {
         if (filename == "") 
             return false;
+#ifdef _WIN32
         if (INVALID_FILE_ATTRIBUTES == GetFileAttributesA(filename.data()) && GetLastError() == ERROR_FILE_NOT_FOUND)
             return false;
         return true;
+#else
+        std::error_code error;
+        return std::filesystem::exists(filename, error);
+#endif
     }
 
     unsigned long long fileLastWriteTime(const std::string_view filePath) {
+#ifdef _WIN32
         WIN32_FILE_ATTRIBUTE_DATA info = {};
         if(!GetFileAttributesExA(filePath.data(), GetFileExInfoStandard, &info))
             return 0;
         return static_cast<unsigned long long>(info.ftLastWriteTime.dwHighDateTime) << 32 | static_cast<unsigned long long>(info.ftLastWriteTime.dwLowDateTime);
+#else
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(filePath, error);
+        if (error)
+            return 0;
+        return static_cast<unsigned long long>(time.time_since_epoch().count());
+#endif
     }
 
     BinaryReader::BinaryReader(const std::string_view filename) {
@@ -3,10 +3,23 @@
 #include "tt_strings.h"
 #include "tt_messages.h"
 #include <string>
+#include <cstdio>
 #include <unordered_set>
-#include <intrin.h>
 #include <string_view>
 #include <unordered_map>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cerrno>
+// The MSVC CRT functions used below, for other platforms.
+inline int fopen_s(std::FILE** fp, const char* filename, const char* mode) {
+    *fp = std::fopen(filename, mode);
+    return *fp ? 0 : errno;
+}
+inline unsigned short _byteswap_ushort(unsigned short value) { return __builtin_bswap16(value); }
+inline unsigned long _byteswap_ulong(unsigned long value) { return __builtin_bswap32((unsigned int)value); }
+inline unsigned long long _byteswap_uint64(unsigned long long value) { return __builtin_bswap64(value); }
+#endif
 
 namespace TT {
 	std::string readAllBytes(const std::string_view filename);
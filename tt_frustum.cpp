@@ -0,0 +1,48 @@
+#include "tt_frustum.h"
+#include "tt_cgmath_kernels.h"
+
+namespace TT {
+	Frustum::Frustum() {}
+
+	Frustum::Frustum(const Mat44& viewProjection) {
+		// Gribb and Hartmann: a point is inside when -w <= x, y, z <= w in clip space, each side is the w row plus or minus another row.
+		const float* m = viewProjection.m;
+		Vec rows[4];
+		for (int i = 0; i < 4; ++i)
+			rows[i] = Vec(m[i], m[4 + i], m[8 + i], m[12 + i]);
+		for (int i = 0; i < 3; ++i) {
+			planes[i * 2] = rows[3] + rows[i];
+			planes[i * 2 + 1] = rows[3] - rows[i];
+		}
+		for (Vec& plane : planes)
+			plane = plane / sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+	}
+
+	bool Frustum::isSphereVisible(Vec center, float radius) const {
+		for (const Vec& p : planes) {
+			if (p.x * center.x + p.y * center.y + p.z * center.z + p.w + radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	bool Frustum::isBoxVisible(Vec center, Vec extent) const {
+		for (const Vec& p : planes) {
+			float radius = fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z;
+			if (p.x * center.x + p.y * center.y + p.z * center.z + p.w + radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	size_t Frustum::cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, unsigned int* visibleBits, unsigned int* visibleIndices) const {
+		const float* streams[4] = { x, y, z, radius };
+		return cgmathKernels->cullSpheres(planes, streams, count, visibleBits, visibleIndices);
+	}
+
+	size_t Frustum::cullBoxes(const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, size_t count,
+		unsigned int* visibleBits, unsigned int* visibleIndices) const {
+		const float* streams[6] = { centerX, centerY, centerZ, extentX, extentY, extentZ };
+		return cgmathKernels->cullBoxes(planes, streams, count, visibleBits, visibleIndices);
+	}
+}
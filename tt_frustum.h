@@ -0,0 +1,26 @@
+#pragma once
+
+#include "tt_cgmath.h"
+
+namespace TT {
+	// The six clip space planes (-x, +x, -y, +y, near, far) of a view projection matrix as (normal, distance) with unit normals
+	// pointing inwards. Works for any projection, including Mat44::perspectiveY, frustum and orthoSymmetric.
+	struct Frustum {
+		Vec planes[6];
+
+		Frustum();
+		// viewProjection as it is used for drawing, e.g. V * P.
+		explicit Frustum(const Mat44& viewProjection);
+
+		// Conservative, volumes near a corner may be reported visible.
+		bool isSphereVisible(Vec center, float radius) const;
+		bool isBoxVisible(Vec center, Vec extent) const;
+
+		// Cull count spheres or axis aligned boxes (center and half size) given as separate streams, 4 or 8 per step depending on the SIMD path.
+		// visibleBits gets bit n % 32 of word n / 32 set for each visible volume, visibleIndices the indices of the visible volumes in order,
+		// either may be null. Returns the number of visible volumes.
+		size_t cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, unsigned int* visibleBits, unsigned int* visibleIndices = nullptr) const;
+		size_t cullBoxes(const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, size_t count,
+			unsigned int* visibleBits, unsigned int* visibleIndices = nullptr) const;
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstring>
 #include <algorithm>
 
 namespace {
@@ -74,6 +75,63 @@ namespace {
     {
         return 0xFFFFFFFF;
     }
+
+    // _crc_slices[k][b] is the crc of byte b followed by k zero bytes, which lets the runtime crc consume 8 bytes per step.
+    struct _Crc32Slices { unsigned int table[8][256]; };
+
+    constexpr _Crc32Slices _makeCrc32Slices()
+    {
+        _Crc32Slices slices{};
+        for (int b = 0; b < 256; ++b)
+            slices.table[0][b] = _crc_table[b];
+        for (int k = 1; k < 8; ++k) {
+            for (int b = 0; b < 256; ++b)
+                slices.table[k][b] = (slices.table[k - 1][b] >> 8) ^ _crc_table[slices.table[k - 1][b] & 0x000000FF];
+        }
+        return slices;
+    }
+
+    static constexpr _Crc32Slices _crc_slices = _makeCrc32Slices();
+
+    // Runtime version of TT_STRING_HASH for strings that are not known at compile time, e.g. parsed keys.
+    // Wide characters are hashed by their low byte, so ASCII text hashes the same as the narrow literal.
+    template<typename Char>
+    unsigned int _crc32Runtime(const Char* str, size_t size)
+    {
+        unsigned int crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < size; ++i)
+            crc = (crc >> 8) ^ _crc_table[(crc ^ (unsigned char)str[i]) & 0x000000FF];
+        return crc ^ 0xFFFFFFFF;
+    }
+
+    // Narrow strings are hashed 8 bytes per step (slicing-by-8) and then 4, object keys are hashed on every lookup.
+    template<>
+    inline unsigned int _crc32Runtime<char>(const char* str, size_t size)
+    {
+        unsigned int crc = 0xFFFFFFFF;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        const unsigned int (&t)[8][256] = _crc_slices.table;
+        for (; size >= 8; size -= 8, str += 8) {
+            unsigned int lo, hi;
+            memcpy(&lo, str, 4);
+            memcpy(&hi, str + 4, 4);
+            lo ^= crc;
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        }
+        if (size >= 4) {
+            unsigned int lo;
+            memcpy(&lo, str, 4);
+            lo ^= crc;
+            crc = t[3][lo & 0xFF] ^ t[2][(lo >> 8) & 0xFF] ^ t[1][(lo >> 16) & 0xFF] ^ t[0][lo >> 24];
+            size -= 4;
+            str += 4;
+        }
+#endif
+        for (size_t i = 0; i < size; ++i)
+            crc = (crc >> 8) ^ _crc_table[(crc ^ (unsigned char)str[i]) & 0x000000FF];
+        return crc ^ 0xFFFFFFFF;
+    }
 }
 
 #define TT_STRING_HASH(x) (_crc32<sizeof(x) - 2>(x) ^ 0xFFFFFFFF)
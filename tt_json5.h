@@ -54,13 +54,23 @@ SOFTWARE.
 #pragma once
 
 #include <string>
+#include <deque>
 #include <fstream>
 #include <sstream>
 #include <codecvt>
+#include <span>
+#include <algorithm>
+#include <memory>
 #include <functional>
 #include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <limits>
+#ifdef _WIN32
 #include "windont.h"
 #include <stringapiset.h>
+#endif
+#include "tt_hashed_string.h"
 
 #ifndef TT_JSON5_NO_JSON5
 // Individual JSON5 features (turning them all off reverts this to a strict JSON compliant parser):
@@ -144,6 +154,9 @@ namespace TTJson {
     };
 
     class Value;
+    struct ArrayShape;
+    struct PackedArray;
+    struct SaxHandler;
 
     class Array : public std::vector<Value> {
     public:
@@ -153,7 +166,75 @@ namespace TTJson {
         const Value& operator[](size_t index) const;
     };
 
-    class Object : public std::unordered_map<str_t, Value> {
+    // A string owned by a StringPool together with its crc32.
+    struct PooledString {
+        str_t text;
+        unsigned int crc;
+    };
+
+    // Deduplicates keys and short string values while parsing, see ParseOptions::stringPool.
+    // Parsed documents point into the pool, so it must outlive them (and any copies of them).
+    // A pool can be used for a single document or shared between many, but not by multiple threads at once.
+    class StringPool {
+        struct Hash {
+            using is_transparent = void;
+            size_t operator()(const PooledString& pooled) const { return hash(pooled.text); }
+            size_t operator()(const str_t& text) const { return hash(text); }
+        };
+        struct Equal {
+            using is_transparent = void;
+            bool operator()(const PooledString& a, const PooledString& b) const { return a.text == b.text; }
+            bool operator()(const PooledString& a, const str_t& b) const { return a.text == b; }
+            bool operator()(const str_t& a, const PooledString& b) const { return a == b.text; }
+        };
+
+        // Set nodes do not move, so references to pooled strings stay valid as the pool grows.
+        std::unordered_set<PooledString, Hash, Equal> strings;
+
+    public:
+        // Hashes 8 bytes per step instead of 1 like the crc32, the crc32 is only computed once per unique string.
+        static size_t hash(const str_t& text);
+
+        const PooledString& intern(const str_t& text);
+        size_t size() const { return strings.size(); }
+        void clear() { strings.clear(); }
+    };
+
+    // Object keys store their crc32 (as TT_STRING_HASH would compute it) so lookups with a key hashed at compile time
+    // do not need to construct or hash a string. Keys parsed with a StringPool reference the pooled text instead of owning a copy.
+    struct ObjectKey {
+        unsigned int crc;
+
+        ObjectKey(const char_t* text);
+        ObjectKey(const str_t& text);
+        ObjectKey(str_t&& text);
+        ObjectKey(const PooledString& pooled);
+
+        const str_t& str() const { return pooled ? *pooled : text; }
+        operator const str_t&() const { return str(); }
+
+    private:
+        str_t text;
+        const str_t* pooled = nullptr;
+    };
+
+    struct ObjectKeyHash {
+        using is_transparent = void;
+        size_t operator()(const ObjectKey& key) const { return key.crc; }
+        size_t operator()(const str_t& key) const;
+        size_t operator()(const TT::HashedString& key) const { return (size_t)key; }
+    };
+
+    struct ObjectKeyEqual {
+        using is_transparent = void;
+        bool operator()(const ObjectKey& a, const ObjectKey& b) const { return a.crc == b.crc && a.str() == b.str(); }
+        bool operator()(const ObjectKey& a, const str_t& b) const { return a.str() == b; }
+        bool operator()(const str_t& a, const ObjectKey& b) const { return a == b.str(); }
+        bool operator()(const ObjectKey& a, const TT::HashedString& b) const;
+        bool operator()(const TT::HashedString& a, const ObjectKey& b) const { return (*this)(b, a); }
+    };
+
+    class Object : public std::unordered_map<ObjectKey, Value, ObjectKeyHash, ObjectKeyEqual> {
     public:
         using unordered_map::unordered_map;
 
@@ -167,23 +248,67 @@ namespace TTJson {
         const str_t* tryGetString(const str_t& key) const;
         const Array* tryGetArray(const str_t& key) const;
         const Object* tryGetObject(const str_t& key) const;
+
+        // Lookups with a key hashed at compile time, e.g. obj.tryGetInt(TT_HASHED_STRING("width")).
+        // No string is constructed or hashed, release builds only compare the crc32, debug builds also compare the text.
+        Value& get(const TT::HashedString& key);
+        const Value& get(const TT::HashedString& key) const;
+
+        const Value* tryGet(const TT::HashedString& key) const;
+        const bool* tryGetBool(const TT::HashedString& key) const;
+        const long long* tryGetInt(const TT::HashedString& key) const;
+        const double* tryGetDouble(const TT::HashedString& key) const;
+        const str_t* tryGetString(const TT::HashedString& key) const;
+        const Array* tryGetArray(const TT::HashedString& key) const;
+        const Object* tryGetObject(const TT::HashedString& key) const;
+
+    private:
+        template<typename Key> Value* lookup(const Key& key) const;
     };
 
     class Value {
         friend class Parser;
         friend void serialize(const Value&, ostream_t&, const char_t*, int);
+        friend void visit(const Value&, SaxHandler&);
+
+        // Parsed values may keep their contents outside of the members below until they are first read, see ParseOptions.
+        // A tag in the padding after bValue and one pointer for all of them, so they hardly add to the size of every Value.
+        enum class Storage : unsigned char {
+            Members,
+            // The number's source text is in sValue, materialize() converts it.
+            LazyNumber,
+            // pooledString points into a StringPool, the text is not copied into sValue until it is modified.
+            PooledString,
+            // packed or shape is owned by this value, expand() converts it to the elements of aValue.
+            PackedArray,
+            ShapedArray
+        };
 
         ValueType type;
 
         bool bValue{};
-        long long iValue{};
-        scalar dValue{};
-        str_t sValue{};
-        Array aValue{};
+        // Converting from const getters writes the members, which makes concurrent reads of a value
+        // that was not read before a data race, see ParseOptions::lazyNumbers.
+        mutable Storage storage = Storage::Members;
+        mutable long long iValue{};
+        mutable scalar dValue{};
+        mutable str_t sValue{};
+        mutable Array aValue{};
         Object oValue{};
+        union {
+            const str_t* pooledString = nullptr;
+            mutable PackedArray* packed;
+            mutable ArrayShape* shape;
+        };
 
         typedef void (*errorFunc)();
 
+        inline void materialize() const;
+        void expand() const;
+        // Takes over the storage of other, this value must not own any.
+        void adoptStorage(Value& other);
+        void releaseStorage();
+
     public:
         Value(ValueType type = ValueType::Null);
         Value(bool value);
@@ -194,6 +319,11 @@ namespace TTJson {
         Value(float value);
         Value(double value);
         Value(long double value);
+        Value(const Value& other);
+        Value(Value&& other) noexcept;
+        Value& operator=(const Value& other);
+        Value& operator=(Value&& other) noexcept;
+        ~Value();
 
         static errorFunc castErrorHandler;
 
@@ -218,15 +348,109 @@ namespace TTJson {
         bool isString() const;
         bool isArray() const;
         bool isObject() const;
+
+        ValueType getType() const;
+
+        // Arrays parsed with ParseOptions::packedNumericArrays or ParseOptions::shapedArrays keep their numbers or columns
+        // until asArray() converts them to regular elements, these read them without converting.
+        bool isPacked() const;
+        // All integers, empty unless packed and every element was an integer.
+        std::span<const long long> ints() const;
+        // All numbers, empty unless packed and at least one element was not an integer.
+        std::span<const scalar> doubles() const;
+        // The values of the given key for all elements in order if this is a shaped array, else nullptr.
+        const std::vector<Value>* column(const str_t& key) const;
+    };
+
+    struct PackedArray {
+        // Int or Double.
+        ValueType type;
+        std::vector<long long> ints;
+        std::vector<scalar> doubles;
+        // Only filled when a Double array also contains integers, so they are restored as Int.
+        std::vector<bool> integral;
+    };
+
+    // Arrays of objects that all have the same keys store the keys once and the values per key,
+    // see ParseOptions::shapedArrays. Each shaped array owns its shape, copies of the array copy it.
+    struct ArrayShape {
+        std::vector<ObjectKey> keys;
+        std::unordered_map<ObjectKey, size_t, ObjectKeyHash, ObjectKeyEqual> fields;
+        // columns[field][row]
+        std::vector<std::vector<Value>> columns;
+    };
+
+    // Where the values of a parsed document are in its text, see ParseOptions::sourceMap and Parser::reparse().
+    // Positions and lengths are in characters of the parsed stream.
+    struct SourceSpan {
+        size_t length = 0;
+        // Containers only: the children in document order, their offset from the start of this value and, for objects, their key.
+        // Offsets are relative to the parent so an edit only updates the containers around it, not every value after it.
+        std::vector<size_t> offsets;
+        std::vector<str_t> keys;
+        std::vector<SourceSpan> children;
+    };
+
+    struct SourceMap {
+        // Start of the root value, after leading whitespace and comments.
+        size_t offset = 0;
+        SourceSpan root;
+    };
+
+    struct ParseOptions {
+        // Numbers only store their text and type while parsing, the conversion to long long or scalar
+        // happens on the first asInt() / asDouble() and is then cached. This is faster for large
+        // number-dense documents of which only a small part is ever read.
+        // Not thread safe: the cache is written on first access, also through a const Value&, so threads must not
+        // read a lazily parsed document at the same time unless every number was read once before (e.g. by serialize()).
+        // The same applies to the asArray() of shaped and packed arrays below.
+        bool lazyNumbers = false;
+        // Maximum number of nested objects and arrays, deeper documents fail to parse.
+        // Parsing and destroying documents do not use the call stack per level so this may be raised freely,
+        // but copying a Value, serialize() and visit() recurse per level.
+        size_t maxDepth = 1024;
+        // Arrays of objects that all have the same keys store each key once and keep the values in a column per key.
+        // This avoids a hash map and a copy of every key per element, and Value::column() gives contiguous access to one field.
+        // The first asArray() converts the columns to regular objects, serialize() and visit() do not.
+        bool shapedArrays = false;
+        // Arrays that only contain numbers store them in a contiguous vector instead of a Value per number,
+        // read them with Value::ints() / Value::doubles(). Integers are packed as doubles if the array also contains
+        // fractional numbers (and remain integers when converted or serialized). The first asArray() converts them to regular elements.
+        bool packedNumericArrays = false;
+        // Keys and string values of up to internMaxLength characters are deduplicated through this pool
+        // instead of each being a separate allocation. The pool must outlive the parsed documents.
+        StringPool* stringPool = nullptr;
+        size_t internMaxLength = 64;
+        // Filled with the span of every value, which Parser::reparse() needs. Arrays are neither shaped nor packed when this is set.
+        SourceMap* sourceMap = nullptr;
+    };
+
+    // Receives a document as a sequence of events instead of a Value tree, see Parser::parse(istream_t&, SaxHandler&) and visit().
+    // Object members are a key() followed by the events of the member's value, the key stays valid until that value has ended.
+    struct SaxHandler {
+        virtual ~SaxHandler() = default;
+        virtual void null() {}
+        virtual void boolean(bool /*value*/) {}
+        virtual void integer(long long /*value*/) {}
+        virtual void number(scalar /*value*/) {}
+        virtual void string(const str_t& /*value*/) {}
+        virtual void key(const str_t& /*key*/) {}
+        virtual void beginObject() {}
+        virtual void endObject() {}
+        virtual void beginArray() {}
+        virtual void endArray() {}
     };
 
     class Parser {
+        ParseOptions options;
         str_t parseError{};
         int errorCode = 0;
         size_t cursor = 0;
         size_t lineNumber = 0;
         size_t columnNumber = 0;
         size_t prevColumnNumber = 0;
+        // Stream position at which the current parse started, source map spans are relative to it.
+        size_t spanBase = 0;
         // Currently necessary to avoid the use of unget, as it causes a crash in the unit tests.
         bool rewind = false; 
         char_t lastChr = '\0';
@@ -241,6 +465,7 @@ namespace TTJson {
         char_t peek1(istream_t& stream);
         char_t read1(istream_t& stream);
         void rewind1(istream_t& stream);
+        size_t position() const { return cursor - (rewind ? 1 : 0) - spanBase; }
 #if defined(TT_JSON5_SUPPORT_BLOCK_COMMENTS) || defined(TT_JSON5_SUPPORT_SINGLE_LINE_COMMENTS)
         bool skipComments(istream_t& stream, char_t& b);
 #endif
@@ -258,14 +483,27 @@ namespace TTJson {
 
         void parseNumber(istream_t& stream, char_t first, Value& result);
         str_t parseKey(istream_t& stream);
-        void parseObject(istream_t& stream, Value& result);
-        void parseArray(istream_t& stream, Value& result);
-        void parseValue(istream_t& stream, Value& result);
+        void storeString(Value& target, str_t&& text);
+        void parseValue(istream_t& stream, Value& root);
+        void parseEvents(istream_t& stream, SaxHandler& handler);
+        void shapeLastElement(Value& array);
+        // Returns true if the element was moved into the packed numbers.
+        bool packLastElement(Value& array);
 
     public:
+        Parser(const ParseOptions& options = {});
+
         bool hasError();
         str_t error();
         void parse(istream_t& stream, Value& result);
+        // Updates a document parsed with ParseOptions::sourceMap after an edit of its text that replaced removed characters at offset
+        // with inserted ones, text is the full text after the edit. Only the smallest value around the edit is parsed again and spliced
+        // into the document, its enclosing containers (and finally the whole text) are tried when the edit changed the structure.
+        // On error the document and map are left unchanged.
+        void reparse(const str_t& text, size_t offset, size_t removed, size_t inserted, Value& document, SourceMap& map);
+        // Parse without building a document. Only maxDepth and lazyNumbers (which has no effect) apply from the options.
+        // On error the events stop where the error occurred, so the handler may not see closing events.
+        void parse(istream_t& stream, SaxHandler& handler);
     };
 
     // Utilities to open fstreams with utf8 encoding.
@@ -273,10 +511,29 @@ namespace TTJson {
     ofstream_t writeUtf8(const std::string & path);
 
     void serialize(const Value& value, ostream_t& out, const char_t* tab = nullptr, int depth = 0);
+    // Emit the events the parser would produce for this document.
+    void visit(const Value& value, SaxHandler& handler);
     void save(const std::string_view path, const TTJson::Value& value, const char_t* tab = nullptr);
 
-    TTJson::Value deserialize(istream_t& in);
-    TTJson::Value load(const std::string_view path);
+    TTJson::Value deserialize(istream_t& in, const ParseOptions& options = {});
+    TTJson::Value load(const std::string_view path, const ParseOptions& options = {});
+
+    // Appends a json pointer (RFC 6901) reference token to path, escaping '~' and '/'.
+    // A template so it also builds the byte string paths of documents that are not parsed into str_t.
+    template<typename String> void appendPathToken(String& path, const String& token) {
+        path += '/';
+        for (auto chr : token) {
+            if (chr == '~') {
+                path += '~';
+                path += '0';
+            } else if (chr == '/') {
+                path += '~';
+                path += '1';
+            } else {
+                path += chr;
+            }
+        }
+    }
 }
 
 #ifdef TT_JSON5_IMPLEMENTATION
@@ -295,7 +552,7 @@ namespace TTJson {
         mbstowcs_s(0, &wc[0], 2, buf, 1);
         return wc;
     }
-#else
+#elif defined(_WIN32)
     str_t makeString(const wchar_t* c) {
         size_t sz = wcslen(c);
         str_t r;
@@ -309,6 +566,39 @@ namespace TTJson {
         WideCharToMultiByte(CP_UTF8, 0, &c, 1, r.data(), (int)r.size(), nullptr, nullptr);
         return r;
     }
+#else
+    namespace {
+        // Without WideCharToMultiByte, wchar_t holds UTF-32.
+        void appendUTF8(str_t& out, unsigned int codePoint) {
+            if (codePoint < 0x80) {
+                out += (char)codePoint;
+            } else if (codePoint < 0x800) {
+                out += (char)(0xC0 | (codePoint >> 6));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            } else if (codePoint < 0x10000) {
+                out += (char)(0xE0 | (codePoint >> 12));
+                out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            } else {
+                out += (char)(0xF0 | (codePoint >> 18));
+                out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+                out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            }
+        }
+    }
+
+    str_t makeString(const wchar_t* c) {
+        str_t r;
+        for (; *c; ++c)
+            appendUTF8(r, (unsigned int)*c);
+        return r;
+    }
+    str_t makeString(wchar_t c) {
+        str_t r;
+        appendUTF8(r, (unsigned int)c);
+        return r;
+    }
 #endif
     str_t makeString(const char_t* c) {
         return c;
@@ -319,6 +609,15 @@ namespace TTJson {
 
     namespace {
         Value _INVALID{};
+
+        // Like stold, but values beyond the range of scalar become infinity or zero instead of throwing.
+        scalar toScalar(const str_t& text) {
+#ifdef TT_JSON5_USE_WSTR
+            return (scalar)std::wcstold(text.c_str(), nullptr);
+#else
+            return (scalar)std::strtold(text.c_str(), nullptr);
+#endif
+        }
     }
 
     Value& Array::operator[](size_t index) {
@@ -331,60 +630,107 @@ namespace TTJson {
         return std::vector<Value>::operator[](index);
     }
 
-    Value& Object::get(const str_t& key) {
-        auto it = find(key);
-        if (find(key) == end()) return _INVALID;
-        return it->second;
+    size_t StringPool::hash(const str_t& text) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+        size_t size = text.size() * sizeof(char_t);
+        unsigned long long h = 0x9E3779B97F4A7C15ull ^ size;
+        unsigned long long word;
+        for (; size >= 8; size -= 8, bytes += 8) {
+            memcpy(&word, bytes, 8);
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        word = 0;
+        memcpy(&word, bytes, size);
+        h = (h ^ word) * 0xC4CEB9FE1A85EC53ull;
+        return (size_t)(h ^ (h >> 29));
     }
 
-    const Value& Object::get(const str_t& key) const {
-        auto it = find(key);
-        if (find(key) == end()) return _INVALID;
-        return it->second;
+    const PooledString& StringPool::intern(const str_t& text) {
+        auto it = strings.find(text);
+        if (it == strings.end())
+            it = strings.insert({ text, _crc32Runtime(text.data(), text.size()) }).first;
+        return *it;
     }
 
-    const Value* Object::tryGet(const str_t& key) const {
-        auto it = find(key);
-        if (it != end()) return &it->second;
-        return nullptr;
+    ObjectKey::ObjectKey(const char_t* text) : text(text) { crc = _crc32Runtime(this->text.data(), this->text.size()); }
+    ObjectKey::ObjectKey(const str_t& text) : text(text) { crc = _crc32Runtime(this->text.data(), this->text.size()); }
+    ObjectKey::ObjectKey(str_t&& text) : text(std::move(text)) { crc = _crc32Runtime(this->text.data(), this->text.size()); }
+    ObjectKey::ObjectKey(const PooledString& pooled) : crc(pooled.crc), pooled(&pooled.text) {}
+
+    size_t ObjectKeyHash::operator()(const str_t& key) const {
+        return _crc32Runtime(key.data(), key.size());
+    }
+
+    bool ObjectKeyEqual::operator()(const ObjectKey& a, const TT::HashedString& b) const {
+#ifdef _DEBUG
+        const str_t& text = a.str();
+        if (a.crc != (size_t)b || text.size() != b.text.size())
+            return false;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != (char_t)(unsigned char)b.text[i])
+                return false;
+        }
+        return true;
+#else
+        return a.crc == (size_t)b;
+#endif
     }
 
-    const bool* Object::tryGetBool(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isBool()) return &value->asBool();
-        return nullptr;
+    template<typename Key> Value* Object::lookup(const Key& key) const {
+        auto it = find(key);
+        if (it == end()) return nullptr;
+        return const_cast<Value*>(&it->second);
     }
 
-    const long long* Object::tryGetInt(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isInt()) return &value->asInt();
-        return nullptr;
+    Value& Object::get(const str_t& key) {
+        Value* value = lookup(key);
+        if (!value) return _INVALID;
+        return *value;
     }
 
-    const double* Object::tryGetDouble(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isDouble()) return &value->asDouble();
-        return nullptr;
+    const Value& Object::get(const str_t& key) const {
+        const Value* value = lookup(key);
+        if (!value) return _INVALID;
+        return *value;
     }
 
-    const str_t* Object::tryGetString(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isString()) return &value->asString();
-        return nullptr;
+    Value& Object::get(const TT::HashedString& key) {
+        Value* value = lookup(key);
+        if (!value) return _INVALID;
+        return *value;
     }
 
-    const Array* Object::tryGetArray(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isArray()) return &value->asArray();
-        return nullptr;
+    const Value& Object::get(const TT::HashedString& key) const {
+        const Value* value = lookup(key);
+        if (!value) return _INVALID;
+        return *value;
     }
 
-    const Object* Object::tryGetObject(const str_t& key) const {
-        const Value* value = tryGet(key);
-        if (value && value->isObject()) return &value->asObject();
-        return nullptr;
+    const Value* Object::tryGet(const str_t& key) const { return lookup(key); }
+    const Value* Object::tryGet(const TT::HashedString& key) const { return lookup(key); }
+
+#define TRY_GET(T, NAME, IS, AS) \
+    const T* Object::NAME(const str_t& key) const { \
+        const Value* value = lookup(key); \
+        if (value && value->IS()) return &value->AS(); \
+        return nullptr; \
+    } \
+    const T* Object::NAME(const TT::HashedString& key) const { \
+        const Value* value = lookup(key); \
+        if (value && value->IS()) return &value->AS(); \
+        return nullptr; \
     }
 
+    TRY_GET(bool, tryGetBool, isBool, asBool)
+    TRY_GET(long long, tryGetInt, isInt, asInt)
+    TRY_GET(double, tryGetDouble, isDouble, asDouble)
+    TRY_GET(str_t, tryGetString, isString, asString)
+    TRY_GET(Array, tryGetArray, isArray, asArray)
+    TRY_GET(Object, tryGetObject, isObject, asObject)
+
+#undef TRY_GET
+
     Value::errorFunc Value::castErrorHandler = nullptr;
 
     Value::Value(ValueType type) : type(type) {}
@@ -397,18 +743,173 @@ namespace TTJson {
     Value::Value(double value) : type(ValueType::Double), dValue(value) {}
     Value::Value(long double value) : type(ValueType::Double), dValue(value) {}
 
+    Value::Value(const Value& other)
+        : type(other.type), bValue(other.bValue), storage(other.storage), iValue(other.iValue), dValue(other.dValue),
+          sValue(other.sValue), aValue(other.aValue), oValue(other.oValue) {
+        // Copies share the pooled text but own their packed numbers and columns.
+        if (storage == Storage::PooledString)
+            pooledString = other.pooledString;
+        else if (storage == Storage::PackedArray)
+            packed = new PackedArray(*other.packed);
+        else if (storage == Storage::ShapedArray)
+            shape = new ArrayShape(*other.shape);
+    }
+
+    Value::Value(Value&& other) noexcept
+        : type(other.type), bValue(other.bValue), iValue(other.iValue), dValue(other.dValue),
+          sValue(std::move(other.sValue)), aValue(std::move(other.aValue)), oValue(std::move(other.oValue)) {
+        adoptStorage(other);
+    }
+
+    Value& Value::operator=(const Value& other) {
+        // Copy first, other may be inside this value.
+        Value copy(other);
+        return *this = std::move(copy);
+    }
+
+    Value& Value::operator=(Value&& other) noexcept {
+        if (this == &other)
+            return *this;
+        // Move other out first, it may be inside this value.
+        Value moved(std::move(other));
+        releaseStorage();
+        type = moved.type;
+        bValue = moved.bValue;
+        iValue = moved.iValue;
+        dValue = moved.dValue;
+        sValue = std::move(moved.sValue);
+        aValue = std::move(moved.aValue);
+        oValue = std::move(moved.oValue);
+        adoptStorage(moved);
+        return *this;
+    }
+
+    Value::~Value() {
+        // The parser accepts documents nested deeper than the call stack allows,
+        // so nested containers are moved into a flat list and released one at a time instead of recursively.
+        auto nested = [](const Value& value) {
+            return !value.aValue.empty() || !value.oValue.empty() || value.storage == Storage::ShapedArray;
+        };
+        if (!nested(*this)) {
+            releaseStorage();
+            return;
+        }
+        std::vector<Value> pending;
+        auto adoptChildren = [&pending, &nested](Value& value) {
+            for (Value& child : value.aValue)
+                if (nested(child))
+                    pending.push_back(std::move(child));
+            for (auto& pair : value.oValue)
+                if (nested(pair.second))
+                    pending.push_back(std::move(pair.second));
+            if (value.storage == Storage::ShapedArray) {
+                for (std::vector<Value>& column : value.shape->columns)
+                    for (Value& child : column)
+                        if (nested(child))
+                            pending.push_back(std::move(child));
+            }
+        };
+        adoptChildren(*this);
+        while (!pending.empty()) {
+            Value value = std::move(pending.back());
+            pending.pop_back();
+            adoptChildren(value);
+        }
+        releaseStorage();
+    }
+
+    void Value::adoptStorage(Value& other) {
+        storage = other.storage;
+        if (storage == Storage::PooledString)
+            pooledString = other.pooledString;
+        else if (storage == Storage::PackedArray)
+            packed = other.packed;
+        else if (storage == Storage::ShapedArray)
+            shape = other.shape;
+        other.storage = Storage::Members;
+    }
+
+    void Value::releaseStorage() {
+        if (storage == Storage::PackedArray)
+            delete packed;
+        else if (storage == Storage::ShapedArray)
+            delete shape;
+        storage = Storage::Members;
+    }
+
+    inline void Value::materialize() const {
+        if (storage != Storage::LazyNumber) return;
+        storage = Storage::Members;
+        if (type == ValueType::Int)
+            iValue = stoll(sValue);
+        else
+            dValue = toScalar(sValue);
+        sValue = {};
+    }
+
+    // Packed numbers and shaped rows come before the elements in aValue, which while parsing is the element being parsed.
+    void Value::expand() const {
+        if (storage == Storage::PackedArray) {
+            std::unique_ptr<PackedArray> data(packed);
+            storage = Storage::Members;
+            std::vector<Value> elements;
+            if (data->type == ValueType::Int) {
+                elements.reserve(data->ints.size() + aValue.size());
+                for (long long value : data->ints)
+                    elements.emplace_back(value);
+            } else {
+                elements.reserve(data->doubles.size() + aValue.size());
+                for (size_t i = 0; i < data->doubles.size(); ++i) {
+                    if (!data->integral.empty() && data->integral[i])
+                        elements.emplace_back((long long)data->doubles[i]);
+                    else
+                        elements.emplace_back(data->doubles[i]);
+                }
+            }
+            for (Value& element : aValue)
+                elements.push_back(std::move(element));
+            aValue.swap(elements);
+        } else if (storage == Storage::ShapedArray) {
+            std::unique_ptr<ArrayShape> data(shape);
+            storage = Storage::Members;
+            const size_t rows = data->columns[0].size();
+            std::vector<Value> elements;
+            elements.reserve(rows + aValue.size());
+            for (size_t row = 0; row < rows; ++row) {
+                Object& object = elements.emplace_back(ValueType::Object).oValue;
+                object.reserve(data->keys.size());
+                for (size_t i = 0; i < data->keys.size(); ++i)
+                    object.emplace(data->keys[i], std::move(data->columns[i][row]));
+            }
+            for (Value& element : aValue)
+                elements.push_back(std::move(element));
+            aValue.swap(elements);
+        }
+    }
+
     const bool& Value::asBool() const { if (type != ValueType::Bool && castErrorHandler != nullptr) castErrorHandler(); return bValue; }
-    const long long& Value::asInt() const { if (type != ValueType::Int && castErrorHandler != nullptr) castErrorHandler(); return iValue; }
-    const scalar& Value::asDouble() const { if (type != ValueType::Double && castErrorHandler != nullptr) castErrorHandler(); return dValue; }
-    const str_t& Value::asString() const { if (type != ValueType::String && castErrorHandler != nullptr) castErrorHandler(); return sValue; }
-    const Array& Value::asArray() const { if (type != ValueType::Array && castErrorHandler != nullptr) castErrorHandler(); return aValue; }
+    const long long& Value::asInt() const { if (type != ValueType::Int && castErrorHandler != nullptr) castErrorHandler(); materialize(); return iValue; }
+    const scalar& Value::asDouble() const { if (type != ValueType::Double && castErrorHandler != nullptr) castErrorHandler(); materialize(); return dValue; }
+    const str_t& Value::asString() const {
+        if (type != ValueType::String && castErrorHandler != nullptr) castErrorHandler();
+        return storage == Storage::PooledString ? *pooledString : sValue;
+    }
+    const Array& Value::asArray() const { if (type != ValueType::Array && castErrorHandler != nullptr) castErrorHandler(); expand(); return aValue; }
     const Object& Value::asObject() const { if (type != ValueType::Object && castErrorHandler != nullptr) castErrorHandler(); return oValue; }
 
     bool& Value::asBool() { if (type != ValueType::Bool && castErrorHandler != nullptr) castErrorHandler(); return bValue; }
-    long long& Value::asInt() { if (type != ValueType::Int && castErrorHandler != nullptr) castErrorHandler(); return iValue; }
-    scalar& Value::asDouble() { if (type != ValueType::Double && castErrorHandler != nullptr) castErrorHandler(); return dValue; }
-    str_t& Value::asString() { if (type != ValueType::String && castErrorHandler != nullptr) castErrorHandler(); return sValue; }
-    Array& Value::asArray() { if (type != ValueType::Array && castErrorHandler != nullptr) castErrorHandler(); return aValue; }
+    long long& Value::asInt() { if (type != ValueType::Int && castErrorHandler != nullptr) castErrorHandler(); materialize(); return iValue; }
+    scalar& Value::asDouble() { if (type != ValueType::Double && castErrorHandler != nullptr) castErrorHandler(); materialize(); return dValue; }
+    str_t& Value::asString() {
+        if (type != ValueType::String && castErrorHandler != nullptr) castErrorHandler();
+        // The pooled text is shared, take a private copy before handing out a mutable reference.
+        if (storage == Storage::PooledString) {
+            sValue = *pooledString;
+            storage = Storage::Members;
+        }
+        return sValue;
+    }
+    Array& Value::asArray() { if (type != ValueType::Array && castErrorHandler != nullptr) castErrorHandler(); expand(); return aValue; }
     Object& Value::asObject() { if (type != ValueType::Object && castErrorHandler != nullptr) castErrorHandler(); return oValue; }
 
     bool Value::isNull() const { return type == ValueType::Null; }
@@ -419,6 +920,37 @@ namespace TTJson {
     bool Value::isArray() const { return type == ValueType::Array; }
     bool Value::isObject() const { return type == ValueType::Object; }
 
+    ValueType Value::getType() const { return type; }
+
+    bool Value::isPacked() const {
+        return storage == Storage::PackedArray;
+    }
+
+    std::span<const long long> Value::ints() const {
+        if (storage != Storage::PackedArray || packed->type != ValueType::Int) return {};
+        return packed->ints;
+    }
+
+    std::span<const scalar> Value::doubles() const {
+        if (storage != Storage::PackedArray || packed->type != ValueType::Double) return {};
+        return packed->doubles;
+    }
+
+    const std::vector<Value>* Value::column(const str_t& key) const {
+        if (storage != Storage::ShapedArray) return nullptr;
+        auto it = shape->fields.find(key);
+        if (it == shape->fields.end()) return nullptr;
+        return &shape->columns[it->second];
+    }
+
+    Parser::Parser(const ParseOptions& options) : options(options) {
+        // Spans are per element, packing or shaping moves elements out of the array.
+        if (options.sourceMap) {
+            this->options.shapedArrays = false;
+            this->options.packedNumericArrays = false;
+        }
+    }
+
     inline void Parser::clearError() {
         parseError.clear();
         errorCode = 0;
@@ -620,11 +1152,15 @@ namespace TTJson {
     {
 #ifdef TT_JSON5_USE_WSTR
         dst << *reinterpret_cast<wchar_t*>(&codePoint);
-#else
+#elif defined(_WIN32)
         static char buf[5];
         memset(buf, 0, sizeof(buf));
         WideCharToMultiByte(CP_UTF8, 0, reinterpret_cast<wchar_t*>(&codePoint), 1, buf, sizeof(buf), nullptr, nullptr);
         dst << buf;
+#else
+        str_t buf;
+        appendUTF8(buf, codePoint);
+        dst << buf;
 #endif
     }
 
@@ -729,6 +1265,10 @@ namespace TTJson {
     }
 
     void Parser::parseNumber(istream_t& stream, char_t first, Value& result) {
+        // parseEvents() parses every number into the same value.
+        result.iValue = 0;
+        result.dValue = 0;
+
 #ifdef TT_JSON5_NUMBER_SUPPORT_INF_AND_NAN
         if (first == 'N') {
             parseKeyword(stream, makeString("aN"), false);
@@ -770,8 +1310,8 @@ namespace TTJson {
                 read1(stream); // actually consume the x
                 result.type = ValueType::Int;
                 bool haveData = false;
+                unsigned long long digits = 0;
                 while (true) {
-                    result.iValue <<= 4;
                     int v = readHexChar(stream);
                     if (v == -1) {
                         if (!haveData) {
@@ -780,9 +1320,10 @@ namespace TTJson {
                         }
                         break;
                     }
-                    result.iValue += v;
+                    digits = (digits << 4) | (unsigned int)v;
                     haveData = true;
                 }
+                result.iValue = (long long)(negative ? 0 - digits : digits);
                 return;
             }
         }
@@ -908,6 +1449,13 @@ namespace TTJson {
         }
 #endif
 
+        // Integers beyond the range of long long are parsed as doubles.
+        bool integer = tail.empty() && exponent.empty() && mode != Mode::FRACTION;
+        if (integer) {
+            const str_t limit = makeString(negative ? "9223372036854775808" : "9223372036854775807");
+            integer = head.size() < limit.size() || (head.size() == limit.size() && head <= limit);
+        }
+
         if (negative) {
             head = makeString('-') + head;
         }
@@ -925,12 +1473,21 @@ namespace TTJson {
             head += exponent;
         }
 
-        if (tail.empty() && exponent.empty() && mode != Mode::FRACTION) {
-            result.iValue = stoll(head);
+        if (integer)
             result.type = ValueType::Int;
-        } else {
-            result.dValue = stold(head);
+        else
             result.type = ValueType::Double;
+
+        if (options.lazyNumbers) {
+            result.sValue = std::move(head);
+            result.storage = Value::Storage::LazyNumber;
+            return;
+        }
+
+        if (result.type == ValueType::Int) {
+            result.iValue = stoll(head);
+        } else {
+            result.dValue = toScalar(head);
         }
     }
 
@@ -983,130 +1540,543 @@ namespace TTJson {
         return parseString(stream);
     }
 
-    void Parser::parseObject(istream_t& stream, Value& result) {
-        result.type = ValueType::Object;
+    void Parser::storeString(Value& target, str_t&& text) {
+        if (options.stringPool && text.size() <= options.internMaxLength) {
+            target.pooledString = &options.stringPool->intern(text).text;
+            target.storage = Value::Storage::PooledString;
+        } else
+            target.sValue = std::move(text);
+    }
 
-        skipWhitespace(stream);
-        if (errorCode != 0) return;
+    // Containers are parsed with an explicit heap allocated stack instead of recursion,
+    // so deeply nested documents can not overflow the call stack and nesting is limited by ParseOptions::maxDepth.
+    // Each stage performs the same reads and checks, in the same order, as the recursive parseValue / parseObject / parseArray
+    // it replaces, so the resulting document and error messages are unchanged.
+    void Parser::parseValue(istream_t& stream, Value& root) {
+        enum class Stage {
+            VALUE = 0, // Parse the value at target.
+            VALUE_END = 1, // Done parsing target, skip trailing whitespace and return to the parent.
+            RETURN = 2, // Done parsing target, return to the parent.
+            OBJECT_LOOP = 3, // Parse the next key and value into the object at target.
+            OBJECT_ELEMENT = 4, // A value of the object at target was parsed.
+            ARRAY_LOOP = 5, // Parse the next element into the array at target.
+            ARRAY_ELEMENT = 6, // An element of the array at target was parsed.
+        };
+
+        std::vector<Value*> parents;
+        Value* target = &root;
+        Stage stage = Stage::VALUE;
+        // Parallel to parents and target when a source map is requested.
+        std::vector<SourceSpan*> spans;
+        std::vector<size_t> begins;
+        SourceSpan* span = nullptr;
+        size_t begin = 0;
+        if (options.sourceMap) {
+            *options.sourceMap = {};
+            span = &options.sourceMap->root;
+        }
+
+        while (true) {
+            switch (stage) {
+            case Stage::VALUE: {
+                if (errorCode != 0) {
+                    stage = Stage::RETURN;
+                    break;
+                }
+
+                skipWhitespace(stream);
+                if (span) {
+                    begin = position();
+                    if (spans.empty())
+                        options.sourceMap->offset = begin;
+                    else
+                        spans.back()->offsets.push_back(begin - begins.back());
+                }
+
+                char_t lead = read1(stream);
+                if (errorCode != 0) {
+                    stage = Stage::RETURN;
+                    break;
+                }
+
+                stage = Stage::VALUE_END;
+                if (lead == '{' || lead == '[') {
+                    if (parents.size() >= options.maxDepth) {
+                        throwParseError(makeString("Exceeded maximum nesting depth."));
+                        return;
+                    }
+                }
+
+                if (lead == '{') {
+                    target->type = ValueType::Object;
+
+                    skipWhitespace(stream);
+                    if (errorCode != 0) break;
 #ifndef TT_JSON5_OBJECT_SUPPORT_TRAILING_COMMA
-        if (read1(stream) == '}')
-            return;
-        rewind1(stream);
-        if (errorCode != 0) return;
+                    if (read1(stream) == '}')
+                        break;
+                    rewind1(stream);
+                    if (errorCode != 0) break;
 #endif
+                    stage = Stage::OBJECT_LOOP;
+                } else if (lead == '[') {
+                    target->type = ValueType::Array;
 
-        while (true) {
+                    skipWhitespace(stream);
+                    if (errorCode != 0) break;
+#ifndef TT_JSON5_ARRAY_SUPPORT_TRAILING_COMMA
+                    if (read1(stream) == ']')
+                        break;
+                    rewind1(stream);
+                    if (errorCode != 0) break;
+#endif
+                    stage = Stage::ARRAY_LOOP;
+                } else if (lead == '"') {
+                    target->type = ValueType::String;
+                    storeString(*target, parseString(stream));
+#ifdef TT_JSON5_STRING_SUPPORT_SINGLE_QUOTES
+                } else if (lead == '\'') {
+                    target->type = ValueType::String;
+                    storeString(*target, parseString(stream, '\''));
+#endif
+                } else if (lead == 'f' && parseKeyword(stream, makeString("alse"))) {
+                    target->type = ValueType::Bool;
+                    target->bValue = false;
+                } else if (lead == 't' && parseKeyword(stream, makeString("rue"))) {
+                    target->type = ValueType::Bool;
+                    target->bValue = true;
+                } else if (lead == 'n' && parseKeyword(stream, makeString("ull")))
+                    target->type = ValueType::Null;
+                else {
+                    parseNumber(stream, lead, *target);
+                }
+                break;
+            }
+
+            case Stage::VALUE_END:
+                if (span)
+                    span->length = position() - begin;
+                skipWhitespace(stream);
+                stage = Stage::RETURN;
+                break;
+
+            case Stage::RETURN:
+                if (parents.empty())
+                    return;
+                target = parents.back();
+                parents.pop_back();
+                if (span) {
+                    span = spans.back();
+                    spans.pop_back();
+                    begin = begins.back();
+                    begins.pop_back();
+                }
+                stage = target->type == ValueType::Object ? Stage::OBJECT_ELEMENT : Stage::ARRAY_ELEMENT;
+                break;
+
+            case Stage::OBJECT_LOOP: {
 #ifdef TT_JSON5_OBJECT_SUPPORT_TRAILING_COMMA
-            // If we reach here on the first loop, we have {}
-            // If we reach here on subsequent loops, we have {"k":<v>,}
-            char_t lead = read1(stream);
-            if (lead == '}')
-                return;
-            else
-                rewind1(stream);
+                // If we reach here on the first loop, we have {}
+                // If we reach here on subsequent loops, we have {"k":<v>,}
+                char_t lead = read1(stream);
+                if (lead == '}') {
+                    stage = Stage::VALUE_END;
+                    break;
+                } else
+                    rewind1(stream);
 #endif
-            Value& element = result.oValue[parseKey(stream)];
-            // if (errorCode != 0) return;
+                str_t key = parseKey(stream);
+                if (span)
+                    span->keys.push_back(key);
+                Value& element = options.stringPool ? target->oValue[ObjectKey(options.stringPool->intern(key))] : target->oValue[std::move(key)];
+
+                stage = Stage::VALUE_END;
+                skipWhitespace(stream);
+                if (errorCode != 0) break;
+
+                char_t delim = read1(stream);
+                if (errorCode != 0) break;
+                if (delim != ':') {
+                    throwParseError(makeString("Expected ':' instead of '") + delim + makeString("'."));
+                    break;
+                }
 
-            skipWhitespace(stream);
-            if (errorCode != 0) return;
+                parents.push_back(target);
+                target = &element;
+                if (span) {
+                    span->children.emplace_back();
+                    spans.push_back(span);
+                    begins.push_back(begin);
+                    span = &span->children.back();
+                }
+                stage = Stage::VALUE;
+                break;
+            }
 
-            char_t delim = read1(stream);
-            if (errorCode != 0) return;
-            if (delim != ':') {
-                throwParseError(makeString("Expected ':' instead of '") + delim + makeString("'."));
-                return;
+            case Stage::OBJECT_ELEMENT: {
+                char_t comma = read1(stream);
+                if (comma != ',') {
+                    if (comma != '}')
+                        throwParseError(makeString("Expected '}' instead of '") + comma + makeString("'."));
+                    stage = Stage::VALUE_END;
+                    break;
+                }
+                skipWhitespace(stream);
+                stage = Stage::OBJECT_LOOP;
+                break;
             }
 
-            parseValue(stream, element);
+            case Stage::ARRAY_LOOP: {
+#ifdef TT_JSON5_ARRAY_SUPPORT_TRAILING_COMMA
+                stage = Stage::VALUE_END;
+                skipWhitespace(stream);
+                if (errorCode != 0) break;
+
+                // If we reach here on the first loop, we have []
+                // If we reach here on subsequent loops, we have [value,]
+                char_t lead = read1(stream);
+                if (lead == ']')
+                    break;
+                else
+                    rewind1(stream);
+#endif
+                target->aValue.emplace_back();
+                parents.push_back(target);
+                target = &target->aValue.back();
+                if (span) {
+                    span->children.emplace_back();
+                    spans.push_back(span);
+                    begins.push_back(begin);
+                    span = &span->children.back();
+                }
+                stage = Stage::VALUE;
+                break;
+            }
 
-            char_t comma = read1(stream);
-            if (comma != ',') {
-                if (comma != '}') {
-                    throwParseError(makeString("Expected '}' instead of '") + comma + makeString("'."));
-                    return;
+            case Stage::ARRAY_ELEMENT: {
+                stage = Stage::VALUE_END;
+                if (errorCode != 0) break;
+
+                // A packed element is no longer in the array, there is nothing left to shape.
+                const bool packed = options.packedNumericArrays && packLastElement(*target);
+                if (options.shapedArrays && !packed)
+                    shapeLastElement(*target);
+
+                char_t comma = read1(stream);
+                if (errorCode != 0) break;
+                if (comma != ',') {
+                    if (comma != ']')
+                        throwParseError(makeString("Expected ']' instead of '") + comma + makeString("'."));
+                    break;
                 }
+                stage = Stage::ARRAY_LOOP;
                 break;
             }
-            skipWhitespace(stream);
+            }
         }
     }
 
-    void Parser::parseArray(istream_t& stream, Value& result) {
-        result.type = ValueType::Array;
+    // The same state machine as parseValue, but the open containers are only tracked by kind
+    // and every value is passed to the handler instead of being stored.
+    void Parser::parseEvents(istream_t& stream, SaxHandler& handler) {
+        enum class Stage {
+            VALUE = 0,
+            VALUE_END = 1,
+            RETURN = 2,
+            OBJECT_LOOP = 3,
+            OBJECT_ELEMENT = 4,
+            ARRAY_LOOP = 5,
+            ARRAY_ELEMENT = 6,
+        };
 
-        skipWhitespace(stream);
-        if (errorCode != 0) return;
+        // True for objects, false for arrays.
+        std::vector<bool> parents;
+        // Key of the member being parsed per depth, kept alive while its value is parsed.
+        // A deque so growing it for deeper members does not move the keys handlers still reference.
+        std::deque<str_t> keys;
+        bool object = false;
+        Stage stage = Stage::VALUE;
+        Value number;
+
+        while (true) {
+            switch (stage) {
+            case Stage::VALUE: {
+                if (errorCode != 0) {
+                    stage = Stage::RETURN;
+                    break;
+                }
+
+                skipWhitespace(stream);
+
+                char_t lead = read1(stream);
+                if (errorCode != 0) {
+                    stage = Stage::RETURN;
+                    break;
+                }
+
+                stage = Stage::VALUE_END;
+                if (lead == '{' || lead == '[') {
+                    if (parents.size() >= options.maxDepth) {
+                        throwParseError(makeString("Exceeded maximum nesting depth."));
+                        return;
+                    }
+                }
+
+                if (lead == '{') {
+                    object = true;
+                    handler.beginObject();
+
+                    skipWhitespace(stream);
+                    if (errorCode != 0) break;
+#ifndef TT_JSON5_OBJECT_SUPPORT_TRAILING_COMMA
+                    if (read1(stream) == '}') {
+                        handler.endObject();
+                        break;
+                    }
+                    rewind1(stream);
+                    if (errorCode != 0) break;
+#endif
+                    stage = Stage::OBJECT_LOOP;
+                } else if (lead == '[') {
+                    object = false;
+                    handler.beginArray();
+
+                    skipWhitespace(stream);
+                    if (errorCode != 0) break;
 #ifndef TT_JSON5_ARRAY_SUPPORT_TRAILING_COMMA
-        if (read1(stream) == ']')
-            return;
-        rewind1(stream);
-        if (errorCode != 0) return;
+                    if (read1(stream) == ']') {
+                        handler.endArray();
+                        break;
+                    }
+                    rewind1(stream);
+                    if (errorCode != 0) break;
+#endif
+                    stage = Stage::ARRAY_LOOP;
+                } else if (lead == '"') {
+                    str_t value = parseString(stream);
+                    if (errorCode == 0)
+                        handler.string(value);
+#ifdef TT_JSON5_STRING_SUPPORT_SINGLE_QUOTES
+                } else if (lead == '\'') {
+                    str_t value = parseString(stream, '\'');
+                    if (errorCode == 0)
+                        handler.string(value);
 #endif
+                } else if (lead == 'f' && parseKeyword(stream, makeString("alse"))) {
+                    handler.boolean(false);
+                } else if (lead == 't' && parseKeyword(stream, makeString("rue"))) {
+                    handler.boolean(true);
+                } else if (lead == 'n' && parseKeyword(stream, makeString("ull")))
+                    handler.null();
+                else {
+                    parseNumber(stream, lead, number);
+                    if (errorCode == 0) {
+                        if (number.type == ValueType::Int)
+                            handler.integer(number.asInt());
+                        else
+                            handler.number(number.asDouble());
+                    }
+                }
+                break;
+            }
 
-        while (true) {
+            case Stage::VALUE_END:
+                skipWhitespace(stream);
+                stage = Stage::RETURN;
+                break;
+
+            case Stage::RETURN:
+                if (parents.empty())
+                    return;
+                object = parents.back();
+                parents.pop_back();
+                stage = object ? Stage::OBJECT_ELEMENT : Stage::ARRAY_ELEMENT;
+                break;
+
+            case Stage::OBJECT_LOOP: {
+#ifdef TT_JSON5_OBJECT_SUPPORT_TRAILING_COMMA
+                char_t lead = read1(stream);
+                if (lead == '}') {
+                    handler.endObject();
+                    stage = Stage::VALUE_END;
+                    break;
+                } else
+                    rewind1(stream);
+#endif
+                if (keys.size() <= parents.size())
+                    keys.resize(parents.size() + 1);
+                str_t& key = keys[parents.size()];
+                key = parseKey(stream);
+                if (errorCode == 0)
+                    handler.key(key);
+
+                stage = Stage::VALUE_END;
+                skipWhitespace(stream);
+                if (errorCode != 0) break;
+
+                char_t delim = read1(stream);
+                if (errorCode != 0) break;
+                if (delim != ':') {
+                    throwParseError(makeString("Expected ':' instead of '") + delim + makeString("'."));
+                    break;
+                }
+
+                parents.push_back(true);
+                stage = Stage::VALUE;
+                break;
+            }
+
+            case Stage::OBJECT_ELEMENT: {
+                char_t comma = read1(stream);
+                if (comma != ',') {
+                    if (comma != '}')
+                        throwParseError(makeString("Expected '}' instead of '") + comma + makeString("'."));
+                    else
+                        handler.endObject();
+                    stage = Stage::VALUE_END;
+                    break;
+                }
+                skipWhitespace(stream);
+                stage = Stage::OBJECT_LOOP;
+                break;
+            }
+
+            case Stage::ARRAY_LOOP: {
 #ifdef TT_JSON5_ARRAY_SUPPORT_TRAILING_COMMA
-            skipWhitespace(stream);
-            if (errorCode != 0) return;
+                stage = Stage::VALUE_END;
+                skipWhitespace(stream);
+                if (errorCode != 0) break;
 
-            // If we reach here on the first loop, we have []
-            // If we reach here on subsequent loops, we have [value,]
-            char_t lead = read1(stream);
-            // if (errorCode != 0) return;
-            if (lead == ']')
-                return;
-            else
-                rewind1(stream);
+                char_t lead = read1(stream);
+                if (lead == ']') {
+                    handler.endArray();
+                    break;
+                } else
+                    rewind1(stream);
 #endif
-            result.aValue.emplace_back();
-            parseValue(stream, result.aValue.back());
-            if (errorCode != 0) return;
+                parents.push_back(false);
+                stage = Stage::VALUE;
+                break;
+            }
 
-            char_t comma = read1(stream);
-            if (errorCode != 0) return;
-            if (comma != ',') {
-                if (comma != ']') {
-                    throwParseError(makeString("Expected ']' instead of '") + comma + makeString("'."));
-                    return;
+            case Stage::ARRAY_ELEMENT: {
+                stage = Stage::VALUE_END;
+                if (errorCode != 0) break;
+
+                char_t comma = read1(stream);
+                if (errorCode != 0) break;
+                if (comma != ',') {
+                    if (comma != ']')
+                        throwParseError(makeString("Expected ']' instead of '") + comma + makeString("'."));
+                    else
+                        handler.endArray();
+                    break;
                 }
+                stage = Stage::ARRAY_LOOP;
                 break;
             }
+            }
         }
     }
 
-    void Parser::parseValue(istream_t& stream, Value& result) {
-        if (errorCode != 0) return;
+    // Called after each array element is parsed, moves the element into the array's columns if it has the same keys as the first element.
+    // Arrays that turn out to be mixed are reverted to regular objects.
+    void Parser::shapeLastElement(Value& array) {
+        Value& element = array.aValue.back();
 
-        skipWhitespace(stream);
+        if (array.storage == Value::Storage::Members) {
+            if (array.aValue.size() != 1 || element.type != ValueType::Object || element.oValue.empty())
+                return;
+            array.shape = new ArrayShape();
+            array.storage = Value::Storage::ShapedArray;
+            for (const auto& pair : element.oValue) {
+                array.shape->fields.emplace(pair.first, array.shape->keys.size());
+                array.shape->keys.push_back(pair.first);
+                array.shape->columns.emplace_back();
+            }
+        }
 
-        char_t lead = read1(stream);
-        if (errorCode != 0) return;
+        if (array.storage != Value::Storage::ShapedArray)
+            return;
 
-        if (lead == '{')
-            parseObject(stream, result);
-        else if (lead == '[')
-            parseArray(stream, result);
-        else if (lead == '"') {
-            result.type = ValueType::String;
-            result.sValue = parseString(stream);
-#ifdef TT_JSON5_STRING_SUPPORT_SINGLE_QUOTES
-        } else if (lead == '\'') {
-            result.type = ValueType::String;
-            result.sValue = parseString(stream, '\'');
-#endif
-        } else if (lead == 'f' && parseKeyword(stream, makeString("alse"))) {
-            result.type = ValueType::Bool;
-            result.bValue = false;
-        } else if (lead == 't' && parseKeyword(stream, makeString("rue"))) {
-            result.type = ValueType::Bool;
-            result.bValue = true;
-        } else if (lead == 'n' && parseKeyword(stream, makeString("ull")))
-            result.type = ValueType::Null;
-        else {
-            parseNumber(stream, lead, result);
+        ArrayShape& shape = *array.shape;
+        bool matches = element.type == ValueType::Object && element.oValue.size() == shape.keys.size();
+        if (matches) {
+            for (const auto& pair : element.oValue) {
+                if (shape.fields.find(pair.first) == shape.fields.end()) {
+                    matches = false;
+                    break;
+                }
+            }
         }
 
-        skipWhitespace(stream);
+        if (!matches) {
+            array.expand();
+            return;
+        }
+
+        for (auto& pair : element.oValue)
+            shape.columns[shape.fields[pair.first]].push_back(std::move(pair.second));
+        array.aValue.pop_back();
+    }
+
+    // Called after each array element is parsed, moves the element into the packed numbers while the array only contains numbers.
+    // While packing, the array holds at most the element that is being parsed.
+    bool Parser::packLastElement(Value& array) {
+        Value& element = array.aValue.back();
+        bool number = element.type == ValueType::Int || element.type == ValueType::Double;
+
+        if (array.storage != Value::Storage::PackedArray) {
+            if (array.storage != Value::Storage::Members || array.aValue.size() != 1 || !number)
+                return false;
+            array.packed = new PackedArray();
+            array.storage = Value::Storage::PackedArray;
+            array.packed->type = element.type;
+        }
+
+        if (!number) {
+            array.expand();
+            return false;
+        }
+
+        element.materialize();
+        PackedArray& packed = *array.packed;
+        // Integers beyond this can not be stored in a double exactly.
+        const long long exact = 1ll << (std::numeric_limits<scalar>::digits < 62 ? std::numeric_limits<scalar>::digits : 62);
+
+        if (element.type == ValueType::Int) {
+            if (packed.type == ValueType::Int) {
+                packed.ints.push_back(element.iValue);
+            } else {
+                if (element.iValue > exact || element.iValue < -exact) {
+                    array.expand();
+                    return false;
+                }
+                if (packed.integral.empty())
+                    packed.integral.resize(packed.doubles.size(), false);
+                packed.doubles.push_back((scalar)element.iValue);
+                packed.integral.push_back(true);
+            }
+        } else {
+            if (packed.type == ValueType::Int) {
+                for (long long value : packed.ints) {
+                    if (value > exact || value < -exact) {
+                        array.expand();
+                        return false;
+                    }
+                }
+                packed.type = ValueType::Double;
+                packed.doubles.assign(packed.ints.begin(), packed.ints.end());
+                packed.integral.assign(packed.ints.size(), true);
+                packed.ints = {};
+            }
+            packed.doubles.push_back(element.dValue);
+            if (!packed.integral.empty())
+                packed.integral.push_back(false);
+        }
+
+        array.aValue.pop_back();
+        return true;
     }
 
     bool Parser::hasError() {
@@ -1155,9 +2125,12 @@ namespace TTJson {
     }
 
     void Parser::parse(istream_t& stream, Value& result) {
+        spanBase = cursor;
         // Return null if file is empty.
         if (peek1(stream) == '\0') {
             result.type = ValueType::Null;
+            if (options.sourceMap)
+                *options.sourceMap = {};
             return;
         }
 
@@ -1169,6 +2142,190 @@ namespace TTJson {
         if (errorCode != 0) return;
         if (stream.eof()) return;
 
+#ifdef TT_JSON5_SUPPORT_MORE_WHITESPACE
+        skipWhitespace(stream);
+#endif
+
+        char_t next = read1(stream);
+        if (stream.eof()) {
+            clearError();
+            return;
+        }
+
+        throwParseError(makeString("Unexpected '") + next + makeString("' after value. Expected end of file."));
+    }
+
+    void Parser::reparse(const str_t& text, size_t offset, size_t removed, size_t inserted, Value& document, SourceMap& map) {
+        clearError();
+
+        struct Level {
+            SourceSpan* span;
+            Value* value;
+            // Absolute start in text.
+            size_t begin;
+            // Index of the next level's span in span->children.
+            size_t child;
+        };
+
+        // Containers only contain the edit if it is between their brackets, scalars may also be extended at either end.
+        auto contains = [&](const Level& level) {
+            const size_t end = level.begin + level.span->length;
+            if (level.value->type == ValueType::Object || level.value->type == ValueType::Array)
+                return level.begin < offset && offset + removed < end;
+            return level.begin <= offset && offset + removed <= end;
+        };
+
+        // Find the deepest value that contains the edit.
+        std::vector<Level> path;
+        Level level{ &map.root, &document, map.offset, 0 };
+        while (contains(level)) {
+            path.push_back(level);
+            const std::vector<size_t>& offsets = level.span->offsets;
+            auto next = std::upper_bound(offsets.begin(), offsets.end(), offset - level.begin);
+            if (next == offsets.begin())
+                break;
+            const size_t child = next - offsets.begin() - 1;
+            path.back().child = child;
+
+            Value* value = nullptr;
+            if (level.value->type == ValueType::Array) {
+                if (child < level.value->aValue.size())
+                    value = &level.value->aValue[child];
+            } else {
+                // Only the last of duplicate keys is stored in the document, the other occurrences have no value of their own.
+                const std::vector<str_t>& keys = level.span->keys;
+                bool duplicate = false;
+                for (size_t i = child + 1; i < keys.size() && !duplicate; ++i)
+                    duplicate = keys[i] == keys[child];
+                auto it = level.value->oValue.find(keys[child]);
+                if (!duplicate && it != level.value->oValue.end())
+                    value = &it->second;
+            }
+            if (!value)
+                break;
+            level = { &level.span->children[child], value, level.begin + offsets[child], 0 };
+        }
+
+        ParseOptions sliceOptions = options;
+        SourceMap sliceMap;
+        sliceOptions.sourceMap = &sliceMap;
+        const size_t delta = inserted - removed;
+
+        // Parses text[begin, begin + length) as one value between open and close, which must span exactly that text.
+        auto parseSlice = [&](size_t begin, size_t length, const str_t& open, const str_t& close, Value& result) {
+            if (begin + length > text.size())
+                return false;
+            // The trailing space ends a number at the end of the slice.
+            sstr_t stream(open + text.substr(begin, length) + close + makeString(' '));
+            Parser parser(sliceOptions);
+            parser.parse(stream, result);
+            return !parser.hasError() && sliceMap.offset == 0 && sliceMap.root.length == length + open.size() + close.size();
+        };
+
+        auto shiftParents = [&](size_t depth) {
+            for (size_t i = depth; i-- > 0;) {
+                SourceSpan& span = *path[i].span;
+                span.length += delta;
+                for (size_t j = path[i].child + 1; j < span.offsets.size(); ++j)
+                    span.offsets[j] += delta;
+            }
+        };
+
+        // Edits between the elements of an array (adding or removing one) only parse the elements around the edit, not the whole array.
+        auto replaceElements = [&](const Level& array) {
+            SourceSpan& span = *array.span;
+            std::vector<size_t>& offsets = span.offsets;
+            const size_t count = offsets.size();
+            // Elements [first, last) touch the edit, the unchanged neighbours around them are reparsed too as they bound the slice.
+            size_t first = std::upper_bound(offsets.begin(), offsets.end(), offset - array.begin) - offsets.begin();
+            if (first > 0 && array.begin + offsets[first - 1] + span.children[first - 1].length >= offset)
+                --first;
+            size_t last = std::upper_bound(offsets.begin(), offsets.end(), offset + removed - array.begin) - offsets.begin();
+            const size_t from = first > 0 ? first - 1 : 0;
+            const size_t to = last < count ? last + 1 : count;
+            if (from == 0 && to == count)
+                return false;
+
+            const size_t begin = first > 0 ? array.begin + offsets[from] : array.begin + 1;
+            const size_t end = last < count ? array.begin + offsets[last] + span.children[last].length : array.begin + span.length - 1;
+            const size_t length = end - begin + delta;
+            Value result;
+            if (!parseSlice(begin, length, makeString("["), makeString("]"), result))
+                return false;
+            // A slice bounded by neighbours must start and end with an element, not with a comma that is only valid in the full array.
+            SourceSpan& slice = sliceMap.root;
+            if (first > 0 && (slice.offsets.empty() || slice.offsets.front() != 1))
+                return false;
+            if (last < count && (slice.offsets.empty() || slice.offsets.back() + slice.children.back().length != length + 1))
+                return false;
+
+            // Overwrite the replaced range in place and only move the elements after it if the count changed.
+            auto splice = [from, to](auto& target, auto& source) {
+                const size_t common = std::min(to - from, source.size());
+                std::move(source.begin(), source.begin() + common, target.begin() + from);
+                if (common < source.size())
+                    target.insert(target.begin() + to, std::make_move_iterator(source.begin() + common), std::make_move_iterator(source.end()));
+                else
+                    target.erase(target.begin() + from + common, target.begin() + to);
+            };
+            for (size_t& sliceOffset : slice.offsets)
+                sliceOffset += begin - array.begin - 1;
+            const size_t added = slice.offsets.size();
+            splice(array.value->aValue, result.aValue);
+            splice(offsets, slice.offsets);
+            splice(span.children, slice.children);
+            for (size_t i = from + added; i < offsets.size(); ++i)
+                offsets[i] += delta;
+            span.length += delta;
+            return true;
+        };
+
+        // Try the smallest value first.
+        for (size_t depth = path.size(); depth-- > 0;) {
+            const Level& candidate = path[depth];
+            if (candidate.value->type == ValueType::Array && replaceElements(candidate)) {
+                shiftParents(depth);
+                return;
+            }
+
+            Value result;
+            if (!parseSlice(candidate.begin, candidate.span->length + delta, {}, {}, result))
+                continue;
+            *candidate.value = std::move(result);
+            *candidate.span = std::move(sliceMap.root);
+            shiftParents(depth);
+            return;
+        }
+
+        // The edit is outside the root value or changed it entirely.
+        sstr_t stream(text + makeString(' '));
+        Parser parser(sliceOptions);
+        Value result;
+        parser.parse(stream, result);
+        if (parser.hasError()) {
+            const ParseOptions ownOptions = options;
+            *this = parser;
+            options = ownOptions;
+            return;
+        }
+        document = std::move(result);
+        map = std::move(sliceMap);
+    }
+
+    void Parser::parse(istream_t& stream, SaxHandler& handler) {
+        if (peek1(stream) == '\0') {
+            handler.null();
+            return;
+        }
+
+#ifdef TT_JSON5_SUPPORT_MORE_WHITESPACE
+        skipWhitespace(stream);
+#endif
+
+        parseEvents(stream, handler);
+        if (errorCode != 0) return;
+        if (stream.eof()) return;
+
 #ifdef TT_JSON5_SUPPORT_MORE_WHITESPACE
         skipWhitespace(stream);
 #endif
@@ -1193,6 +2350,25 @@ namespace TTJson {
             if (!tab) return;
             out << '\n';
         }
+
+        // Objects and the rows of shaped arrays, forEach calls its argument with the key and value of each of the count members.
+        template<typename ForEach> void serializeObject(ostream_t& out, const char_t* tab, int depth, size_t count, ForEach forEach) {
+            out << '{';
+            if (count != 0)
+                newLine(out, tab);
+            forEach([&](const str_t& key, const Value& member) {
+                indent(out, tab, depth + 1);
+                out << '"';
+                out << key;
+                out << makeString("\": ");
+                serialize(member, out, tab, depth + 1);
+                if (--count != 0)
+                    out << makeString(", ");
+                newLine(out, tab);
+            });
+            indent(out, tab, depth);
+            out << '}';
+        }
     }
 
     ifstream_t readUtf8(const std::string& path) {
@@ -1208,6 +2384,7 @@ namespace TTJson {
     }
 
     void serialize(const Value& value, ostream_t& out, const char_t* tab, int depth) {
+        value.materialize();
         switch (value.type) {
         case ValueType::Int:
             out << value.iValue;
@@ -1224,12 +2401,53 @@ namespace TTJson {
         }
         case ValueType::String:
             out << '"';
-            out << value.sValue.c_str();
+            out << value.asString().c_str();
             out << '"';
             break;
         case ValueType::Array:
             out << '[';
-            {
+            if (value.storage == Value::Storage::PackedArray) {
+                const PackedArray& packed = *value.packed;
+                if (packed.type == ValueType::Int) {
+                    for (size_t i = 0; i < packed.ints.size(); ++i) {
+                        if (i != 0)
+                            out << ',';
+                        out << packed.ints[i];
+                    }
+                } else {
+                    // Same formatting as individual doubles, reusing one stream for all elements.
+                    sstr_t tmp;
+                    for (size_t i = 0; i < packed.doubles.size(); ++i) {
+                        if (i != 0)
+                            out << ',';
+                        if (!packed.integral.empty() && packed.integral[i]) {
+                            out << (long long)packed.doubles[i];
+                            continue;
+                        }
+                        tmp.str({});
+                        tmp << packed.doubles[i];
+                        str_t text = tmp.str();
+                        out << text.c_str();
+                        if (text.find('.') == str_t::npos)
+                            out << makeString(".0");
+                    }
+                }
+            } else if (value.storage == Value::Storage::ShapedArray) {
+                const ArrayShape& shape = *value.shape;
+                const size_t rows = shape.columns[0].size();
+                newLine(out, tab);
+                for (size_t row = 0; row < rows; ++row) {
+                    indent(out, tab, depth + 1);
+                    serializeObject(out, tab, depth + 1, shape.keys.size(), [&](auto&& member) {
+                        for (size_t i = 0; i < shape.keys.size(); ++i)
+                            member(shape.keys[i].str(), shape.columns[i][row]);
+                    });
+                    if (row + 1 != rows)
+                        out << ',';
+                    newLine(out, tab);
+                }
+                indent(out, tab, depth);
+            } else {
                 bool mode = value.aValue.size() != 0 && value.aValue[0].type == ValueType::Object;
                 if (mode)
                     newLine(out, tab);
@@ -1248,21 +2466,10 @@ namespace TTJson {
             out << ']';
             break;
         case ValueType::Object:
-            out << '{';
-            if (value.oValue.size() != 0)
-                newLine(out, tab);
-            for (auto e = value.oValue.begin(); e != value.oValue.end(); ++e) {
-                indent(out, tab, depth + 1);
-                out << '"';
-                out << e->first;
-                out << makeString("\": ");
-                serialize(e->second, out, tab, depth + 1);
-                if (std::next(e) != value.oValue.end())
-                    out << makeString(", ");
-                newLine(out, tab);
-            }
-            indent(out, tab, depth);
-            out << '}';
+            serializeObject(out, tab, depth, value.oValue.size(), [&](auto&& member) {
+                for (const auto& pair : value.oValue)
+                    member(pair.first.str(), pair.second);
+            });
             break;
         case ValueType::Bool:
             out << makeString(value.bValue ? "true" : "false");
@@ -1273,16 +2480,72 @@ namespace TTJson {
         }
     }
 
-    TTJson::Value deserialize(istream_t& stream) {
+    void visit(const Value& value, SaxHandler& handler) {
+        switch (value.type) {
+        case ValueType::Null:
+            handler.null();
+            break;
+        case ValueType::Bool:
+            handler.boolean(value.bValue);
+            break;
+        case ValueType::Int:
+            handler.integer(value.asInt());
+            break;
+        case ValueType::Double:
+            handler.number(value.asDouble());
+            break;
+        case ValueType::String:
+            handler.string(value.asString());
+            break;
+        case ValueType::Array:
+            handler.beginArray();
+            if (value.storage == Value::Storage::PackedArray) {
+                const PackedArray& packed = *value.packed;
+                for (long long number : packed.ints)
+                    handler.integer(number);
+                for (size_t i = 0; i < packed.doubles.size(); ++i) {
+                    if (!packed.integral.empty() && packed.integral[i])
+                        handler.integer((long long)packed.doubles[i]);
+                    else
+                        handler.number(packed.doubles[i]);
+                }
+            } else if (value.storage == Value::Storage::ShapedArray) {
+                const ArrayShape& shape = *value.shape;
+                for (size_t row = 0; row < shape.columns[0].size(); ++row) {
+                    handler.beginObject();
+                    for (size_t i = 0; i < shape.keys.size(); ++i) {
+                        handler.key(shape.keys[i]);
+                        visit(shape.columns[i][row], handler);
+                    }
+                    handler.endObject();
+                }
+            } else {
+                for (const Value& element : value.aValue)
+                    visit(element, handler);
+            }
+            handler.endArray();
+            break;
+        case ValueType::Object:
+            handler.beginObject();
+            for (const auto& pair : value.oValue) {
+                handler.key(pair.first);
+                visit(pair.second, handler);
+            }
+            handler.endObject();
+            break;
+        }
+    }
+
+    TTJson::Value deserialize(istream_t& stream, const ParseOptions& options) {
         TTJson::Value document;
-        TTJson::Parser parser;
+        TTJson::Parser parser(options);
         parser.parse(stream, document);
         return document;
     }
 
-    TTJson::Value load(const std::string_view path) {
+    TTJson::Value load(const std::string_view path, const ParseOptions& options) {
         std::ifstream ifs((std::string)path, std::ios::binary | std::ios::in);
-        return deserialize(ifs);
+        return deserialize(ifs, options);
     }
 
     void save(const std::string_view path, const TTJson::Value& value, const char_t* tab) {
@@ -0,0 +1,471 @@
+#include "tt_json5_transcoder.h"
+#include <vector>
+#include <emmintrin.h>
+
+namespace {
+	int lowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	bool isHex(char chr) {
+		return (chr >= '0' && chr <= '9') || (chr >= 'a' && chr <= 'f') || (chr >= 'A' && chr <= 'F');
+	}
+
+	bool isDigit(char chr) {
+		return chr >= '0' && chr <= '9';
+	}
+
+	bool isIdentifierChar(char chr) {
+		return (chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z') || isDigit(chr) || chr == '_' || chr == '$' || (unsigned char)chr >= 0x80;
+	}
+
+	// Number of bytes from p that can be copied into a double quoted string as is,
+	// stops at quotes, backslashes and control characters. Checks 16 bytes per step.
+	size_t plainRun(const char* p, const char* end) {
+		const char* start = p;
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i apostrophe = _mm_set1_epi8('\'');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		while (end - p >= 16) {
+			__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i stop = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, apostrophe)),
+				_mm_or_si128(_mm_cmpeq_epi8(chars, backslash), _mm_cmpeq_epi8(_mm_max_epu8(chars, control), control)));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(stop);
+			if (mask != 0)
+				return p - start + lowestBit(mask);
+			p += 16;
+		}
+		while (p < end && *p != '"' && *p != '\'' && *p != '\\' && (unsigned char)*p > 0x1F)
+			++p;
+		return p - start;
+	}
+
+	class Transcoder {
+		const char* begin;
+		const char* cur;
+		const char* end;
+		std::string& out;
+		TT::Json5Output format;
+		std::string message;
+		// '{' or '[' per open container.
+		std::vector<char> stack;
+
+		bool fail(const std::string& reason) {
+			size_t line = 1;
+			size_t column = 1;
+			for (const char* p = begin; p < cur; ++p) {
+				if (*p == '\n') {
+					++line;
+					column = 1;
+				} else {
+					++column;
+				}
+			}
+			message = "line: " + std::to_string(line) + ", column: " + std::to_string(column) + ". " + reason;
+			return false;
+		}
+
+		// Length of the line terminator at p, 0 if there is none.
+		size_t lineTerminator(const char* p) const {
+			if (*p == '\n') return 1;
+			if (*p == '\r') return (p + 1 < end && p[1] == '\n') ? 2 : 1;
+			// U+2028, U+2029
+			if (end - p >= 3 && (unsigned char)p[0] == 0xE2 && (unsigned char)p[1] == 0x80 && ((unsigned char)p[2] == 0xA8 || (unsigned char)p[2] == 0xA9)) return 3;
+			return 0;
+		}
+
+		// Length of the non ascii whitespace at p, 0 if there is none.
+		size_t unicodeSpace(const char* p) const {
+			unsigned char a = (unsigned char)p[0];
+			if (a < 0x80 || end - p < 2) return 0;
+			unsigned char b = (unsigned char)p[1];
+			if (a == 0xC2 && b == 0xA0) return 2; // U+00A0
+			if (end - p < 3) return 0;
+			unsigned char c = (unsigned char)p[2];
+			if (a == 0xEF && b == 0xBB && c == 0xBF) return 3; // U+FEFF
+			if (a == 0xE1 && b == 0x9A && c == 0x80) return 3; // U+1680
+			if (a == 0xE2 && b == 0x80 && ((c >= 0x80 && c <= 0x8A) || c == 0xA8 || c == 0xA9 || c == 0xAF)) return 3; // U+2000-200A, U+2028, U+2029, U+202F
+			if (a == 0xE2 && b == 0x81 && c == 0x9F) return 3; // U+205F
+			if (a == 0xE3 && b == 0x80 && c == 0x80) return 3; // U+3000
+			return 0;
+		}
+
+		bool skipSpace() {
+			while (cur < end) {
+				char chr = *cur;
+				if (chr == ' ' || chr == '\t' || chr == '\n' || chr == '\r' || chr == '\v' || chr == '\f') {
+					++cur;
+				} else if (chr == '/' && cur + 1 < end && cur[1] == '/') {
+					cur += 2;
+					while (cur < end && lineTerminator(cur) == 0)
+						++cur;
+				} else if (chr == '/' && cur + 1 < end && cur[1] == '*') {
+					const char* start = cur;
+					cur += 2;
+					while (cur + 1 < end && !(cur[0] == '*' && cur[1] == '/'))
+						++cur;
+					if (cur + 1 >= end) {
+						cur = start;
+						return fail("Unterminated block comment.");
+					}
+					cur += 2;
+				} else if (size_t size = unicodeSpace(cur)) {
+					cur += size;
+				} else {
+					break;
+				}
+			}
+			return true;
+		}
+
+		bool hexDigits(int count) {
+			for (int i = 0; i < count; ++i) {
+				if (cur + i >= end || !isHex(cur[i]))
+					return fail("Invalid escape sequence, expected " + std::to_string(count) + " hexadecimal digits.");
+			}
+			return true;
+		}
+
+		// Append a string character, escaping what json does not allow unescaped.
+		void appendChar(char chr) {
+			if (chr == '"') {
+				out += "\\\"";
+			} else if ((unsigned char)chr <= 0x1F) {
+				static const char hex[] = "0123456789abcdef";
+				out += "\\u00";
+				out += hex[(unsigned char)chr >> 4];
+				out += hex[chr & 15];
+			} else {
+				out += chr;
+			}
+		}
+
+		bool string() {
+			char quote = *cur++;
+			out += '"';
+			while (true) {
+				size_t run = plainRun(cur, end);
+				out.append(cur, run);
+				cur += run;
+				if (cur >= end)
+					return fail("Unterminated string.");
+
+				char chr = *cur;
+				if (chr == quote) {
+					++cur;
+					out += '"';
+					return true;
+				}
+				if (chr == '"' || chr == '\'') {
+					// The other quote, double quotes only get here inside single quoted strings.
+					appendChar(chr);
+					++cur;
+					continue;
+				}
+				if (chr != '\\') {
+					if (lineTerminator(cur) != 0)
+						return fail("Unexpected line break.");
+					appendChar(chr);
+					++cur;
+					continue;
+				}
+
+				++cur;
+				if (cur >= end)
+					return fail("Unterminated string.");
+				chr = *cur;
+				if (size_t size = lineTerminator(cur)) {
+					// Line continuation.
+					cur += size;
+					continue;
+				}
+				switch (chr) {
+				case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+					out += '\\';
+					out += chr;
+					++cur;
+					break;
+				case '\'':
+					out += '\'';
+					++cur;
+					break;
+				case 'v':
+					out += "\\u000b";
+					++cur;
+					break;
+				case '0':
+					if (cur + 1 < end && isDigit(cur[1]))
+						return fail("Octal escape sequences are not allowed.");
+					out += "\\u0000";
+					++cur;
+					break;
+				case 'x':
+					++cur;
+					if (!hexDigits(2)) return false;
+					out += "\\u00";
+					out.append(cur, 2);
+					cur += 2;
+					break;
+				case 'u':
+					++cur;
+					if (!hexDigits(4)) return false;
+					out += "\\u";
+					out.append(cur, 4);
+					cur += 4;
+					break;
+				default:
+					if (isDigit(chr))
+						return fail("Octal escape sequences are not allowed.");
+					// Any other escaped character is the character itself.
+					appendChar(chr);
+					++cur;
+					break;
+				}
+			}
+		}
+
+		bool identifier() {
+			bool quoted = format == TT::Json5Output::Json;
+			if (quoted)
+				out += '"';
+			const char* start = cur;
+			while (cur < end) {
+				if (*cur == '\\') {
+					if (cur + 1 >= end || cur[1] != 'u')
+						return fail("Invalid escape sequence in identifier.");
+					cur += 2;
+					if (!hexDigits(4)) return false;
+					cur += 4;
+				} else if (isIdentifierChar(*cur) && unicodeSpace(cur) == 0) {
+					++cur;
+				} else {
+					break;
+				}
+			}
+			if (cur == start || isDigit(*start))
+				return fail("Expected a key.");
+			out.append(start, cur - start);
+			if (quoted)
+				out += '"';
+			return true;
+		}
+
+		bool word(const char* text) {
+			const char* start = cur;
+			for (; *text != '\0'; ++text, ++cur) {
+				if (cur >= end || *cur != *text) {
+					cur = start;
+					return fail("Unexpected character.");
+				}
+			}
+			out.append(start, cur - start);
+			return true;
+		}
+
+		bool number() {
+			const char* start = cur;
+			bool negative = false;
+			if (*cur == '-' || *cur == '+') {
+				negative = *cur == '-';
+				++cur;
+			}
+			if (cur < end && (*cur == 'I' || *cur == 'N')) {
+				if (format == TT::Json5Output::Json)
+					return fail("Infinity and NaN can not be represented in json.");
+				out.append(start, cur - start);
+				return word(*cur == 'I' ? "Infinity" : "NaN");
+			}
+
+			if (cur + 1 < end && cur[0] == '0' && (cur[1] == 'x' || cur[1] == 'X')) {
+				cur += 2;
+				const char* digits = cur;
+				unsigned long long value = 0;
+				for (; cur < end && isHex(*cur); ++cur) {
+					if (value >> 60)
+						return fail("Hexadecimal number is too large.");
+					int digit = *cur <= '9' ? *cur - '0' : (*cur | 0x20) - 'a' + 10;
+					value = value * 16 + digit;
+				}
+				if (cur == digits)
+					return fail("Expected hexadecimal digits.");
+				if (format == TT::Json5Output::Json5) {
+					out.append(start, cur - start);
+					return true;
+				}
+				if (negative && value != 0)
+					out += '-';
+				out += std::to_string(value);
+				return true;
+			}
+
+			const char* integer = cur;
+			while (cur < end && isDigit(*cur))
+				++cur;
+			size_t integerDigits = cur - integer;
+			if (integerDigits > 1 && *integer == '0') {
+				cur = integer + 1;
+				return fail("Leading zeros are not allowed.");
+			}
+			const char* fraction = nullptr;
+			size_t fractionDigits = 0;
+			if (cur < end && *cur == '.') {
+				fraction = ++cur;
+				while (cur < end && isDigit(*cur))
+					++cur;
+				fractionDigits = cur - fraction;
+			}
+			if (integerDigits + fractionDigits == 0) {
+				cur = start;
+				return fail("Unexpected character.");
+			}
+			const char* exponent = cur;
+			if (cur < end && (*cur == 'e' || *cur == 'E')) {
+				++cur;
+				if (cur < end && (*cur == '+' || *cur == '-'))
+					++cur;
+				const char* digits = cur;
+				while (cur < end && isDigit(*cur))
+					++cur;
+				if (cur == digits)
+					return fail("Expected exponent digits.");
+			}
+
+			if (format == TT::Json5Output::Json5) {
+				out.append(start, cur - start);
+				return true;
+			}
+			if (negative)
+				out += '-';
+			if (integerDigits == 0)
+				out += '0';
+			else
+				out.append(integer, integerDigits);
+			if (fraction) {
+				out += '.';
+				if (fractionDigits == 0)
+					out += '0';
+				else
+					out.append(fraction, fractionDigits);
+			}
+			out.append(exponent, cur - exponent);
+			return true;
+		}
+
+		bool value() {
+			char chr = *cur;
+			switch (chr) {
+			case '"':
+			case '\'':
+				return string();
+			case 't':
+				return word("true");
+			case 'f':
+				return word("false");
+			case 'n':
+				return word("null");
+			default:
+				if (isDigit(chr) || chr == '-' || chr == '+' || chr == '.' || chr == 'I' || chr == 'N')
+					return number();
+				return fail(std::string("Unexpected '") + chr + "'.");
+			}
+		}
+
+	public:
+		Transcoder(const std::string_view input, std::string& out, TT::Json5Output format) :
+			begin(input.data()), cur(input.data()), end(input.data() + input.size()), out(out), format(format) {}
+
+		const std::string& error() const { return message; }
+
+		bool run() {
+			out.reserve(out.size() + (end - begin));
+			enum class Expect { Value, Key, AfterValue } expect = Expect::Value;
+			while (true) {
+				if (!skipSpace()) return false;
+				if (cur >= end) {
+					if (expect == Expect::AfterValue && stack.empty())
+						return true;
+					return fail("Unexpected end of input.");
+				}
+
+				char chr = *cur;
+				switch (expect) {
+				case Expect::Value:
+					if (chr == '{' || chr == '[') {
+						stack.push_back(chr);
+						out += chr;
+						++cur;
+						if (!skipSpace()) return false;
+						if (cur < end && (*cur == '}' || *cur == ']')) {
+							expect = Expect::AfterValue;
+							continue;
+						}
+						expect = chr == '{' ? Expect::Key : Expect::Value;
+						continue;
+					}
+					if (chr == '}' || chr == ']')
+						return fail(std::string("Unexpected '") + chr + "'.");
+					if (!value()) return false;
+					expect = Expect::AfterValue;
+					break;
+
+				case Expect::Key:
+					if (chr == '"' || chr == '\'') {
+						if (!string()) return false;
+					} else if (!identifier()) {
+						return false;
+					}
+					if (!skipSpace()) return false;
+					if (cur >= end || *cur != ':')
+						return fail("Expected ':'.");
+					out += ':';
+					++cur;
+					expect = Expect::Value;
+					break;
+
+				case Expect::AfterValue: {
+					if (stack.empty())
+						return fail(std::string("Unexpected '") + chr + "' after value. Expected end of file.");
+					char close = stack.back() == '{' ? '}' : ']';
+					if (chr == close) {
+						out += close;
+						stack.pop_back();
+						++cur;
+						break;
+					}
+					if (chr != ',')
+						return fail(std::string("Expected ',' or '") + close + "'.");
+					++cur;
+					if (!skipSpace()) return false;
+					// Trailing comma.
+					if (cur < end && *cur == close)
+						break;
+					out += ',';
+					expect = stack.back() == '{' ? Expect::Key : Expect::Value;
+					break;
+				}
+				}
+			}
+		}
+	};
+}
+
+namespace TT {
+	bool transcodeJson5(const std::string_view input, std::string& output, Json5Output format, std::string* error) {
+		size_t outputSize = output.size();
+		Transcoder transcoder(input, output, format);
+		if (transcoder.run())
+			return true;
+		output.resize(outputSize);
+		if (error)
+			*error = transcoder.error();
+		return false;
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace TT {
+	enum class Json5Output {
+		// Strict, minified json.
+		Json,
+		// Minified json5, identifier keys and json5 numbers are kept as written.
+		Json5,
+	};
+
+	// Converts json5 text to minified json (or json5) in one pass over the bytes without building a document.
+	// Comments, whitespace and trailing commas are dropped, identifier keys are quoted, single quoted strings become double quoted
+	// and json5 escapes and numbers (hex, leading / trailing decimal point, explicit +) are rewritten to their json equivalent.
+	// Memory use beyond the output is one byte per nesting level. The output is appended to (and left as is on failure), the input is expected to be UTF8.
+	// Returns false with a message (including line and column) if the input is not valid json5, or,
+	// when writing json, contains Infinity or NaN which json can not represent.
+	bool transcodeJson5(const std::string_view input, std::string& output, Json5Output format = Json5Output::Json, std::string* error = nullptr);
+}
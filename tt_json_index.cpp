@@ -0,0 +1,572 @@
+#include "tt_json_index.h"
+#include "tt_files.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+
+namespace {
+	const unsigned int INDEX_MAGIC = 0x494A5454; // "TTJI"
+	const unsigned int INDEX_VERSION = 1;
+
+	void appendUtf8(std::string& text, unsigned int codePoint) {
+		if (codePoint < 0x80) {
+			text += (char)codePoint;
+		} else if (codePoint < 0x800) {
+			text += (char)(0xC0 | (codePoint >> 6));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		} else if (codePoint < 0x10000) {
+			text += (char)(0xE0 | (codePoint >> 12));
+			text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		} else {
+			text += (char)(0xF0 | (codePoint >> 18));
+			text += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	// -1 if chr is not a hexadecimal digit.
+	int hexValue(int chr) {
+		return chr >= '0' && chr <= '9' ? chr - '0' : (chr | 0x20) >= 'a' && (chr | 0x20) <= 'f' ? (chr | 0x20) - 'a' + 10 : -1;
+	}
+
+	bool isDelimiter(int chr) {
+		return chr == ' ' || chr == '\t' || chr == '\n' || chr == '\r' || chr == '\v' || chr == '\f' ||
+			chr == ',' || chr == ':' || chr == '[' || chr == ']' || chr == '{' || chr == '}' || chr == '/' || chr == '"' || chr == '\'';
+	}
+
+	// Buffered forward reading with absolute offsets.
+	class Scanner {
+		std::FILE* fp;
+		std::vector<char> buffer;
+		size_t pos = 0;
+		size_t size = 0;
+		unsigned long long base = 0;
+
+	public:
+		Scanner(std::FILE* fp) : fp(fp), buffer(1 << 20) {}
+
+		// Make sure count bytes are buffered, false at the end of the file.
+		bool ensure(size_t count) {
+			if (size - pos >= count)
+				return true;
+			memmove(buffer.data(), buffer.data() + pos, size - pos);
+			base += pos;
+			size -= pos;
+			pos = 0;
+			size += std::fread(buffer.data() + size, 1, buffer.size() - size, fp);
+			return size - pos >= count;
+		}
+
+		// -1 at the end of the file.
+		int peek(size_t ahead = 0) {
+			return ensure(ahead + 1) ? (unsigned char)buffer[pos + ahead] : -1;
+		}
+
+		// Only skips buffered bytes, so the cursor never moves past the end of the file.
+		void skip(size_t count = 1) {
+			pos = std::min(pos + count, size);
+		}
+
+		unsigned long long offset() const {
+			return base + pos;
+		}
+
+		// Length of the non ascii whitespace at the cursor, 0 if there is none.
+		size_t unicodeSpace() {
+			int a = peek();
+			if (a < 0x80) return 0;
+			int b = peek(1);
+			if (a == 0xC2 && b == 0xA0) return 2;
+			int c = peek(2);
+			if (a == 0xEF && b == 0xBB && c == 0xBF) return 3;
+			if (a == 0xE1 && b == 0x9A && c == 0x80) return 3;
+			if (a == 0xE2 && b == 0x80 && ((c >= 0x80 && c <= 0x8A) || c == 0xA8 || c == 0xA9 || c == 0xAF)) return 3;
+			if (a == 0xE2 && b == 0x81 && c == 0x9F) return 3;
+			if (a == 0xE3 && b == 0x80 && c == 0x80) return 3;
+			return 0;
+		}
+
+		// False if the file ends inside a block comment.
+		bool skipSpace() {
+			while (true) {
+				int chr = peek();
+				if (chr == ' ' || chr == '\t' || chr == '\n' || chr == '\r' || chr == '\v' || chr == '\f') {
+					skip();
+				} else if (chr == '/' && peek(1) == '/') {
+					skip(2);
+					while ((chr = peek()) != -1 && chr != '\n' && chr != '\r')
+						skip();
+				} else if (chr == '/' && peek(1) == '*') {
+					skip(2);
+					while (peek() != -1 && !(peek() == '*' && peek(1) == '/'))
+						skip();
+					if (peek() == -1)
+						return false;
+					skip(2);
+				} else if (size_t size = unicodeSpace()) {
+					skip(size);
+				} else {
+					return true;
+				}
+			}
+		}
+
+		// Skip a quoted string, decoding it into text if that is not null.
+		bool string(std::string* text) {
+			char quote = (char)peek();
+			skip();
+			while (ensure(1)) {
+				const char* start = buffer.data() + pos;
+				const char* end = buffer.data() + size;
+				const char* cur = start;
+				while (cur < end && *cur != quote && *cur != '\\')
+					++cur;
+				if (text)
+					text->append(start, cur);
+				pos += cur - start;
+				if (cur == end)
+					continue;
+				if (*cur == quote) {
+					skip();
+					return true;
+				}
+
+				int escape = peek(1);
+				if (escape == -1) {
+					skip();
+					return false;
+				}
+				skip(2);
+				if (!text)
+					continue;
+				switch (escape) {
+				case 'b': *text += '\b'; break;
+				case 'f': *text += '\f'; break;
+				case 'n': *text += '\n'; break;
+				case 'r': *text += '\r'; break;
+				case 't': *text += '\t'; break;
+				case 'v': *text += '\v'; break;
+				case '0': *text += '\0'; break;
+				case '\n': break;
+				case '\r': if (peek() == '\n') skip(); break;
+				case 'x':
+				case 'u': {
+					int digits = escape == 'x' ? 2 : 4;
+					unsigned int codePoint = 0;
+					for (int i = 0; i < digits; ++i) {
+						int value = hexValue(peek());
+						if (value < 0)
+							return false;
+						codePoint = codePoint * 16 + value;
+						skip();
+					}
+					// Combine utf16 surrogate pairs.
+					if (codePoint >= 0xD800 && codePoint <= 0xDBFF && peek() == '\\' && peek(1) == 'u') {
+						int low = 0;
+						for (int i = 0; i < 4 && low >= 0; ++i) {
+							int value = hexValue(peek(2 + i));
+							low = value < 0 ? -1 : low * 16 + value;
+						}
+						if (low >= 0xDC00 && low <= 0xDFFF) {
+							skip(6);
+							codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+						}
+					}
+					appendUtf8(*text, codePoint);
+					break;
+				}
+				default: *text += (char)escape; break;
+				}
+			}
+			return false;
+		}
+
+		// Skip a number, literal or identifier, appending it to text if that is not null.
+		void token(std::string* text) {
+			int chr;
+			while ((chr = peek()) != -1 && !isDelimiter(chr) && unicodeSpace() == 0) {
+				if (text)
+					*text += (char)chr;
+				skip();
+			}
+		}
+	};
+
+	// 64 bit seeking, ftell / fseek use a 32 bit long on windows.
+	int seek(std::FILE* fp, unsigned long long offset, int origin) {
+#ifdef _MSC_VER
+		return _fseeki64(fp, (long long)offset, origin);
+#else
+		return fseeko(fp, (off_t)offset, origin);
+#endif
+	}
+
+	unsigned long long tell(std::FILE* fp) {
+#ifdef _MSC_VER
+		return (unsigned long long)_ftelli64(fp);
+#else
+		return (unsigned long long)ftello(fp);
+#endif
+	}
+}
+
+namespace TT {
+	bool JsonIndex::open(const std::string_view jsonPath, size_t maxDepth, std::string* error) {
+		std::string indexPath = std::string(jsonPath) + ".index";
+		if (load(indexPath, jsonPath) && this->maxDepth == maxDepth)
+			return true;
+		if (!build(jsonPath, maxDepth, error))
+			return false;
+		save(indexPath);
+		return true;
+	}
+
+	bool JsonIndex::build(const std::string_view jsonPath, size_t maxDepth, std::string* error) {
+		this->jsonPath = jsonPath;
+		this->maxDepth = maxDepth;
+		list.clear();
+		sorted.clear();
+
+		std::FILE* fp = nullptr;
+		fopen_s(&fp, this->jsonPath.c_str(), "rb");
+		if (!fp) {
+			if (error)
+				*error = "Failed to open '" + this->jsonPath + "'.";
+			return false;
+		}
+		writeTime = fileLastWriteTime(jsonPath);
+
+		struct Frame {
+			bool object;
+			// Index in list, or npos if this container is deeper than maxDepth.
+			size_t entry;
+			// Size of path before this container was entered.
+			size_t pathSize;
+			size_t count;
+		};
+
+		Scanner scanner(fp);
+		std::vector<Frame> frames;
+		// Path of the innermost indexed container.
+		std::string path;
+		// Decoded key of the member being scanned.
+		std::string key;
+		enum class Expect { Value, Key, AfterValue } expect = Expect::Value;
+		std::string message;
+
+		auto close = [&]() {
+			scanner.skip();
+			const Frame& frame = frames.back();
+			if (frame.entry != std::string::npos)
+				list[frame.entry].length = scanner.offset() - list[frame.entry].offset;
+			path.resize(frame.pathSize);
+			frames.pop_back();
+			expect = Expect::AfterValue;
+		};
+
+		while (message.empty()) {
+			if (!scanner.skipSpace()) {
+				message = "Unterminated comment.";
+				break;
+			}
+			int chr = scanner.peek();
+			if (chr == -1) {
+				if (expect != Expect::AfterValue || !frames.empty())
+					message = "Unexpected end of file.";
+				break;
+			}
+			char closing = frames.empty() ? '\0' : frames.back().object ? '}' : ']';
+
+			switch (expect) {
+			case Expect::Value: {
+				if (chr == closing) {
+					// Empty array or trailing comma.
+					close();
+					break;
+				}
+				size_t depth = frames.size();
+				size_t pathSize = path.size();
+				size_t entry = std::string::npos;
+				if (depth <= maxDepth) {
+					if (depth > 0)
+						TTJson::appendPathToken(path, frames.back().object ? key : std::to_string(frames.back().count));
+					entry = list.size();
+					list.push_back({ path, scanner.offset(), 0 });
+				}
+
+				if (chr == '{' || chr == '[') {
+					scanner.skip();
+					frames.push_back({ chr == '{', entry, pathSize, 0 });
+					expect = chr == '{' ? Expect::Key : Expect::Value;
+					break;
+				}
+				if (chr == '"' || chr == '\'') {
+					if (!scanner.string(nullptr))
+						message = "Unterminated string.";
+				} else if (isDelimiter(chr)) {
+					message = std::string("Unexpected '") + (char)chr + "'.";
+				} else {
+					scanner.token(nullptr);
+				}
+				if (entry != std::string::npos)
+					list[entry].length = scanner.offset() - list[entry].offset;
+				path.resize(pathSize);
+				expect = Expect::AfterValue;
+				break;
+			}
+
+			case Expect::Key: {
+				if (chr == '}') {
+					close();
+					break;
+				}
+				// Keys are only needed for paths of indexed values.
+				bool decode = frames.size() <= maxDepth;
+				key.clear();
+				if (chr == '"' || chr == '\'') {
+					if (!scanner.string(decode ? &key : nullptr))
+						message = "Unterminated string.";
+				} else {
+					scanner.token(decode ? &key : nullptr);
+				}
+				if (message.empty() && !scanner.skipSpace())
+					message = "Unterminated comment.";
+				if (!message.empty())
+					break;
+				if (scanner.peek() != ':') {
+					message = "Expected ':'.";
+					break;
+				}
+				scanner.skip();
+				expect = Expect::Value;
+				break;
+			}
+
+			case Expect::AfterValue:
+				if (frames.empty()) {
+					message = "Unexpected data after the document.";
+				} else if (chr == closing) {
+					close();
+				} else if (chr == ',') {
+					scanner.skip();
+					++frames.back().count;
+					expect = frames.back().object ? Expect::Key : Expect::Value;
+				} else {
+					message = std::string("Expected ',' or '") + closing + "'.";
+				}
+				break;
+			}
+		}
+
+		fileSize = scanner.offset();
+		std::fclose(fp);
+		if (!message.empty()) {
+			if (error)
+				*error = "Offset " + std::to_string(scanner.offset()) + ". " + message;
+			list.clear();
+			return false;
+		}
+		sortPaths();
+		return true;
+	}
+
+	bool JsonIndex::save(const std::string_view indexPath) const {
+		std::FILE* fp = nullptr;
+		fopen_s(&fp, std::string(indexPath).c_str(), "wb");
+		if (!fp)
+			return false;
+		auto u32 = [fp](unsigned int value) { std::fwrite(&value, sizeof(value), 1, fp); };
+		auto u64 = [fp](unsigned long long value) { std::fwrite(&value, sizeof(value), 1, fp); };
+		u32(INDEX_MAGIC);
+		u32(INDEX_VERSION);
+		u64(writeTime);
+		u64(fileSize);
+		u32((unsigned int)maxDepth);
+		u64(list.size());
+		for (const Entry& entry : list) {
+			u64(entry.offset);
+			u64(entry.length);
+			u32((unsigned int)entry.path.size());
+			std::fwrite(entry.path.data(), 1, entry.path.size(), fp);
+		}
+		std::fwrite(sorted.data(), sizeof(unsigned int), sorted.size(), fp);
+		bool success = std::ferror(fp) == 0;
+		std::fclose(fp);
+		return success;
+	}
+
+	bool JsonIndex::load(const std::string_view indexPath, const std::string_view jsonPath) {
+		list.clear();
+		sorted.clear();
+		if (!fileExists(indexPath) || !fileExists(jsonPath))
+			return false;
+
+		// One read, the index of a large file has many small entries.
+		const std::string data = readAllBytes(std::string(indexPath));
+		size_t pos = 0;
+		bool valid = true;
+		auto bytes = [&](void* target, size_t size) {
+			valid &= data.size() - pos >= size;
+			if (valid)
+				memcpy(target, data.data() + pos, size);
+			pos += valid ? size : 0;
+		};
+		auto u32 = [&]() { unsigned int value = 0; bytes(&value, sizeof(value)); return value; };
+		auto u64 = [&]() { unsigned long long value = 0; bytes(&value, sizeof(value)); return value; };
+
+		valid &= u32() == INDEX_MAGIC;
+		valid &= u32() == INDEX_VERSION;
+		writeTime = u64();
+		fileSize = u64();
+		maxDepth = u32();
+		unsigned long long count = u64();
+		// Every entry takes at least 20 bytes, this also guards the reserve against corrupt counts.
+		valid &= count <= (data.size() - pos) / 20;
+		if (valid)
+			list.reserve((size_t)count);
+		for (unsigned long long i = 0; valid && i < count; ++i) {
+			Entry entry;
+			entry.offset = u64();
+			entry.length = u64();
+			size_t size = u32();
+			valid &= data.size() - pos >= size;
+			if (valid) {
+				entry.path.assign(data.data() + pos, size);
+				pos += size;
+			}
+			list.push_back(std::move(entry));
+		}
+		valid &= (data.size() - pos) / sizeof(unsigned int) == count;
+		if (valid) {
+			sorted.resize((size_t)count);
+			bytes(sorted.data(), sorted.size() * sizeof(unsigned int));
+			for (unsigned int index : sorted)
+				valid &= index < count;
+		}
+
+		// The json file must be the one the index was built for.
+		std::FILE* json = nullptr;
+		fopen_s(&json, std::string(jsonPath).c_str(), "rb");
+		if (json) {
+			seek(json, 0, SEEK_END);
+			valid &= tell(json) == fileSize;
+			std::fclose(json);
+		}
+		valid &= json != nullptr && fileLastWriteTime(jsonPath) == writeTime;
+
+		if (!valid) {
+			list.clear();
+			sorted.clear();
+			return false;
+		}
+		this->jsonPath = jsonPath;
+		return true;
+	}
+
+	void JsonIndex::sortPaths() {
+		sorted.resize(list.size());
+		for (size_t i = 0; i < list.size(); ++i)
+			sorted[i] = (unsigned int)i;
+		std::sort(sorted.begin(), sorted.end(), [this](unsigned int a, unsigned int b) { return list[a].path < list[b].path; });
+	}
+
+	const JsonIndex::Entry* JsonIndex::find(const std::string_view path) const {
+		auto it = std::lower_bound(sorted.begin(), sorted.end(), path, [this](unsigned int index, const std::string_view path) { return list[index].path < path; });
+		return it != sorted.end() && list[*it].path == path ? &list[*it] : nullptr;
+	}
+
+	bool JsonIndex::readText(const std::string_view path, std::string& result) const {
+		const Entry* entry = find(path);
+		if (!entry)
+			return false;
+		std::FILE* fp = nullptr;
+		fopen_s(&fp, jsonPath.c_str(), "rb");
+		if (!fp)
+			return false;
+		result.resize((size_t)entry->length);
+		bool success = seek(fp, entry->offset, SEEK_SET) == 0 && std::fread(result.data(), 1, result.size(), fp) == result.size();
+		std::fclose(fp);
+		return success;
+	}
+
+	bool JsonIndex::read(const std::string_view path, TTJson::Value& result, const TTJson::ParseOptions& options, std::string* error) const {
+		// Find the closest indexed parent, then walk the remaining tokens in the parsed value.
+		size_t split = path.size();
+		while (!find(path.substr(0, split))) {
+			if (split == 0) {
+				if (error)
+					*error = "No index entry for '" + std::string(path) + "'.";
+				return false;
+			}
+			split = path.rfind('/', split - 1);
+			if (split == std::string_view::npos)
+				split = 0;
+		}
+
+		std::string text;
+		if (!readText(path.substr(0, split), text)) {
+			if (error)
+				*error = "Failed to read '" + jsonPath + "'.";
+			return false;
+		}
+		// The parser needs a character after a number at the end of its input.
+		text += '\n';
+#ifdef TT_JSON5_USE_WSTR
+		TTJson::sstr_t stream(TTJson::makeString(text.c_str()));
+#else
+		TTJson::sstr_t stream(text);
+#endif
+		TTJson::Parser parser(options);
+		TTJson::Value value;
+		parser.parse(stream, value);
+		if (parser.hasError()) {
+			if (error) {
+				TTJson::str_t message = parser.error();
+				*error = std::string(message.begin(), message.end());
+			}
+			return false;
+		}
+
+		const TTJson::Value* current = &value;
+		while (split < path.size()) {
+			size_t next = path.find('/', split + 1);
+			if (next == std::string_view::npos)
+				next = path.size();
+			std::string token;
+			for (size_t i = split + 1; i < next; ++i) {
+				if (path[i] == '~' && i + 1 < next) {
+					token += path[++i] == '1' ? '/' : '~';
+				} else {
+					token += path[i];
+				}
+			}
+			split = next;
+
+			const TTJson::Value* child = nullptr;
+			if (current->isObject()) {
+#ifdef TT_JSON5_USE_WSTR
+				child = current->asObject().tryGet(TTJson::makeString(token.c_str()));
+#else
+				child = current->asObject().tryGet(token);
+#endif
+			} else if (current->isArray() && !token.empty() && token.find_first_not_of("0123456789") == std::string::npos) {
+				// Json pointers have no leading zeros, and indices too large for size_t do not exist.
+				size_t index = 0;
+				auto [end, code] = std::from_chars(token.data(), token.data() + token.size(), index);
+				if (code == std::errc() && end == token.data() + token.size() && (token.size() == 1 || token[0] != '0') && index < current->asArray().size())
+					child = &current->asArray()[index];
+			}
+			if (!child) {
+				if (error)
+					*error = "'" + std::string(path) + "' does not exist.";
+				return false;
+			}
+			current = child;
+		}
+		result = *current;
+		return true;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include "tt_json5.h"
+
+namespace TT {
+	// Random access into large read-mostly json5 files. One pass over the file records the byte range of every value
+	// down to maxDepth, keyed by json pointer (e.g. "/nodes/12"), and stores it in a sidecar file next to the json.
+	// Reading a value then seeks to its range and parses only those bytes.
+	struct JsonIndex {
+		struct Entry {
+			// Json pointer, the root is "".
+			std::string path;
+			unsigned long long offset;
+			unsigned long long length;
+		};
+
+		// Loads jsonPath + ".index", or (re)builds and saves it if it is missing, or older than the json file.
+		// Returns false if the json file could not be read.
+		bool open(const std::string_view jsonPath, size_t maxDepth = 2, std::string* error = nullptr);
+
+		// Scans the json file in one pass, the file is read in chunks so this does not depend on the file size.
+		// Only the structure is checked, errors inside scalars are found when the value is read.
+		bool build(const std::string_view jsonPath, size_t maxDepth = 2, std::string* error = nullptr);
+		bool save(const std::string_view indexPath) const;
+		// Fails if the index file is missing or corrupt, or if the json file changed since the index was built.
+		bool load(const std::string_view indexPath, const std::string_view jsonPath);
+
+		// Null if the path is deeper than maxDepth or does not exist.
+		const Entry* find(const std::string_view path) const;
+
+		// The source text of a value. Values deeper than maxDepth are not indexed, use read() for those.
+		bool readText(const std::string_view path, std::string& result) const;
+		// Parses the value at path. Values deeper than maxDepth are found by parsing their closest indexed parent.
+		bool read(const std::string_view path, TTJson::Value& result, const TTJson::ParseOptions& options = {}, std::string* error = nullptr) const;
+
+		const std::vector<Entry>& entries() const { return list; }
+		size_t depth() const { return maxDepth; }
+
+	private:
+		std::string jsonPath;
+		unsigned long long writeTime = 0;
+		unsigned long long fileSize = 0;
+		size_t maxDepth = 0;
+		// Document order.
+		std::vector<Entry> list;
+		// Indices into list sorted by path, stored in the index file so loading does not need to hash or sort.
+		std::vector<unsigned int> sorted;
+
+		void sortPaths();
+	};
+}
@@ -0,0 +1,441 @@
+#include "tt_json_schema.h"
+#include <cmath>
+
+namespace {
+	bool isKeyword(const TTJson::str_t& key, const char* keyword) {
+		size_t i = 0;
+		for (; keyword[i] != '\0'; ++i) {
+			if (i >= key.size() || key[i] != (TTJson::char_t)keyword[i])
+				return false;
+		}
+		return i == key.size();
+	}
+
+	// Keywords that affect validation in draft-07 but are not compiled, accepting documents while ignoring them would be wrong.
+	const char* unsupportedKeywords[] = {
+		"$ref", "pattern", "patternProperties", "propertyNames", "dependencies", "additionalItems", "contains",
+		"uniqueItems", "allOf", "anyOf", "oneOf", "not", "if", "then", "else",
+	};
+
+	// Length in code points, as json schema defines it.
+	size_t codePointCount(const TTJson::str_t& text) {
+		size_t count = 0;
+		for (TTJson::char_t chr : text) {
+#ifdef TT_JSON5_USE_WSTR
+			if (sizeof(wchar_t) == 2 && chr >= 0xDC00 && chr <= 0xDFFF)
+				continue;
+#else
+			if (((unsigned char)chr & 0xC0) == 0x80)
+				continue;
+#endif
+			++count;
+		}
+		return count;
+	}
+
+	TTJson::str_t numberText(TTJson::scalar number) {
+		TTJson::sstr_t text;
+		text << number;
+		return text.str();
+	}
+
+	TTJson::str_t indexToken(size_t index) {
+#ifdef TT_JSON5_USE_WSTR
+		return std::to_wstring(index);
+#else
+		return std::to_string(index);
+#endif
+	}
+}
+
+namespace TT {
+	JsonSchema::JsonSchema(const TTJson::Value& schema) {
+		nodes.push_back({ ALL_TYPES, 0, 0, ANY, ANY, {}, {}, {} });
+		nodes.push_back({ 0, 0, 0, NONE, NONE, {}, {}, {} });
+		root = compile(schema, {});
+	}
+
+	size_t JsonSchema::compile(const TTJson::Value& schema, const TTJson::str_t& path) {
+		if (!error.empty())
+			return NONE;
+		if (schema.isBool())
+			return schema.asBool() ? ANY : NONE;
+		if (!schema.isObject()) {
+			error = path + TTJson::makeString(": a schema must be an object or a boolean.");
+			return NONE;
+		}
+
+		// Children are compiled first so this node's instructions stay contiguous.
+		size_t items = ANY;
+		size_t additionalProperties = ANY;
+		std::unordered_map<TTJson::str_t, size_t> properties;
+		const TTJson::Object& keywords = schema.asObject();
+		for (const auto& keyword : keywords) {
+			const TTJson::str_t& key = keyword.first;
+			const TTJson::Value& value = keyword.second;
+			TTJson::str_t childPath = path;
+			TTJson::appendPathToken(childPath, key);
+			if (isKeyword(key, "items")) {
+				if (value.isArray())
+					error = childPath + TTJson::makeString(": tuple validation is not supported.");
+				else
+					items = compile(value, childPath);
+			} else if (isKeyword(key, "additionalProperties")) {
+				additionalProperties = compile(value, childPath);
+			} else if (isKeyword(key, "properties")) {
+				if (!value.isObject()) {
+					error = childPath + TTJson::makeString(": expected an object.");
+					continue;
+				}
+				for (const auto& property : value.asObject()) {
+					TTJson::str_t propertyPath = childPath;
+					TTJson::appendPathToken(propertyPath, property.first.str());
+					properties[property.first.str()] = compile(property.second, propertyPath);
+				}
+			} else {
+				for (const char* unsupported : unsupportedKeywords) {
+					if (isKeyword(key, unsupported))
+						error = childPath + TTJson::makeString(": keyword is not supported.");
+				}
+			}
+		}
+		if (!error.empty())
+			return NONE;
+
+		Node node{ ALL_TYPES, program.size(), program.size(), items, additionalProperties, std::move(properties), {}, {} };
+		auto addNumber = [&](const char* keyword, Op op) {
+			const TTJson::Value* value = keywords.tryGet(TTJson::makeString(keyword));
+			if (!value)
+				return;
+			if (value->isInt())
+				program.push_back({ op, (TTJson::scalar)value->asInt(), 0 });
+			else if (value->isDouble())
+				program.push_back({ op, value->asDouble(), 0 });
+			else
+				error = path + TTJson::makeString("/") + TTJson::makeString(keyword) + TTJson::makeString(": expected a number.");
+		};
+		addNumber("minimum", Op::Minimum);
+		addNumber("maximum", Op::Maximum);
+		addNumber("exclusiveMinimum", Op::ExclusiveMinimum);
+		addNumber("exclusiveMaximum", Op::ExclusiveMaximum);
+		addNumber("multipleOf", Op::MultipleOf);
+		addNumber("minLength", Op::MinLength);
+		addNumber("maxLength", Op::MaxLength);
+		addNumber("minItems", Op::MinItems);
+		addNumber("maxItems", Op::MaxItems);
+		addNumber("minProperties", Op::MinProperties);
+		addNumber("maxProperties", Op::MaxProperties);
+
+		if (const TTJson::Value* type = keywords.tryGet(TTJson::makeString("type"))) {
+			node.types = 0;
+			auto addType = [&](const TTJson::Value& name) {
+				const TTJson::str_t empty;
+				const TTJson::str_t& text = name.isString() ? name.asString() : empty;
+				if (isKeyword(text, "null")) node.types |= NULL_TYPE;
+				else if (isKeyword(text, "boolean")) node.types |= BOOLEAN;
+				else if (isKeyword(text, "integer")) node.types |= INTEGER;
+				else if (isKeyword(text, "number")) node.types |= NUMBER;
+				else if (isKeyword(text, "string")) node.types |= STRING;
+				else if (isKeyword(text, "array")) node.types |= ARRAY;
+				else if (isKeyword(text, "object")) node.types |= OBJECT;
+				else error = path + TTJson::makeString("/type: unknown type.");
+			};
+			if (type->isArray()) {
+				for (const TTJson::Value& name : type->asArray())
+					addType(name);
+			} else {
+				addType(*type);
+			}
+		}
+
+		auto addEnum = [&](const TTJson::Value& value) {
+			if (value.isArray() || value.isObject())
+				error = path + TTJson::makeString(": enum and const values must be scalars.");
+			enums.push_back(value);
+		};
+		if (const TTJson::Value* values = keywords.tryGet(TTJson::makeString("enum"))) {
+			Instruction instruction{ Op::Enum, (TTJson::scalar)enums.size(), 0 };
+			if (values->isArray()) {
+				for (const TTJson::Value& value : values->asArray())
+					addEnum(value);
+			}
+			instruction.count = enums.size() - (size_t)instruction.operand;
+			program.push_back(instruction);
+		}
+		if (const TTJson::Value* value = keywords.tryGet(TTJson::makeString("const"))) {
+			program.push_back({ Op::Enum, (TTJson::scalar)enums.size(), 1 });
+			addEnum(*value);
+		}
+
+		if (const TTJson::Value* required = keywords.tryGet(TTJson::makeString("required"))) {
+			if (required->isArray()) {
+				for (const TTJson::Value& name : required->asArray()) {
+					if (!name.isString())
+						continue;
+					if (node.requiredIndex.try_emplace(name.asString(), node.required.size()).second)
+						node.required.push_back(name.asString());
+				}
+			}
+		}
+
+		node.end = program.size();
+		nodes.push_back(std::move(node));
+		return nodes.size() - 1;
+	}
+
+	bool JsonSchema::validate(const TTJson::Value& document, TTJson::str_t* message) const {
+		Validator validator(*this);
+		TTJson::visit(document, validator);
+		if (message)
+			*message = validator.message();
+		return validator.valid();
+	}
+
+	bool JsonSchema::validate(TTJson::istream_t& stream, TTJson::str_t* message, const TTJson::ParseOptions& options) const {
+		Validator validator(*this);
+		TTJson::Parser parser(options);
+		parser.parse(stream, validator);
+		if (parser.hasError()) {
+			if (message)
+				*message = parser.error();
+			return false;
+		}
+		if (message)
+			*message = validator.message();
+		return validator.valid();
+	}
+
+	JsonSchema::Validator::Validator(const JsonSchema& schema) : schema(schema) {
+		reset();
+	}
+
+	void JsonSchema::Validator::reset() {
+		frames.clear();
+		seen.clear();
+		member = ANY;
+		started = false;
+		failed = !schema.error.empty();
+		error = schema.error;
+	}
+
+	// Node the next value is validated against.
+	size_t JsonSchema::Validator::next() {
+		if (frames.empty()) {
+			if (started) {
+				fail(0, TTJson::makeString("expected a single document."));
+				return ANY;
+			}
+			started = true;
+			return schema.root;
+		}
+		Frame& frame = frames.back();
+		if (frame.object)
+			return member;
+		++frame.count;
+		return schema.nodes[frame.node].items;
+	}
+
+	bool JsonSchema::Validator::checkType(size_t node, unsigned int type, bool integral) {
+		unsigned int allowed = schema.nodes[node].types;
+		if ((allowed & type) != 0 || (type == INTEGER && (allowed & NUMBER) != 0) || (type == NUMBER && integral && (allowed & INTEGER) != 0))
+			return true;
+		if (node == NONE) {
+			fail(frames.size(), TTJson::makeString("no value is allowed here."));
+			return false;
+		}
+		TTJson::str_t reason = TTJson::makeString("expected type");
+		const char* names[] = { "null", "boolean", "integer", "number", "string", "array", "object" };
+		for (unsigned int i = 0; i < 7; ++i) {
+			if ((allowed & (1u << i)) != 0)
+				reason += TTJson::makeString(" ") + TTJson::makeString(names[i]);
+		}
+		fail(frames.size(), reason + TTJson::makeString("."));
+		return false;
+	}
+
+	void JsonSchema::Validator::checkScalar(const Scalar& value) {
+		if (failed)
+			return;
+		size_t node = next();
+		bool integral = value.type == INTEGER || (value.type == NUMBER && std::floor(value.number) == value.number);
+		if (failed || !checkType(node, value.type, integral))
+			return;
+
+		const Node& compiled = schema.nodes[node];
+		for (size_t i = compiled.begin; i < compiled.end; ++i) {
+			const Instruction& instruction = schema.program[i];
+			bool number = value.type == INTEGER || value.type == NUMBER;
+			const char* reason = nullptr;
+			switch (instruction.op) {
+			case Op::Minimum:
+				if (number && value.number < instruction.operand) reason = "less than minimum ";
+				break;
+			case Op::Maximum:
+				if (number && value.number > instruction.operand) reason = "greater than maximum ";
+				break;
+			case Op::ExclusiveMinimum:
+				if (number && value.number <= instruction.operand) reason = "not greater than exclusiveMinimum ";
+				break;
+			case Op::ExclusiveMaximum:
+				if (number && value.number >= instruction.operand) reason = "not less than exclusiveMaximum ";
+				break;
+			case Op::MultipleOf:
+				if (number && std::fmod(value.number, instruction.operand) != 0) reason = "not a multiple of ";
+				break;
+			case Op::MinLength:
+				if (value.string && codePointCount(*value.string) < instruction.operand) reason = "shorter than minLength ";
+				break;
+			case Op::MaxLength:
+				if (value.string && codePointCount(*value.string) > instruction.operand) reason = "longer than maxLength ";
+				break;
+			case Op::Enum: {
+				bool match = false;
+				for (size_t j = 0; j < instruction.count && !match; ++j) {
+					const TTJson::Value& option = schema.enums[(size_t)instruction.operand + j];
+					switch (option.getType()) {
+					case TTJson::ValueType::Null: match = value.type == NULL_TYPE; break;
+					case TTJson::ValueType::Bool: match = value.type == BOOLEAN && value.boolean == option.asBool(); break;
+					case TTJson::ValueType::Int: match = number && value.number == (TTJson::scalar)option.asInt(); break;
+					case TTJson::ValueType::Double: match = number && value.number == option.asDouble(); break;
+					case TTJson::ValueType::String: match = value.string && *value.string == option.asString(); break;
+					default: break;
+					}
+				}
+				if (!match) {
+					fail(frames.size(), TTJson::makeString("not one of the allowed values."));
+					return;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+			if (reason) {
+				fail(frames.size(), TTJson::makeString(reason) + numberText(instruction.operand) + TTJson::makeString("."));
+				return;
+			}
+		}
+	}
+
+	void JsonSchema::Validator::beginContainer(bool object) {
+		if (failed)
+			return;
+		size_t node = next();
+		if (failed || !checkType(node, object ? OBJECT : ARRAY, false))
+			return;
+		frames.push_back({ node, object, 0, seen.size() });
+		seen.resize(seen.size() + schema.nodes[node].required.size(), false);
+	}
+
+	void JsonSchema::Validator::endContainer() {
+		if (failed)
+			return;
+		const Frame& frame = frames.back();
+		const Node& compiled = schema.nodes[frame.node];
+		for (size_t i = compiled.begin; i < compiled.end; ++i) {
+			const Instruction& instruction = schema.program[i];
+			const char* reason = nullptr;
+			switch (instruction.op) {
+			case Op::MinItems:
+				if (!frame.object && frame.count < instruction.operand) reason = "fewer items than minItems ";
+				break;
+			case Op::MaxItems:
+				if (!frame.object && frame.count > instruction.operand) reason = "more items than maxItems ";
+				break;
+			case Op::MinProperties:
+				if (frame.object && frame.count < instruction.operand) reason = "fewer properties than minProperties ";
+				break;
+			case Op::MaxProperties:
+				if (frame.object && frame.count > instruction.operand) reason = "more properties than maxProperties ";
+				break;
+			default:
+				break;
+			}
+			if (reason) {
+				fail(frames.size() - 1, TTJson::makeString(reason) + numberText(instruction.operand) + TTJson::makeString("."));
+				return;
+			}
+		}
+		for (size_t i = 0; i < compiled.required.size(); ++i) {
+			if (!seen[frame.seenOffset + i]) {
+				fail(frames.size() - 1, TTJson::makeString("missing required property \"") + compiled.required[i] + TTJson::makeString("\"."));
+				return;
+			}
+		}
+		seen.resize(frame.seenOffset);
+		frames.pop_back();
+	}
+
+	// depth is the number of frames the failing value is nested in.
+	void JsonSchema::Validator::fail(size_t depth, const TTJson::str_t& reason) {
+		failed = true;
+		error.clear();
+		for (size_t i = 0; i < depth; ++i) {
+			if (frames[i].object)
+				TTJson::appendPathToken(error, *frames[i].key);
+			else
+				TTJson::appendPathToken(error, indexToken(frames[i].count - 1));
+		}
+		error += TTJson::makeString(": ") + reason;
+	}
+
+	void JsonSchema::Validator::null() {
+		checkScalar({ NULL_TYPE });
+	}
+
+	void JsonSchema::Validator::boolean(bool value) {
+		checkScalar({ BOOLEAN, value });
+	}
+
+	void JsonSchema::Validator::integer(long long value) {
+		checkScalar({ INTEGER, false, (TTJson::scalar)value });
+	}
+
+	void JsonSchema::Validator::number(TTJson::scalar value) {
+		checkScalar({ NUMBER, false, value });
+	}
+
+	void JsonSchema::Validator::string(const TTJson::str_t& value) {
+		checkScalar({ STRING, false, 0, &value });
+	}
+
+	void JsonSchema::Validator::key(const TTJson::str_t& key) {
+		if (failed)
+			return;
+		Frame& frame = frames.back();
+		frame.key = &key;
+		++frame.count;
+		const Node& compiled = schema.nodes[frame.node];
+		auto it = compiled.properties.find(key);
+		if (it == compiled.properties.end()) {
+			member = compiled.additionalProperties;
+			if (member == NONE) {
+				fail(frames.size(), TTJson::makeString("additional property is not allowed."));
+				return;
+			}
+		} else {
+			member = it->second;
+		}
+		if (!compiled.required.empty()) {
+			auto required = compiled.requiredIndex.find(key);
+			if (required != compiled.requiredIndex.end())
+				seen[frame.seenOffset + required->second] = true;
+		}
+	}
+
+	void JsonSchema::Validator::beginObject() {
+		beginContainer(true);
+	}
+
+	void JsonSchema::Validator::endObject() {
+		endContainer();
+	}
+
+	void JsonSchema::Validator::beginArray() {
+		beginContainer(false);
+	}
+
+	void JsonSchema::Validator::endArray() {
+		endContainer();
+	}
+}
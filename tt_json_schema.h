@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "tt_json5.h"
+
+namespace TT {
+	// Validates documents against a JSON Schema (draft-07 subset). The schema is compiled once into a flat list of nodes
+	// and instructions, validation is a single pass over the document or its parse events without building anything.
+	// Supported keywords: type, enum, const, minimum, maximum, exclusiveMinimum, exclusiveMaximum, multipleOf,
+	// minLength, maxLength, items (a single schema), minItems, maxItems, properties, required, additionalProperties,
+	// minProperties, maxProperties and boolean schemas. Keywords that would change the result but are not supported
+	// (e.g. pattern, anyOf, $ref) fail compilation, annotations like title and format are ignored.
+	struct JsonSchema {
+		JsonSchema(const TTJson::Value& schema);
+
+		// Empty if the schema compiled, otherwise every document fails to validate.
+		const TTJson::str_t& compileError() const { return error; }
+
+		// On failure message is set to the first error as "<json pointer>: <reason>".
+		bool validate(const TTJson::Value& document, TTJson::str_t* message = nullptr) const;
+		// Parse and validate in one pass without building a document, parse errors are reported as validation errors.
+		bool validate(TTJson::istream_t& stream, TTJson::str_t* message = nullptr, const TTJson::ParseOptions& options = {}) const;
+
+		// Validates the events of one document, can be reused for multiple documents with reset().
+		class Validator : public TTJson::SaxHandler {
+			struct Scalar {
+				unsigned int type;
+				bool boolean = false;
+				TTJson::scalar number = 0;
+				const TTJson::str_t* string = nullptr;
+			};
+
+			struct Frame {
+				size_t node;
+				bool object;
+				// Number of members or elements so far.
+				size_t count = 0;
+				// Offset of this object's required flags in seen.
+				size_t seenOffset = 0;
+				// Current member, only used to describe errors.
+				const TTJson::str_t* key = nullptr;
+			};
+
+			const JsonSchema& schema;
+			std::vector<Frame> frames;
+			std::vector<bool> seen;
+			// Node for the next value of the current object.
+			size_t member;
+			bool started = false;
+			bool failed = false;
+			TTJson::str_t error;
+
+			size_t next();
+			bool checkType(size_t node, unsigned int type, bool integral);
+			void checkScalar(const Scalar& value);
+			void beginContainer(bool object);
+			void endContainer();
+			void fail(size_t depth, const TTJson::str_t& reason);
+
+		public:
+			Validator(const JsonSchema& schema);
+
+			void reset();
+			bool valid() const { return !failed; }
+			const TTJson::str_t& message() const { return error; }
+
+			void null() override;
+			void boolean(bool value) override;
+			void integer(long long value) override;
+			void number(TTJson::scalar value) override;
+			void string(const TTJson::str_t& value) override;
+			void key(const TTJson::str_t& key) override;
+			void beginObject() override;
+			void endObject() override;
+			void beginArray() override;
+			void endArray() override;
+		};
+
+	private:
+		enum TypeBits : unsigned int {
+			NULL_TYPE = 1,
+			BOOLEAN = 2,
+			INTEGER = 4,
+			NUMBER = 8,
+			STRING = 16,
+			ARRAY = 32,
+			OBJECT = 64,
+			ALL_TYPES = 127,
+		};
+
+		enum class Op : unsigned char {
+			Minimum,
+			Maximum,
+			ExclusiveMinimum,
+			ExclusiveMaximum,
+			MultipleOf,
+			MinLength,
+			MaxLength,
+			// Operand is the first index in enums, count the number of values.
+			Enum,
+			// Evaluated when the array or object ends.
+			MinItems,
+			MaxItems,
+			MinProperties,
+			MaxProperties,
+		};
+
+		struct Instruction {
+			Op op;
+			TTJson::scalar operand;
+			size_t count;
+		};
+
+		struct Node {
+			unsigned int types;
+			size_t begin;
+			size_t end;
+			size_t items;
+			size_t additionalProperties;
+			// Schema node of each declared property.
+			std::unordered_map<TTJson::str_t, size_t> properties;
+			// Required properties need not be declared, their values are then validated against additionalProperties.
+			// Index of each required name in required and in the object's flags in seen.
+			std::unordered_map<TTJson::str_t, size_t> requiredIndex;
+			// Names of required properties, for error messages.
+			std::vector<TTJson::str_t> required;
+		};
+
+		// Nodes 0 and 1 are the schemas true (anything) and false (nothing).
+		static const size_t ANY = 0;
+		static const size_t NONE = 1;
+
+		std::vector<Node> nodes;
+		std::vector<Instruction> program;
+		std::vector<TTJson::Value> enums;
+		size_t root = ANY;
+		TTJson::str_t error;
+
+		size_t compile(const TTJson::Value& schema, const TTJson::str_t& path);
+	};
+}
@@ -1,15 +1,25 @@
 #include "tt_math.h"
 #include "tt_cgmath.h"
+#include "tt_cgmath_kernels.h"
+#include "tt_cgmath_lanes.h"
 #include <cmath>
 
 namespace TT {
+	namespace {
+		__m128 rsqrtNewton(__m128 a) {
+			__m128 r = _mm_rsqrt_ps(a);
+			return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(a, r), r)));
+		}
+	}
+
 #define SPECIAL(T) \
 	template<> T clamp(T v, T n, T x) { return _mm_max_ps(_mm_min_ps(v, x), n); } \
 	template<> T min(T a, T b) { return _mm_min_ps(a, b); } \
 	template<> T max(T a, T b) { return _mm_max_ps(a, b); } \
-	template<> T floor(T a) { return _mm_floor_ps(a); } \
-	template<> T ceil(T a) { return _mm_ceil_ps(a); } \
-	template<> T mod(T a, T b) { return Vec(a) % b; }
+	template<> T floor(T a) { return cgmathKernels->floor(a); } \
+	template<> T ceil(T a) { return cgmathKernels->ceil(a); } \
+	template<> T mod(T a, T b) { return Vec(a) % b; } \
+	template<> T rsqrt(T a) { return rsqrtNewton(a); }
 
 	SPECIAL(__m128)
 	SPECIAL(Vec)
@@ -19,6 +29,14 @@ namespace TT {
 
 #undef SPECIAL
 
+	// The 4 lane polynomials directly, a call through cgmathKernels costs more than they do.
+	template<> __m128 sin(__m128 a) { return sinLanes<Lanes4>(a); }
+	template<> __m128 cos(__m128 a) { return cosLanes<Lanes4>(a); }
+	template<> void sincos(__m128 a, __m128& s, __m128& c) { sinCosLanes<Lanes4>(a, &s, &c); }
+	template<> __m128 exp(__m128 a) { return expLanes<Lanes4>(a); }
+	template<> __m128 log(__m128 a) { return logLanes<Lanes4>(a); }
+	template<> __m128 atan2(__m128 y, __m128 x) { return atan2Lanes<Lanes4>(y, x); }
+
 	template<> float mod(float a, float b) {
 		return a - b * std::floor(a / b);
 	}
@@ -27,6 +45,13 @@ namespace TT {
 		return a - b * std::floor(a / b);
 	}
 
+	void sin(const float* in, float* out, size_t count) { cgmathKernels->sinArray(in, out, count); }
+	void cos(const float* in, float* out, size_t count) { cgmathKernels->cosArray(in, out, count); }
+	void sincos(const float* in, float* sinOut, float* cosOut, size_t count) { cgmathKernels->sincosArray(in, sinOut, cosOut, count); }
+	void exp(const float* in, float* out, size_t count) { cgmathKernels->expArray(in, out, count); }
+	void log(const float* in, float* out, size_t count) { cgmathKernels->logArray(in, out, count); }
+	void atan2(const float* y, const float* x, float* out, size_t count) { cgmathKernels->atan2Array(y, x, out, count); }
+
 	size_t hashCombine(size_t a, size_t b) {
 		return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
 	}
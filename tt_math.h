@@ -1,7 +1,8 @@
 #pragma once
 
-#include <xmmintrin.h>
+#include <immintrin.h>
 #include <algorithm>
+#include <cmath>
 #include "tt_cgmath.h"
 
 namespace TT {
@@ -37,13 +38,50 @@ namespace TT {
 		return std::ceil(a);
 	}
 
+	// For the SIMD types below these evaluate polynomials per lane. Largest errors against double precision, measured over millions of floats:
+	// sin and cos 1.5 ulp for |a| <= pi and an absolute error below 1e-7 for |a| < 8192 (so more ulp close to their zeros),
+	// larger angles lose precision, without FMA quickly (the SSE2 path, and single vectors unless the library is built for AVX2).
+	// exp 1 ulp, log 1 ulp, atan2 2.6 ulp.
+	// Denormal results and inputs, inf, NaN and signed zeros are handled like the standard library does.
+	template<typename T> T sin(T a) {
+		return std::sin(a);
+	}
+
+	template<typename T> T cos(T a) {
+		return std::cos(a);
+	}
+
+	// Cheaper than sin and cos separately.
+	template<typename T> void sincos(T a, T& s, T& c) {
+		s = std::sin(a);
+		c = std::cos(a);
+	}
+
+	template<typename T> T exp(T a) {
+		return std::exp(a);
+	}
+
+	template<typename T> T log(T a) {
+		return std::log(a);
+	}
+
+	template<typename T> T atan2(T y, T x) {
+		return std::atan2(y, x);
+	}
+
+	// 1 / sqrt(a), for the SIMD types from rsqrt with a Newton step (about 22 bits, 4 ulp for normal floats).
+	template<typename T> T rsqrt(T a) {
+		return (T)1 / std::sqrt(a);
+	}
+
 #define SPECIAL(T) \
 	template<> T clamp(T v, T n, T x); \
 	template<> T min(T a, T b); \
 	template<> T max(T a, T b); \
 	template<> T floor(T a); \
 	template<> T ceil(T a); \
-	template<> T mod(T a, T b);
+	template<> T mod(T a, T b); \
+	template<> T rsqrt(T a);
 	SPECIAL(__m128)
 	SPECIAL(Vec)
 	SPECIAL(Vec2)
@@ -51,6 +89,45 @@ namespace TT {
 	SPECIAL(Vec4)
 #undef SPECIAL
 
+	template<> __m128 sin(__m128 a);
+	template<> __m128 cos(__m128 a);
+	template<> void sincos(__m128 a, __m128& s, __m128& c);
+	template<> __m128 exp(__m128 a);
+	template<> __m128 log(__m128 a);
+	template<> __m128 atan2(__m128 y, __m128 x);
+
+	// Inline, a Vec passed by value to another file goes through memory in two halves, which costs more than the polynomial.
+#define SPECIAL(T) \
+	template<> inline T sin(T a) { return sin<__m128>(a.m); } \
+	template<> inline T cos(T a) { return cos<__m128>(a.m); } \
+	template<> inline void sincos(T a, T& s, T& c) { __m128 ms, mc; sincos<__m128>(a.m, ms, mc); s = ms; c = mc; } \
+	template<> inline T exp(T a) { return exp<__m128>(a.m); } \
+	template<> inline T log(T a) { return log<__m128>(a.m); } \
+	template<> inline T atan2(T y, T x) { return atan2<__m128>(y.m, x.m); }
+	SPECIAL(Vec)
+	SPECIAL(Vec2)
+	SPECIAL(Vec3)
+	SPECIAL(Vec4)
+#undef SPECIAL
+
+#ifdef __AVX__
+	// Only for files compiled with AVX, running on a CPU with AVX2 and FMA.
+	template<> __m256 sin(__m256 a);
+	template<> __m256 cos(__m256 a);
+	template<> void sincos(__m256 a, __m256& s, __m256& c);
+	template<> __m256 exp(__m256 a);
+	template<> __m256 log(__m256 a);
+	template<> __m256 atan2(__m256 y, __m256 x);
+#endif
+
+	// The same over arrays, 8 or 4 floats at a time depending on the SIMD path. out may be an input.
+	void sin(const float* in, float* out, size_t count);
+	void cos(const float* in, float* out, size_t count);
+	void sincos(const float* in, float* sinOut, float* cosOut, size_t count);
+	void exp(const float* in, float* out, size_t count);
+	void log(const float* in, float* out, size_t count);
+	void atan2(const float* y, const float* x, float* out, size_t count);
+
 	template<> float mod(float a, float b);
 	template<> double mod(double a, double b);
 
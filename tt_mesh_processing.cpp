@@ -0,0 +1,585 @@
+#include "tt_mesh_processing.h"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "tt_cgmath_wide.h"
+#include "tt_numerictypes.h"
+#include "tt_parallel.h"
+
+namespace TT {
+	namespace {
+		u64 mix(u64 h) {
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ull;
+			return h ^ (h >> 33);
+		}
+
+		u64 hashBytes(const u8* bytes, size_t size) {
+			u64 h = 0x9e3779b97f4a7c15ull ^ size;
+			size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				u64 word;
+				memcpy(&word, bytes + i, 8);
+				h = (h ^ word) * 0xff51afd7ed558ccdull;
+				h ^= h >> 32;
+			}
+			for (; i < size; ++i)
+				h = (h ^ bytes[i]) * 0x100000001b3ull;
+			return mix(h);
+		}
+
+		u64 hashCell(i64 x, i64 y, i64 z) {
+			return mix(mix(mix((u64)x) ^ (u64)y) ^ (u64)z);
+		}
+
+		// floor(x) clamped to +-2^62, so the conversion is defined for huge and non-finite coordinates. NaN goes to the lowest cell.
+		i64 cellOf(double x) {
+			const double LIMIT = 0x1p62;
+			if (!(x > -LIMIT))
+				return -(i64)LIMIT;
+			return x < LIMIT ? (i64)std::floor(x) : (i64)LIMIT;
+		}
+
+		const unsigned int NONE = ~0u;
+
+		// Welding hash table entry: the vertices with one key in ascending order, a list from first to last continued by next[vertex].
+		struct Cell {
+			u64 key;
+			unsigned int first;
+			unsigned int last;
+		};
+
+		size_t findCell(const std::vector<Cell>& table, u64 key) {
+			size_t mask = table.size() - 1;
+			size_t slot = (size_t)key & mask;
+			while (table[slot].first != NONE && table[slot].key != key)
+				slot = (slot + 1) & mask;
+			return slot;
+		}
+
+		// Doubles the table, keeping it at most half full so probing stays short, and small enough to stay in cache while there are few keys.
+		void growTable(std::vector<Cell>& table) {
+			std::vector<Cell> old(2 * table.size(), Cell{ 0, NONE, NONE });
+			old.swap(table);
+			for (const Cell& cell : old)
+				if (cell.first != NONE)
+					table[findCell(table, cell.key)] = cell;
+		}
+
+		// 4 floats, per face or vertex values are W / 4 of these.
+		struct alignas(16) Lanes {
+			float f[4];
+		};
+
+		// vertexValues[v] = the sum of faceValues[t] of the triangles t around vertex v, W floats each, always added in triangle order.
+		// With several parts each owns a range of vertices and the corners are first bucketed by owner, in triangle order.
+		template<int W> void accumulateCorners(const unsigned int* indices, size_t triangleCount, const Lanes* faceValues,
+			Lanes* vertexValues, size_t vertexCount, size_t parts) {
+			constexpr int L = W / 4;
+			auto add = [&](size_t v, size_t t) {
+				for (int l = 0; l < L; ++l)
+					_mm_store_ps(vertexValues[v * L + l].f, _mm_add_ps(_mm_load_ps(vertexValues[v * L + l].f), _mm_load_ps(faceValues[t * L + l].f)));
+			};
+			if (parts <= 1) {
+				std::fill(vertexValues, vertexValues + vertexCount * L, Lanes{});
+				for (size_t t = 0; t < triangleCount; ++t)
+					for (int c = 0; c < 3; ++c)
+						add(indices[3 * t + c], t);
+				return;
+			}
+			size_t range = std::max<size_t>((vertexCount + parts - 1) / parts, 1);
+			// offsets[part * parts + owner] counts and then places the corners of part's triangles owned by owner.
+			std::vector<size_t> offsets(parts * parts);
+			parallelParts(triangleCount, parts, [&](size_t part, size_t begin, size_t end) {
+				size_t* counts = &offsets[part * parts];
+				for (size_t i = 3 * begin; i < 3 * end; ++i)
+					++counts[indices[i] / range];
+			});
+			std::vector<size_t> bucketStart(parts + 1);
+			size_t offset = 0;
+			for (size_t owner = 0; owner < parts; ++owner) {
+				bucketStart[owner] = offset;
+				for (size_t part = 0; part < parts; ++part) {
+					size_t count = offsets[part * parts + owner];
+					offsets[part * parts + owner] = offset;
+					offset += count;
+				}
+			}
+			bucketStart[parts] = offset;
+			struct Corner {
+				unsigned int vertex;
+				unsigned int triangle;
+			};
+			std::vector<Corner> corners(offset);
+			parallelParts(triangleCount, parts, [&](size_t part, size_t begin, size_t end) {
+				size_t* next = &offsets[part * parts];
+				for (size_t i = 3 * begin; i < 3 * end; ++i)
+					corners[next[indices[i] / range]++] = { indices[i], (unsigned int)(i / 3) };
+			});
+			parallelParts(parts, parts, [&](size_t owner, size_t, size_t) {
+				size_t first = std::min(owner * range, vertexCount), last = std::min(first + range, vertexCount);
+				std::fill(vertexValues + first * L, vertexValues + last * L, Lanes{});
+				for (size_t i = bucketStart[owner]; i < bucketStart[owner + 1]; ++i)
+					add(corners[i].vertex, corners[i].triangle);
+			});
+		}
+
+		// The corners of triangles t to t + 4 (repeating the last one past end) as 3 SoA vectors of x, y and z.
+		template<typename V> void gatherTriangles(const V* positions, const unsigned int* indices, size_t t, size_t end, Vec3x4 corners[3]) {
+			__m128 p[3][4];
+			for (size_t l = 0; l < 4; ++l) {
+				const unsigned int* triangle = indices + 3 * std::min(t + l, end - 1);
+				for (int c = 0; c < 3; ++c)
+					p[c][l] = _mm_load_ps(&positions[triangle[c]].x);
+			}
+			for (int c = 0; c < 3; ++c)
+				corners[c] = Vec3x4::transposed(p[c][0], p[c][1], p[c][2], p[c][3]);
+		}
+
+		// Writes lanes [0, count) of v with w = 0 to out[l * stride].
+		void storeLanes(const Vec3x4& v, Lanes* out, size_t stride, size_t count) {
+			__m128 a = v.x, b = v.y, c = v.z, d = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			__m128 lanes[4] = { a, b, c, d };
+			for (size_t l = 0; l < count; ++l)
+				_mm_store_ps(out[l * stride].f, lanes[l]);
+		}
+
+		Vec3x4 loadLanes(const Lanes* in, size_t stride, size_t count) {
+			__m128 lanes[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (size_t l = 0; l < count; ++l)
+				lanes[l] = _mm_load_ps(in[l * stride].f);
+			return Vec3x4::transposed(lanes[0], lanes[1], lanes[2], lanes[3]);
+		}
+
+		// v / |v|, zero vectors stay zero.
+		Vec3x4 normalizedOrZero(const Vec3x4& v) {
+			return v / _mm_sqrt_ps(_mm_max_ps(v.sqrLen(), _mm_set_ps1(FLT_MIN)));
+		}
+
+		// Forsyth's vertex scores: by position in the modelled LRU cache, the last triangle's vertices fixed, and a boost for few remaining triangles.
+		const int CACHE_SIZE = 32;
+		const size_t OPTIMIZE_CHUNK = 1 << 16;
+		const int VALENCE_SCORES = 32;
+
+		struct VertexScores {
+			float cache[CACHE_SIZE];
+			float valence[VALENCE_SCORES];
+
+			VertexScores() {
+				for (int i = 0; i < CACHE_SIZE; ++i)
+					cache[i] = i < 3 ? 0.75f : std::pow(1.0f - (float)(i - 3) / (CACHE_SIZE - 3), 1.5f);
+				for (int i = 0; i < VALENCE_SCORES; ++i)
+					valence[i] = 2.0f / std::sqrt((float)std::max(i, 1));
+			}
+			float operator()(int position, unsigned int remaining) const {
+				if (remaining == 0)
+					return -1.0f;
+				return (position >= 0 ? cache[position] : 0.0f) + (remaining < (unsigned int)VALENCE_SCORES ? valence[remaining] : 2.0f / std::sqrt((float)remaining));
+			}
+		};
+
+		// Reorders the triangles of one chunk. local maps mesh vertices to chunk vertices, ~0u where unused, and is left that way.
+		void optimizeChunk(const unsigned int* indices, size_t triangleCount, unsigned int* out, std::vector<unsigned int>& local, const VertexScores& scores) {
+			std::vector<unsigned int> vertices;
+			std::vector<unsigned int> corners(3 * triangleCount);
+			for (size_t i = 0; i < 3 * triangleCount; ++i) {
+				unsigned int& l = local[indices[i]];
+				if (l == ~0u) {
+					l = (unsigned int)vertices.size();
+					vertices.push_back(indices[i]);
+				}
+				corners[i] = l;
+			}
+			for (unsigned int v : vertices)
+				local[v] = ~0u;
+
+			// The triangles not yet emitted around each vertex: adjacency[first[v], first[v] + remaining[v]).
+			size_t vertexCount = vertices.size();
+			std::vector<unsigned int> remaining(vertexCount), first(vertexCount + 1), adjacency(3 * triangleCount);
+			for (unsigned int c : corners)
+				++remaining[c];
+			for (size_t v = 0; v < vertexCount; ++v)
+				first[v + 1] = first[v] + remaining[v];
+			std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+			for (size_t i = 0; i < 3 * triangleCount; ++i)
+				adjacency[fill[corners[i]]++] = (unsigned int)(i / 3);
+
+			std::vector<int> cachePosition(vertexCount, -1);
+			std::vector<float> vertexScore(vertexCount), triangleScore(triangleCount);
+			std::vector<bool> emitted(triangleCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+				vertexScore[v] = scores(-1, remaining[v]);
+			size_t best = 0;
+			for (size_t t = 0; t < triangleCount; ++t) {
+				triangleScore[t] = vertexScore[corners[3 * t]] + vertexScore[corners[3 * t + 1]] + vertexScore[corners[3 * t + 2]];
+				if (triangleScore[t] > triangleScore[best])
+					best = t;
+			}
+
+			unsigned int cache[CACHE_SIZE + 3];
+			unsigned int next[CACHE_SIZE + 3];
+			size_t cacheCount = 0;
+			size_t scan = 0;
+			for (size_t n = 0; n < triangleCount; ++n) {
+				if (best == SIZE_MAX) {
+					// Nothing in the cache has triangles left, continue with the first triangle not emitted.
+					while (emitted[scan])
+						++scan;
+					best = scan;
+				}
+				const unsigned int* triangle = &corners[3 * best];
+				for (int c = 0; c < 3; ++c) {
+					out[3 * n + c] = vertices[triangle[c]];
+					unsigned int v = triangle[c];
+					unsigned int* around = &adjacency[first[v]];
+					unsigned int* end = around + remaining[v];
+					std::iter_swap(std::find(around, end, (unsigned int)best), end - 1);
+					--remaining[v];
+				}
+				emitted[best] = true;
+
+				// The triangle's vertices move to the front of the cache, pushing out the last ones.
+				size_t nextCount = 0;
+				for (int c = 0; c < 3; ++c)
+					next[nextCount++] = triangle[c];
+				for (size_t i = 0; i < cacheCount; ++i)
+					if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+						next[nextCount++] = cache[i];
+				for (size_t i = 0; i < nextCount; ++i) {
+					unsigned int v = next[i];
+					cachePosition[v] = i < (size_t)CACHE_SIZE ? (int)i : -1;
+					float score = scores(cachePosition[v], remaining[v]);
+					float delta = score - vertexScore[v];
+					vertexScore[v] = score;
+					for (unsigned int k = first[v]; k < first[v] + remaining[v]; ++k)
+						triangleScore[adjacency[k]] += delta;
+				}
+				cacheCount = std::min<size_t>(nextCount, CACHE_SIZE);
+				std::copy(next, next + cacheCount, cache);
+
+				best = SIZE_MAX;
+				float bestScore = -FLT_MAX;
+				for (size_t i = 0; i < cacheCount; ++i) {
+					unsigned int v = cache[i];
+					for (unsigned int k = first[v]; k < first[v] + remaining[v]; ++k)
+						if (triangleScore[adjacency[k]] > bestScore) {
+							bestScore = triangleScore[adjacency[k]];
+							best = adjacency[k];
+						}
+				}
+			}
+		}
+
+		// Groups the triangles into regions of up to OPTIMIZE_CHUNK triangles grown breadth first over shared vertices, so each region
+		// is local whatever the input order. Writes the triangles region by region to out and returns where each region starts, and the end.
+		std::vector<size_t> splitRegions(const unsigned int* indices, size_t triangleCount, size_t vertexCount, unsigned int* out) {
+			// The triangles around each vertex are around[first[v], first[v + 1]).
+			std::vector<unsigned int> first(vertexCount + 1), around(3 * triangleCount);
+			for (size_t i = 0; i < 3 * triangleCount; ++i)
+				++first[indices[i] + 1];
+			for (size_t v = 0; v < vertexCount; ++v)
+				first[v + 1] += first[v];
+			std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+			for (size_t i = 0; i < 3 * triangleCount; ++i)
+				around[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+			std::vector<unsigned int> order;
+			order.reserve(triangleCount);
+			std::vector<bool> assigned(triangleCount);
+			std::vector<size_t> regions;
+			size_t seed = 0;
+			while (order.size() < triangleCount) {
+				while (assigned[seed])
+					++seed;
+				size_t start = order.size();
+				regions.push_back(start);
+				assigned[seed] = true;
+				order.push_back((unsigned int)seed);
+				for (size_t head = start; head < order.size() && order.size() - start < OPTIMIZE_CHUNK; ++head) {
+					const unsigned int* triangle = indices + 3 * order[head];
+					for (int c = 0; c < 3; ++c)
+						for (unsigned int k = first[triangle[c]]; k < first[triangle[c] + 1] && order.size() - start < OPTIMIZE_CHUNK; ++k)
+							if (!assigned[around[k]]) {
+								assigned[around[k]] = true;
+								order.push_back(around[k]);
+							}
+				}
+			}
+			regions.push_back(triangleCount);
+			for (size_t i = 0; i < triangleCount; ++i)
+				std::copy(indices + 3 * order[i], indices + 3 * order[i] + 3, out + 3 * i);
+			return regions;
+		}
+	}
+
+	size_t weldVertices(const void* vertices, size_t stride, size_t count, float epsilon, unsigned int* remap, unsigned int threads) {
+		const u8* bytes = (const u8*)vertices;
+		size_t parts = partCount(count, threads);
+		// The hash tables are split into partitions by the top bits of the keys, so threads can build them separately.
+		int partitionBits = parts > 1 ? std::bit_width(parts * 4 - 1) : 0;
+		size_t partitions = (size_t)1 << partitionBits;
+		auto partitionOf = [partitionBits](u64 key) { return partitionBits ? (size_t)(key >> (64 - partitionBits)) : 0; };
+
+		// With epsilon positions go into cells of 4 epsilon, so the vertices within epsilon of one are in the 1 or 2 cells per axis
+		// its position +- epsilon touches (with some slack for rounding). The cells are offset by half, which puts round coordinates
+		// (common with a decimal epsilon) in their middle rather than on a boundary.
+		double scale = epsilon > 0.0f ? 0.25 / epsilon : 0.0;
+		auto position = [&](size_t i, float p[3]) { memcpy(p, bytes + i * stride, 3 * sizeof(float)); };
+		auto matches = [&](size_t a, size_t b) {
+			if (epsilon <= 0.0f)
+				return memcmp(bytes + a * stride, bytes + b * stride, stride) == 0;
+			float pa[3], pb[3];
+			position(a, pa);
+			position(b, pb);
+			for (int c = 0; c < 3; ++c)
+				if (!(std::abs(pa[c] - pb[c]) <= epsilon))
+					return false;
+			return memcmp(bytes + a * stride + 3 * sizeof(float), bytes + b * stride + 3 * sizeof(float), stride - 3 * sizeof(float)) == 0;
+		};
+
+		std::vector<u64> keys(count);
+		parallelParts(count, parts, [&](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				if (epsilon > 0.0f) {
+					float p[3];
+					position(i, p);
+					keys[i] = hashCell(cellOf(p[0] * scale + 0.5), cellOf(p[1] * scale + 0.5), cellOf(p[2] * scale + 0.5));
+				} else {
+					keys[i] = hashBytes(bytes + i * stride, stride);
+				}
+			}
+		});
+
+		// With several partitions the vertices sorted by partition, each partition's in ascending order: counted per part and partition, then placed.
+		std::vector<size_t> partitionStart(partitions + 1);
+		std::vector<unsigned int> sorted;
+		partitionStart[partitions] = count;
+		if (partitions > 1) {
+			std::vector<size_t> offsets(parts * partitions);
+			parallelParts(count, parts, [&](size_t part, size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					++offsets[part * partitions + partitionOf(keys[i])];
+			});
+			size_t offset = 0;
+			for (size_t p = 0; p < partitions; ++p) {
+				partitionStart[p] = offset;
+				for (size_t part = 0; part < parts; ++part) {
+					size_t n = offsets[part * partitions + p];
+					offsets[part * partitions + p] = offset;
+					offset += n;
+				}
+			}
+			sorted.resize(count);
+			parallelParts(count, parts, [&](size_t part, size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					sorted[offsets[part * partitions + partitionOf(keys[i])]++] = (unsigned int)i;
+			});
+		}
+
+		// Each vertex's representative is the lowest index vertex matching it, which is itself if there is none.
+		// Exact matches are found while building the tables: all vertices with a key are in its partition and come in ascending order,
+		// and only representatives need to be listed as equal bytes match the same ones.
+		std::vector<unsigned int> representatives(count);
+		std::vector<unsigned int> next(count);
+		std::vector<std::vector<Cell>> tables(partitions);
+		parallelParts(partitions, std::min(parts, partitions), [&](size_t, size_t begin, size_t end) {
+			for (size_t p = begin; p < end; ++p) {
+				std::vector<Cell>& table = tables[p];
+				table.assign(64, Cell{ 0, NONE, NONE });
+				size_t used = 0;
+				for (size_t j = partitionStart[p]; j < partitionStart[p + 1]; ++j) {
+					unsigned int v = sorted.empty() ? (unsigned int)j : sorted[j];
+					representatives[v] = v;
+					next[v] = NONE;
+					size_t slot = findCell(table, keys[v]);
+					if (table[slot].first == NONE) {
+						if (2 * ++used > table.size()) {
+							growTable(table);
+							slot = findCell(table, keys[v]);
+						}
+						table[slot] = { keys[v], v, v };
+						continue;
+					}
+					Cell& cell = table[slot];
+					if (epsilon <= 0.0f) {
+						for (unsigned int u = cell.first; u != NONE; u = next[u])
+							if (matches(u, v)) {
+								representatives[v] = u;
+								break;
+							}
+						if (representatives[v] != v)
+							continue;
+					}
+					next[cell.last] = v;
+					cell.last = v;
+				}
+			}
+		});
+		sorted = std::vector<unsigned int>();
+		keys = std::vector<u64>();
+
+		if (epsilon > 0.0f) {
+			parallelParts(count, parts, [&](size_t, size_t begin, size_t end) {
+				for (size_t v = begin; v < end; ++v) {
+					unsigned int best = (unsigned int)v;
+					float p[3];
+					position(v, p);
+					// Non-finite positions match nothing, they would only walk the crowded outermost cells.
+					if (!std::isfinite(p[0]) || !std::isfinite(p[1]) || !std::isfinite(p[2])) {
+						representatives[v] = best;
+						continue;
+					}
+					i64 low[3], high[3];
+					for (int c = 0; c < 3; ++c) {
+						low[c] = cellOf(p[c] * scale + 0.24);
+						high[c] = cellOf(p[c] * scale + 0.76);
+					}
+					for (i64 z = low[2]; z <= high[2]; ++z)
+						for (i64 y = low[1]; y <= high[1]; ++y)
+							for (i64 x = low[0]; x <= high[0]; ++x) {
+								u64 key = hashCell(x, y, z);
+								const std::vector<Cell>& table = tables[partitionOf(key)];
+								for (unsigned int u = table[findCell(table, key)].first; u < best; u = next[u])
+									if (matches(u, v)) {
+										best = u;
+										break;
+									}
+							}
+					representatives[v] = best;
+				}
+			});
+		}
+
+		// Representatives come first, so their new index is known when the vertices merging into them get it.
+		size_t unique = 0;
+		for (size_t v = 0; v < count; ++v) {
+			unsigned int r = representatives[v];
+			remap[v] = r == v ? (unsigned int)unique++ : remap[r];
+		}
+		return unique;
+	}
+
+	void remapVertices(const void* vertices, size_t stride, size_t count, const unsigned int* remap, void* out) {
+		size_t next = 0;
+		for (size_t i = 0; i < count; ++i)
+			if (remap[i] == next)
+				memcpy((u8*)out + next++ * stride, (const u8*)vertices + i * stride, stride);
+	}
+
+	void remapIndices(const unsigned int* indices, size_t indexCount, const unsigned int* remap, unsigned int* out) {
+		for (size_t i = 0; i < indexCount; ++i)
+			out[i] = remap[indices ? indices[i] : i];
+	}
+
+	void computeNormals(const Vec3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, Vec3* normals, unsigned int threads) {
+		size_t triangleCount = indexCount / 3;
+		size_t parts = partCount(triangleCount, threads);
+		std::vector<Lanes> faces(triangleCount);
+		parallelParts(triangleCount, parts, [&](size_t, size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t += 4) {
+				Vec3x4 p[3];
+				gatherTriangles(positions, indices, t, end, p);
+				storeLanes((p[1] - p[0]).cross(p[2] - p[0]), &faces[t], 1, std::min<size_t>(4, end - t));
+			}
+		});
+		// Vec3 is 16 bytes, so the sums go straight to normals and are normalized in place.
+		Lanes* sums = reinterpret_cast<Lanes*>(normals);
+		accumulateCorners<4>(indices, triangleCount, faces.data(), sums, vertexCount, parts);
+		parallelParts(vertexCount, partCount(vertexCount, threads), [&](size_t, size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v += 4) {
+				size_t n = std::min<size_t>(4, end - v);
+				storeLanes(normalizedOrZero(loadLanes(sums + v, 1, n)), sums + v, 1, n);
+			}
+		});
+	}
+
+	void computeTangents(const Vec3* positions, const Vec2* uvs, const Vec3* normals, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		Vec4* tangents, unsigned int threads) {
+		size_t triangleCount = indexCount / 3;
+		size_t parts = partCount(triangleCount, threads);
+		// Per triangle the directions of increasing u and v, each scaled to the triangle's area, then summed per vertex the same way.
+		std::vector<Lanes> faces(2 * triangleCount);
+		parallelParts(triangleCount, parts, [&](size_t, size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t += 4) {
+				Vec3x4 p[3], uv[3];
+				gatherTriangles(positions, indices, t, end, p);
+				gatherTriangles(uvs, indices, t, end, uv);
+				Vec3x4 e1 = p[1] - p[0], e2 = p[2] - p[0];
+				__m128 du1 = _mm_sub_ps(uv[1].x, uv[0].x), dv1 = _mm_sub_ps(uv[1].y, uv[0].y);
+				__m128 du2 = _mm_sub_ps(uv[2].x, uv[0].x), dv2 = _mm_sub_ps(uv[2].y, uv[0].y);
+				__m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+				// The directions are (e1 * dv2 - e2 * dv1) / det and (e2 * du1 - e1 * du2) / det, only the sign of det matters before normalizing.
+				__m128 sign = _mm_and_ps(det, _mm_set_ps1(-0.0f));
+				__m128 area = _mm_and_ps(e1.cross(e2).len(), _mm_cmpneq_ps(det, _mm_setzero_ps()));
+				Vec3x4 tangent = normalizedOrZero(e1 * dv2 - e2 * dv1) * _mm_xor_ps(area, sign);
+				Vec3x4 bitangent = normalizedOrZero(e2 * du1 - e1 * du2) * _mm_xor_ps(area, sign);
+				size_t n = std::min<size_t>(4, end - t);
+				storeLanes(tangent, &faces[2 * t], 2, n);
+				storeLanes(bitangent, &faces[2 * t + 1], 2, n);
+			}
+		});
+		std::vector<Lanes> sums(2 * vertexCount);
+		accumulateCorners<8>(indices, triangleCount, faces.data(), sums.data(), vertexCount, parts);
+		faces = std::vector<Lanes>();
+
+		parallelParts(vertexCount, partCount(vertexCount, threads), [&](size_t, size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v += 4) {
+				size_t n = std::min<size_t>(4, end - v);
+				Vec3x4 normal = Vec3x4::load(normals + v, n);
+				Vec3x4 tangent = loadLanes(&sums[2 * v], 2, n);
+				Vec3x4 bitangent = loadLanes(&sums[2 * v + 1], 2, n);
+				__m128 summedSquared = tangent.sqrLen();
+				tangent -= normal * normal.dot(tangent);
+				// Without a tangent left any vector orthogonal to the normal: normal x (1, 0, 0), or normal x (0, 1, 0) when the normal is close to x.
+				__m128 zero = _mm_setzero_ps();
+				__m128 nearX = _mm_cmpgt_ps(_mm_mul_ps(normal.x, normal.x), _mm_set_ps1(0.8f));
+				Vec3x4 fallback = Vec3x4::select(nearX, Vec3x4(_mm_sub_ps(zero, normal.z), zero, normal.x), Vec3x4(zero, normal.z, _mm_sub_ps(zero, normal.y)));
+				// Also when the summed tangent was (close to) parallel to the normal.
+				tangent = Vec3x4::select(_mm_cmpgt_ps(tangent.sqrLen(), _mm_mul_ps(_mm_set_ps1(1e-8f), summedSquared)), tangent, fallback);
+				tangent = normalizedOrZero(tangent);
+				__m128 handedness = _mm_or_ps(_mm_set_ps1(1.0f), _mm_and_ps(normal.cross(tangent).dot(bitangent), _mm_set_ps1(-0.0f)));
+				__m128 x = tangent.x, y = tangent.y, z = tangent.z, w = handedness;
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				__m128 lanes[4] = { x, y, z, w };
+				for (size_t l = 0; l < n; ++l)
+					_mm_store_ps(&tangents[v + l].x, lanes[l]);
+			}
+		});
+	}
+
+	void optimizeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int* out, unsigned int threads) {
+		size_t triangleCount = indexCount / 3;
+		VertexScores scores;
+		if (triangleCount <= OPTIMIZE_CHUNK) {
+			std::vector<unsigned int> local(vertexCount, ~0u);
+			optimizeChunk(indices, triangleCount, out, local, scores);
+			return;
+		}
+		std::vector<unsigned int> grouped(3 * triangleCount);
+		std::vector<size_t> regions = splitRegions(indices, triangleCount, vertexCount, grouped.data());
+		size_t regionCount = regions.size() - 1;
+		parallelParts(regionCount, std::min(partCount(triangleCount, threads), regionCount), [&](size_t, size_t begin, size_t end) {
+			std::vector<unsigned int> local(vertexCount, ~0u);
+			for (size_t region = begin; region < end; ++region)
+				optimizeChunk(&grouped[3 * regions[region]], regions[region + 1] - regions[region], out + 3 * regions[region], local, scores);
+		});
+	}
+
+	float averageCacheMissRatio(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+		// A vertex is in the FIFO cache if fewer than cacheSize misses happened since it was last loaded.
+		std::vector<size_t> loaded(vertexCount, 0);
+		size_t misses = 0;
+		for (size_t i = 0; i < indexCount; ++i) {
+			size_t& time = loaded[indices[i]];
+			if (time == 0 || misses + 1 - time > cacheSize)
+				time = ++misses;
+		}
+		return indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "tt_cgmath.h"
+
+// Processing of triangle meshes (e.g. earcut output) on the CPU before upload: welding duplicate vertices into an index buffer,
+// area weighted normals and tangents, and triangle order for the post transform vertex cache. Indices are 3 per triangle.
+// threads = 0 uses all hardware threads, meshes too small to be worth it are processed on the calling thread.
+// The results do not depend on the number of threads.
+namespace TT {
+	// Finds duplicate vertices: remap[i] is the new index of vertex i, numbered in order of first appearance. Returns the number of unique vertices.
+	// vertices holds count vertices of stride bytes, starting with a 3 float position. epsilon = 0 merges vertices whose bytes are all equal,
+	// epsilon > 0 those whose positions differ by at most epsilon per axis and whose remaining bytes are equal, vertices with non-finite positions
+	// stay unique. Each vertex merges into the lowest index vertex matching it (and with that into whatever it merges into), so chains of close
+	// vertices can end up further apart.
+	size_t weldVertices(const void* vertices, size_t stride, size_t count, float epsilon, unsigned int* remap, unsigned int threads = 0);
+	// Writes the unique vertices, each the first vertex mapped to its index. out must hold as many vertices as weldVertices() returned.
+	void remapVertices(const void* vertices, size_t stride, size_t count, const unsigned int* remap, void* out);
+	// out[i] = remap[indices[i]], or remap[i] without indices (a triangle list without index buffer). out may be indices.
+	void remapIndices(const unsigned int* indices, size_t indexCount, const unsigned int* remap, unsigned int* out);
+
+	// Vertex normals as the normalized sum of the cross products of the triangles' edges around them, so large triangles weigh more.
+	// Vertices without triangles get zero normals.
+	void computeNormals(const Vec3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, Vec3* normals, unsigned int threads = 0);
+	// Tangents for normal mapping along the u direction of the texture coordinates, area weighted, orthogonalized against the (unit) normals.
+	// w is the handedness, the bitangent is cross(normal, tangent) * w. Vertices without usable texture coordinates get any tangent orthogonal to the normal.
+	void computeTangents(const Vec3* positions, const Vec2* uvs, const Vec3* normals, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		Vec4* tangents, unsigned int threads = 0);
+
+	// Reorders the triangles for the post transform vertex cache with Forsyth's linear speed algorithm (32 entry LRU model).
+	// Large meshes are split into regions of connected triangles (whatever their order) that are optimized on worker threads. out must not overlap indices.
+	void optimizeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int* out, unsigned int threads = 0);
+	// Average cache miss ratio: vertices transformed per triangle with a FIFO cache of cacheSize entries, from 3 down to about 0.5 for regular grids.
+	float averageCacheMissRatio(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+}
@@ -1,13 +1,50 @@
 #include "tt_messages.h"
-#include "windont.h"
 #include <cstdio>
+#include <cstdarg>
+#ifdef _WIN32
+#include "windont.h"
 #include <corecrt_wstdio.h>
+#else
+#include <cwchar>
+#include <cstdlib>
+
+// Messages go to stderr where there is no message box or debugger api.
+namespace {
+    enum { MB_OK = 0, MB_ICONINFORMATION = 0, MB_ICONWARNING = 0, MB_ICONEXCLAMATION = 0 };
+    bool IsDebuggerPresent() { return false; }
+    void DebugBreak() {}
+    void ExitProcess(int code) { std::exit(code); }
+    void OutputDebugStringA(const char* message) { std::fputs(message, stderr); }
+    void MessageBoxA(void*, const char* message, const char* title, unsigned int) { std::fprintf(stderr, "%s: %s\n", title, message); }
+    int _vsnwprintf(wchar_t* buffer, size_t size, const wchar_t* fmt, va_list args) {
+        if (buffer)
+            return std::vswprintf(buffer, size, fmt, args);
+        // vswprintf can not measure the output, grow a scratch buffer until it fits.
+        std::wstring scratch(256, L'\0');
+        while (true) {
+            va_list copy;
+            va_copy(copy, args);
+            int result = std::vswprintf(scratch.data(), scratch.size(), fmt, copy);
+            va_end(copy);
+            if (result >= 0 || scratch.size() >= (1u << 24))
+                return result < 0 ? 0 : result;
+            scratch.resize(scratch.size() * 2);
+        }
+    }
+    int _vsnwprintf_s(wchar_t* buffer, size_t size, size_t, const wchar_t* fmt, va_list args) { return std::vswprintf(buffer, size, fmt, args); }
+}
+#define __crt_va_start va_start
+#define __crt_va_end va_end
+#endif
 
 namespace {
     // Caller owns the return value
     char* _formatStr(const std::string_view fmt, va_list args, size_t& size) {
 #pragma warning(suppress:28719)    // 28719
-        size = vsnprintf(nullptr, 0, fmt.data(), args);
+        va_list sizeArgs;
+        va_copy(sizeArgs, args);
+        size = vsnprintf(nullptr, 0, fmt.data(), sizeArgs);
+        va_end(sizeArgs);
 
         char* message = new char[size + 1u];
         vsnprintf(message, size + 1u, fmt.data(), args);
@@ -18,7 +55,10 @@ namespace {
 
     wchar_t* _formatStr(const std::wstring_view fmt, va_list args, size_t& size) {
 #pragma warning(suppress:4996)    // 28719
-        size = _vsnwprintf(nullptr, 0, fmt.data(), args);
+        va_list sizeArgs;
+        va_copy(sizeArgs, args);
+        size = _vsnwprintf(nullptr, 0, fmt.data(), sizeArgs);
+        va_end(sizeArgs);
 
         wchar_t* message = new wchar_t[size + 1u];
         _vsnwprintf_s(message, size + 1u, size + 1u, fmt.data(), args);
@@ -36,7 +76,7 @@ namespace {
 		}
 		else
 			MessageBoxA(0, message, title.data(), flags);
-		delete message;
+		delete[] message;
 	}
 }
 
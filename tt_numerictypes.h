@@ -10,4 +10,14 @@ typedef short i16;
 typedef int i32;
 typedef long long i64;
 typedef float f32;
-typedef double f64;
\ No newline at end of file
+typedef double f64;
+
+// Compact storage types, convert them with the functions in tt_packing.h.
+// IEEE 754 half precision float.
+struct f16 { u16 bits; };
+// [-1, 1] as -32767 to 32767.
+struct snorm16 { i16 value; };
+// [0, 1] as 0 to 255.
+struct unorm8 { u8 value; };
+// Unit vector mapped onto an octahedron and unfolded onto a square, as two snorm16.
+struct octahedral16 { snorm16 x; snorm16 y; };
@@ -0,0 +1,62 @@
+#include "tt_packing.h"
+#include "tt_cgmath_kernels.h"
+
+namespace TT {
+	// Single values go through the array kernels, the bit manipulation for halves is not worth duplicating.
+	f16 toF16(float a) {
+		f16 r;
+		cgmathKernels->floatToF16(&a, &r, 1);
+		return r;
+	}
+
+	float toFloat(f16 a) {
+		float r;
+		cgmathKernels->f16ToFloat(&a, &r, 1);
+		return r;
+	}
+
+	snorm16 toSnorm16(float a) {
+		snorm16 r;
+		cgmathKernels->floatToSnorm16(&a, &r, 1);
+		return r;
+	}
+
+	float toFloat(snorm16 a) {
+		float r;
+		cgmathKernels->snorm16ToFloat(&a, &r, 1);
+		return r;
+	}
+
+	unorm8 toUnorm8(float a) {
+		unorm8 r;
+		cgmathKernels->floatToUnorm8(&a, &r, 1);
+		return r;
+	}
+
+	float toFloat(unorm8 a) {
+		float r;
+		cgmathKernels->unorm8ToFloat(&a, &r, 1);
+		return r;
+	}
+
+	octahedral16 toOctahedral16(const Vec3& unit) {
+		octahedral16 r;
+		cgmathKernels->encodeOctahedral(&unit, &r, 1);
+		return r;
+	}
+
+	Vec3 toVec3(octahedral16 a) {
+		Vec3 r;
+		cgmathKernels->decodeOctahedral(&a, &r, 1);
+		return r;
+	}
+
+	void pack(const float* in, f16* out, size_t count) { cgmathKernels->floatToF16(in, out, count); }
+	void unpack(const f16* in, float* out, size_t count) { cgmathKernels->f16ToFloat(in, out, count); }
+	void pack(const float* in, snorm16* out, size_t count) { cgmathKernels->floatToSnorm16(in, out, count); }
+	void unpack(const snorm16* in, float* out, size_t count) { cgmathKernels->snorm16ToFloat(in, out, count); }
+	void pack(const float* in, unorm8* out, size_t count) { cgmathKernels->floatToUnorm8(in, out, count); }
+	void unpack(const unorm8* in, float* out, size_t count) { cgmathKernels->unorm8ToFloat(in, out, count); }
+	void pack(const Vec3* in, octahedral16* out, size_t count) { cgmathKernels->encodeOctahedral(in, out, count); }
+	void unpack(const octahedral16* in, Vec3* out, size_t count) { cgmathKernels->decodeOctahedral(in, out, count); }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "tt_cgmath.h"
+#include "tt_numerictypes.h"
+
+// Conversions between floats and the compact types of tt_numerictypes.h, e.g. to halve the size of vertex data.
+// The array versions convert 8 values (4 vectors) per step, on the AVX2 path with F16C for halves. in and out must not overlap.
+// Largest errors, all with round to nearest:
+// f16: 2^-11 relative for normal halves (|a| in [6.1e-5, 65504]), below that 2^-25 absolute, larger values become inf.
+// snorm16: 1.54e-5 absolute, inputs are clamped to [-1, 1]. unorm8: 1.97e-3 absolute, inputs are clamped to [0, 1].
+// octahedral16: 0.004 degrees for unit vectors, decoded vectors are normalized.
+// Halves match F16C bit for bit on both paths, NaNs included.
+namespace TT {
+	f16 toF16(float a);
+	float toFloat(f16 a);
+	snorm16 toSnorm16(float a);
+	float toFloat(snorm16 a);
+	unorm8 toUnorm8(float a);
+	float toFloat(unorm8 a);
+	octahedral16 toOctahedral16(const Vec3& unit);
+	Vec3 toVec3(octahedral16 a);
+
+	// An array of Vec can be passed as 4 * count floats.
+	void pack(const float* in, f16* out, size_t count);
+	void unpack(const f16* in, float* out, size_t count);
+	void pack(const float* in, snorm16* out, size_t count);
+	void unpack(const snorm16* in, float* out, size_t count);
+	void pack(const float* in, unorm8* out, size_t count);
+	void unpack(const unorm8* in, float* out, size_t count);
+	void pack(const Vec3* in, octahedral16* out, size_t count);
+	void unpack(const octahedral16* in, Vec3* out, size_t count);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Internal to cgmath. The threading helpers of the batch functions that take a threads argument, where 0 means all hardware threads.
+// Work is split into consecutive parts run on plain std::threads, the calling thread runs the first part.
+namespace TT {
+	// Parts smaller than this are not worth a thread.
+	inline constexpr size_t PARALLEL_MIN = 16384;
+
+	// The number of parts to split count items into for up to threads threads.
+	inline size_t partCount(size_t count, unsigned int threads) {
+		if (threads == 0)
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+		return std::min<size_t>(threads, std::max<size_t>(count / PARALLEL_MIN, 1));
+	}
+
+	// Calls f(part, begin, end) for parts consecutive parts of [0, count), each on its own thread.
+	template<typename F> void parallelParts(size_t count, size_t parts, F&& f) {
+		std::vector<std::thread> workers;
+		for (size_t part = 1; part < parts; ++part)
+			workers.emplace_back([&f, part, parts, count] { f(part, count * part / parts, count * (part + 1) / parts); });
+		f(0, 0, count / parts);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	// Calls f(begin, end) on consecutive parts of [0, count), in parallel on up to threads threads.
+	template<typename F> void parallelFor(size_t count, unsigned int threads, F&& f) {
+		parallelParts(count, partCount(count, threads), [&f](size_t, size_t begin, size_t end) { f(begin, end); });
+	}
+}
@@ -0,0 +1,50 @@
+#include "tt_skinning.h"
+#include "tt_cgmath_kernels.h"
+#include "tt_parallel.h"
+
+namespace TT {
+	namespace {
+		// Positions followed by normals, as skinStreams takes them, offset to the first vertex of a chunk.
+		template<typename T> void streams(T* const positions[3], T* const normals[3], size_t offset, T* out[6]) {
+			for (int c = 0; c < 3; ++c) {
+				out[c] = positions[c] + offset;
+				out[3 + c] = normals ? normals[c] + offset : nullptr;
+			}
+		}
+	}
+
+	void skin(const Mat44* palette, const u16* joints, const float* weights, const Vec3* positions, const Vec3* normals, Vec3* outPositions, Vec3* outNormals, size_t count) {
+		cgmathKernels->skin(palette, joints, weights, reinterpret_cast<const float*>(positions), reinterpret_cast<const float*>(normals), reinterpret_cast<float*>(outPositions),
+			reinterpret_cast<float*>(outNormals), count);
+	}
+
+	void skin(const Mat44* palette, const u16* joints, const float* weights, const float* const positions[3], const float* const normals[3],
+		float* const outPositions[3], float* const outNormals[3], size_t count) {
+		const float* in[6];
+		float* out[6];
+		streams(positions, normals, 0, in);
+		streams(outPositions, outNormals, 0, out);
+		cgmathKernels->skinStreams(palette, joints, weights, in, out, normals && outNormals, count);
+	}
+
+	void skinParallel(const Mat44* palette, const u16* joints, const float* weights, const Vec3* positions, const Vec3* normals, Vec3* outPositions, Vec3* outNormals,
+		size_t count, unsigned int threads) {
+		bool withNormals = normals && outNormals;
+		parallelFor(count, threads, [&](size_t begin, size_t end) {
+			skin(palette, joints + 4 * begin, weights + 4 * begin, positions + begin, withNormals ? normals + begin : nullptr,
+				outPositions + begin, withNormals ? outNormals + begin : nullptr, end - begin);
+		});
+	}
+
+	void skinParallel(const Mat44* palette, const u16* joints, const float* weights, const float* const positions[3], const float* const normals[3],
+		float* const outPositions[3], float* const outNormals[3], size_t count, unsigned int threads) {
+		bool withNormals = normals && outNormals;
+		parallelFor(count, threads, [&](size_t begin, size_t end) {
+			const float* in[6];
+			float* out[6];
+			streams(positions, withNormals ? normals : nullptr, begin, in);
+			streams(outPositions, withNormals ? outNormals : nullptr, begin, out);
+			cgmathKernels->skinStreams(palette, joints + 4 * begin, weights + 4 * begin, in, out, withNormals, end - begin);
+		});
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "tt_cgmath.h"
+#include "tt_numerictypes.h"
+
+// Linear blend skinning on the CPU, e.g. for export or collision. Each vertex is transformed by the weighted sum of up to 4 matrices
+// from palette, usually inverse bind matrix * joint world matrix per joint. joints and weights hold 4 entries per vertex: weights should
+// sum to 1, unused entries need weight 0 and a valid joint index such as 0. Normals are transformed by the blended matrix and renormalized,
+// which is exact for rotations and uniform scale. normals and outNormals may be null to skip the normals. Outputs must not overlap inputs,
+// Vec3 results have w = 0.
+namespace TT {
+	void skin(const Mat44* palette, const u16* joints, const float* weights, const Vec3* positions, const Vec3* normals, Vec3* outPositions, Vec3* outNormals, size_t count);
+	// The same on separate x, y and z streams, normals and outNormals are null or 3 streams like the positions.
+	void skin(const Mat44* palette, const u16* joints, const float* weights, const float* const positions[3], const float* const normals[3],
+		float* const outPositions[3], float* const outNormals[3], size_t count);
+
+	// Split into chunks skinned on up to threads threads, 0 uses all hardware threads. Small meshes are skinned on the calling thread.
+	void skinParallel(const Mat44* palette, const u16* joints, const float* weights, const Vec3* positions, const Vec3* normals, Vec3* outPositions, Vec3* outNormals,
+		size_t count, unsigned int threads = 0);
+	void skinParallel(const Mat44* palette, const u16* joints, const float* weights, const float* const positions[3], const float* const normals[3],
+		float* const outPositions[3], float* const outNormals[3], size_t count, unsigned int threads = 0);
+}
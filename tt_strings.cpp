@@ -1,7 +1,6 @@
-#pragma once
-
 #include "tt_strings.h"
 #include "tt_messages.h"
+#include <cstring>
 
 namespace TT {
 	size_t find(const std::string_view text, const std::string_view substr, size_t offset) {
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <iterator>
 #include <string_view>
 
 namespace TT {
@@ -0,0 +1,120 @@
+#include "tt_transform_hierarchy.h"
+#include "tt_cgmath_kernels.h"
+#include <cassert>
+
+namespace TT {
+	unsigned int TransformHierarchy::add(unsigned int parent, const Mat44& local) {
+		unsigned int node = (unsigned int)parents.size();
+		assert(parent == NO_PARENT || parent < node);
+		if (parent != NO_PARENT && parent >= node)
+			return NO_PARENT;
+		parents.push_back(parent);
+		flags.push_back(LOCAL_CHANGED);
+		translations.push_back(Vec(0.0f));
+		rotations.push_back(Vec(0.0f));
+		scales.push_back(Vec(1.0f, 1.0f, 1.0f, 0.0f));
+		orders.push_back(ERotateOrder::YXZ);
+		locals.push_back(local);
+		worlds.push_back(local);
+		if (firstDirty > node)
+			firstDirty = node;
+		return node;
+	}
+
+	unsigned int TransformHierarchy::add(unsigned int parent, Vec translate, Vec radians, Vec scale, ERotateOrder order) {
+		unsigned int node = add(parent);
+		if (node != NO_PARENT)
+			setTRS(node, translate, radians, scale, order);
+		return node;
+	}
+
+	void TransformHierarchy::reserve(size_t count) {
+		parents.reserve(count);
+		flags.reserve(count);
+		translations.reserve(count);
+		rotations.reserve(count);
+		scales.reserve(count);
+		orders.reserve(count);
+		locals.reserve(count);
+		worlds.reserve(count);
+	}
+
+	void TransformHierarchy::clear() {
+		parents.clear();
+		flags.clear();
+		translations.clear();
+		rotations.clear();
+		scales.clear();
+		orders.clear();
+		locals.clear();
+		worlds.clear();
+		firstDirty = 0;
+	}
+
+	void TransformHierarchy::markDirty(unsigned int node, unsigned char flag) {
+		flags[node] |= flag;
+		if (firstDirty > node)
+			firstDirty = node;
+	}
+
+	void TransformHierarchy::setLocal(unsigned int node, const Mat44& local) {
+		locals[node] = local;
+		// An explicit matrix replaces a pending TRS.
+		flags[node] &= ~TRS_CHANGED;
+		markDirty(node, LOCAL_CHANGED);
+	}
+
+	void TransformHierarchy::setTRS(unsigned int node, Vec translate, Vec radians, Vec scale, ERotateOrder order) {
+		translations[node] = translate;
+		rotations[node] = radians;
+		scales[node] = scale;
+		orders[node] = order;
+		markDirty(node, TRS_CHANGED);
+	}
+
+	void TransformHierarchy::setTranslation(unsigned int node, Vec translate) {
+		translations[node] = translate;
+		markDirty(node, TRS_CHANGED);
+	}
+
+	void TransformHierarchy::setRotation(unsigned int node, Vec radians) {
+		rotations[node] = radians;
+		markDirty(node, TRS_CHANGED);
+	}
+
+	void TransformHierarchy::setScale(unsigned int node, Vec scale) {
+		scales[node] = scale;
+		markDirty(node, TRS_CHANGED);
+	}
+
+	size_t TransformHierarchy::update() {
+		const size_t count = parents.size();
+		const size_t first = firstDirty;
+		firstDirty = count;
+		if (first >= count)
+			return 0;
+
+		// Pass 1 only reads parent indices and flags (5 bytes per node) to find the changed subtrees. Parents come first,
+		// so a parent's UPDATED flag is final when its children are visited. Flags of nodes before first are stale and are not read.
+		pending.clear();
+		const unsigned int* parent = parents.data();
+		unsigned char* flag = flags.data();
+		for (size_t i = first; i < count; ++i) {
+			unsigned int p = parent[i];
+			unsigned char f = flag[i];
+			bool changed = (f & (LOCAL_CHANGED | TRS_CHANGED)) || (p != NO_PARENT && p >= first && (flag[p] & UPDATED));
+			if (!changed) {
+				flag[i] = 0;
+				continue;
+			}
+			if (f & TRS_CHANGED)
+				locals[i] = Mat44::TRS(translations[i], rotations[i], scales[i], orders[i]);
+			flag[i] = UPDATED;
+			pending.push_back((unsigned int)i);
+		}
+
+		// Pass 2 multiplies in increasing node order, so every parent is final before its children read it.
+		cgmathKernels->multiplyHierarchy(locals.data(), parent, worlds.data(), pending.data(), pending.size());
+		return pending.size();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include "tt_cgmath.h"
+
+namespace TT {
+	// Data oriented tree of transforms. Every property is an array indexed by node and parents are always stored before their children,
+	// so update() recomputes the world matrices in one forward pass, skipping nodes whose local transform and ancestors did not change.
+	// World matrices follow Mat44::operator* conventions: world = local * parent world.
+	struct TransformHierarchy {
+		static constexpr unsigned int NO_PARENT = ~0u;
+
+		// The parent must already exist, which keeps the nodes in topological order. Returns the new node's index, or asserts and returns
+		// NO_PARENT without adding a node when the parent does not exist.
+		unsigned int add(unsigned int parent = NO_PARENT, const Mat44& local = MAT44_IDENTITY);
+		unsigned int add(unsigned int parent, Vec translate, Vec radians, Vec scale, ERotateOrder order = ERotateOrder::YXZ);
+		void reserve(size_t count);
+		void clear();
+		size_t size() const { return parents.size(); }
+
+		void setLocal(unsigned int node, const Mat44& local);
+		// As Mat44::TRS, the matrix is built in update().
+		void setTRS(unsigned int node, Vec translate, Vec radians, Vec scale, ERotateOrder order = ERotateOrder::YXZ);
+		void setTranslation(unsigned int node, Vec translate);
+		void setRotation(unsigned int node, Vec radians);
+		void setScale(unsigned int node, Vec scale);
+
+		unsigned int parent(unsigned int node) const { return parents[node]; }
+		// Nodes only set with setLocal() report identity TRS values.
+		Vec translation(unsigned int node) const { return translations[node]; }
+		Vec rotation(unsigned int node) const { return rotations[node]; }
+		Vec scale(unsigned int node) const { return scales[node]; }
+		// Local and world matrices are up to date after update().
+		const Mat44& local(unsigned int node) const { return locals[node]; }
+		const Mat44& world(unsigned int node) const { return worlds[node]; }
+		// All world matrices, e.g. to upload as an instance buffer.
+		const Mat44* worldMatrices() const { return worlds.data(); }
+
+		// Recomputes the world matrices of changed nodes and their descendants, returns the number of nodes recomputed.
+		size_t update();
+
+	private:
+		enum Flags : unsigned char {
+			LOCAL_CHANGED = 1,
+			TRS_CHANGED = 2,
+			// Set on nodes recomputed in the last update(), children read it to inherit the change.
+			UPDATED = 4,
+		};
+
+		std::vector<unsigned int> parents;
+		std::vector<unsigned char> flags;
+		std::vector<Vec> translations;
+		std::vector<Vec> rotations;
+		std::vector<Vec> scales;
+		std::vector<ERotateOrder> orders;
+		std::vector<Mat44> locals;
+		std::vector<Mat44> worlds;
+		// Nodes to recompute, collected by update() so the multiplies run as one tight loop.
+		std::vector<unsigned int> pending;
+		// Nodes before this one are clean.
+		size_t firstDirty = 0;
+
+		void markDirty(unsigned int node, unsigned char flag);
+	};
+}